@@ -99,15 +99,55 @@ static void __far *ne_dos_calloc(uint32_t count, uint32_t size)
     return p;
 }
 
+/*
+ * ne_dos_largest_free - size in bytes of the largest free conventional
+ * memory block: AH=48h with BX=FFFFh always fails and returns the largest
+ * available paragraph count in BX.
+ */
+static uint32_t ne_dos_largest_free(void)
+{
+    union REGS   r;
+    struct SREGS sr;
+
+    r.h.ah = 0x48;
+    r.x.bx = 0xFFFFu;
+    intdosx(&r, &r, &sr);
+
+    return (uint32_t)r.x.bx << 4;
+}
+
 #define NE_MALLOC(sz)      ne_dos_alloc((uint32_t)(sz))
 #define NE_CALLOC(n, sz)   ne_dos_calloc((uint32_t)(n), (uint32_t)(sz))
 #define NE_FREE(p)         ne_dos_free(p)
+#define NE_LARGEST_FREE()  ne_dos_largest_free()
+
+#elif defined(NE_ALLOC_STATS) /* POSIX host, counting allocations */
+
+/*
+ * Building with -DNE_ALLOC_STATS counts every NE_MALLOC / NE_CALLOC call
+ * and the bytes requested, so benchmarks can report allocations per
+ * operation.  The program must define both counters exactly once
+ * (tests/bench_ne_load.c does).  The counters are not thread-safe.
+ */
+extern unsigned long ne_alloc_calls;  /* NE_MALLOC + NE_CALLOC calls  */
+extern unsigned long ne_alloc_bytes;  /* bytes requested by those calls */
+
+#define NE_MALLOC(sz)      (ne_alloc_calls++, \
+                            ne_alloc_bytes += (unsigned long)(sz), \
+                            malloc((size_t)(sz)))
+#define NE_CALLOC(n, sz)   (ne_alloc_calls++, \
+                            ne_alloc_bytes += (unsigned long)(n) * \
+                                              (unsigned long)(sz), \
+                            calloc((size_t)(n), (size_t)(sz)))
+#define NE_FREE(p)         free(p)
+#define NE_LARGEST_FREE()  0x100000uL    /* host: 1 MB simulated */
 
 #else /* POSIX host */
 
 #define NE_MALLOC(sz)      malloc((size_t)(sz))
 #define NE_CALLOC(n, sz)   calloc((size_t)(n), (size_t)(sz))
 #define NE_FREE(p)         free(p)
+#define NE_LARGEST_FREE()  0x100000uL    /* host: 1 MB simulated */
 
 #endif /* __WATCOMC__ */
 
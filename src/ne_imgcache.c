@@ -0,0 +1,341 @@
+/*
+ * ne_imgcache.c - Parsed NE image cache implementation
+ *
+ * A small fixed table of NEImgCacheEntry slots searched linearly by path.
+ * File identity comes from stat(); the NE header CRC is read with two
+ * small reads when NE_IMGCACHE_CHECK_CRC is set.
+ */
+
+#include "ne_imgcache.h"
+#include "ne_dosalloc.h"
+
+#include <string.h>
+#include <sys/stat.h>   /* available on both Open Watcom and POSIX hosts */
+
+/* -------------------------------------------------------------------------
+ * Internal helpers
+ * ---------------------------------------------------------------------- */
+
+/* Read a little-endian uint32 from a buffer position */
+static uint32_t ic_read_u32(const uint8_t *p)
+{
+    return (uint32_t)(p[0]
+                    | ((uint32_t)p[1] <<  8)
+                    | ((uint32_t)p[2] << 16)
+                    | ((uint32_t)p[3] << 24));
+}
+
+/*
+ * file_identity - fetch the size / mtime key parts for 'path'.
+ */
+static int file_identity(const char *path, uint32_t *size, long *mtime)
+{
+    struct stat st;
+
+    if (stat(path, &st) != 0 || st.st_size <= 0)
+        return NE_IMGCACHE_ERR_IO;
+
+    *size  = (uint32_t)st.st_size;
+    *mtime = (long)st.st_mtime;
+    return NE_IMGCACHE_OK;
+}
+
+/*
+ * file_ne_crc - read the CRC field of the NE header without loading the
+ * whole file: the MZ e_lfanew word locates the NE header, whose CRC sits
+ * at offset 0x08.
+ */
+static int file_ne_crc(const char *path, uint32_t *crc)
+{
+    FILE    *fp;
+    uint8_t  b[4];
+    uint32_t ne_off;
+    int      ok;
+
+    fp = fopen(path, "rb");
+    if (!fp)
+        return NE_IMGCACHE_ERR_IO;
+
+    ok = fseek(fp, 0x3CL, SEEK_SET) == 0 && fread(b, 1, 4, fp) == 4;
+    if (ok) {
+        ne_off = ic_read_u32(b);
+        ok = fseek(fp, (long)ne_off + 0x08L, SEEK_SET) == 0 &&
+             fread(b, 1, 4, fp) == 4;
+    }
+    fclose(fp);
+
+    if (!ok)
+        return NE_IMGCACHE_ERR_IO;
+    *crc = ic_read_u32(b);
+    return NE_IMGCACHE_OK;
+}
+
+/*
+ * entry_release_all - free every product owned by a slot and mark it free.
+ */
+static void entry_release_all(NEImgCache *cache, NEImgCacheEntry *e)
+{
+    if (!e->in_use)
+        return;
+
+    ne_export_free(&e->exports);
+    ne_reloc_plan_free(&e->plan);
+    ne_reloc_free(&e->relocs);
+    ne_free(&e->parser);
+    ne_image_close(&e->image);
+    memset(e, 0, sizeof(*e));
+    cache->count--;
+}
+
+/*
+ * entry_load - open, parse and index the file at 'path' into slot 'e'.
+ */
+static int entry_load(NEImgCacheEntry *e, const char *path,
+                      uint32_t size, long mtime)
+{
+    int rc;
+
+    memset(e, 0, sizeof(*e));
+
+    rc = ne_image_open(path, &e->image);
+    if (rc == NE_ERR_ALLOC)
+        return NE_IMGCACHE_ERR_ALLOC;
+    if (rc != NE_OK)
+        return NE_IMGCACHE_ERR_IO;
+
+    rc = ne_parse_image(&e->image, &e->parser);
+    if (rc != NE_OK) {
+        ne_image_close(&e->image);
+        return (rc == NE_ERR_ALLOC) ? NE_IMGCACHE_ERR_ALLOC
+                                    : NE_IMGCACHE_ERR_FORMAT;
+    }
+
+    /* One structural sweep per file identity; a failing image still
+     * loads, just without the trusted fast path */
+    e->validated = ne_validate_parsed(&e->parser, e->image.data,
+                                      e->image.len, NULL) == NE_VALIDATE_OK;
+
+    rc = ne_reloc_parse(e->image.data, e->image.len, &e->parser, &e->relocs);
+    if (rc == NE_RELOC_OK)
+        rc = ne_reloc_plan_build(e->image.data, e->image.len, &e->parser,
+                                 &e->relocs, &e->plan);
+    if (rc == NE_RELOC_OK)
+        rc = ne_export_build_parsed(&e->parser, NE_EXPORT_NAMES,
+                                    &e->exports);
+    if (rc != NE_OK) {
+        ne_reloc_plan_free(&e->plan);
+        ne_reloc_free(&e->relocs);
+        ne_free(&e->parser);
+        ne_image_close(&e->image);
+        return (rc == NE_RELOC_ERR_ALLOC || rc == NE_IMPEXP_ERR_ALLOC)
+               ? NE_IMGCACHE_ERR_ALLOC : NE_IMGCACHE_ERR_FORMAT;
+    }
+
+    strncpy(e->path, path, NE_IMGCACHE_PATH_MAX - 1u);
+    e->path[NE_IMGCACHE_PATH_MAX - 1u] = '\0';
+    e->file_size = size;
+    e->mtime     = mtime;
+    e->crc32     = e->parser.header.crc32;
+    e->in_use    = 1;
+    return NE_IMGCACHE_OK;
+}
+
+/*
+ * find_slot - pick a free slot, or evict the least recently used
+ * unreferenced entry.  Returns NULL when every slot is referenced.
+ */
+static NEImgCacheEntry *find_slot(NEImgCache *cache)
+{
+    NEImgCacheEntry *victim = NULL;
+    uint16_t i;
+
+    for (i = 0; i < cache->capacity; i++) {
+        NEImgCacheEntry *e = &cache->entries[i];
+        if (!e->in_use)
+            return e;
+        if (e->ref_count == 0 &&
+            (!victim || e->last_use < victim->last_use))
+            victim = e;
+    }
+
+    if (victim) {
+        entry_release_all(cache, victim);
+        cache->evictions++;
+    }
+    return victim;
+}
+
+/* -------------------------------------------------------------------------
+ * ne_imgcache_init / ne_imgcache_free
+ * ---------------------------------------------------------------------- */
+
+int ne_imgcache_init(NEImgCache *cache, uint16_t capacity, uint16_t flags)
+{
+    if (!cache || capacity == 0)
+        return NE_IMGCACHE_ERR_NULL;
+
+    memset(cache, 0, sizeof(*cache));
+
+    cache->entries = (NEImgCacheEntry *)NE_CALLOC(capacity,
+                                                  sizeof(NEImgCacheEntry));
+    if (!cache->entries)
+        return NE_IMGCACHE_ERR_ALLOC;
+
+    cache->capacity    = capacity;
+    cache->flags       = flags;
+    cache->initialized = 1;
+    return NE_IMGCACHE_OK;
+}
+
+void ne_imgcache_free(NEImgCache *cache)
+{
+    uint16_t i;
+
+    if (!cache)
+        return;
+
+    if (cache->entries) {
+        for (i = 0; i < cache->capacity; i++)
+            entry_release_all(cache, &cache->entries[i]);
+        NE_FREE(cache->entries);
+    }
+
+    memset(cache, 0, sizeof(*cache));
+}
+
+/* -------------------------------------------------------------------------
+ * ne_imgcache_acquire / ne_imgcache_release
+ * ---------------------------------------------------------------------- */
+
+int ne_imgcache_acquire(NEImgCache             *cache,
+                        const char             *path,
+                        const NEImgCacheEntry **out)
+{
+    NEImgCacheEntry *slot;
+    uint32_t size;
+    uint32_t crc = 0;
+    long     mtime;
+    uint16_t i;
+    int      rc;
+
+    if (!cache || !cache->initialized || !path || !out)
+        return NE_IMGCACHE_ERR_NULL;
+
+    *out = NULL;
+
+    /* The key is stored in a fixed buffer; a truncated one never matches */
+    if (strlen(path) >= NE_IMGCACHE_PATH_MAX)
+        return NE_IMGCACHE_ERR_PATH;
+
+    rc = file_identity(path, &size, &mtime);
+    if (rc != NE_IMGCACHE_OK)
+        return rc;
+    if ((cache->flags & NE_IMGCACHE_CHECK_CRC) &&
+        file_ne_crc(path, &crc) != NE_IMGCACHE_OK)
+        return NE_IMGCACHE_ERR_IO;
+
+    cache->tick++;
+
+    for (i = 0; i < cache->capacity; i++) {
+        NEImgCacheEntry *e = &cache->entries[i];
+
+        if (!e->in_use || e->stale ||
+            strncmp(e->path, path, NE_IMGCACHE_PATH_MAX) != 0)
+            continue;
+
+        if (e->file_size == size && e->mtime == mtime &&
+            (!(cache->flags & NE_IMGCACHE_CHECK_CRC) || e->crc32 == crc)) {
+            e->ref_count++;
+            e->last_use = cache->tick;
+            cache->hits++;
+            *out = e;
+            return NE_IMGCACHE_OK;
+        }
+
+        /*
+         * The file changed on disk.  Holders of the old entry keep their
+         * view; it is freed when the last of them releases it.
+         */
+        if (e->ref_count == 0)
+            entry_release_all(cache, e);
+        else
+            e->stale = 1;
+    }
+
+    cache->misses++;
+
+    slot = find_slot(cache);
+    if (!slot)
+        return NE_IMGCACHE_ERR_FULL;
+
+    rc = entry_load(slot, path, size, mtime);
+    if (rc != NE_IMGCACHE_OK)
+        return rc;
+
+    slot->ref_count = 1;
+    slot->last_use  = cache->tick;
+    cache->count++;
+    *out = slot;
+    return NE_IMGCACHE_OK;
+}
+
+int ne_imgcache_release(NEImgCache *cache, const NEImgCacheEntry *entry)
+{
+    NEImgCacheEntry *e;
+
+    if (!cache || !cache->initialized || !entry)
+        return NE_IMGCACHE_ERR_NULL;
+
+    if (entry < cache->entries ||
+        entry >= cache->entries + cache->capacity)
+        return NE_IMGCACHE_ERR_NOT_FOUND;
+
+    e = &cache->entries[entry - cache->entries];
+    if (!e->in_use || e->ref_count == 0)
+        return NE_IMGCACHE_ERR_NOT_FOUND;
+
+    if (--e->ref_count == 0 && e->stale)
+        entry_release_all(cache, e);
+    return NE_IMGCACHE_OK;
+}
+
+/* -------------------------------------------------------------------------
+ * ne_imgcache_purge
+ * ---------------------------------------------------------------------- */
+
+int ne_imgcache_purge(NEImgCache *cache)
+{
+    uint16_t i;
+    int      freed = 0;
+
+    if (!cache || !cache->initialized)
+        return NE_IMGCACHE_ERR_NULL;
+
+    for (i = 0; i < cache->capacity; i++) {
+        NEImgCacheEntry *e = &cache->entries[i];
+        if (e->in_use && e->ref_count == 0) {
+            entry_release_all(cache, e);
+            freed++;
+        }
+    }
+    return freed;
+}
+
+/* -------------------------------------------------------------------------
+ * ne_imgcache_strerror
+ * ---------------------------------------------------------------------- */
+
+const char *ne_imgcache_strerror(int err)
+{
+    switch (err) {
+    case NE_IMGCACHE_OK:            return "success";
+    case NE_IMGCACHE_ERR_NULL:      return "NULL argument";
+    case NE_IMGCACHE_ERR_ALLOC:     return "memory allocation failure";
+    case NE_IMGCACHE_ERR_IO:        return "file cannot be opened or examined";
+    case NE_IMGCACHE_ERR_FORMAT:    return "file is not a valid NE image";
+    case NE_IMGCACHE_ERR_FULL:      return "all cache slots are referenced";
+    case NE_IMGCACHE_ERR_NOT_FOUND: return "entry not held by this cache";
+    case NE_IMGCACHE_ERR_PATH:      return "path too long";
+    default:                        return "unknown error";
+    }
+}
@@ -0,0 +1,183 @@
+/*
+ * ne_imgcache.h - Parsed NE image cache
+ *
+ * Keeps the immutable products of loading an NE file - the mapped file
+ * image, the parsed header and segment table, the relocation tables and
+ * the export table - so that a module which is loaded, freed and loaded
+ * again does not re-read and re-parse its file each time.
+ *
+ * Entries are keyed by file identity: path, file size and modification
+ * time, plus (optionally) the CRC field of the NE header.  A repeated
+ * acquire of an unchanged file is a reference-counted table lookup.
+ * Released entries stay cached until they are evicted (least recently
+ * used first, when the table is full), purged, or found to be stale.
+ *
+ * On the POSIX host the image is memory-mapped, so a file that is updated
+ * by replacing it (new directory entry) is safe while old entries are
+ * still held, but one rewritten in place is not: keep the usual deploy
+ * practice of writing a new file and renaming it over the old one.
+ *
+ * Each image is checked once with ne_validate_image() when it is loaded.
+ * The verdict is kept with the entry, so it is keyed by the same file
+ * identity.  When the image passes, 'parser' trusts the entry's image
+ * (ne_validate_parsed()), and every later ne_load_buffer() /
+ * ne_reloc_parse() of those bytes skips the bounds checks that the
+ * sweep covered.
+ *
+ * Everything reachable from an NEImgCacheEntry is read-only for callers.
+ * Per-instance state (segment images, applied fixups) is still produced
+ * by ne_load_buffer() and ne_reloc_plan_apply() from the cached products;
+ * the entry's relocation plan is built once, so later loads of the same
+ * file do not walk fixup chains again.
+ *
+ * Reference: Microsoft "New Executable" format specification.
+ */
+
+#ifndef NE_IMGCACHE_H
+#define NE_IMGCACHE_H
+
+#include "ne_parser.h"
+#include "ne_reloc.h"
+#include "ne_impexp.h"
+#include "ne_validate.h"
+
+/* -------------------------------------------------------------------------
+ * Error codes
+ * ---------------------------------------------------------------------- */
+#define NE_IMGCACHE_OK            0
+#define NE_IMGCACHE_ERR_NULL     -1   /* NULL pointer argument              */
+#define NE_IMGCACHE_ERR_ALLOC    -2   /* memory allocation failure          */
+#define NE_IMGCACHE_ERR_IO       -3   /* file cannot be opened or stat'ed   */
+#define NE_IMGCACHE_ERR_FORMAT   -4   /* file is not a valid NE image       */
+#define NE_IMGCACHE_ERR_FULL     -5   /* every slot is referenced           */
+#define NE_IMGCACHE_ERR_NOT_FOUND -6  /* entry does not belong to cache     */
+#define NE_IMGCACHE_ERR_PATH     -7   /* path too long for the cache key    */
+
+/* -------------------------------------------------------------------------
+ * Configuration
+ * ---------------------------------------------------------------------- */
+#define NE_IMGCACHE_DEFAULT_CAP  16u  /* default number of cached images    */
+#define NE_IMGCACHE_PATH_MAX    128u  /* max path length incl. NUL (DOS)    */
+
+/* Flags for ne_imgcache_init() */
+#define NE_IMGCACHE_CHECK_CRC  0x0001u /* also compare the NE header CRC    */
+
+/* -------------------------------------------------------------------------
+ * Cache entry
+ * ---------------------------------------------------------------------- */
+
+/*
+ * NEImgCacheEntry - one cached NE image and its parsed products.
+ *
+ * 'parser' borrows its tables from 'image' (see ne_parse_image()).
+ * An entry with ref_count 0 is still valid but may be evicted at the next
+ * acquire.  'stale' entries were superseded by a newer file on disk; they
+ * are freed as soon as their last reference is released.
+ */
+typedef struct {
+    char            path[NE_IMGCACHE_PATH_MAX]; /* key: file path           */
+    uint32_t        file_size; /* key: size in bytes at acquire time       */
+    long            mtime;     /* key: modification time at acquire time   */
+    uint32_t        crc32;     /* key: NE header CRC field                 */
+
+    NEImage         image;     /* shared read-only file image              */
+    NEParserContext parser;    /* header, segment table and tables         */
+    NERelocContext  relocs;    /* per-segment relocation records           */
+    NERelocPlan     plan;      /* relocs compiled with chains unrolled     */
+    NEExportTable   exports;   /* export table                             */
+    int             validated; /* ne_validate_image() verdict: non-zero ok */
+
+    uint16_t        ref_count; /* outstanding acquires                     */
+    uint32_t        last_use;  /* LRU stamp (cache tick of last acquire)   */
+    int             in_use;    /* non-zero when the slot holds an image    */
+    int             stale;     /* non-zero once superseded on disk         */
+} NEImgCacheEntry;
+
+/* -------------------------------------------------------------------------
+ * Cache context
+ * ---------------------------------------------------------------------- */
+
+/*
+ * NEImgCache - fixed-capacity image cache.
+ *
+ * One instance is meant to be shared by the module loads of a process;
+ * ne_modgraph_build_cached() takes its module files from one.  Not
+ * thread-safe: acquire and release from one thread at a time.
+ * Initialise with ne_imgcache_init(); release with ne_imgcache_free().
+ */
+typedef struct {
+    NEImgCacheEntry *entries;   /* heap-allocated array [0..capacity-1]    */
+    uint16_t         capacity;  /* total slots                             */
+    uint16_t         count;     /* slots currently holding an image        */
+    uint16_t         flags;     /* NE_IMGCACHE_* flags                     */
+    uint32_t         tick;      /* monotonically increasing LRU clock      */
+
+    uint32_t         hits;      /* acquires served from the cache          */
+    uint32_t         misses;    /* acquires that had to load the file      */
+    uint32_t         evictions; /* unreferenced entries dropped for space  */
+
+    int              initialized; /* non-zero after successful init        */
+} NEImgCache;
+
+/* -------------------------------------------------------------------------
+ * Public API
+ * ---------------------------------------------------------------------- */
+
+/*
+ * ne_imgcache_init - initialise *cache with 'capacity' slots.
+ *
+ * 'capacity' must be > 0 (NE_IMGCACHE_DEFAULT_CAP is a reasonable value).
+ * 'flags' is a combination of NE_IMGCACHE_* flags.
+ *
+ * Returns NE_IMGCACHE_OK on success.  Call ne_imgcache_free() when done.
+ */
+int ne_imgcache_init(NEImgCache *cache, uint16_t capacity, uint16_t flags);
+
+/*
+ * ne_imgcache_free - release every cached image, referenced or not.
+ * Safe to call on a zeroed context and on NULL.
+ */
+void ne_imgcache_free(NEImgCache *cache);
+
+/*
+ * ne_imgcache_acquire - return the cached products for the file at 'path'.
+ *
+ * If an entry with the same path, size and modification time (and CRC,
+ * with NE_IMGCACHE_CHECK_CRC) exists, its reference count is incremented
+ * and it is returned.  Otherwise the file is opened with ne_image_open(),
+ * parsed in zero-copy mode, its relocation and export tables are built,
+ * and the result is inserted, evicting the least recently used
+ * unreferenced entry if the cache is full.
+ *
+ * On success *out points at the entry; it stays valid until the matching
+ * ne_imgcache_release().
+ *
+ * Paths of NE_IMGCACHE_PATH_MAX bytes or more are rejected with
+ * NE_IMGCACHE_ERR_PATH, since the entry could not be found again by them.
+ *
+ * Returns NE_IMGCACHE_OK or a negative NE_IMGCACHE_ERR_* code.
+ */
+int ne_imgcache_acquire(NEImgCache             *cache,
+                        const char             *path,
+                        const NEImgCacheEntry **out);
+
+/*
+ * ne_imgcache_release - drop one reference taken by ne_imgcache_acquire().
+ *
+ * The entry stays cached for the next acquire unless it is stale.
+ * Returns NE_IMGCACHE_OK, NE_IMGCACHE_ERR_NULL or NE_IMGCACHE_ERR_NOT_FOUND.
+ */
+int ne_imgcache_release(NEImgCache *cache, const NEImgCacheEntry *entry);
+
+/*
+ * ne_imgcache_purge - free every unreferenced entry.
+ * Returns the number of entries freed, or NE_IMGCACHE_ERR_NULL.
+ */
+int ne_imgcache_purge(NEImgCache *cache);
+
+/*
+ * ne_imgcache_strerror - return a static string describing error code 'err'.
+ */
+const char *ne_imgcache_strerror(int err);
+
+#endif /* NE_IMGCACHE_H */
@@ -2,9 +2,10 @@
  * ne_impexp.c - NE (New Executable) import/export resolution implementation
  *
  * Implements Step 5 of the WinDOS kernel-replacement roadmap.
- * Parses the NE entry table and resident name table to build per-module
- * export tables, performs ordinal- and name-based import resolution, and
- * maintains a shared stub-tracking table for unresolved imports.
+ * Parses the NE entry table and names it from the parser's name index to
+ * build per-module export tables, performs ordinal- and name-based import
+ * resolution, and maintains a shared stub-tracking table for unresolved
+ * imports.
  */
 
 #include "ne_impexp.h"
@@ -121,7 +122,7 @@ static uint16_t fill_export_entries(const uint8_t *data,
                                        ? (uint16_t)(seg_1based - 1u)
                                        : 0u;
                 out[written].offset  = off;
-                out[written].name[0] = '\0';
+                out[written].name    = "";
 
                 written++;
                 ordinal++;
@@ -142,7 +143,7 @@ static uint16_t fill_export_entries(const uint8_t *data,
                 out[written].ordinal = ordinal;
                 out[written].segment = seg0;
                 out[written].offset  = off;
-                out[written].name[0] = '\0';
+                out[written].name    = "";
 
                 written++;
                 ordinal++;
@@ -155,68 +156,45 @@ static uint16_t fill_export_entries(const uint8_t *data,
 }
 
 /* -------------------------------------------------------------------------
- * Internal helper – attach names from the resident name table
+ * Internal helper – attach names from the parser's name index
  *
- * Scans the resident name table at buf[rnt_abs .. rnt_end) and for each
- * (name, ordinal) pair sets the 'name' field of the matching entry in
- * 'entries[0..count)'.
- *
- * The first entry in the resident name table is the module name (ordinal 0)
- * and is skipped.  All subsequent entries with ordinal > 0 are exports.
+ * Looks each entry's ordinal up with ne_ordinal_to_name() and copies the
+ * names that exist into one pool owned by the table, so a table costs
+ * only the bytes of the names it actually carries.
  * ---------------------------------------------------------------------- */
-static void attach_export_names(const uint8_t *buf,
-                                 uint32_t       rnt_abs,
-                                 uint32_t       rnt_end,
-                                 NEExportEntry *entries,
-                                 uint16_t       count)
+static int attach_export_names(const NEParserContext *parser,
+                               NEExportTable         *tbl)
 {
-    uint32_t pos = rnt_abs;
-    uint8_t  name_len;
-    uint16_t ordinal;
-    uint16_t i;
-    uint8_t  copy_len;
-    char     name_buf[NE_EXPORT_NAME_MAX];
-    int      first = 1; /* flag to skip the module-name entry (ordinal 0) */
+    const char *name;
+    uint32_t    bytes = 0;
+    uint32_t    pos   = 0;
+    size_t      n;
+    uint16_t    i;
 
-    while (pos < rnt_end) {
-        name_len = buf[pos++];
-        if (name_len == 0u)
-            break; /* end-of-table marker */
+    for (i = 0u; i < tbl->count; i++) {
+        name = ne_ordinal_to_name(parser, tbl->entries[i].ordinal);
+        if (name)
+            bytes += (uint32_t)strlen(name) + 1u;
+    }
+    if (bytes == 0u)
+        return NE_IMPEXP_OK;
+    if ((uint32_t)(size_t)bytes != bytes)
+        return NE_IMPEXP_ERR_ALLOC;
 
-        /* Check that the name + 2-byte ordinal fit within the table */
-        if (pos + (uint32_t)name_len + 2u > rnt_end)
-            break;
+    tbl->names = (char *)NE_MALLOC((size_t)bytes);
+    if (!tbl->names)
+        return NE_IMPEXP_ERR_ALLOC;
 
-        /* Copy the name */
-        copy_len = (name_len < (uint8_t)(NE_EXPORT_NAME_MAX - 1u))
-                   ? name_len
-                   : (uint8_t)(NE_EXPORT_NAME_MAX - 1u);
-        memcpy(name_buf, buf + pos, copy_len);
-        name_buf[copy_len] = '\0';
-        pos += name_len;
-
-        /* Read the 2-byte ordinal */
-        ordinal = read_u16le(buf + pos);
-        pos    += 2u;
-
-        /* Skip the module-name entry (ordinal 0 by convention) */
-        if (first) {
-            first = 0;
+    for (i = 0u; i < tbl->count; i++) {
+        name = ne_ordinal_to_name(parser, tbl->entries[i].ordinal);
+        if (!name)
             continue;
-        }
-
-        if (ordinal == 0u)
-            continue; /* defensive: skip any other ordinal-0 entries */
-
-        /* Find the matching entry in the export table and set the name */
-        for (i = 0u; i < count; i++) {
-            if (entries[i].ordinal == ordinal) {
-                strncpy(entries[i].name, name_buf, NE_EXPORT_NAME_MAX - 1u);
-                entries[i].name[NE_EXPORT_NAME_MAX - 1u] = '\0';
-                break;
-            }
-        }
+        n = strlen(name) + 1u;
+        memcpy(tbl->names + pos, name, n);
+        tbl->entries[i].name = tbl->names + pos;
+        pos += (uint32_t)n;
     }
+    return NE_IMPEXP_OK;
 }
 
 /* =========================================================================
@@ -227,11 +205,22 @@ int ne_export_build(const uint8_t        *buf,
                     size_t                len,
                     const NEParserContext *parser,
                     NEExportTable        *tbl)
+{
+    return ne_export_build_parsed(parser,
+                                  (buf && len > 0u) ? NE_EXPORT_NAMES : 0u,
+                                  tbl);
+}
+
+/* =========================================================================
+ * ne_export_build_parsed
+ * ===================================================================== */
+
+int ne_export_build_parsed(const NEParserContext *parser,
+                           uint16_t               flags,
+                           NEExportTable         *tbl)
 {
     uint16_t entry_count;
     uint16_t written;
-    uint32_t rnt_abs;
-    uint32_t rnt_end;
 
     if (!parser || !tbl)
         return NE_IMPEXP_ERR_NULL;
@@ -257,34 +246,145 @@ int ne_export_build(const uint8_t        *buf,
                                   tbl->entries);
     tbl->count = written;
 
-    /* ---- Resident name table (requires the raw buffer) ---- */
-    if (buf && len > 0u
-            && parser->header.resident_name_table_offset != 0u) {
+    /* ---- Names (from the parser's name index, when asked for) ---- */
+    if ((flags & NE_EXPORT_NAMES) && parser->names.count > 0u) {
+        if (attach_export_names(parser, tbl) != NE_IMPEXP_OK) {
+            ne_export_free(tbl);
+            return NE_IMPEXP_ERR_ALLOC;
+        }
+    }
 
-        rnt_abs = parser->ne_offset
-                  + parser->header.resident_name_table_offset;
+    /* Without memory for the index, lookups fall back to scanning */
+    (void)ne_export_index(tbl);
 
-        /* The entry table immediately follows the resident name table in a
-         * well-formed NE file; use that as the upper bound.  Fall back to
-         * the buffer length if the entry table offset is not set. */
-        if (parser->header.entry_table_offset != 0u) {
-            rnt_end = parser->ne_offset + parser->header.entry_table_offset;
-        } else {
-            rnt_end = (uint32_t)len;
-        }
+    return NE_IMPEXP_OK;
+}
 
-        if (rnt_end > (uint32_t)len)
-            rnt_end = (uint32_t)len;
+/* =========================================================================
+ * ne_export_index
+ * ===================================================================== */
 
-        if (rnt_abs < rnt_end) {
-            attach_export_names(buf, rnt_abs, rnt_end,
-                                tbl->entries, tbl->count);
-        }
+/* ASCII upper case, independent of the C locale */
+static unsigned char fold_upper(char c)
+{
+    unsigned char u = (unsigned char)c;
+    return (u >= 'a' && u <= 'z') ? (unsigned char)(u - 0x20u) : u;
+}
+
+static int name_eq_nocase(const char *a, const char *b)
+{
+    while (*a && fold_upper(*a) == fold_upper(*b)) {
+        a++;
+        b++;
+    }
+    return fold_upper(*a) == fold_upper(*b);
+}
+
+/* FNV-1a over the upper-cased name */
+static uint32_t name_hash(const char *name)
+{
+    uint32_t h = 2166136261UL;
+
+    for (; *name; name++)
+        h = (h ^ fold_upper(*name)) * 16777619UL;
+    return h;
+}
+
+static int build_ordinal_index(NEExportTable *tbl)
+{
+    uint32_t limit = 0u;
+    uint32_t bytes;
+    uint16_t i;
+
+    for (i = 0u; i < tbl->count; i++) {
+        if ((uint32_t)tbl->entries[i].ordinal + 1u > limit)
+            limit = (uint32_t)tbl->entries[i].ordinal + 1u;
+    }
+    if (limit > (uint32_t)tbl->count * NE_EXPORT_ORD_SPARSE
+                + NE_EXPORT_ORD_SLACK)
+        return NE_IMPEXP_OK;  /* too sparse: keep scanning */
+    bytes = limit * (uint32_t)sizeof(uint16_t);
+    if ((uint32_t)(size_t)bytes != bytes)
+        return NE_IMPEXP_ERR_ALLOC;  /* does not fit a 16-bit size_t */
+
+    tbl->ord_index = (uint16_t *)NE_CALLOC((size_t)limit, sizeof(uint16_t));
+    if (!tbl->ord_index)
+        return NE_IMPEXP_ERR_ALLOC;
+
+    for (i = 0u; i < tbl->count; i++) {
+        uint16_t *slot = &tbl->ord_index[tbl->entries[i].ordinal];
+        if (*slot == 0u)
+            *slot = (uint16_t)(i + 1u);
+    }
+    tbl->ord_limit = limit;
+    return NE_IMPEXP_OK;
+}
+
+static int build_name_index(NEExportTable *tbl)
+{
+    uint32_t named = 0u;
+    uint32_t cap   = 8u;
+    uint32_t bytes;
+    uint32_t mask;
+    uint32_t h;
+    uint16_t i;
+
+    for (i = 0u; i < tbl->count; i++) {
+        if (tbl->entries[i].name && tbl->entries[i].name[0] != '\0')
+            named++;
     }
+    if (named == 0u)
+        return NE_IMPEXP_OK;
+
+    /* At most half full, so probe runs stay short */
+    while (cap < 2u * named)
+        cap <<= 1;
+    bytes = cap * (uint32_t)sizeof(uint16_t);
+    if ((uint32_t)(size_t)bytes != bytes)
+        return NE_IMPEXP_ERR_ALLOC;
 
+    tbl->name_index = (uint16_t *)NE_CALLOC((size_t)cap, sizeof(uint16_t));
+    if (!tbl->name_index)
+        return NE_IMPEXP_ERR_ALLOC;
+
+    /* Inserted in table order, so the first of any duplicates probes first */
+    mask = cap - 1u;
+    for (i = 0u; i < tbl->count; i++) {
+        const char *name = tbl->entries[i].name;
+        if (!name || name[0] == '\0')
+            continue;
+        h = name_hash(name) & mask;
+        while (tbl->name_index[h] != 0u)
+            h = (h + 1u) & mask;
+        tbl->name_index[h] = (uint16_t)(i + 1u);
+    }
+    tbl->name_cap = cap;
     return NE_IMPEXP_OK;
 }
 
+int ne_export_index(NEExportTable *tbl)
+{
+    int rc;
+
+    if (!tbl)
+        return NE_IMPEXP_ERR_NULL;
+
+    NE_FREE(tbl->ord_index);
+    NE_FREE(tbl->name_index);
+    tbl->ord_index  = NULL;
+    tbl->ord_limit  = 0u;
+    tbl->name_index = NULL;
+    tbl->name_cap   = 0u;
+
+    if (!tbl->entries || tbl->count == 0u)
+        return NE_IMPEXP_OK;
+
+    rc = build_ordinal_index(tbl);
+    if (build_name_index(tbl) != NE_IMPEXP_OK)
+        rc = NE_IMPEXP_ERR_ALLOC;
+    return rc;
+}
+
 /* =========================================================================
  * ne_export_free
  * ===================================================================== */
@@ -294,9 +394,45 @@ void ne_export_free(NEExportTable *tbl)
     if (!tbl)
         return;
     NE_FREE(tbl->entries);
+    NE_FREE(tbl->names);
+    NE_FREE(tbl->ord_index);
+    NE_FREE(tbl->name_index);
     memset(tbl, 0, sizeof(*tbl));
 }
 
+/* =========================================================================
+ * ne_export_fingerprint
+ * ===================================================================== */
+
+static uint32_t fnv_u16(uint32_t h, uint16_t v)
+{
+    h = (h ^ (uint8_t)(v & 0xFFu)) * 16777619UL;
+    return (h ^ (uint8_t)(v >> 8)) * 16777619UL;
+}
+
+uint32_t ne_export_fingerprint(const NEExportTable *tbl)
+{
+    uint32_t    h = 2166136261UL;   /* FNV-1a offset basis */
+    const char *p;
+    uint16_t    i;
+
+    if (!tbl)
+        return 0;
+
+    h = fnv_u16(h, tbl->count);
+    for (i = 0u; tbl->entries && i < tbl->count; i++) {
+        const NEExportEntry *e = &tbl->entries[i];
+
+        h = fnv_u16(h, e->ordinal);
+        h = fnv_u16(h, e->segment);
+        h = fnv_u16(h, e->offset);
+        for (p = e->name; p && *p; p++)
+            h = (h ^ (uint8_t)*p) * 16777619UL;
+        h = (h ^ 0u) * 16777619UL;   /* name terminator */
+    }
+    return h ? h : 1u;
+}
+
 /* =========================================================================
  * ne_export_find_by_ordinal
  * ===================================================================== */
@@ -309,6 +445,13 @@ const NEExportEntry *ne_export_find_by_ordinal(const NEExportTable *tbl,
     if (!tbl || !tbl->entries)
         return NULL;
 
+    if (tbl->ord_index) {
+        if ((uint32_t)ordinal >= tbl->ord_limit ||
+            tbl->ord_index[ordinal] == 0u)
+            return NULL;
+        return &tbl->entries[tbl->ord_index[ordinal] - 1u];
+    }
+
     for (i = 0u; i < tbl->count; i++) {
         if (tbl->entries[i].ordinal == ordinal)
             return &tbl->entries[i];
@@ -320,6 +463,29 @@ const NEExportEntry *ne_export_find_by_ordinal(const NEExportTable *tbl,
  * ne_export_find_by_name
  * ===================================================================== */
 
+/*
+ * Probe the name index for 'name'.  With 'nocase' the first entry equal
+ * ignoring case is returned, otherwise the first exact match; both sit
+ * in the same probe run because the hash folds case.
+ */
+static const NEExportEntry *find_name_indexed(const NEExportTable *tbl,
+                                              const char          *name,
+                                              int                  nocase)
+{
+    uint32_t mask = tbl->name_cap - 1u;
+    uint32_t h    = name_hash(name) & mask;
+    uint16_t slot;
+
+    while ((slot = tbl->name_index[h]) != 0u) {
+        const NEExportEntry *e = &tbl->entries[slot - 1u];
+        if (nocase ? name_eq_nocase(e->name, name)
+                   : strncmp(e->name, name, NE_EXPORT_NAME_MAX) == 0)
+            return e;
+        h = (h + 1u) & mask;
+    }
+    return NULL;
+}
+
 const NEExportEntry *ne_export_find_by_name(const NEExportTable *tbl,
                                              const char          *name)
 {
@@ -328,6 +494,9 @@ const NEExportEntry *ne_export_find_by_name(const NEExportTable *tbl,
     if (!tbl || !tbl->entries || !name || name[0] == '\0')
         return NULL;
 
+    if (tbl->name_index)
+        return find_name_indexed(tbl, name, 0);
+
     for (i = 0u; i < tbl->count; i++) {
         if (strncmp(tbl->entries[i].name, name, NE_EXPORT_NAME_MAX) == 0)
             return &tbl->entries[i];
@@ -335,6 +504,29 @@ const NEExportEntry *ne_export_find_by_name(const NEExportTable *tbl,
     return NULL;
 }
 
+/* =========================================================================
+ * ne_export_find_by_name_nocase
+ * ===================================================================== */
+
+const NEExportEntry *ne_export_find_by_name_nocase(const NEExportTable *tbl,
+                                                    const char          *name)
+{
+    uint16_t i;
+
+    if (!tbl || !tbl->entries || !name || name[0] == '\0')
+        return NULL;
+
+    if (tbl->name_index)
+        return find_name_indexed(tbl, name, 1);
+
+    for (i = 0u; i < tbl->count; i++) {
+        if (tbl->entries[i].name[0] != '\0' &&
+            name_eq_nocase(tbl->entries[i].name, name))
+            return &tbl->entries[i];
+    }
+    return NULL;
+}
+
 /* =========================================================================
  * ne_import_resolve_ordinal
  * ===================================================================== */
@@ -378,7 +570,7 @@ int ne_import_resolve_name(const NEExportTable *export_tbl,
     if (!export_tbl)
         return NE_IMPEXP_ERR_UNRESOLVED;
 
-    e = ne_export_find_by_name(export_tbl, api_name);
+    e = ne_export_find_by_name_nocase(export_tbl, api_name);
     if (!e)
         return NE_IMPEXP_ERR_UNRESOLVED;
 
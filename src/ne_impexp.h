@@ -37,7 +37,7 @@
 /*
  * Maximum length of an export symbol name, including the NUL terminator.
  * The NE format uses a 1-byte length prefix (max 255 chars), so 256 bytes
- * is the safe upper bound.
+ * is the safe upper bound for fixed-size name buffers.
  */
 #define NE_EXPORT_NAME_MAX  256u
 
@@ -45,24 +45,49 @@
  * NEExportEntry - one exported symbol from a module.
  *
  * 'segment' is the 0-based index into the module's segment array.
- * 'name' is the empty string ("") for ordinal-only exports.
+ * 'name' is never NULL; it is the empty string ("") for ordinal-only
+ * exports.  It points into the owning table's 'names' pool (or at static
+ * storage for tables built by hand) and is valid until ne_export_free().
  */
 typedef struct {
-    uint16_t ordinal;                  /* 1-based ordinal number               */
-    uint16_t segment;                  /* 0-based segment index                */
-    uint16_t offset;                   /* byte offset within that segment      */
-    char     name[NE_EXPORT_NAME_MAX]; /* export name, or empty string         */
+    uint16_t    ordinal;  /* 1-based ordinal number                       */
+    uint16_t    segment;  /* 0-based segment index                        */
+    uint16_t    offset;   /* byte offset within that segment              */
+    const char *name;     /* export name, or empty string                 */
 } NEExportEntry;
 
+/*
+ * ne_export_index() builds the dense ordinal index while the highest
+ * ordinal + 1 is at most count * NE_EXPORT_ORD_SPARSE + NE_EXPORT_ORD_SLACK
+ * (entry tables number their ordinals consecutively, so real modules are
+ * far below it).  The slack lets a small table with a few high ordinals
+ * keep the index; it costs at most 2 * NE_EXPORT_ORD_SLACK bytes.
+ */
+#define NE_EXPORT_ORD_SPARSE  4u
+#define NE_EXPORT_ORD_SLACK   64u
+
 /*
  * NEExportTable - the complete export table for one loaded module.
  *
- * Entries are kept in ascending ordinal order.
- * Build with ne_export_build(); release with ne_export_free().
+ * Entries are kept in ascending ordinal order.  The names of all entries
+ * are stored back to back in the single 'names' allocation.
+ * Build with ne_export_build_parsed(); release with ne_export_free().
+ *
+ * 'ord_index' maps an ordinal below 'ord_limit' to its entry index + 1
+ * (0: no such export), so ne_export_find_by_ordinal() is one array read.
+ * 'name_index' is an open-addressed hash of the names, folded to upper
+ * case, holding entry index + 1 in 'name_cap' (a power of two) slots.
+ * ne_export_build_parsed() fills both; a table assembled by hand gets
+ * them from ne_export_index() and is scanned linearly until then.
  */
 typedef struct {
     NEExportEntry *entries;  /* heap-allocated array, sorted by ordinal  */
     uint16_t       count;    /* number of valid entries                  */
+    char          *names;    /* heap string pool for entry names, or NULL */
+    uint16_t      *ord_index;/* ordinal -> entry index + 1, or NULL      */
+    uint32_t       ord_limit;/* slots in ord_index (highest ordinal + 1) */
+    uint16_t      *name_index;/* name hash -> entry index + 1, or NULL   */
+    uint32_t       name_cap; /* slots in name_index                      */
 } NEExportTable;
 
 /* -------------------------------------------------------------------------
@@ -123,25 +148,59 @@ typedef struct {
  * ---------------------------------------------------------------------- */
 
 /*
- * ne_export_build - build the export table for a module from its file image.
+ * Flags for ne_export_build_parsed().
  *
- * Parses the entry table (from parser->entry_data / parser->entry_size) and
- * the resident name table (read from buf/len at the absolute offset
- * parser->ne_offset + header.resident_name_table_offset) to populate *tbl
- * with all exported symbols.
+ * NE_EXPORT_NAMES  name each entry from the parser's resident /
+ *                  non-resident name index; without it every export
+ *                  name is an empty string.
+ */
+#define NE_EXPORT_NAMES  0x0001u
+
+/*
+ * ne_export_build_parsed - build the export table for a module from its
+ * parser context.
  *
- * 'buf' may be NULL; in that case the entry table is still parsed but
- * all export names will be empty strings.
+ * Parses the entry table (from parser->entry_data / parser->entry_size)
+ * to populate *tbl with all exported symbols, naming each entry from
+ * parser->names when 'flags' holds NE_EXPORT_NAMES.  The file image is
+ * not needed: everything comes from the parser.
  *
  * Returns NE_IMPEXP_OK on success (tbl->count may be 0 when the module has
  * no exports); caller must call ne_export_free() when done.
  * On failure *tbl is zeroed and no memory is leaked.
  */
+int ne_export_build_parsed(const NEParserContext *parser,
+                           uint16_t               flags,
+                           NEExportTable         *tbl);
+
+/*
+ * ne_export_build - build the export table for a module from its file image.
+ *
+ * Kept for existing callers; equivalent to ne_export_build_parsed() with
+ * NE_EXPORT_NAMES when 'buf' is non-NULL and 'len' non-zero, and with no
+ * flags otherwise.  The bytes of 'buf' are not read: names come from the
+ * parser's name index, which ne_parse_buffer() built from the image.
+ *
+ * Returns as ne_export_build_parsed().
+ */
 int ne_export_build(const uint8_t       *buf,
                     size_t               len,
                     const NEParserContext *parser,
                     NEExportTable        *tbl);
 
+/*
+ * ne_export_index - (re)build the ordinal and name indexes of *tbl after
+ * its entries have been filled in by hand.  Entries need not be sorted;
+ * when an ordinal or name appears twice the first entry wins, as with a
+ * linear scan.
+ *
+ * The ordinal index is skipped for a table whose ordinal range exceeds
+ * NE_EXPORT_ORD_SPARSE times its entry count; lookups then scan.
+ * Returns NE_IMPEXP_OK, NE_IMPEXP_ERR_NULL or NE_IMPEXP_ERR_ALLOC (the
+ * table stays usable without an index).
+ */
+int ne_export_index(NEExportTable *tbl);
+
 /*
  * ne_export_free - release all heap memory owned by *tbl.
  * Safe to call on a zeroed context or NULL.
@@ -149,7 +208,18 @@ int ne_export_build(const uint8_t       *buf,
 void ne_export_free(NEExportTable *tbl);
 
 /*
- * ne_export_find_by_ordinal - look up an export by ordinal.
+ * ne_export_fingerprint - 32-bit FNV-1a hash of every entry's ordinal,
+ * segment, offset and name.  Two tables with the same fingerprint export
+ * the same symbols at the same places; used to stamp bound imports (see
+ * NEBindInfo in ne_reloc.h).
+ *
+ * Returns 0 only for NULL.
+ */
+uint32_t ne_export_fingerprint(const NEExportTable *tbl);
+
+/*
+ * ne_export_find_by_ordinal - look up an export by ordinal: O(1) through
+ * the ordinal index, a linear scan for a table without one.
  *
  * Returns a pointer to the matching entry, or NULL if not found.
  * The pointer is valid until ne_export_free() is called on *tbl.
@@ -165,6 +235,16 @@ const NEExportEntry *ne_export_find_by_ordinal(const NEExportTable *tbl,
 const NEExportEntry *ne_export_find_by_name(const NEExportTable *tbl,
                                              const char          *name);
 
+/*
+ * ne_export_find_by_name_nocase - look up an export by name ignoring ASCII
+ * case, as Windows does for GetProcAddress and imports by name.  When
+ * several exports differ only in case, the first in the table wins.
+ *
+ * Returns a pointer to the matching entry, or NULL if not found.
+ */
+const NEExportEntry *ne_export_find_by_name_nocase(const NEExportTable *tbl,
+                                                    const char          *name);
+
 /* -------------------------------------------------------------------------
  * Public API – import resolution
  * ---------------------------------------------------------------------- */
@@ -185,7 +265,8 @@ int ne_import_resolve_ordinal(const NEExportTable *export_tbl,
                                uint16_t            *out_off);
 
 /*
- * ne_import_resolve_name - resolve a name-based import (case-sensitive).
+ * ne_import_resolve_name - resolve a name-based import (case-insensitive,
+ * see ne_export_find_by_name_nocase()).
  *
  * Looks up 'api_name' in 'export_tbl'.  On success, sets *out_seg and
  * *out_off and returns NE_IMPEXP_OK.
@@ -203,12 +203,13 @@ int ne_kernel_register_exports(NEKernelContext *ctx)
         ctx->exports.entries[i].ordinal = g_catalog[i].ordinal;
         ctx->exports.entries[i].segment = 0u;
         ctx->exports.entries[i].offset  = g_catalog[i].ordinal;
-        strncpy(ctx->exports.entries[i].name, g_catalog[i].name,
-                NE_EXPORT_NAME_MAX - 1u);
-        ctx->exports.entries[i].name[NE_EXPORT_NAME_MAX - 1u] = '\0';
+        ctx->exports.entries[i].name    = g_catalog[i].name;
     }
 
     ctx->exports.count = CATALOG_COUNT;
+
+    /* The catalog is grouped by subsystem, not by ordinal */
+    (void)ne_export_index(&ctx->exports);
     return NE_KERNEL_OK;
 }
 
@@ -334,14 +335,28 @@ int ne_kernel_get_module_filename(NEKernelContext *ctx, uint16_t hModule,
 uint32_t ne_kernel_get_proc_address(NEKernelContext *ctx, uint16_t hModule,
                                      const char *name)
 {
+    const NEExportTable *exports;
     const NEExportEntry *entry;
 
     if (!ctx || !ctx->initialized || !name)
         return 0;
 
-    (void)hModule; /* look up in the KERNEL export table */
+    /* hModule 0 names KERNEL itself; others come from the module table */
+    if (hModule == 0) {
+        exports = &ctx->exports;
+    } else {
+        if (!ctx->modules)
+            return 0;
+        exports = ne_mod_exports(ctx->modules, hModule);
+        if (!exports)
+            return 0;
+    }
 
-    entry = ne_export_find_by_name(&ctx->exports, name);
+    /* As for FindResource, a 16-bit pointer value is a MAKEINTRESOURCE ordinal */
+    if ((uintptr_t)name <= 0xFFFFu)
+        entry = ne_export_find_by_ordinal(exports, (uint16_t)(uintptr_t)name);
+    else
+        entry = ne_export_find_by_name_nocase(exports, name);
     if (entry)
         return ((uint32_t)entry->segment << 16) | entry->offset;
 
@@ -431,19 +446,27 @@ NEGMemHandle ne_kernel_global_realloc(NEKernelContext *ctx,
     if (!blk)
         return NE_GMEM_HANDLE_INVALID;
 
+    /*
+     * Lock the source first: under a heap limit the allocation below may
+     * discard least recently used blocks, and a locked one is never picked.
+     * NULL here means it was already discarded and there is nothing to copy.
+     */
+    old_data = ne_gmem_lock(ctx->gmem, handle);
+    copy_size = (blk->size < new_size) ? blk->size : new_size;
+
     new_handle = ne_gmem_alloc(ctx->gmem, flags, new_size, blk->owner_task);
-    if (new_handle == NE_GMEM_HANDLE_INVALID)
+    if (new_handle == NE_GMEM_HANDLE_INVALID) {
+        if (old_data)
+            ne_gmem_unlock(ctx->gmem, handle);
         return NE_GMEM_HANDLE_INVALID;
+    }
 
-    old_data = ne_gmem_lock(ctx->gmem, handle);
     new_data = ne_gmem_lock(ctx->gmem, new_handle);
-
-    if (old_data && new_data) {
-        copy_size = (blk->size < new_size) ? blk->size : new_size;
+    if (old_data && new_data)
         memcpy(new_data, old_data, (size_t)copy_size);
-    }
 
-    ne_gmem_unlock(ctx->gmem, handle);
+    if (old_data)
+        ne_gmem_unlock(ctx->gmem, handle);
     ne_gmem_unlock(ctx->gmem, new_handle);
     ne_gmem_free(ctx->gmem, handle);
 
@@ -1529,10 +1552,9 @@ NELMemHandle ne_kernel_local_handle(NEKernelContext *ctx, const void *ptr)
 
 uint32_t ne_kernel_global_compact(NEKernelContext *ctx, uint32_t dwMinFree)
 {
-    (void)dwMinFree;
     if (!ctx || !ctx->initialized)
         return 0;
-    return ne_gmem_compact(ctx->gmem);
+    return ne_gmem_compact(ctx->gmem, dwMinFree);
 }
 
 uint16_t ne_kernel_local_compact(NEKernelContext *ctx, uint16_t wMinFree)
@@ -1548,7 +1570,7 @@ uint32_t ne_kernel_get_free_space(NEKernelContext *ctx, uint16_t flags)
     (void)flags;
     if (!ctx || !ctx->initialized)
         return 0;
-    return 0x100000uL; /* 1 MB simulated free space */
+    return ne_gmem_free_space(ctx->gmem);
 }
 
 uint16_t ne_kernel_get_free_system_resources(NEKernelContext *ctx,
@@ -352,7 +352,8 @@ long ne_kernel_llseek(NEKernelContext *ctx, int hFile,
  * ===================================================================== */
 
 /*
- * ne_kernel_get_module_handle - return the handle for a loaded module.
+ * ne_kernel_get_module_handle - return the handle for a loaded module,
+ * matching 'name' ignoring case.
  *
  * Returns a non-zero handle on success or 0 if not found.
  */
@@ -368,7 +369,10 @@ int ne_kernel_get_module_filename(NEKernelContext *ctx, uint16_t hModule,
                                   char *buf, int size);
 
 /*
- * ne_kernel_get_proc_address - look up a named export in a module.
+ * ne_kernel_get_proc_address - look up an export of module 'hModule'
+ * (0 for KERNEL itself).  'name' is either a string, matched ignoring case
+ * as Windows does, or a MAKEINTRESOURCE-style ordinal (pointer value
+ * <= 0xFFFF).
  *
  * Returns a packed seg:offset value on success or 0 on failure.
  */
@@ -905,8 +909,9 @@ NELMemHandle ne_kernel_local_handle(NEKernelContext *ctx, const void *ptr);
 /*
  * ne_kernel_global_compact - compact global memory.
  *
- * 'dwMinFree' is ignored (stub).  Delegates to ne_gmem_compact().
- * Returns the size of the largest free block (currently 0).
+ * Delegates to ne_gmem_compact(), which discards discardable blocks if
+ * needed to reach 'dwMinFree'.  Returns ne_gmem_free_space(): the size of
+ * the largest free block, or the total left under a heap limit.
  */
 uint32_t ne_kernel_global_compact(NEKernelContext *ctx, uint32_t dwMinFree);
 
@@ -921,7 +926,8 @@ uint16_t ne_kernel_local_compact(NEKernelContext *ctx, uint16_t wMinFree);
 /*
  * ne_kernel_get_free_space - return the amount of free memory.
  *
- * 'flags' is ignored.  Stub: returns 0x100000 (1 MB available).
+ * 'flags' is ignored.  Returns ne_gmem_free_space() (1 MB simulated on
+ * the host unless a heap limit is set with ne_gmem_set_limit()).
  */
 uint32_t ne_kernel_get_free_space(NEKernelContext *ctx, uint16_t flags);
 
@@ -2,7 +2,10 @@
  * ne_loader.c - NE (New Executable) segment loader implementation
  *
  * Allocates memory for each NE segment, copies the file-backed data into
- * those buffers, and validates the module entry point.
+ * those buffers, and validates the module entry point.  In lazy mode only
+ * the segments needed at start-up are copied; the rest are materialised on
+ * first use from the borrowed file image.  ne_load_file() reads segment
+ * data in file order, coalescing neighbouring segments into large reads.
  */
 
 #include "ne_loader.h"
@@ -23,30 +26,142 @@ static uint32_t resolve_seg_size(uint16_t raw)
     return (raw == 0) ? 0x10000u : (uint32_t)raw;
 }
 
+/*
+ * Return non-zero when segment 'idx' (0-based) must be resident as soon as
+ * the module is loaded: preload segments, the automatic data segment and
+ * the segments holding the initial CS:IP and SS:SP.
+ */
+static int seg_needed_at_load(const NEHeader *hdr,
+                              const NESegmentDescriptor *sd,
+                              uint16_t idx)
+{
+    uint16_t num = (uint16_t)(idx + 1u);
+
+    if (sd->flags & NE_SEG_PRELOAD)
+        return 1;
+    return num == hdr->auto_data_seg ||
+           num == hdr->initial_cs    ||
+           num == hdr->initial_ss;
+}
+
+/*
+ * Allocate 'n' zeroed bytes for 'loader': from its arena when it has one,
+ * otherwise from the heap.
+ */
+static void *loader_alloc(NELoaderContext *loader, uint32_t n)
+{
+    if (loader->arena)
+        return ne_arena_alloc(loader->arena, n);
+    if ((uint32_t)(size_t)n != n)
+        return NULL;  /* does not fit a 16-bit size_t */
+    return NE_CALLOC(1, (size_t)n);
+}
+
+/*
+ * Allocate and fill the image of one segment whose file_off / data_size /
+ * alloc_size fields have already been validated against 'len'.
+ */
+static int seg_materialize(NELoaderContext *loader, NELoadedSegment *ls,
+                           const uint8_t *buf)
+{
+    ls->data = (uint8_t *)loader_alloc(loader, ls->alloc_size);
+    if (!ls->data)
+        return NE_LOAD_ERR_NOMEM;
+
+    if (ls->data_size > 0)
+        memcpy(ls->data, buf + ls->file_off, ls->data_size);
+    ls->deferred = 0;
+    return NE_LOAD_OK;
+}
+
+/*
+ * Fill file_off / data_size / alloc_size / flags of segment 'idx' from the
+ * segment table and check its file data against a file of 'len' bytes
+ * (skipped when 'trusted': the image passed ne_validate_parsed()).
+ */
+static int seg_describe(const NEParserContext *parser, uint16_t idx,
+                        uint32_t len, int trusted, NELoadedSegment *ls)
+{
+    const NESegmentDescriptor *sd = &parser->segments[idx];
+    uint32_t file_off;
+    uint32_t data_sz;
+    uint32_t alloc_sz;
+
+    /* File byte offset of this segment's data (0 means no file data) */
+    file_off = (sd->offset != 0)
+               ? ((uint32_t)sd->offset << parser->header.align_shift)
+               : 0u;
+
+    /* Actual sizes: 0 in the NE field means 64 KB */
+    data_sz  = resolve_seg_size(sd->length);
+    alloc_sz = resolve_seg_size(sd->min_alloc);
+    /* Allocation must be at least as large as the on-disk image */
+    if (alloc_sz < data_sz)
+        alloc_sz = data_sz;
+
+    /* File-backed segment data must lie within the image */
+    if (!trusted && sd->offset != 0 &&
+        (file_off > len || data_sz > len - file_off))
+        return NE_LOAD_ERR_IO;
+
+    ls->flags      = sd->flags;
+    ls->file_off   = file_off;
+    ls->alloc_size = alloc_sz;
+    ls->data_size  = (sd->offset != 0) ? data_sz : 0u;
+    return NE_LOAD_OK;
+}
+
+/*
+ * Verify that the entry-point CS:IP lies within the bounds of the
+ * designated code segment.  initial_cs == 0 means no entry point
+ * (typical for DLLs), so skip the check in that case.
+ */
+static int check_entry(const NEHeader *hdr, const NELoaderContext *loader)
+{
+    uint16_t cs_idx;
+
+    if (hdr->initial_cs == 0)
+        return NE_LOAD_OK;
+
+    cs_idx = (uint16_t)(hdr->initial_cs - 1u);
+    if (cs_idx >= loader->count)
+        return NE_LOAD_ERR_BOUNDS;
+    if ((uint32_t)hdr->initial_ip >= loader->segments[cs_idx].alloc_size)
+        return NE_LOAD_ERR_BOUNDS;
+    return NE_LOAD_OK;
+}
+
 /* -------------------------------------------------------------------------
  * Core loader
  * ---------------------------------------------------------------------- */
 
-int ne_load_buffer(const uint8_t *buf, size_t len,
-                   const NEParserContext *parser,
-                   NELoaderContext *loader)
+static int load_core(const uint8_t *buf, size_t len,
+                     const NEParserContext *parser,
+                     NELoaderContext *loader,
+                     int lazy,
+                     NEArena *arena)
 {
     const NEHeader *hdr;
     uint16_t i;
+    int      rc;
+    int      trusted;
 
     if (!buf || !parser || !loader)
         return NE_LOAD_ERR_NULL;
 
     memset(loader, 0, sizeof(*loader));
+    loader->arena = arena;
 
-    hdr = &parser->header;
+    hdr     = &parser->header;
+    trusted = ne_parser_trusted(parser, buf, len);
 
     /* Nothing to do when there are no segments */
     if (hdr->segment_count == 0)
         goto validate_entry;
 
-    loader->segments = (NELoadedSegment *)NE_CALLOC(hdr->segment_count,
-                                                 sizeof(NELoadedSegment));
+    loader->segments = (NELoadedSegment *)loader_alloc(loader,
+                           (uint32_t)hdr->segment_count
+                           * (uint32_t)sizeof(NELoadedSegment));
     if (!loader->segments)
         return NE_LOAD_ERR_NOMEM;
 
@@ -55,78 +170,302 @@ int ne_load_buffer(const uint8_t *buf, size_t len,
     for (i = 0; i < hdr->segment_count; i++) {
         const NESegmentDescriptor *sd = &parser->segments[i];
         NELoadedSegment *ls = &loader->segments[i];
-        uint32_t file_off;
-        uint32_t data_sz;
-        uint32_t alloc_sz;
-
-        /* File byte offset of this segment's data (0 means no file data) */
-        file_off = (sd->offset != 0)
-                   ? ((uint32_t)sd->offset << hdr->align_shift)
-                   : 0u;
-
-        /* Actual sizes: 0 in the NE field means 64 KB */
-        data_sz  = resolve_seg_size(sd->length);
-        alloc_sz = resolve_seg_size(sd->min_alloc);
-        /* Allocation must be at least as large as the on-disk image */
-        if (alloc_sz < data_sz)
-            alloc_sz = data_sz;
-
-        ls->flags     = sd->flags;
-        ls->file_off  = file_off;
-        ls->alloc_size = alloc_sz;
-        ls->data_size  = 0;
-
-        /* Allocate and zero-fill the segment buffer */
-        ls->data = (uint8_t *)NE_CALLOC(1, alloc_sz);
-        if (!ls->data) {
+
+        rc = seg_describe(parser, i, (uint32_t)len, trusted, ls);
+        if (rc != NE_LOAD_OK) {
             ne_loader_free(loader);
-            return NE_LOAD_ERR_NOMEM;
+            return rc;
         }
 
-        /* Copy file-backed segment data when the segment has file content */
-        if (sd->offset != 0) {
-            if ((uint32_t)file_off + data_sz > (uint32_t)len) {
-                ne_loader_free(loader);
-                return NE_LOAD_ERR_IO;
-            }
-            memcpy(ls->data, buf + file_off, data_sz);
-            ls->data_size = data_sz;
+        if (lazy && !seg_needed_at_load(hdr, sd, i)) {
+            ls->deferred = 1;
+            loader->deferred_count++;
+            continue;
+        }
+
+        rc = seg_materialize(loader, ls, buf);
+        if (rc != NE_LOAD_OK) {
+            ne_loader_free(loader);
+            return rc;
         }
     }
 
+    if (lazy && loader->deferred_count > 0) {
+        loader->image     = buf;
+        loader->image_len = len;
+    }
+
 validate_entry:
+    rc = check_entry(hdr, loader);
+    if (rc != NE_LOAD_OK)
+        ne_loader_free(loader);
+    return rc;
+}
+
+int ne_load_buffer(const uint8_t *buf, size_t len,
+                   const NEParserContext *parser,
+                   NELoaderContext *loader)
+{
+    return load_core(buf, len, parser, loader, 0, NULL);
+}
+
+int ne_load_buffer_lazy(const uint8_t *buf, size_t len,
+                        const NEParserContext *parser,
+                        NELoaderContext *loader)
+{
+    return load_core(buf, len, parser, loader, 1, NULL);
+}
+
+int ne_load_buffer_arena(const uint8_t *buf, size_t len,
+                         const NEParserContext *parser,
+                         NELoaderContext *loader,
+                         NEArena *arena)
+{
+    if (!arena || !arena->base)
+        return NE_LOAD_ERR_NULL;
+    return load_core(buf, len, parser, loader, 0, arena);
+}
+
+/* -------------------------------------------------------------------------
+ * On-demand materialisation
+ * ---------------------------------------------------------------------- */
+
+int ne_loader_materialize(NELoaderContext *loader, uint16_t seg_idx)
+{
+    NELoadedSegment *ls;
+    int rc;
+
+    if (!loader)
+        return NE_LOAD_ERR_NULL;
+    if (seg_idx >= loader->count || !loader->segments)
+        return NE_LOAD_ERR_BOUNDS;
+
+    ls = &loader->segments[seg_idx];
+    if (!ls->deferred)
+        return NE_LOAD_OK;
+    if (!loader->image)
+        return NE_LOAD_ERR_IO;
+
+    rc = seg_materialize(loader, ls, loader->image);
+    if (rc != NE_LOAD_OK)
+        return rc;
+
+    if (--loader->deferred_count == 0) {
+        /* Nothing left to pull from the image; drop the borrowed view */
+        loader->image     = NULL;
+        loader->image_len = 0;
+    }
+    return NE_LOAD_OK;
+}
+
+/* -------------------------------------------------------------------------
+ * Coalesced streaming loader
+ * ---------------------------------------------------------------------- */
+
+/*
+ * Sort the indices in order[0 .. n-1] by segment file offset.  Segment
+ * tables are short and usually already in file order, so an insertion
+ * sort does close to n comparisons.
+ */
+static void sort_by_file_off(const NELoadedSegment *segs, uint16_t *order,
+                             uint16_t n)
+{
+    uint16_t i, j, v;
+
+    for (i = 1; i < n; i++) {
+        v = order[i];
+        for (j = i; j > 0 && segs[order[j - 1u]].file_off > segs[v].file_off;
+             j--)
+            order[j] = order[j - 1u];
+        order[j] = v;
+    }
+}
+
+/*
+ * Keep a copy of the relocation block that follows segment 'ls' when the
+ * run [start, end) just read into 'run' holds all of it.  A block that
+ * is cut off, or that cannot be copied, is simply not kept; the
+ * relocation parser reads it itself.
+ */
+static void keep_relocs(NELoadedSegment *ls, uint32_t start, uint32_t end,
+                        const uint8_t *run)
+{
+    const uint8_t *p;
+    uint32_t off;
+    uint32_t size;
+
+    if (!(ls->flags & NE_SEG_RELOC) || ls->data_size == 0)
+        return;
+
+    off = ls->file_off + ls->data_size;
+    if (off > end || end - off < 2u)
+        return;
+    p    = run + (off - start);
+    size = 2u + (uint32_t)(p[0] | ((uint16_t)p[1] << 8)) * 8u;
+    if (size > end - off)
+        return;
+
+    ls->relocs = (uint8_t *)NE_MALLOC((size_t)size);
+    if (ls->relocs) {
+        memcpy(ls->relocs, p, (size_t)size);
+        ls->reloc_size = size;
+    }
+}
+
+/*
+ * Read one run of segments order[first .. last] that starts at file
+ * offset 'start' and ends at 'end' with a single read into 'run', then
+ * copy each segment's bytes and relocation block out.  A run of one
+ * segment is read straight into the segment image.
+ */
+static int read_run(NEReadAtFn read_at, void *user,
+                    NELoaderContext *loader, const uint16_t *order,
+                    uint16_t first, uint16_t last,
+                    uint32_t start, uint32_t end, uint8_t *run)
+{
+    NELoadedSegment *ls;
+    uint16_t k;
+
+    loader->reads++;
+
+    if (first == last) {
+        ls = &loader->segments[order[first]];
+        return (read_at(user, ls->file_off, ls->data, (size_t)ls->data_size)
+                == (size_t)ls->data_size) ? NE_LOAD_OK : NE_LOAD_ERR_IO;
+    }
+
+    if (read_at(user, start, run, (size_t)(end - start))
+            != (size_t)(end - start))
+        return NE_LOAD_ERR_IO;
+
+    for (k = first; k <= last; k++) {
+        ls = &loader->segments[order[k]];
+        memcpy(ls->data, run + (ls->file_off - start), (size_t)ls->data_size);
+        keep_relocs(ls, start, end, run);
+    }
+    return NE_LOAD_OK;
+}
+
+int ne_load_stream(NEReadAtFn read_at, void *user, uint32_t file_len,
+                   const NEParserContext *parser,
+                   NELoaderContext *loader)
+{
+    const NEHeader *hdr;
+    uint16_t *order = NULL;
+    uint8_t  *run   = NULL;
+    uint16_t  n     = 0;
+    uint16_t  i, first;
+    uint32_t  start, end;
+    int       rc    = NE_LOAD_OK;
+
+    if (!read_at || !parser || !loader)
+        return NE_LOAD_ERR_NULL;
+
+    memset(loader, 0, sizeof(*loader));
+    hdr = &parser->header;
+
+    if (hdr->segment_count > 0) {
+        loader->segments = (NELoadedSegment *)NE_CALLOC(hdr->segment_count,
+                               sizeof(NELoadedSegment));
+        order = (uint16_t *)NE_MALLOC((size_t)hdr->segment_count
+                                      * sizeof(uint16_t));
+        if (!loader->segments || !order) {
+            rc = NE_LOAD_ERR_NOMEM;
+            goto done;
+        }
+        loader->count = hdr->segment_count;
+    }
+
+    /* Describe and allocate every segment; queue the file-backed ones */
+    for (i = 0; i < loader->count; i++) {
+        NELoadedSegment *ls = &loader->segments[i];
+
+        rc = seg_describe(parser, i, file_len, 0, ls);
+        if (rc != NE_LOAD_OK)
+            goto done;
+        ls->data = (uint8_t *)loader_alloc(loader, ls->alloc_size);
+        if (!ls->data) {
+            rc = NE_LOAD_ERR_NOMEM;
+            goto done;
+        }
+        if (ls->data_size > 0)
+            order[n++] = i;
+    }
+
     /*
-     * Verify that the entry-point CS:IP lies within the bounds of the
-     * designated code segment.  initial_cs == 0 means no entry point
-     * (typical for DLLs), so skip the check in that case.
+     * Walk the segments in file order and grow a run while the next one
+     * starts within NE_LOAD_GAP_MAX bytes of the current end (the gap is
+     * normally the previous segment's relocation records, kept by
+     * read_run()) and the run still fits NE_LOAD_RUN_MAX.  Each run costs
+     * one seek and one read.
      */
-    if (hdr->initial_cs != 0) {
-        uint16_t cs_idx = (uint16_t)(hdr->initial_cs - 1u);
-        if (cs_idx >= loader->count) {
-            ne_loader_free(loader);
-            return NE_LOAD_ERR_BOUNDS;
+    sort_by_file_off(loader->segments, order, n);
+    first = 0;
+    while (first < n && rc == NE_LOAD_OK) {
+        const NELoadedSegment *ls = &loader->segments[order[first]];
+        uint16_t last = first;
+
+        start = ls->file_off;
+        end   = ls->file_off + ls->data_size;
+        while ((uint16_t)(last + 1u) < n) {
+            const NELoadedSegment *nx = &loader->segments[order[last + 1u]];
+            uint32_t nx_end = nx->file_off + nx->data_size;
+
+            if (nx->file_off > end && nx->file_off - end > NE_LOAD_GAP_MAX)
+                break;
+            if (nx_end < end)
+                nx_end = end;   /* overlapping segment inside the run */
+            if (nx_end - start > NE_LOAD_RUN_MAX)
+                break;
+            end = nx_end;
+            last++;
         }
-        if ((uint32_t)hdr->initial_ip >= loader->segments[cs_idx].alloc_size) {
-            ne_loader_free(loader);
-            return NE_LOAD_ERR_BOUNDS;
+
+        /* The bounce buffer is only needed once two segments share a run */
+        if (last != first && !run) {
+            run = (uint8_t *)NE_MALLOC((size_t)NE_LOAD_RUN_MAX);
+            if (!run) {
+                rc = NE_LOAD_ERR_NOMEM;
+                break;
+            }
         }
+        rc = read_run(read_at, user, loader, order, first, last,
+                      start, end, run);
+        first = (uint16_t)(last + 1u);
     }
 
-    return NE_LOAD_OK;
+    if (rc == NE_LOAD_OK)
+        rc = check_entry(hdr, loader);
+
+done:
+    NE_FREE(run);
+    NE_FREE(order);
+    if (rc != NE_LOAD_OK)
+        ne_loader_free(loader);
+    return rc;
 }
 
 /* -------------------------------------------------------------------------
  * File-based entry point
  * ---------------------------------------------------------------------- */
 
+/* NEReadAtFn over a stdio stream */
+static size_t fp_read_at(void *user, uint32_t offset, void *dst, size_t n)
+{
+    FILE *fp = (FILE *)user;
+
+    if (fseek(fp, (long)offset, SEEK_SET) != 0)
+        return 0;
+    return fread(dst, 1, n, fp);
+}
+
 int ne_load_file(const char *path,
                  const NEParserContext *parser,
                  NELoaderContext *loader)
 {
-    FILE    *fp;
-    long     file_len;
-    uint8_t *buf;
-    int      ret;
+    FILE *fp;
+    long  file_len;
+    int   ret;
 
     if (!path || !parser || !loader)
         return NE_LOAD_ERR_NULL;
@@ -135,34 +474,13 @@ int ne_load_file(const char *path,
     if (!fp)
         return NE_LOAD_ERR_IO;
 
-    if (fseek(fp, 0, SEEK_END) != 0) {
-        fclose(fp);
-        return NE_LOAD_ERR_IO;
-    }
-
-    file_len = ftell(fp);
-    if (file_len <= 0) {
+    if (fseek(fp, 0, SEEK_END) != 0 || (file_len = ftell(fp)) <= 0) {
         fclose(fp);
         return NE_LOAD_ERR_IO;
     }
 
-    rewind(fp);
-
-    buf = (uint8_t *)NE_MALLOC((size_t)file_len);
-    if (!buf) {
-        fclose(fp);
-        return NE_LOAD_ERR_NOMEM;
-    }
-
-    if (fread(buf, 1, (size_t)file_len, fp) != (size_t)file_len) {
-        NE_FREE(buf);
-        fclose(fp);
-        return NE_LOAD_ERR_IO;
-    }
+    ret = ne_load_stream(fp_read_at, fp, (uint32_t)file_len, parser, loader);
     fclose(fp);
-
-    ret = ne_load_buffer(buf, (size_t)file_len, parser, loader);
-    NE_FREE(buf);
     return ret;
 }
 
@@ -177,9 +495,12 @@ void ne_loader_free(NELoaderContext *loader)
     if (!loader)
         return;
 
-    if (loader->segments) {
-        for (i = 0; i < loader->count; i++)
+    /* Arena-backed segments go back with ne_arena_free() */
+    if (loader->segments && !loader->arena) {
+        for (i = 0; i < loader->count; i++) {
             NE_FREE(loader->segments[i].data);
+            NE_FREE(loader->segments[i].relocs);
+        }
         NE_FREE(loader->segments);
     }
 
@@ -207,12 +528,13 @@ void ne_loader_print_info(const NELoaderContext *loader,
                 "Idx", "Host Address", "AllocSize", "FileBytes", "Type");
         for (i = 0; i < loader->count; i++) {
             const NELoadedSegment *ls = &loader->segments[i];
-            fprintf(out, "  %-4u  %-18p  %-10lu  %-10lu  %s\n",
+            fprintf(out, "  %-4u  %-18p  %-10lu  %-10lu  %s%s\n",
                     (unsigned)(i + 1u),
                     (void *)ls->data,
                     (unsigned long)ls->alloc_size,
                     (unsigned long)ls->data_size,
-                    (ls->flags & NE_SEG_DATA) ? "DATA" : "CODE");
+                    (ls->flags & NE_SEG_DATA) ? "DATA" : "CODE",
+                    ls->deferred ? " (deferred)" : "");
         }
     }
 
@@ -27,6 +27,18 @@
 #define NE_LOAD_ERR_IO     -3   /* file I/O error or data out of bounds    */
 #define NE_LOAD_ERR_BOUNDS -4   /* entry-point offset outside segment      */
 
+/* -------------------------------------------------------------------------
+ * Coalesced reads (ne_load_stream / ne_load_file)
+ *
+ * Segments are read in file order.  A segment joins the current read when
+ * it starts no more than NE_LOAD_GAP_MAX bytes after the previous one ends
+ * (the gap usually holds that segment's relocation records, which are
+ * kept for ne_reloc_parse_stream()) and the whole read stays within
+ * NE_LOAD_RUN_MAX bytes.
+ * ---------------------------------------------------------------------- */
+#define NE_LOAD_RUN_MAX   0x8000u  /* largest multi-segment read (bytes)  */
+#define NE_LOAD_GAP_MAX   0x1000u  /* largest gap bridged inside one read */
+
 /* -------------------------------------------------------------------------
  * Loaded segment descriptor
  * ---------------------------------------------------------------------- */
@@ -37,6 +49,14 @@
  * 'data' points to an alloc_size-byte heap buffer that holds the segment
  * image.  Bytes [0, data_size) were read from the file; the rest are zero.
  * A data_size of 0 means the segment has no file backing (BSS-like).
+ *
+ * A segment left behind by ne_load_buffer_lazy() has 'deferred' set: 'data'
+ * is NULL and data_size is the number of file bytes that will be copied in
+ * when the segment is first materialised (see ne_loader_materialize()).
+ *
+ * 'relocs' is a copy of the segment's relocation block (record count word
+ * and records) when ne_load_stream() read it along with a later segment;
+ * NULL otherwise.
  */
 typedef struct {
     uint8_t  *data;       /* heap-allocated segment image (alloc_size bytes) */
@@ -44,6 +64,9 @@ typedef struct {
     uint32_t  alloc_size; /* total bytes allocated for this segment           */
     uint32_t  data_size;  /* bytes read from the file (may be 0)             */
     uint16_t  flags;      /* NE_SEG_* flags copied from the segment table    */
+    uint16_t  deferred;   /* non-zero while the segment is not yet resident  */
+    uint8_t  *relocs;     /* relocation block read by ne_load_stream(), or NULL */
+    uint32_t  reloc_size; /* bytes in 'relocs'                               */
 } NELoadedSegment;
 
 /* -------------------------------------------------------------------------
@@ -53,11 +76,24 @@ typedef struct {
 /*
  * NELoaderContext - result of loading all segments of an NE module.
  *
+ * 'image' / 'image_len' are only set by ne_load_buffer_lazy(): they borrow
+ * the caller's file image so that deferred segments can be materialised
+ * later.  The image must stay valid until the last deferred segment has
+ * been materialised or the context has been freed.
+ *
+ * 'arena' is set by ne_load_buffer_arena(): the segment array and every
+ * segment image then live in that arena.
+ *
  * Caller must call ne_loader_free() when done.
  */
 typedef struct {
     NELoadedSegment *segments; /* heap-allocated array [0 .. count-1] */
     uint16_t         count;    /* number of loaded segments            */
+    uint16_t         deferred_count; /* segments still awaiting materialisation */
+    const uint8_t   *image;    /* borrowed file image (lazy mode only) */
+    size_t           image_len;/* byte length of 'image'               */
+    NEArena         *arena;    /* owning arena, or NULL for heap       */
+    uint16_t         reads;    /* read calls made by ne_load_stream()  */
 } NELoaderContext;
 
 /* -------------------------------------------------------------------------
@@ -80,9 +116,76 @@ int ne_load_buffer(const uint8_t *buf, size_t len,
                    NELoaderContext *loader);
 
 /*
- * ne_load_file - open 'path', parse the NE header, then load all segments.
+ * ne_load_buffer_lazy - load NE segments on demand.
+ *
+ * Like ne_load_buffer(), but only segments that must be resident at start
+ * are allocated and copied now: those flagged NE_SEG_PRELOAD, the automatic
+ * data segment and the entry-point CS and SS segments.  Every other segment
+ * is recorded with its file offset and size and marked 'deferred'; call
+ * ne_loader_materialize() (or ne_reloc_materialize() to also apply its
+ * fixups) before touching its data.
+ *
+ * All segment extents are validated against 'len' up front, so a later
+ * materialisation cannot fail on bounds.  'buf' is borrowed, not copied:
+ * it must outlive the deferred segments (see NELoaderContext).
+ *
+ * Returns NE_LOAD_OK on success or a negative NE_LOAD_ERR_* code.
+ */
+int ne_load_buffer_lazy(const uint8_t *buf, size_t len,
+                        const NEParserContext *parser,
+                        NELoaderContext *loader);
+
+/*
+ * ne_load_buffer_arena - ne_load_buffer() with the segment array and all
+ * segment images bump-allocated from 'arena' (see NEArena in ne_parser.h;
+ * ne_arena_size_for_image() in ne_reloc.h sizes it for a whole module).
+ *
+ * Returns NE_LOAD_OK, NE_LOAD_ERR_NOMEM when the arena is too small, or
+ * another NE_LOAD_ERR_* code.  ne_loader_free() on the result only resets
+ * *loader; the memory goes back with ne_arena_free().
+ */
+int ne_load_buffer_arena(const uint8_t *buf, size_t len,
+                         const NEParserContext *parser,
+                         NELoaderContext *loader,
+                         NEArena *arena);
+
+/*
+ * ne_loader_materialize - bring deferred segment 'seg_idx' (0-based) into
+ * memory.  Allocates alloc_size bytes, copies the file-backed part from the
+ * borrowed image and clears the 'deferred' flag.
+ *
+ * Returns NE_LOAD_OK when the segment is resident (including when it was
+ * already resident), NE_LOAD_ERR_BOUNDS for a bad index, NE_LOAD_ERR_IO if
+ * no image is attached, or NE_LOAD_ERR_NOMEM.
+ */
+int ne_loader_materialize(NELoaderContext *loader, uint16_t seg_idx);
+
+/*
+ * ne_load_stream - load NE segments from a file of 'file_len' bytes read
+ * through 'read_at' (called with 'user'; see NEReadAtFn in ne_parser.h).
+ *
+ * Produces the same context as ne_load_buffer() on the whole file, but
+ * only segment data is read: segments are sorted by file offset and
+ * neighbours are merged into runs of at most NE_LOAD_RUN_MAX bytes, each
+ * fetched with one read_at call.  loader->reads holds the number of calls.
+ * Relocation blocks that fall inside a run are kept in the segments'
+ * 'relocs'; pass the context to ne_reloc_parse_stream(), which reads only
+ * the blocks that were not.
+ *
+ * Returns NE_LOAD_OK, NE_LOAD_ERR_IO when a read comes back short, or
+ * another NE_LOAD_ERR_* code; caller must call ne_loader_free().
+ */
+int ne_load_stream(NEReadAtFn read_at, void *user, uint32_t file_len,
+                   const NEParserContext *parser,
+                   NELoaderContext *loader);
+
+/*
+ * ne_load_file - open 'path' and load all segments described by 'parser'.
  *
- * Combines ne_parse_file() and ne_load_buffer() into a single call.
+ * Uses ne_load_stream() over a stdio stream, so a module loads with one
+ * seek and read per run of neighbouring segments rather than reading the
+ * whole file.  Callers that already hold an NEImage should call
+ * ne_load_buffer(img.data, img.len, ...) instead.
  * Returns NE_LOAD_OK on success; caller must call ne_loader_free().
  */
 int ne_load_file(const char *path,
@@ -90,7 +193,8 @@ int ne_load_file(const char *path,
                  NELoaderContext *loader);
 
 /*
- * ne_loader_free - release all heap memory owned by *loader.
+ * ne_loader_free - release all heap memory owned by *loader (nothing for
+ * an arena-backed context).
  * Safe to call on a partially-initialised or zeroed context, and on NULL.
  */
 void ne_loader_free(NELoaderContext *loader);
@@ -14,43 +14,519 @@
 
 #include <string.h>
 
+#ifndef __WATCOMC__
+#include <stdint.h>
+#endif
+
 /* =========================================================================
  * Internal helpers – GMEM
  * ===================================================================== */
 
+/*
+ * NEGMemChunk - header at the start of every pool chunk (it fits in the
+ * NE_GMEM_POOL_MIN bytes reserved there).  'live', 'pinned' and 'keep'
+ * are scratch counters used by ne_gmem_compact().
+ */
+typedef struct NEGMemChunk {
+    struct NEGMemChunk *next;
+    uint16_t            cls;     /* size class of the chunk's blocks    */
+    uint16_t            live;    /* allocated blocks in the chunk       */
+    uint16_t            pinned;  /* of those, blocks that cannot move   */
+    uint16_t            keep;    /* non-zero: chunk survives compaction */
+} NEGMemChunk;
+
+/*
+ * mem_linear - address of 'p' for ordering and range checks.  Large-model
+ * far pointers compare by offset only, so use the linear address on DOS.
+ */
+#ifdef __WATCOMC__
+typedef uint32_t NEMemAddr;
+
+static NEMemAddr mem_linear(const void *p)
+{
+    return ((uint32_t)FP_SEG(p) << 4) + FP_OFF(p);
+}
+#else
+typedef uintptr_t NEMemAddr;
+
+static NEMemAddr mem_linear(const void *p)
+{
+    return (uintptr_t)p;
+}
+#endif
+
+/*
+ * pool_class - return the size class for a 'size'-byte request, or -1 if
+ * it is larger than NE_GMEM_POOL_MAX and bypasses the pool.
+ */
+static int pool_class(uint32_t size)
+{
+    int      c = 0;
+    uint32_t bsize = NE_GMEM_POOL_MIN;
+
+    if (size > NE_GMEM_POOL_MAX)
+        return -1;
+    while (bsize < size) {
+        bsize <<= 1;
+        c++;
+    }
+    return c;
+}
+
+static void pool_count(NEGMemPoolClass *c)
+{
+    c->allocs++;
+    c->live++;
+    if (c->live > c->peak)
+        c->peak = c->live;
+}
+
+/*
+ * pool_refill - carve a new chunk into blocks of class 'c' and push them
+ * onto the class free list.  The first NE_GMEM_POOL_MIN bytes of the
+ * chunk link it into the pool's chunk list.
+ */
+static int pool_refill(NEGMemPool *pool, int c)
+{
+    uint8_t     *chunk;
+    NEGMemChunk *hdr;
+    uint32_t     bsize = (uint32_t)NE_GMEM_POOL_MIN << c;
+    uint32_t     off;
+
+    chunk = (uint8_t *)NE_MALLOC(NE_GMEM_POOL_CHUNK);
+    if (!chunk)
+        return -1;
+
+    hdr = (NEGMemChunk *)chunk;
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->next    = pool->chunks;
+    hdr->cls     = (uint16_t)c;
+    pool->chunks = hdr;
+    pool->stats.classes[c].chunks++;
+    pool->stats.footprint += NE_GMEM_POOL_CHUNK;
+
+    /* Push from the top down so the list hands out ascending addresses. */
+    off = NE_GMEM_POOL_MIN +
+          ((NE_GMEM_POOL_CHUNK - NE_GMEM_POOL_MIN) / bsize - 1u) * bsize;
+    for (;;) {
+        *(uint8_t **)(chunk + off) = pool->free_list[c];
+        pool->free_list[c] = chunk + off;
+        if (off == NE_GMEM_POOL_MIN)
+            break;
+        off -= bsize;
+    }
+    return 0;
+}
+
+/*
+ * gmem_data_alloc - allocate the data of a 'size'-byte block, from the
+ * pool when it is small enough and from NE_MALLOC otherwise.
+ */
+static uint8_t *gmem_data_alloc(NEGMemTable *tbl, uint32_t size, int zero)
+{
+    NEGMemPool *pool = &tbl->pool;
+    uint8_t    *buf;
+    int         c = pool_class(size);
+
+    if (c < 0) {
+        /*
+         * On Watcom/DOS: uses DOS INT 21h AH=48h for conventional memory.
+         * On POSIX host: uses standard C library malloc/calloc.
+         */
+        buf = zero ? (uint8_t *)NE_CALLOC(1u, size)
+                   : (uint8_t *)NE_MALLOC(size);
+        if (!buf)
+            return NULL;
+        pool->stats.footprint += size;
+        pool->stats.large.chunks++;
+        pool_count(&pool->stats.large);
+        return buf;
+    }
+
+    if (pool->free_list[c])
+        pool->stats.classes[c].hits++;
+    else if (pool_refill(pool, c) != 0)
+        return NULL;
+
+    buf = pool->free_list[c];
+    pool->free_list[c] = *(uint8_t **)buf;
+    pool_count(&pool->stats.classes[c]);
+
+    if (zero)
+        memset(buf, 0, size);
+    return buf;
+}
+
+/*
+ * gmem_data_free - release block data obtained from gmem_data_alloc()
+ * for a block of 'size' bytes.
+ */
+static void gmem_data_free(NEGMemTable *tbl, uint8_t *data, uint32_t size)
+{
+    NEGMemPool *pool = &tbl->pool;
+    int         c;
+
+    if (!data)
+        return;
+
+    c = pool_class(size);
+    if (c < 0) {
+        NE_FREE(data);
+        pool->stats.footprint -= size;
+        pool->stats.large.live--;
+        return;
+    }
+
+    *(uint8_t **)data = pool->free_list[c];
+    pool->free_list[c] = data;
+    pool->stats.classes[c].live--;
+}
+
+/*
+ * gmem_addr_upper - number of address-index entries whose data starts at
+ * or below linear address 'a'.
+ */
+static uint16_t gmem_addr_upper(const NEGMemTable *tbl, NEMemAddr a)
+{
+    uint16_t lo = 0;
+    uint16_t hi = tbl->addr_count;
+    uint16_t mid;
+
+    while (lo < hi) {
+        mid = (uint16_t)(lo + (hi - lo) / 2u);
+        if (mem_linear(tbl->blocks[tbl->addr_index[mid]].data) <= a)
+            lo = (uint16_t)(mid + 1u);
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* gmem_addr_insert / gmem_addr_remove - keep slot 'i' in the index. */
+static void gmem_addr_insert(NEGMemTable *tbl, uint16_t i)
+{
+    uint16_t pos = gmem_addr_upper(tbl, mem_linear(tbl->blocks[i].data));
+
+    memmove(&tbl->addr_index[pos + 1u], &tbl->addr_index[pos],
+            (size_t)(tbl->addr_count - pos) * sizeof(uint16_t));
+    tbl->addr_index[pos] = i;
+    tbl->addr_count++;
+}
+
+static void gmem_addr_remove(NEGMemTable *tbl, uint16_t i)
+{
+    uint16_t pos = gmem_addr_upper(tbl, mem_linear(tbl->blocks[i].data));
+
+    if (pos == 0 || tbl->addr_index[pos - 1u] != i)
+        return;
+    pos--;
+    memmove(&tbl->addr_index[pos], &tbl->addr_index[pos + 1u],
+            (size_t)(tbl->addr_count - pos - 1u) * sizeof(uint16_t));
+    tbl->addr_count--;
+}
+
+/*
+ * gmem_slot - return the slot index that 'handle' refers to, or
+ * NE_GMEM_SLOT_NONE if the handle is invalid, out of range or stale.
+ * A live slot stores its full handle, so one compare checks both the
+ * slot being in use and the generation.
+ */
+static uint16_t gmem_slot(const NEGMemTable *tbl, NEGMemHandle handle)
+{
+    uint16_t slot;
+
+    if (!tbl || !tbl->blocks || handle == NE_GMEM_HANDLE_INVALID)
+        return NE_GMEM_SLOT_NONE;
+
+    slot = (uint16_t)(handle & (uint16_t)((1ul << tbl->index_bits) - 1u));
+    if (slot == 0 || slot > tbl->capacity)
+        return NE_GMEM_SLOT_NONE;
+    slot--;
+    if (tbl->blocks[slot].handle != handle)
+        return NE_GMEM_SLOT_NONE;
+    return slot;
+}
+
 /*
  * gmem_find_block - locate the block entry for 'handle'.
  * Returns NULL if not found or handle is invalid.
  */
 static NEGMemBlock *gmem_find_block(NEGMemTable *tbl, NEGMemHandle handle)
 {
-    uint16_t i;
+    uint16_t slot = gmem_slot(tbl, handle);
 
-    if (!tbl || !tbl->blocks || handle == NE_GMEM_HANDLE_INVALID)
-        return NULL;
+    return (slot == NE_GMEM_SLOT_NONE) ? NULL : &tbl->blocks[slot];
+}
 
-    for (i = 0; i < tbl->capacity; i++) {
-        if (tbl->blocks[i].handle == handle)
-            return &tbl->blocks[i];
+/*
+ * lru_unlink / lru_append - take slot 'i' off the discard list, or add it
+ * at the warm end.
+ */
+static void lru_unlink(NEGMemTable *tbl, uint16_t i)
+{
+    NEGMemBlock *b = &tbl->blocks[i];
+
+    if (b->lru_prev != NE_GMEM_SLOT_NONE)
+        tbl->blocks[b->lru_prev].lru_next = b->lru_next;
+    else
+        tbl->lru_head = b->lru_next;
+    if (b->lru_next != NE_GMEM_SLOT_NONE)
+        tbl->blocks[b->lru_next].lru_prev = b->lru_prev;
+    else
+        tbl->lru_tail = b->lru_prev;
+    b->lru_prev = b->lru_next = NE_GMEM_SLOT_NONE;
+}
+
+static void lru_append(NEGMemTable *tbl, uint16_t i)
+{
+    NEGMemBlock *b = &tbl->blocks[i];
+
+    b->lru_prev = tbl->lru_tail;
+    b->lru_next = NE_GMEM_SLOT_NONE;
+    if (tbl->lru_tail != NE_GMEM_SLOT_NONE)
+        tbl->blocks[tbl->lru_tail].lru_next = i;
+    else
+        tbl->lru_head = i;
+    tbl->lru_tail = i;
+}
+
+/* lru_member - non-zero if 'b' belongs on the discard list. */
+static int lru_member(const NEGMemBlock *b)
+{
+    return (b->flags & NE_GMEM_DISCARDABLE) && b->data && b->lock_count == 0;
+}
+
+/*
+ * gmem_release - free the data of block 'b', advance the slot's
+ * generation so outstanding copies of its handle go stale, and push the
+ * slot onto the free list.
+ */
+static void gmem_release(NEGMemTable *tbl, NEGMemBlock *b)
+{
+    uint16_t gen_mask;
+    uint16_t gen;
+
+    if (lru_member(b))
+        lru_unlink(tbl, (uint16_t)(b - tbl->blocks));
+    if (b->data)
+        gmem_addr_remove(tbl, (uint16_t)(b - tbl->blocks));
+    gmem_data_free(tbl, b->data, b->size);
+
+    gen_mask = (tbl->index_bits >= 16u)
+             ? 0u : (uint16_t)(0xFFFFu >> tbl->index_bits);
+    gen = (uint16_t)((b->generation + 1u) & gen_mask);
+
+    memset(b, 0, sizeof(*b));
+    b->generation = gen;
+    b->next_free  = tbl->free_head;
+    tbl->free_head = (uint16_t)(b - tbl->blocks);
+    tbl->count--;
+}
+
+/* gmem_discard - drop the data of 'b' but keep its handle. */
+static void gmem_discard(NEGMemTable *tbl, NEGMemBlock *b)
+{
+    if (lru_member(b))
+        lru_unlink(tbl, (uint16_t)(b - tbl->blocks));
+    gmem_addr_remove(tbl, (uint16_t)(b - tbl->blocks));
+    gmem_data_free(tbl, b->data, b->size);
+    b->data = NULL;
+    b->size = 0;
+    tbl->pool.stats.discarded++;
+}
+
+/* pool_chunk_of - the chunk holding pool block 'p'. */
+static NEGMemChunk *pool_chunk_of(const NEGMemPool *pool, const uint8_t *p)
+{
+    NEGMemChunk *c;
+
+    for (c = pool->chunks; c; c = c->next) {
+        if (mem_linear(p) >= mem_linear(c) &&
+            mem_linear(p) <  mem_linear(c) + NE_GMEM_POOL_CHUNK)
+            return c;
     }
     return NULL;
 }
 
 /*
- * gmem_free_slot - locate a slot with handle == 0 (unused).
+ * gmem_pack - move unlocked moveable pool blocks out of the emptiest
+ * chunks of each class into free blocks of the fullest ones, and return
+ * every chunk left empty to the system.
+ *
+ * Chunks are picked per class: every chunk holding a block that cannot
+ * move is kept, then the fullest others until the kept chunks can hold
+ * all of the class's blocks.  The free lists are rebuilt from the kept
+ * chunks before anything moves, so every moved block finds a slot.
+ * Finding a block's chunk walks the chunk list; compaction is rare
+ * enough for that.
  */
-static NEGMemBlock *gmem_free_slot(NEGMemTable *tbl)
+static void gmem_pack(NEGMemTable *tbl)
 {
-    uint16_t i;
+    NEGMemPool   *pool = &tbl->pool;
+    NEGMemChunk  *c;
+    NEGMemChunk  *best;
+    NEGMemChunk **link;
+    uint8_t      *p;
+    uint8_t      *list;
+    uint8_t      *dst;
+    uint32_t      live[NE_GMEM_POOL_CLASSES];
+    uint32_t      room[NE_GMEM_POOL_CLASSES];
+    uint32_t      per_chunk;
+    uint16_t      i;
+    int           k;
+
+    if (!pool->chunks)
+        return;
 
-    if (!tbl || !tbl->blocks)
-        return NULL;
+    for (c = pool->chunks; c; c = c->next)
+        c->live = c->pinned = c->keep = 0;
 
     for (i = 0; i < tbl->capacity; i++) {
-        if (tbl->blocks[i].handle == NE_GMEM_HANDLE_INVALID)
-            return &tbl->blocks[i];
+        NEGMemBlock *b = &tbl->blocks[i];
+
+        if (b->handle == NE_GMEM_HANDLE_INVALID || !b->data ||
+            b->size > NE_GMEM_POOL_MAX)
+            continue;
+        c = pool_chunk_of(pool, b->data);
+        if (!c)
+            continue;
+        c->live++;
+        if (!(b->flags & NE_GMEM_MOVEABLE) || b->lock_count > 0)
+            c->pinned++;
+    }
+
+    /* Choose the chunks to keep. */
+    for (k = 0; k < (int)NE_GMEM_POOL_CLASSES; k++) {
+        per_chunk = (NE_GMEM_POOL_CHUNK - NE_GMEM_POOL_MIN) /
+                    ((uint32_t)NE_GMEM_POOL_MIN << k);
+        live[k] = 0;
+        room[k] = 0;
+        for (c = pool->chunks; c; c = c->next) {
+            if (c->cls != (uint16_t)k)
+                continue;
+            live[k] += c->live;
+            if (c->pinned) {
+                c->keep  = 1;
+                room[k] += per_chunk;
+            }
+        }
+        while (room[k] < live[k]) {
+            best = NULL;
+            for (c = pool->chunks; c; c = c->next) {
+                if (c->cls == (uint16_t)k && !c->keep &&
+                    (!best || c->live > best->live))
+                    best = c;
+            }
+            if (!best)
+                break;
+            best->keep = 1;
+            room[k] += per_chunk;
+        }
+    }
+
+    /* Drop free blocks that lie in chunks about to be released. */
+    for (k = 0; k < (int)NE_GMEM_POOL_CLASSES; k++) {
+        list = NULL;
+        while (pool->free_list[k]) {
+            p = pool->free_list[k];
+            pool->free_list[k] = *(uint8_t **)p;
+            c = pool_chunk_of(pool, p);
+            if (c && c->keep) {
+                *(uint8_t **)p = list;
+                list = p;
+            }
+        }
+        pool->free_list[k] = list;
+    }
+
+    /* Move the blocks out of those chunks. */
+    for (i = 0; i < tbl->capacity; i++) {
+        NEGMemBlock *b = &tbl->blocks[i];
+
+        if (b->handle == NE_GMEM_HANDLE_INVALID || !b->data ||
+            b->size > NE_GMEM_POOL_MAX)
+            continue;
+        c = pool_chunk_of(pool, b->data);
+        if (!c || c->keep)
+            continue;
+
+        k   = pool_class(b->size);
+        dst = pool->free_list[k];
+        if (!dst)
+            continue;       /* cannot happen: the kept chunks have room */
+        pool->free_list[k] = *(uint8_t **)dst;
+        memcpy(dst, b->data, (size_t)b->size);
+        gmem_addr_remove(tbl, i);
+        b->data = dst;
+        gmem_addr_insert(tbl, i);
+        pool->stats.moved++;
+    }
+
+    /* Release the chunks that are now empty. */
+    link = &pool->chunks;
+    while (*link) {
+        c = *link;
+        if (c->keep) {
+            link = &c->next;
+            continue;
+        }
+        *link = c->next;
+        NE_FREE(c);
+        pool->stats.footprint -= NE_GMEM_POOL_CHUNK;
+        pool->stats.released++;
     }
-    return NULL;
+}
+
+/*
+ * gmem_evict - make room for an allocation by discarding the least
+ * recently used unlocked discardable block.  A discarded pool block only
+ * gives memory back once its chunk is empty, so the pool is packed after
+ * it.  With nothing left to discard, packs once more (*packed tracks
+ * that) in case earlier frees left chunks empty.
+ * Returns 0 if something was reclaimed and the caller should retry.
+ */
+static int gmem_evict(NEGMemTable *tbl, int *packed)
+{
+    NEGMemBlock *b;
+    int          pooled;
+
+    if (tbl->lru_head == NE_GMEM_SLOT_NONE) {
+        if (*packed)
+            return -1;
+        gmem_pack(tbl);
+        *packed = 1;
+        return 0;
+    }
+
+    b = &tbl->blocks[tbl->lru_head];
+    pooled = (b->size <= NE_GMEM_POOL_MAX);
+    gmem_discard(tbl, b);
+    if (pooled) {
+        gmem_pack(tbl);
+        *packed = 1;
+    }
+    return 0;
+}
+
+/*
+ * gmem_over_limit - non-zero if a 'size'-byte block would take the table
+ * past its heap limit.  A pool block costs a chunk only when its class has
+ * no free block left.
+ */
+static int gmem_over_limit(const NEGMemTable *tbl, uint32_t size)
+{
+    int      c;
+    uint32_t cost;
+
+    if (tbl->heap_limit == 0)
+        return 0;
+
+    c = pool_class(size);
+    if (c < 0)
+        cost = size;
+    else
+        cost = tbl->pool.free_list[c] ? 0u : NE_GMEM_POOL_CHUNK;
+    return tbl->pool.stats.footprint + cost > tbl->heap_limit;
 }
 
 /* =========================================================================
@@ -59,6 +535,8 @@ static NEGMemBlock *gmem_free_slot(NEGMemTable *tbl)
 
 int ne_gmem_table_init(NEGMemTable *tbl, uint16_t capacity)
 {
+    uint16_t i;
+
     if (!tbl)
         return NE_MEM_ERR_NULL;
     if (capacity == 0)
@@ -66,34 +544,67 @@ int ne_gmem_table_init(NEGMemTable *tbl, uint16_t capacity)
 
     memset(tbl, 0, sizeof(*tbl));
 
-    tbl->blocks = (NEGMemBlock *)NE_CALLOC(capacity, sizeof(NEGMemBlock));
-    if (!tbl->blocks)
+    tbl->blocks     = (NEGMemBlock *)NE_CALLOC(capacity, sizeof(NEGMemBlock));
+    tbl->addr_index = (uint16_t *)NE_CALLOC(capacity, sizeof(uint16_t));
+    if (!tbl->blocks || !tbl->addr_index) {
+        if (tbl->blocks)
+            NE_FREE(tbl->blocks);
+        if (tbl->addr_index)
+            NE_FREE(tbl->addr_index);
+        memset(tbl, 0, sizeof(*tbl));
         return NE_MEM_ERR_ALLOC;
+    }
+
+    /* Chain every slot into the free list, lowest index first. */
+    for (i = 0; i + 1u < capacity; i++)
+        tbl->blocks[i].next_free = (uint16_t)(i + 1u);
+    tbl->blocks[capacity - 1u].next_free = NE_GMEM_SLOT_NONE;
+
+    tbl->index_bits = 1u;
+    while (tbl->index_bits < 16u && (1ul << tbl->index_bits) <= capacity)
+        tbl->index_bits++;
+
+    tbl->capacity  = capacity;
+    tbl->count     = 0;
+    tbl->free_head = 0;
+    tbl->lru_head  = NE_GMEM_SLOT_NONE;
+    tbl->lru_tail  = NE_GMEM_SLOT_NONE;
 
-    tbl->capacity    = capacity;
-    tbl->count       = 0;
-    tbl->next_handle = 1u;
+    for (i = 0; i < NE_GMEM_POOL_CLASSES; i++)
+        tbl->pool.stats.classes[i].block_size =
+            (uint16_t)(NE_GMEM_POOL_MIN << i);
 
     return NE_MEM_OK;
 }
 
 void ne_gmem_table_free(NEGMemTable *tbl)
 {
-    uint16_t i;
+    uint16_t     i;
+    NEGMemChunk *chunk;
 
     if (!tbl)
         return;
 
     if (tbl->blocks) {
+        /* Pooled blocks go back with their chunks below. */
         for (i = 0; i < tbl->capacity; i++) {
             if (tbl->blocks[i].handle != NE_GMEM_HANDLE_INVALID &&
-                tbl->blocks[i].data   != NULL) {
+                tbl->blocks[i].data   != NULL &&
+                tbl->blocks[i].size   >  NE_GMEM_POOL_MAX) {
                 NE_FREE(tbl->blocks[i].data);
                 tbl->blocks[i].data = NULL;
             }
         }
         NE_FREE(tbl->blocks);
     }
+    if (tbl->addr_index)
+        NE_FREE(tbl->addr_index);
+
+    while (tbl->pool.chunks) {
+        chunk = tbl->pool.chunks;
+        tbl->pool.chunks = chunk->next;
+        NE_FREE(chunk);
+    }
 
     memset(tbl, 0, sizeof(*tbl));
 }
@@ -109,36 +620,47 @@ NEGMemHandle ne_gmem_alloc(NEGMemTable *tbl,
 {
     NEGMemBlock *slot;
     uint8_t     *buf;
+    uint16_t     index;
+    int          packed = 0;
 
-    if (!tbl || size == 0)
+    if (!tbl || !tbl->blocks || size == 0)
         return NE_GMEM_HANDLE_INVALID;
 
-    if (tbl->count >= tbl->capacity)
+    if (tbl->count >= tbl->capacity || tbl->free_head == NE_GMEM_SLOT_NONE)
         return NE_GMEM_HANDLE_INVALID;
-
-    slot = gmem_free_slot(tbl);
-    if (!slot)
+    if (tbl->heap_limit != 0 && size > tbl->heap_limit)
         return NE_GMEM_HANDLE_INVALID;
 
-    /*
-     * Allocate the data buffer.
-     * On Watcom/DOS: uses DOS INT 21h AH=48h for conventional memory.
-     * On POSIX host: uses standard C library malloc/calloc.
-     */
-    if (flags & NE_GMEM_ZEROINIT) {
-        buf = (uint8_t *)NE_CALLOC(1u, size);
-    } else {
-        buf = (uint8_t *)NE_MALLOC(size);
+    index = tbl->free_head;
+    slot  = &tbl->blocks[index];
+
+    /* Discard cold blocks while over the limit or out of memory. */
+    for (;;) {
+        if (gmem_over_limit(tbl, size)) {
+            buf = NULL;
+        } else {
+            buf = gmem_data_alloc(tbl, size, (flags & NE_GMEM_ZEROINIT) != 0);
+            if (buf)
+                break;
+        }
+        if (gmem_evict(tbl, &packed) != 0)
+            return NE_GMEM_HANDLE_INVALID;
     }
-    if (!buf)
-        return NE_GMEM_HANDLE_INVALID;
 
-    slot->handle     = tbl->next_handle++;
+    tbl->free_head   = slot->next_free;
+
+    /* 32-bit shift: index_bits may be 16, the width of int on DOS */
+    slot->handle     = (NEGMemHandle)(((uint32_t)slot->generation
+                                       << tbl->index_bits) | (index + 1u));
+    slot->next_free  = NE_GMEM_SLOT_NONE;
     slot->flags      = flags;
     slot->data       = buf;
     slot->size       = size;
     slot->lock_count = 0;
     slot->owner_task = owner;
+    if (lru_member(slot))
+        lru_append(tbl, index);
+    gmem_addr_insert(tbl, index);
 
     tbl->count++;
 
@@ -162,15 +684,7 @@ int ne_gmem_free(NEGMemTable *tbl, NEGMemHandle handle)
     if (!b)
         return NE_MEM_ERR_NOT_FOUND;
 
-    /* Free the data buffer. */
-    if (b->data) {
-        NE_FREE(b->data);
-        b->data = NULL;
-    }
-
-    /* Zero the slot so it can be reused. */
-    memset(b, 0, sizeof(*b));
-    tbl->count--;
+    gmem_release(tbl, b);
 
     return NE_MEM_OK;
 }
@@ -190,6 +704,8 @@ void *ne_gmem_lock(NEGMemTable *tbl, NEGMemHandle handle)
     if (!b || !b->data)
         return NULL;
 
+    if (lru_member(b))
+        lru_unlink(tbl, (uint16_t)(b - tbl->blocks));
     b->lock_count++;
     return b->data;
 }
@@ -207,8 +723,11 @@ int ne_gmem_unlock(NEGMemTable *tbl, NEGMemHandle handle)
     if (!b)
         return NE_MEM_ERR_NOT_FOUND;
 
-    if (b->lock_count > 0)
+    if (b->lock_count > 0) {
         b->lock_count--;
+        if (lru_member(b))
+            lru_append(tbl, (uint16_t)(b - tbl->blocks));
+    }
 
     return NE_MEM_OK;
 }
@@ -219,16 +738,9 @@ int ne_gmem_unlock(NEGMemTable *tbl, NEGMemHandle handle)
 
 uint32_t ne_gmem_size(const NEGMemTable *tbl, NEGMemHandle handle)
 {
-    uint16_t i;
+    uint16_t slot = gmem_slot(tbl, handle);
 
-    if (!tbl || !tbl->blocks || handle == NE_GMEM_HANDLE_INVALID)
-        return 0;
-
-    for (i = 0; i < tbl->capacity; i++) {
-        if (tbl->blocks[i].handle == handle)
-            return tbl->blocks[i].size;
-    }
-    return 0;
+    return (slot == NE_GMEM_SLOT_NONE) ? 0 : tbl->blocks[slot].size;
 }
 
 /* =========================================================================
@@ -259,18 +771,26 @@ uint16_t ne_gmem_free_by_owner(NEGMemTable *tbl, uint16_t owner_task)
         if (b->owner_task != owner_task)
             continue;
 
-        if (b->data) {
-            NE_FREE(b->data);
-            b->data = NULL;
-        }
-        memset(b, 0, sizeof(*b));
-        tbl->count--;
+        gmem_release(tbl, b);
         freed++;
     }
 
     return freed;
 }
 
+/* =========================================================================
+ * ne_gmem_pool_stats
+ * ===================================================================== */
+
+int ne_gmem_pool_stats(const NEGMemTable *tbl, NEGMemPoolStats *out)
+{
+    if (!tbl || !out)
+        return NE_MEM_ERR_NULL;
+
+    *out = tbl->pool.stats;
+    return NE_MEM_OK;
+}
+
 /* =========================================================================
  * Internal helpers – LMEM
  * ===================================================================== */
@@ -289,6 +809,47 @@ static NELMemBlock *lmem_find_block(NELMemHeap *heap, NELMemHandle handle)
     return NULL;
 }
 
+/*
+ * lmem_addr_upper / lmem_addr_insert / lmem_addr_remove - the heap's
+ * address index, as for GMEM; its length is heap->count.
+ */
+static uint16_t lmem_addr_upper(const NELMemHeap *heap, uint16_t n,
+                                NEMemAddr a)
+{
+    uint16_t lo = 0;
+    uint16_t hi = n;
+    uint16_t mid;
+
+    while (lo < hi) {
+        mid = (uint16_t)(lo + (hi - lo) / 2u);
+        if (mem_linear(heap->blocks[heap->addr_index[mid]].data) <= a)
+            lo = (uint16_t)(mid + 1u);
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void lmem_addr_insert(NELMemHeap *heap, uint16_t n, uint16_t i)
+{
+    uint16_t pos = lmem_addr_upper(heap, n, mem_linear(heap->blocks[i].data));
+
+    memmove(&heap->addr_index[pos + 1u], &heap->addr_index[pos],
+            (size_t)(n - pos) * sizeof(uint16_t));
+    heap->addr_index[pos] = i;
+}
+
+static void lmem_addr_remove(NELMemHeap *heap, uint16_t n, uint16_t i)
+{
+    uint16_t pos = lmem_addr_upper(heap, n, mem_linear(heap->blocks[i].data));
+
+    if (pos == 0 || heap->addr_index[pos - 1u] != i)
+        return;
+    pos--;
+    memmove(&heap->addr_index[pos], &heap->addr_index[pos + 1u],
+            (size_t)(n - pos - 1u) * sizeof(uint16_t));
+}
+
 static NELMemBlock *lmem_free_slot(NELMemHeap *heap)
 {
     uint16_t i;
@@ -369,6 +930,7 @@ NELMemHandle ne_lmem_alloc(NELMemHeap *heap, uint16_t flags, uint16_t size)
     slot->size       = size;
     slot->lock_count = 0;
 
+    lmem_addr_insert(heap, heap->count, (uint16_t)(slot - heap->blocks));
     heap->count++;
 
     return slot->handle;
@@ -392,6 +954,7 @@ int ne_lmem_free(NELMemHeap *heap, NELMemHandle handle)
         return NE_MEM_ERR_NOT_FOUND;
 
     if (b->data) {
+        lmem_addr_remove(heap, heap->count, (uint16_t)(b - heap->blocks));
         NE_FREE(b->data);
         b->data = NULL;
     }
@@ -464,16 +1027,9 @@ uint16_t ne_lmem_size(const NELMemHeap *heap, NELMemHandle handle)
 
 uint16_t ne_gmem_flags(const NEGMemTable *tbl, NEGMemHandle handle)
 {
-    uint16_t i;
+    uint16_t slot = gmem_slot(tbl, handle);
 
-    if (!tbl || !tbl->blocks || handle == NE_GMEM_HANDLE_INVALID)
-        return 0;
-
-    for (i = 0; i < tbl->capacity; i++) {
-        if (tbl->blocks[i].handle == handle)
-            return tbl->blocks[i].flags;
-    }
-    return 0;
+    return (slot == NE_GMEM_SLOT_NONE) ? 0 : tbl->blocks[slot].flags;
 }
 
 /* =========================================================================
@@ -482,27 +1038,124 @@ uint16_t ne_gmem_flags(const NEGMemTable *tbl, NEGMemHandle handle)
 
 NEGMemHandle ne_gmem_handle(const NEGMemTable *tbl, const void *ptr)
 {
-    uint16_t i;
+    const NEGMemBlock *b;
+    NEMemAddr          a;
+    uint16_t           pos;
 
-    if (!tbl || !tbl->blocks || !ptr)
+    if (!tbl || !tbl->blocks || !tbl->addr_index || !ptr)
         return NE_GMEM_HANDLE_INVALID;
 
-    for (i = 0; i < tbl->capacity; i++) {
-        if (tbl->blocks[i].handle != NE_GMEM_HANDLE_INVALID &&
-            tbl->blocks[i].data == (const uint8_t *)ptr)
-            return tbl->blocks[i].handle;
-    }
-    return NE_GMEM_HANDLE_INVALID;
+    /* The last block starting at or below 'ptr' is the only candidate. */
+    a   = mem_linear(ptr);
+    pos = gmem_addr_upper(tbl, a);
+    if (pos == 0)
+        return NE_GMEM_HANDLE_INVALID;
+
+    b = &tbl->blocks[tbl->addr_index[pos - 1u]];
+    if (a - mem_linear(b->data) >= b->size)
+        return NE_GMEM_HANDLE_INVALID;
+    return b->handle;
+}
+
+/* =========================================================================
+ * ne_gmem_discard / ne_gmem_set_limit / ne_gmem_free_space
+ * ===================================================================== */
+
+int ne_gmem_discard(NEGMemTable *tbl, NEGMemHandle handle)
+{
+    NEGMemBlock *b;
+
+    if (!tbl)
+        return NE_MEM_ERR_NULL;
+    if (handle == NE_GMEM_HANDLE_INVALID)
+        return NE_MEM_ERR_BAD_HANDLE;
+
+    b = gmem_find_block(tbl, handle);
+    if (!b)
+        return NE_MEM_ERR_NOT_FOUND;
+    if (b->lock_count > 0)
+        return NE_MEM_ERR_LOCKED;
+
+    if (b->data)
+        gmem_discard(tbl, b);
+    return NE_MEM_OK;
+}
+
+int ne_gmem_set_limit(NEGMemTable *tbl, uint32_t bytes)
+{
+    if (!tbl)
+        return NE_MEM_ERR_NULL;
+
+    tbl->heap_limit = bytes;
+    return NE_MEM_OK;
+}
+
+uint32_t ne_gmem_free_space(const NEGMemTable *tbl)
+{
+    if (!tbl)
+        return 0;
+
+    if (tbl->heap_limit == 0)
+        return (uint32_t)NE_LARGEST_FREE();
+    if (tbl->pool.stats.footprint >= tbl->heap_limit)
+        return 0;
+    return tbl->heap_limit - tbl->pool.stats.footprint;
 }
 
 /* =========================================================================
  * ne_gmem_compact
  * ===================================================================== */
 
-uint32_t ne_gmem_compact(NEGMemTable *tbl)
+/*
+ * gmem_relocate_large - move each unlocked moveable non-pool block into
+ * a fresh allocation made before the old one is freed, so a first-fit
+ * allocator places it in the lowest hole that fits.  A block that cannot
+ * be reallocated simply stays where it is.
+ */
+static void gmem_relocate_large(NEGMemTable *tbl)
 {
-    (void)tbl;
-    return 0;
+    uint16_t i;
+    uint8_t *buf;
+
+    for (i = 0; i < tbl->capacity; i++) {
+        NEGMemBlock *b = &tbl->blocks[i];
+
+        if (b->handle == NE_GMEM_HANDLE_INVALID || !b->data ||
+            b->size <= NE_GMEM_POOL_MAX)
+            continue;
+        if (!(b->flags & NE_GMEM_MOVEABLE) || b->lock_count > 0)
+            continue;
+
+        buf = (uint8_t *)NE_MALLOC(b->size);
+        if (!buf)
+            continue;
+        memcpy(buf, b->data, (size_t)b->size);
+        gmem_addr_remove(tbl, i);
+        NE_FREE(b->data);
+        b->data = buf;
+        gmem_addr_insert(tbl, i);
+        tbl->pool.stats.moved++;
+    }
+}
+
+uint32_t ne_gmem_compact(NEGMemTable *tbl, uint32_t min_free)
+{
+    uint32_t free_space;
+    int      packed = 1;
+
+    if (!tbl || !tbl->blocks)
+        return 0;
+
+    gmem_pack(tbl);
+    gmem_relocate_large(tbl);
+
+    free_space = ne_gmem_free_space(tbl);
+    while (free_space < min_free && tbl->lru_head != NE_GMEM_SLOT_NONE) {
+        gmem_evict(tbl, &packed);
+        free_space = ne_gmem_free_space(tbl);
+    }
+
+    return free_space;
 }
 
 /* =========================================================================
@@ -532,11 +1185,14 @@ NELMemHandle ne_lmem_realloc(NELMemHeap *heap, NELMemHandle handle,
     copy_size = (b->size < new_size) ? b->size : new_size;
     if (b->data) {
         memcpy(buf, b->data, copy_size);
+        lmem_addr_remove(heap, heap->count, (uint16_t)(b - heap->blocks));
         NE_FREE(b->data);
     }
 
     b->data = buf;
     b->size = new_size;
+    lmem_addr_insert(heap, (uint16_t)(heap->count - 1u),
+                     (uint16_t)(b - heap->blocks));
 
     return handle;
 }
@@ -565,17 +1221,22 @@ uint16_t ne_lmem_flags(const NELMemHeap *heap, NELMemHandle handle)
 
 NELMemHandle ne_lmem_handle(const NELMemHeap *heap, const void *ptr)
 {
-    uint16_t i;
+    const NELMemBlock *b;
+    NEMemAddr          a;
+    uint16_t           pos;
 
     if (!heap || !ptr)
         return NE_LMEM_HANDLE_INVALID;
 
-    for (i = 0; i < NE_LMEM_HEAP_CAP; i++) {
-        if (heap->blocks[i].handle != NE_LMEM_HANDLE_INVALID &&
-            heap->blocks[i].data == (const uint8_t *)ptr)
-            return heap->blocks[i].handle;
-    }
-    return NE_LMEM_HANDLE_INVALID;
+    a   = mem_linear(ptr);
+    pos = lmem_addr_upper(heap, heap->count, a);
+    if (pos == 0)
+        return NE_LMEM_HANDLE_INVALID;
+
+    b = &heap->blocks[heap->addr_index[pos - 1u]];
+    if (a - mem_linear(b->data) >= b->size)
+        return NE_LMEM_HANDLE_INVALID;
+    return b->handle;
 }
 
 /* =========================================================================
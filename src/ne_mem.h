@@ -11,9 +11,20 @@
  * Watcom far-heap primitives (_fmalloc / _ffree / _fcalloc) or DOS
  * INT 21h / AH=48h (allocate memory) and AH=49h (release memory).
  *
- * GMEM handle values are 1-based uint16_t indices into the global block
- * table.  0 (NE_GMEM_HANDLE_INVALID) is the sentinel for an invalid handle,
- * matching the NULL-handle convention used by the Windows 3.1 API.
+ * Small GMEM blocks are sub-allocated from a per-table pool: requests of
+ * up to NE_GMEM_POOL_MAX bytes are rounded up to a power-of-two size class
+ * and taken from that class's free list, which is refilled by carving
+ * NE_GMEM_POOL_CHUNK-byte chunks.  Larger requests go straight to
+ * NE_MALLOC.  On DOS this replaces one INT 21h call and one MCB per small
+ * GlobalAlloc with one per chunk, and keeps small blocks from splintering
+ * the MCB chain.
+ *
+ * A GMEM handle encodes the 1-based slot index of its block in the low
+ * bits and the slot's generation count in the bits above, so a lookup is
+ * a single array index and a handle kept after its block was freed no
+ * longer matches once the slot is reused.  0 (NE_GMEM_HANDLE_INVALID) is
+ * the sentinel for an invalid handle, matching the NULL-handle convention
+ * used by the Windows 3.1 API.
  *
  * Reference: Microsoft Windows 3.1 SDK – Memory Management Functions.
  */
@@ -59,13 +70,23 @@
 /* Default initial capacity for a new GMEM block table. */
 #define NE_GMEM_TABLE_CAP   128u
 
+/* GMEM pool: size classes NE_GMEM_POOL_MIN << 0 .. NE_GMEM_POOL_MAX. */
+#define NE_GMEM_POOL_MIN      16u   /* smallest class (one paragraph)     */
+#define NE_GMEM_POOL_MAX     512u   /* largest pooled request size        */
+#define NE_GMEM_POOL_CLASSES   6u   /* 16, 32, 64, 128, 256, 512          */
+#define NE_GMEM_POOL_CHUNK  4096u   /* bytes per chunk carved into blocks */
+
+/* End of the GMEM free-slot list. */
+#define NE_GMEM_SLOT_NONE   0xFFFFu
+
 /* Maximum number of blocks in a single local heap. */
 #define NE_LMEM_HEAP_CAP     64u
 
 /* -------------------------------------------------------------------------
  * GMEM handle type
  *
- * A non-zero uint16_t value that identifies one global memory block.
+ * A non-zero uint16_t value that identifies one global memory block:
+ * (generation << NEGMemTable.index_bits) | (slot + 1).
  * NE_GMEM_HANDLE_INVALID (0) is the null sentinel.
  * ---------------------------------------------------------------------- */
 typedef uint16_t NEGMemHandle;
@@ -92,18 +113,85 @@ typedef struct {
     uint32_t      size;        /* allocated byte count                     */
     uint16_t      lock_count;  /* number of outstanding locks              */
     uint16_t      owner_task;  /* NETaskHandle of owning task (0 = none)   */
+    uint16_t      generation;  /* bumped each time the slot is freed       */
+    uint16_t      next_free;   /* next free slot, or NE_GMEM_SLOT_NONE     */
+    uint16_t      lru_prev;    /* discard order: colder neighbour          */
+    uint16_t      lru_next;    /* discard order: warmer neighbour          */
 } NEGMemBlock;
 
+/* -------------------------------------------------------------------------
+ * GMEM pool statistics
+ *
+ * 'hits' counts allocations served from a class free list; 'chunks' counts
+ * the chunks carved for the class (each one an allocation from DOS).
+ * Requests above NE_GMEM_POOL_MAX are counted in 'large'.
+ * ---------------------------------------------------------------------- */
+typedef struct {
+    uint16_t  block_size;  /* bytes per block (0 for 'large')            */
+    uint32_t  allocs;      /* allocations in this class                  */
+    uint32_t  hits;        /* allocations that needed no new chunk       */
+    uint32_t  chunks;      /* chunks carved (or large blocks allocated)  */
+    uint16_t  live;        /* blocks currently allocated                 */
+    uint16_t  peak;        /* highest value of 'live'                    */
+} NEGMemPoolClass;
+
+typedef struct {
+    NEGMemPoolClass classes[NE_GMEM_POOL_CLASSES];
+    NEGMemPoolClass large;       /* pass-through requests              */
+    uint32_t        footprint;   /* bytes held: chunks + large blocks  */
+    uint32_t        released;    /* chunks returned by compaction      */
+    uint32_t        moved;       /* blocks moved by compaction         */
+    uint32_t        discarded;   /* blocks discarded                   */
+} NEGMemPoolStats;
+
+/*
+ * GMEM pool  (internal)
+ *
+ * Free blocks of a class are chained through their first bytes.  Each
+ * chunk starts with a small header that links it into 'chunks'.  Chunks
+ * are returned to the system by ne_gmem_compact() once it has emptied
+ * them, and by ne_gmem_table_free().
+ */
+typedef struct {
+    uint8_t            *free_list[NE_GMEM_POOL_CLASSES];
+    struct NEGMemChunk *chunks;  /* most recently carved chunk        */
+    NEGMemPoolStats     stats;
+} NEGMemPool;
+
 /* -------------------------------------------------------------------------
  * GMEM table
  *
+ * Unused slots are chained through NEGMemBlock.next_free starting at
+ * 'free_head', so allocation takes the head slot without scanning.
+ * 'index_bits' is the smallest width that holds capacity; the remaining
+ * 16 - index_bits bits of a handle carry the generation (none when the
+ * capacity needs all 16 bits).
+ *
+ * Unlocked NE_GMEM_DISCARDABLE blocks that still have data are kept on a
+ * doubly linked list through lru_prev/lru_next, coldest at 'lru_head'.
+ * A block leaves the list when it is locked and rejoins at the warm end
+ * when its last lock is released, so the head is the block least
+ * recently used.  With a heap limit set, ne_gmem_alloc() discards from
+ * the head until the new block fits.
+ *
+ * 'addr_index' lists the slots of all blocks that have data in order of
+ * their data address, so ne_gmem_handle() is a binary search.  Alloc,
+ * free, discard and compaction keep it up to date.
+ *
  * Initialise with ne_gmem_table_init(); release with ne_gmem_table_free().
  * ---------------------------------------------------------------------- */
 typedef struct {
     NEGMemBlock *blocks;       /* heap-allocated array [0..capacity-1]     */
     uint16_t     capacity;     /* total slots                              */
     uint16_t     count;        /* number of allocated (active) slots       */
-    uint16_t     next_handle;  /* next handle value to assign (starts at 1)*/
+    uint16_t     free_head;    /* first free slot, or NE_GMEM_SLOT_NONE    */
+    uint16_t     index_bits;   /* handle bits holding slot + 1             */
+    uint32_t     heap_limit;   /* global heap size, 0 = ask the system     */
+    uint16_t     lru_head;     /* coldest discardable block, or NONE       */
+    uint16_t     lru_tail;     /* warmest discardable block, or NONE       */
+    uint16_t    *addr_index;   /* slots with data, sorted by data address  */
+    uint16_t     addr_count;   /* entries in addr_index                    */
+    NEGMemPool   pool;         /* small-block sub-allocator                */
 } NEGMemTable;
 
 /* -------------------------------------------------------------------------
@@ -120,12 +208,16 @@ typedef struct {
 /* -------------------------------------------------------------------------
  * Local heap (one per task)
  *
+ * 'addr_index' lists the slots of the active blocks in order of their
+ * data address, as in NEGMemTable, for ne_lmem_handle().
+ *
  * Initialise with ne_lmem_heap_init(); release with ne_lmem_heap_free().
  * ---------------------------------------------------------------------- */
 typedef struct {
     NELMemBlock  blocks[NE_LMEM_HEAP_CAP]; /* fixed-size block array      */
     uint16_t     count;        /* number of allocated (active) blocks      */
     uint16_t     next_handle;  /* next handle value to assign              */
+    uint16_t     addr_index[NE_LMEM_HEAP_CAP]; /* slots by data address   */
 } NELMemHeap;
 
 /* =========================================================================
@@ -143,7 +235,8 @@ int ne_gmem_table_init(NEGMemTable *tbl, uint16_t capacity);
 /*
  * ne_gmem_table_free - release all resources owned by *tbl.
  *
- * Frees the data buffer of every active block, then frees the blocks array.
+ * Frees the data buffer of every active block and every pool chunk, then
+ * frees the blocks array.
  * Safe to call on a zeroed or partially-initialised table and on NULL.
  */
 void ne_gmem_table_free(NEGMemTable *tbl);
@@ -156,7 +249,14 @@ void ne_gmem_table_free(NEGMemTable *tbl);
  * 'owner'  : NETaskHandle of the owning task, or 0 for no owner.
  *
  * Returns a non-zero NEGMemHandle on success or NE_GMEM_HANDLE_INVALID on
- * failure (table full or malloc failure).
+ * failure (table full or malloc failure).  Runs in constant time apart
+ * from the data allocation itself, which for sizes up to NE_GMEM_POOL_MAX
+ * comes from the pool.
+ *
+ * When the block would take the table past its heap limit (see
+ * ne_gmem_set_limit()), or the system allocation fails, the least
+ * recently used unlocked discardable blocks are discarded until it fits;
+ * allocation fails only when none are left.
  *
  * On the Watcom/DOS target, replace malloc/calloc with _fmalloc/_fcalloc
  * or INT 21h / AH=48h for conventional-memory allocation.
@@ -169,9 +269,10 @@ NEGMemHandle ne_gmem_alloc(NEGMemTable *tbl,
 /*
  * ne_gmem_free - free a global memory block.
  *
- * Releases the data buffer of the block identified by 'handle' and removes
- * the entry from the table.  Locked blocks (lock_count > 0) may still be
- * freed; the caller is responsible for not dereferencing the stale pointer.
+ * Releases the data buffer of the block identified by 'handle' and returns
+ * its slot to the free list; the handle (and any copy of it) becomes
+ * stale.  Locked blocks (lock_count > 0) may still be freed; the caller is
+ * responsible for not dereferencing the stale pointer.
  *
  * Returns NE_MEM_OK, NE_MEM_ERR_BAD_HANDLE, or NE_MEM_ERR_NOT_FOUND.
  */
@@ -205,8 +306,8 @@ uint32_t ne_gmem_size(const NEGMemTable *tbl, NEGMemHandle handle);
 /*
  * ne_gmem_find_block - return a pointer to the block descriptor for 'handle'.
  *
- * Returns NULL if not found.  The pointer is valid until the next alloc or
- * free operation on the table.
+ * Returns NULL if not found or stale.  The pointer is valid until the block
+ * is freed.
  */
 NEGMemBlock *ne_gmem_find_block(NEGMemTable *tbl, NEGMemHandle handle);
 
@@ -221,6 +322,50 @@ NEGMemBlock *ne_gmem_find_block(NEGMemTable *tbl, NEGMemHandle handle);
  */
 uint16_t ne_gmem_free_by_owner(NEGMemTable *tbl, uint16_t owner_task);
 
+/*
+ * ne_gmem_discard - discard the data of an unlocked block.
+ *
+ * The handle stays valid, as with Windows GlobalDiscard: its size becomes
+ * 0 and ne_gmem_lock() returns NULL until the block is freed.
+ *
+ * Returns NE_MEM_OK, NE_MEM_ERR_NULL, NE_MEM_ERR_BAD_HANDLE,
+ * NE_MEM_ERR_NOT_FOUND or NE_MEM_ERR_LOCKED.
+ */
+int ne_gmem_discard(NEGMemTable *tbl, NEGMemHandle handle);
+
+/*
+ * ne_gmem_set_limit - set the size of the global heap *tbl draws from.
+ *
+ * With a limit, free space is the limit minus the bytes the table holds
+ * from the system (pool chunks and large blocks), and ne_gmem_alloc()
+ * discards blocks rather than exceed it.  Lowering the limit does not
+ * discard anything by itself.  0 (the default) reports what the system
+ * has left instead (NE_LARGEST_FREE(): INT 21h AH=48h on DOS, a simulated
+ * 1 MB on the host).
+ *
+ * Returns NE_MEM_OK or NE_MEM_ERR_NULL.
+ */
+int ne_gmem_set_limit(NEGMemTable *tbl, uint32_t bytes);
+
+/*
+ * ne_gmem_free_space - return the free space, in bytes, as described for
+ * ne_gmem_set_limit().  Returns 0 for NULL.
+ *
+ * Without a limit this is the largest contiguous free block the system
+ * reports.  With one it is the total left under the limit: the limit is
+ * a byte budget with no address layout, so a block above
+ * NE_GMEM_POOL_MAX of that size still fits, and the total is also the
+ * largest block ne_gmem_alloc() can return without discarding.
+ */
+uint32_t ne_gmem_free_space(const NEGMemTable *tbl);
+
+/*
+ * ne_gmem_pool_stats - copy the pool statistics of *tbl to *out.
+ *
+ * Returns NE_MEM_OK or NE_MEM_ERR_NULL.
+ */
+int ne_gmem_pool_stats(const NEGMemTable *tbl, NEGMemPoolStats *out);
+
 /* =========================================================================
  * Public API – local memory (LMEM)
  * ===================================================================== */
@@ -289,18 +434,30 @@ uint16_t ne_gmem_flags(const NEGMemTable *tbl, NEGMemHandle handle);
 /*
  * ne_gmem_handle - look up a global memory handle by data pointer.
  *
- * Scans the table for a block whose data pointer equals 'ptr'.
+ * 'ptr' may point anywhere inside a block's data, as Windows GlobalHandle
+ * allows.  A binary search of the address index; discarded blocks have no
+ * data and are not found.
  * Returns the handle on success or NE_GMEM_HANDLE_INVALID if not found.
  */
 NEGMemHandle ne_gmem_handle(const NEGMemTable *tbl, const void *ptr);
 
 /*
- * ne_gmem_compact - compact global memory (stub).
+ * ne_gmem_compact - compact global memory (GlobalCompact).
  *
- * In a real implementation this would coalesce free blocks and return
- * the size of the largest contiguous free block.  This stub returns 0.
+ * Moves unlocked NE_GMEM_MOVEABLE pool blocks into as few chunks as will
+ * hold them and returns the emptied chunks to the system, then moves each
+ * unlocked moveable block above NE_GMEM_POOL_MAX into a fresh allocation
+ * so that the DOS first-fit allocator can slide it down.  Moved blocks
+ * get a new 'data' pointer; locked and fixed blocks never move.
+ *
+ * If the free space is still below 'min_free', unlocked
+ * NE_GMEM_DISCARDABLE blocks are discarded (see ne_gmem_discard()),
+ * least recently used first, until it is not.
+ *
+ * Returns the free space afterwards (ne_gmem_free_space(): the largest
+ * free block, or the total under a heap limit), or 0 for NULL.
  */
-uint32_t ne_gmem_compact(NEGMemTable *tbl);
+uint32_t ne_gmem_compact(NEGMemTable *tbl, uint32_t min_free);
 
 /*
  * ne_lmem_realloc - change the size of a local memory block.
@@ -325,7 +482,8 @@ uint16_t ne_lmem_flags(const NELMemHeap *heap, NELMemHandle handle);
 /*
  * ne_lmem_handle - look up a local memory handle by data pointer.
  *
- * Scans the heap for a block whose data pointer equals 'ptr'.
+ * 'ptr' may point anywhere inside a block's data.  A binary search of the
+ * heap's address index.
  * Returns the handle on success or NE_LMEM_HANDLE_INVALID if not found.
  */
 NELMemHandle ne_lmem_handle(const NELMemHeap *heap, const void *ptr);
@@ -0,0 +1,946 @@
+/*
+ * ne_modgraph.c - Dependency-graph batch loading implementation
+ *
+ * Building is a breadth-first walk: each wave of newly found modules is
+ * parsed (in parallel on the host), then their module-reference tables
+ * are read serially to find the next wave.  Loading repeats the same
+ * split per layer: the heavy part (segments, exports, relocations) runs
+ * in the worker pool and only touches the module being loaded plus the
+ * export tables of earlier layers, then the layer is registered in the
+ * module table from the calling thread.
+ */
+
+#ifndef __WATCOMC__
+#define _POSIX_C_SOURCE 200809L   /* pthreads, clock_gettime, sysconf under -std=c99 */
+#endif
+
+#include "ne_modgraph.h"
+#include "ne_reloc.h"
+#include "ne_validate.h"
+#include "ne_dosalloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __WATCOMC__
+#define NE_MODGRAPH_SEP '\\'
+#else
+#include <pthread.h>
+#include <unistd.h>
+#define NE_MODGRAPH_SEP '/'
+#endif
+
+/* -------------------------------------------------------------------------
+ * Internal helpers
+ * ---------------------------------------------------------------------- */
+
+/* Microsecond clock for the per-module load times */
+static uint32_t mg_now_us(void)
+{
+#ifndef __WATCOMC__
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec * 1000000UL + (uint32_t)(ts.tv_nsec / 1000L);
+#else
+    return (uint32_t)((unsigned long)clock() *
+                      (1000000UL / (unsigned long)CLOCKS_PER_SEC));
+#endif
+}
+
+/* ASCII upper / lower case, independent of the C locale */
+static char mg_upper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+}
+
+static char mg_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static int mg_name_eq(const char *a, const char *b)
+{
+    while (*a && mg_upper(*a) == mg_upper(*b)) {
+        a++;
+        b++;
+    }
+    return mg_upper(*a) == mg_upper(*b);
+}
+
+/* Module name from a file path: base name without extension, upper case */
+static void mg_name_from_path(const char *path, char *name)
+{
+    const char *base = path;
+    const char *p;
+    uint16_t    n = 0;
+
+    for (p = path; *p; p++) {
+        if (*p == '/' || *p == '\\' || *p == ':')
+            base = p + 1;
+    }
+    while (base[n] && base[n] != '.' && n < NE_MOD_NAME_MAX - 1u) {
+        name[n] = mg_upper(base[n]);
+        n++;
+    }
+    name[n] = '\0';
+}
+
+static uint16_t mg_find_node(const NEModGraph *g, const char *name)
+{
+    uint16_t i;
+
+    for (i = 0; i < g->count; i++) {
+        if (mg_name_eq(g->nodes[i].name, name))
+            return i;
+    }
+    return NE_MODGRAPH_NONE;
+}
+
+static int mg_add_node(NEModGraph *g, const char *name, uint16_t *out)
+{
+    NEModGraphNode *n;
+
+    if (g->count == g->capacity) {
+        uint16_t        new_cap;
+        NEModGraphNode *grown;
+
+        if (g->capacity >= NE_MODGRAPH_MAX_NODES)
+            return NE_MODGRAPH_ERR_FULL;
+        new_cap = g->capacity ? (uint16_t)(g->capacity * 2u) : 16u;
+        if (new_cap > NE_MODGRAPH_MAX_NODES)
+            new_cap = NE_MODGRAPH_MAX_NODES;
+
+        grown = (NEModGraphNode *)NE_MALLOC((size_t)new_cap *
+                                            sizeof(NEModGraphNode));
+        if (!grown)
+            return NE_MODGRAPH_ERR_ALLOC;
+        if (g->nodes) {
+            memcpy(grown, g->nodes, (size_t)g->count * sizeof(NEModGraphNode));
+            NE_FREE(g->nodes);
+        }
+        g->nodes    = grown;
+        g->capacity = new_cap;
+    }
+
+    n = &g->nodes[g->count];
+    memset(n, 0, sizeof(*n));
+    strncpy(n->name, name, NE_MOD_NAME_MAX - 1u);
+    n->layer = NE_MODGRAPH_NONE;
+    *out = g->count++;
+    return NE_MODGRAPH_OK;
+}
+
+/* -------------------------------------------------------------------------
+ * Per-module jobs (run by the worker pool)
+ * ---------------------------------------------------------------------- */
+
+typedef struct {
+    const NEModGraph *g;
+    uint16_t          node;
+} MGResolve;
+
+/*
+ * mg_resolve - NEImportResolver over the export tables of the importing
+ * node's dependencies.  They belong to earlier layers (or the module
+ * table), so they are complete and no longer written.
+ */
+static int mg_resolve(uint16_t       mod_idx,
+                      uint16_t       ref2,
+                      int            by_name,
+                      const uint8_t *imported_names,
+                      uint16_t       imp_names_size,
+                      uint16_t      *out_seg,
+                      uint16_t      *out_offset,
+                      void          *userdata)
+{
+    const MGResolve      *r = (const MGResolve *)userdata;
+    const NEModGraphNode *n = &r->g->nodes[r->node];
+    const NEExportTable  *exports;
+    const NEExportEntry  *entry;
+    char                  name[NE_EXPORT_NAME_MAX];
+    uint8_t               len;
+
+    if (mod_idx == 0 || mod_idx > n->dep_count)
+        return NE_MODGRAPH_ERR_NOT_FOUND;
+    exports = r->g->nodes[n->deps[mod_idx - 1u]].exports;
+    if (!exports)
+        return NE_MODGRAPH_ERR_NOT_FOUND;
+
+    if (by_name) {
+        if (!imported_names || ref2 >= imp_names_size)
+            return NE_MODGRAPH_ERR_NOT_FOUND;
+        len = imported_names[ref2];
+        if ((uint32_t)ref2 + 1u + len > imp_names_size)
+            return NE_MODGRAPH_ERR_NOT_FOUND;
+        memcpy(name, imported_names + ref2 + 1u, len);
+        name[len] = '\0';
+        entry = ne_export_find_by_name_nocase(exports, name);
+    } else {
+        entry = ne_export_find_by_ordinal(exports, ref2);
+    }
+    if (!entry)
+        return NE_MODGRAPH_ERR_NOT_FOUND;
+
+    *out_seg    = entry->segment;
+    *out_offset = entry->offset;
+    return NE_MODGRAPH_OK;
+}
+
+/* The file image of node 'n': its cache entry's, or its own */
+static const NEImage *mg_image(const NEModGraphNode *n)
+{
+    return n->cached ? &n->cached->image : &n->image;
+}
+
+/* Close the node's file image or give its cache entry back */
+static void mg_drop_image(NEModGraph *g, NEModGraphNode *n)
+{
+    if (n->cached) {
+        ne_imgcache_release(g->cache, n->cached);
+        n->cached = NULL;
+    }
+    ne_image_close(&n->image);
+}
+
+/* Open and parse one module file (tables are copied, see ne_parse_buffer) */
+static void mg_parse_node(NEModGraph *g, uint16_t i)
+{
+    NEModGraphNode *n  = &g->nodes[i];
+    const NEImage  *img;
+    uint32_t        t0 = mg_now_us();
+    int             rc;
+
+    if (g->cache) {
+        rc = ne_imgcache_acquire(g->cache, n->path, &n->cached);
+        if (rc != NE_IMGCACHE_OK) {
+            n->status = (rc == NE_IMGCACHE_ERR_FORMAT)
+                        ? NE_MODGRAPH_ERR_LOAD : NE_MODGRAPH_ERR_NOT_FOUND;
+            n->detail = rc;
+            return;
+        }
+    } else {
+        rc = ne_image_open(n->path, &n->image);
+        if (rc != NE_OK) {
+            n->status = NE_MODGRAPH_ERR_NOT_FOUND;
+            n->detail = rc;
+            return;
+        }
+    }
+    img = mg_image(n);
+    rc = ne_parse_buffer(img->data, img->len, &n->parser);
+    if (rc != NE_OK) {
+        n->status = NE_MODGRAPH_ERR_LOAD;
+        n->detail = rc;
+    }
+    n->load_us += mg_now_us() - t0;
+}
+
+/*
+ * Load segments, build exports and apply relocations for one module.  A
+ * cached module takes its exports and relocation plan from the entry.
+ */
+static void mg_load_node(NEModGraph *g, uint16_t i)
+{
+    NEModGraphNode *n  = &g->nodes[i];
+    const NEImage  *img = mg_image(n);
+    uint32_t        t0 = mg_now_us();
+    NERelocContext  relocs;
+    MGResolve       r;
+    int             rc;
+
+    if (n->resident)
+        return;
+
+    r.g    = g;
+    r.node = i;
+
+    if (n->cached)
+        ne_validate_inherit(&n->parser, &n->cached->parser);
+    rc = ne_load_buffer(img->data, img->len, &n->parser, &n->loader);
+    if (rc == NE_LOAD_OK && n->cached) {
+        n->exports = &n->cached->exports;
+        rc = ne_reloc_plan_apply(&n->loader, &n->cached->plan, &n->parser,
+                                 mg_resolve, &r);
+    } else if (rc == NE_LOAD_OK) {
+        rc = ne_export_build_parsed(&n->parser, NE_EXPORT_NAMES,
+                                    &n->own_exports);
+        if (rc == NE_IMPEXP_OK) {
+            n->exports = &n->own_exports;
+            rc = ne_reloc_parse(img->data, img->len, &n->parser, &relocs);
+        }
+        if (rc == NE_RELOC_OK) {
+            rc = ne_reloc_apply(&n->loader, &relocs, &n->parser,
+                                mg_resolve, &r);
+            ne_reloc_free(&relocs);
+        }
+    }
+    if (rc != 0) {
+        n->status = NE_MODGRAPH_ERR_LOAD;
+        n->detail = rc;
+    }
+
+    /* Parser and loader hold copies; the file is no longer needed (a
+     * cache entry is kept for its exports until ne_modgraph_free()) */
+    ne_image_close(&n->image);
+    n->load_us += mg_now_us() - t0;
+}
+
+/* -------------------------------------------------------------------------
+ * Worker pool
+ * ---------------------------------------------------------------------- */
+
+typedef void (*MGJobFn)(NEModGraph *g, uint16_t node);
+
+#ifndef __WATCOMC__
+
+typedef struct {
+    NEModGraph      *g;
+    const uint16_t  *list;
+    uint16_t         count;
+    uint16_t         next;   /* next list entry to claim */
+    MGJobFn          fn;
+    pthread_mutex_t  lock;
+} MGQueue;
+
+static void *mg_worker(void *arg)
+{
+    MGQueue  *q = (MGQueue *)arg;
+    uint16_t  k;
+
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        k = q->next;
+        if (k < q->count)
+            q->next++;
+        pthread_mutex_unlock(&q->lock);
+        if (k >= q->count)
+            break;
+        q->fn(q->g, q->list[k]);
+    }
+    return NULL;
+}
+
+#endif /* !__WATCOMC__ */
+
+/* Run 'fn' on every node in list[0 .. count-1] */
+static void mg_run(NEModGraph *g, const uint16_t *list, uint16_t count,
+                   MGJobFn fn, unsigned workers)
+{
+    uint16_t k;
+#ifndef __WATCOMC__
+    pthread_t threads[NE_MODGRAPH_MAX_WORKERS];
+    MGQueue   q;
+    unsigned  started = 0;
+    unsigned  t;
+
+    if (workers == 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = (ncpu > 0) ? (unsigned)ncpu : 1u;
+    }
+    if (workers > NE_MODGRAPH_MAX_WORKERS)
+        workers = NE_MODGRAPH_MAX_WORKERS;
+    if (workers > count)
+        workers = count;
+
+    if (workers > 1u) {
+        q.g     = g;
+        q.list  = list;
+        q.count = count;
+        q.next  = 0;
+        q.fn    = fn;
+        if (pthread_mutex_init(&q.lock, NULL) == 0) {
+            for (t = 1; t < workers; t++) {
+                if (pthread_create(&threads[started], NULL, mg_worker, &q) != 0)
+                    break;
+                started++;
+            }
+            /* The calling thread is one of the workers */
+            mg_worker(&q);
+            for (t = 0; t < started; t++)
+                pthread_join(threads[t], NULL);
+            pthread_mutex_destroy(&q.lock);
+            return;
+        }
+    }
+#else
+    (void)workers;
+#endif
+    for (k = 0; k < count; k++)
+        fn(g, list[k]);
+}
+
+/* -------------------------------------------------------------------------
+ * Layering and cycle detection
+ * ---------------------------------------------------------------------- */
+
+/*
+ * mg_mark_cycle - every unlayered node has an unlayered dependency, so
+ * following them from any unlayered node must come back to a node seen
+ * before; the nodes from there on form a cycle.
+ */
+static int mg_mark_cycle(NEModGraph *g)
+{
+    uint16_t *step;
+    uint16_t  cur;
+    uint16_t  n = 1;
+    uint16_t  r;
+
+    step = (uint16_t *)NE_CALLOC(g->count, sizeof(uint16_t));
+    if (!step)
+        return NE_MODGRAPH_ERR_ALLOC;
+
+    for (cur = 0; g->nodes[cur].layer != NE_MODGRAPH_NONE; cur++)
+        ;
+    while (step[cur] == 0u) {
+        const NEModGraphNode *nd = &g->nodes[cur];
+        step[cur] = n++;
+        for (r = 0; r < nd->dep_count; r++) {
+            if (nd->deps[r] != cur &&
+                g->nodes[nd->deps[r]].layer == NE_MODGRAPH_NONE)
+                break;
+        }
+        cur = nd->deps[r];
+    }
+
+    /* 'cur' starts the cycle: mark it and everything after it */
+    g->failed = cur;
+    r = step[cur];
+    for (n = 0; n < g->count; n++) {
+        if (step[n] >= r) {
+            g->nodes[n].status = NE_MODGRAPH_ERR_CYCLE;
+            g->cycle_count++;
+        }
+    }
+    NE_FREE(step);
+    return NE_MODGRAPH_ERR_CYCLE;
+}
+
+/*
+ * mg_layer - put each node one layer above its deepest non-resident
+ * dependency and fill g->order / g->layer_start.
+ */
+static int mg_layer(NEModGraph *g)
+{
+    uint16_t i;
+    uint16_t r;
+    uint16_t placed = 0;
+    uint16_t top = 0;
+    int      changed;
+
+    for (i = 0; i < g->count; i++) {
+        if (g->nodes[i].resident) {
+            g->nodes[i].layer = 0;
+            placed++;
+        }
+    }
+
+    do {
+        changed = 0;
+        for (i = 0; i < g->count; i++) {
+            NEModGraphNode *n = &g->nodes[i];
+            uint16_t        layer = 0;
+
+            if (n->layer != NE_MODGRAPH_NONE)
+                continue;
+            for (r = 0; r < n->dep_count; r++) {
+                const NEModGraphNode *d = &g->nodes[n->deps[r]];
+                if (n->deps[r] == i || d->resident)
+                    continue;
+                if (d->layer == NE_MODGRAPH_NONE)
+                    break;
+                if (d->layer + 1u > layer)
+                    layer = (uint16_t)(d->layer + 1u);
+            }
+            if (r < n->dep_count)
+                continue;
+            n->layer = layer;
+            if (layer > top)
+                top = layer;
+            placed++;
+            changed = 1;
+        }
+    } while (changed);
+
+    if (placed < g->count)
+        return mg_mark_cycle(g);
+
+    /* List the nodes layer by layer, in node order within a layer */
+    g->layer_count = (uint16_t)(top + 1u);
+    g->order       = (uint16_t *)NE_MALLOC((size_t)g->count * sizeof(uint16_t));
+    g->layer_start = (uint16_t *)NE_MALLOC((size_t)(g->layer_count + 1u) *
+                                           sizeof(uint16_t));
+    if (!g->order || !g->layer_start)
+        return NE_MODGRAPH_ERR_ALLOC;
+
+    placed = 0;
+    for (r = 0; r < g->layer_count; r++) {
+        g->layer_start[r] = placed;
+        for (i = 0; i < g->count; i++) {
+            if (g->nodes[i].layer == r)
+                g->order[placed++] = i;
+        }
+    }
+    g->layer_start[g->layer_count] = placed;
+    return NE_MODGRAPH_OK;
+}
+
+/* -------------------------------------------------------------------------
+ * ne_modgraph_build
+ * ---------------------------------------------------------------------- */
+
+int ne_modgraph_build(NEModGraph    *g,
+                      NEModuleTable *tbl,
+                      const char    *root_path,
+                      NEModLocateFn  locate,
+                      void          *user,
+                      unsigned       workers)
+{
+    return ne_modgraph_build_cached(g, tbl, NULL, root_path, locate, user,
+                                    workers);
+}
+
+int ne_modgraph_build_cached(NEModGraph    *g,
+                             NEModuleTable *tbl,
+                             NEImgCache    *cache,
+                             const char    *root_path,
+                             NEModLocateFn  locate,
+                             void          *user,
+                             unsigned       workers)
+{
+    uint16_t       *wave;
+    uint16_t       *next;
+    uint16_t       *swap;
+    uint16_t        wave_n = 1;
+    uint16_t        next_n;
+    uint16_t        root;
+    uint16_t        k;
+    uint16_t        r;
+    char            name[NE_MOD_NAME_MAX];
+    NEModuleHandle  h;
+    int             rc;
+
+    if (!g || !tbl || !root_path || !locate)
+        return NE_MODGRAPH_ERR_NULL;
+
+    memset(g, 0, sizeof(*g));
+    g->failed = NE_MODGRAPH_NONE;
+    g->cache  = cache;
+
+    wave = (uint16_t *)NE_MALLOC(NE_MODGRAPH_MAX_NODES * sizeof(uint16_t));
+    next = (uint16_t *)NE_MALLOC(NE_MODGRAPH_MAX_NODES * sizeof(uint16_t));
+    if (!wave || !next) {
+        rc = NE_MODGRAPH_ERR_ALLOC;
+        goto out;
+    }
+
+    mg_name_from_path(root_path, name);
+    rc = mg_add_node(g, name, &root);
+    if (rc != NE_MODGRAPH_OK)
+        goto out;
+    if (strlen(root_path) >= NE_MODGRAPH_PATH_MAX) {
+        g->nodes[root].status = rc = NE_MODGRAPH_ERR_NOT_FOUND;
+        g->failed = root;
+        goto out;
+    }
+    strcpy(g->nodes[root].path, root_path);
+    wave[0] = root;
+
+    while (wave_n > 0u) {
+        /* Acquiring from the cache is not thread-safe */
+        mg_run(g, wave, wave_n, mg_parse_node, cache ? 1u : workers);
+
+        next_n = 0;
+        for (k = 0; k < wave_n; k++) {
+            uint16_t        i = wave[k];
+            NEModGraphNode *n = &g->nodes[i];
+
+            if (n->status != NE_MODGRAPH_OK) {
+                g->failed = i;
+                rc = n->status;
+                goto out;
+            }
+
+            /* The root is known by its resident name once parsed */
+            if (i == root) {
+                if (ne_module_name(&n->parser)[0] != '\0') {
+                    strncpy(n->name, ne_module_name(&n->parser),
+                            NE_MOD_NAME_MAX - 1u);
+                    n->name[NE_MOD_NAME_MAX - 1u] = '\0';
+                }
+                h = ne_mod_find(tbl, n->name);
+                if (h != NE_MOD_HANDLE_INVALID) {
+                    ne_free(&n->parser);
+                    mg_drop_image(g, n);
+                    n->resident = 1;
+                    n->handle   = h;
+                    continue;
+                }
+            }
+
+            if (n->parser.module_ref_count > 0u) {
+                n->deps = (uint16_t *)NE_CALLOC(n->parser.module_ref_count,
+                                                sizeof(uint16_t));
+                if (!n->deps) {
+                    rc = NE_MODGRAPH_ERR_ALLOC;
+                    goto out;
+                }
+                n->dep_count = n->parser.module_ref_count;
+            }
+
+            for (r = 1; r <= g->nodes[i].dep_count; r++) {
+                uint16_t d;
+
+                rc = ne_module_ref_name(&g->nodes[i].parser, r, name,
+                                        sizeof(name));
+                if (rc != NE_OK) {
+                    g->nodes[i].status = NE_MODGRAPH_ERR_LOAD;
+                    g->nodes[i].detail = rc;
+                    g->failed = i;
+                    rc = NE_MODGRAPH_ERR_LOAD;
+                    goto out;
+                }
+
+                d = mg_find_node(g, name);
+                if (d == NE_MODGRAPH_NONE) {
+                    /* May move g->nodes */
+                    rc = mg_add_node(g, name, &d);
+                    if (rc != NE_MODGRAPH_OK)
+                        goto out;
+                    h = ne_mod_find(tbl, name);
+                    if (h != NE_MOD_HANDLE_INVALID) {
+                        g->nodes[d].resident = 1;
+                        g->nodes[d].handle   = h;
+                        g->nodes[d].exports  = ne_mod_exports(tbl, h);
+                    } else if (locate(name, g->nodes[d].path,
+                                      NE_MODGRAPH_PATH_MAX, user) != 0) {
+                        g->nodes[d].status = NE_MODGRAPH_ERR_NOT_FOUND;
+                        g->failed = d;
+                        rc = NE_MODGRAPH_ERR_NOT_FOUND;
+                        goto out;
+                    } else {
+                        next[next_n++] = d;
+                    }
+                }
+                g->nodes[i].deps[r - 1u] = d;
+            }
+        }
+
+        swap   = wave;
+        wave   = next;
+        next   = swap;
+        wave_n = next_n;
+    }
+
+    rc = mg_layer(g);
+
+out:
+    NE_FREE(wave);
+    NE_FREE(next);
+    return rc;
+}
+
+/* -------------------------------------------------------------------------
+ * ne_modgraph_load
+ * ---------------------------------------------------------------------- */
+
+/* Hand node i over to the module table */
+static int mg_register(NEModGraph *g, NEModuleTable *tbl, uint16_t i)
+{
+    NEModGraphNode *n = &g->nodes[i];
+    NEModuleHandle  h;
+    uint16_t        r;
+    int             rc;
+
+    /* A module of that name appeared since the graph was built */
+    if (ne_mod_find(tbl, n->name) != NE_MOD_HANDLE_INVALID) {
+        n->status = NE_MODGRAPH_ERR_LOAD;
+        return NE_MODGRAPH_ERR_LOAD;
+    }
+
+    rc = ne_mod_load(tbl, n->name, &n->parser, &n->loader, &h);
+    if (rc != NE_MOD_OK) {
+        n->status = (rc == NE_MOD_ERR_FULL) ? NE_MODGRAPH_ERR_FULL
+                                            : NE_MODGRAPH_ERR_LOAD;
+        n->detail = rc;
+        return n->status;
+    }
+    memset(&n->parser, 0, sizeof(n->parser));
+    memset(&n->loader, 0, sizeof(n->loader));
+    n->handle = h;
+
+    /* A cached module keeps resolving against the entry's exports */
+    if (!n->cached) {
+        ne_mod_set_exports(tbl, h, &n->own_exports);
+        n->exports = ne_mod_exports(tbl, h);
+    }
+
+    for (r = 0; r < n->dep_count; r++) {
+        if (n->deps[r] != i)
+            (void)ne_mod_add_dep(tbl, h, g->nodes[n->deps[r]].handle);
+    }
+    return NE_MODGRAPH_OK;
+}
+
+int ne_modgraph_load(NEModGraph     *g,
+                     NEModuleTable  *tbl,
+                     unsigned        workers,
+                     NEModuleHandle *out_root)
+{
+    uint16_t layer;
+    uint16_t k;
+    int      rc = NE_MODGRAPH_OK;
+
+    if (!g || !tbl || !out_root || !g->order)
+        return NE_MODGRAPH_ERR_NULL;
+
+    *out_root = NE_MOD_HANDLE_INVALID;
+
+    for (layer = 0; layer < g->layer_count; layer++) {
+        const uint16_t *list  = &g->order[g->layer_start[layer]];
+        uint16_t        count = (uint16_t)(g->layer_start[layer + 1u] -
+                                           g->layer_start[layer]);
+
+        mg_run(g, list, count, mg_load_node, workers);
+
+        for (k = 0; k < count; k++) {
+            if (g->nodes[list[k]].status != NE_MODGRAPH_OK) {
+                g->failed = list[k];
+                rc = NE_MODGRAPH_ERR_LOAD;
+                goto rollback;
+            }
+        }
+        for (k = 0; k < count; k++) {
+            if (g->nodes[list[k]].resident)
+                continue;
+            rc = mg_register(g, tbl, list[k]);
+            if (rc != NE_MODGRAPH_OK) {
+                g->failed = list[k];
+                goto rollback;
+            }
+        }
+    }
+
+    if (g->nodes[0].resident)
+        ne_mod_addref(tbl, g->nodes[0].handle);
+    *out_root = g->nodes[0].handle;
+    return NE_MODGRAPH_OK;
+
+rollback:
+    /* Dependents sit in later layers, so unload in reverse order */
+    for (k = g->count; k-- > 0u; ) {
+        NEModGraphNode *n = &g->nodes[g->order[k]];
+        if (!n->resident && n->handle != NE_MOD_HANDLE_INVALID) {
+            ne_mod_unload(tbl, n->handle);
+            n->handle  = NE_MOD_HANDLE_INVALID;
+            n->exports = NULL;
+        }
+    }
+    return rc;
+}
+
+/* -------------------------------------------------------------------------
+ * ne_modgraph_critical_path
+ * ---------------------------------------------------------------------- */
+
+uint16_t ne_modgraph_critical_path(const NEModGraph *g,
+                                   uint16_t         *out,
+                                   uint16_t          max,
+                                   uint32_t         *total_us)
+{
+    uint32_t *best;
+    uint16_t *via;
+    uint16_t  k;
+    uint16_t  r;
+    uint16_t  n = 0;
+    uint16_t  cur;
+    uint32_t  b;
+
+    if (total_us)
+        *total_us = 0;
+    if (!g || !g->order || g->count == 0)
+        return 0;
+
+    best = (uint32_t *)NE_CALLOC(g->count, sizeof(uint32_t));
+    via  = (uint16_t *)NE_MALLOC((size_t)g->count * sizeof(uint16_t));
+    if (!best || !via) {
+        NE_FREE(best);
+        NE_FREE(via);
+        return 0;
+    }
+
+    /* Dependencies come first in 'order', so their totals are final */
+    for (k = 0; k < g->count; k++) {
+        uint16_t              i  = g->order[k];
+        const NEModGraphNode *nd = &g->nodes[i];
+        uint32_t              w  = nd->resident ? 0u
+                                 : (nd->load_us ? nd->load_us : 1u);
+
+        via[i] = NE_MODGRAPH_NONE;
+        b      = 0;
+        for (r = 0; r < nd->dep_count; r++) {
+            uint16_t d = nd->deps[r];
+            if (d != i && best[d] > b) {
+                b      = best[d];
+                via[i] = d;
+            }
+        }
+        best[i] = w + b;
+    }
+
+    for (cur = 0; cur != NE_MODGRAPH_NONE; cur = via[cur]) {
+        if (n < max && out)
+            out[n] = cur;
+        n++;
+    }
+    if (total_us)
+        *total_us = best[0];
+
+    NE_FREE(best);
+    NE_FREE(via);
+    return n;
+}
+
+/* -------------------------------------------------------------------------
+ * ne_modgraph_locate_dir
+ * ---------------------------------------------------------------------- */
+
+int ne_modgraph_locate_dir(const char *module, char *path,
+                           size_t path_size, void *user)
+{
+    static const char *const exts[] = { ".DLL", ".EXE", ".DRV" };
+    const char *dir = (const char *)user;
+    char        file[NE_MOD_NAME_MAX + 4];
+    FILE       *fp;
+    size_t      n;
+    size_t      j;
+    unsigned    e;
+    int         lower;
+
+    if (!module || !path || !dir || path_size == 0)
+        return -1;
+
+    n = strlen(module);
+    if (n >= NE_MOD_NAME_MAX || strlen(dir) + 1u + n + 4u >= path_size)
+        return -1;
+
+    for (lower = 0; lower < 2; lower++) {
+        for (e = 0; e < sizeof(exts) / sizeof(exts[0]); e++) {
+            sprintf(file, "%s%s", module, exts[e]);
+            if (lower) {
+                for (j = 0; file[j]; j++)
+                    file[j] = mg_lower(file[j]);
+            }
+            sprintf(path, "%s%c%s", dir, NE_MODGRAPH_SEP, file);
+            fp = fopen(path, "rb");
+            if (fp) {
+                fclose(fp);
+                return 0;
+            }
+        }
+    }
+    path[0] = '\0';
+    return -1;
+}
+
+/* -------------------------------------------------------------------------
+ * ne_modgraph_print
+ * ---------------------------------------------------------------------- */
+
+void ne_modgraph_print(const NEModGraph *g, FILE *out)
+{
+    uint16_t path[NE_MODGRAPH_MAX_NODES];
+    uint16_t layer;
+    uint16_t len;
+    uint16_t k;
+    uint16_t r;
+    uint32_t total;
+
+    if (!g || !out)
+        return;
+
+    fprintf(out, "Module graph: %u module(s), %u layer(s)\n",
+            (unsigned)g->count, (unsigned)g->layer_count);
+
+    if (!g->order) {
+        /* Not layered (failed build): list the nodes as found */
+        for (k = 0; k < g->count; k++) {
+            const NEModGraphNode *n = &g->nodes[k];
+            fprintf(out, "  %-8s  %s\n", n->name,
+                    ne_modgraph_strerror(n->status));
+        }
+        return;
+    }
+
+    for (layer = 0; layer < g->layer_count; layer++) {
+        fprintf(out, "  Layer %u:\n", (unsigned)layer);
+        for (k = g->layer_start[layer]; k < g->layer_start[layer + 1u]; k++) {
+            const NEModGraphNode *n = &g->nodes[g->order[k]];
+
+            fprintf(out, "    %-8s", n->name);
+            if (n->resident)
+                fprintf(out, " (resident)");
+            else
+                fprintf(out, " %lu us", (unsigned long)n->load_us);
+            if (n->dep_count > 0u) {
+                fprintf(out, "  <-");
+                for (r = 0; r < n->dep_count; r++)
+                    fprintf(out, " %s", g->nodes[n->deps[r]].name);
+            }
+            if (n->status != NE_MODGRAPH_OK)
+                fprintf(out, "  [%s]", ne_modgraph_strerror(n->status));
+            fputc('\n', out);
+        }
+    }
+
+    len = ne_modgraph_critical_path(g, path, NE_MODGRAPH_MAX_NODES, &total);
+    if (len > 0u) {
+        fprintf(out, "  Critical path (%lu us):", (unsigned long)total);
+        for (k = 0; k < len; k++)
+            fprintf(out, "%s%s", k ? " -> " : " ", g->nodes[path[k]].name);
+        fputc('\n', out);
+    }
+}
+
+/* -------------------------------------------------------------------------
+ * ne_modgraph_free
+ * ---------------------------------------------------------------------- */
+
+void ne_modgraph_free(NEModGraph *g)
+{
+    uint16_t i;
+
+    if (!g)
+        return;
+
+    for (i = 0; i < g->count; i++) {
+        NEModGraphNode *n = &g->nodes[i];
+        NE_FREE(n->deps);
+        ne_export_free(&n->own_exports);
+        ne_loader_free(&n->loader);
+        ne_free(&n->parser);
+        mg_drop_image(g, n);
+    }
+    NE_FREE(g->nodes);
+    NE_FREE(g->order);
+    NE_FREE(g->layer_start);
+    memset(g, 0, sizeof(*g));
+}
+
+/* -------------------------------------------------------------------------
+ * ne_modgraph_strerror
+ * ---------------------------------------------------------------------- */
+
+const char *ne_modgraph_strerror(int err)
+{
+    switch (err) {
+    case NE_MODGRAPH_OK:            return "success";
+    case NE_MODGRAPH_ERR_NULL:      return "NULL argument";
+    case NE_MODGRAPH_ERR_ALLOC:     return "memory allocation failure";
+    case NE_MODGRAPH_ERR_NOT_FOUND: return "module not found";
+    case NE_MODGRAPH_ERR_LOAD:      return "module failed to load";
+    case NE_MODGRAPH_ERR_CYCLE:     return "import cycle";
+    case NE_MODGRAPH_ERR_FULL:      return "too many modules";
+    default:                        return "unknown error";
+    }
+}
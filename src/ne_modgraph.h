@@ -0,0 +1,245 @@
+/*
+ * ne_modgraph.h - Dependency-graph batch loading of NE modules
+ *
+ * ne_modgraph_build() starts from one module file and follows the
+ * module-reference tables to the transitive closure of its imports,
+ * locating each referenced module through a caller-supplied callback.
+ * Modules already present in the module table are leaves of the graph
+ * and are not read again.  The closure is then sorted into layers: layer
+ * 0 holds modules with no unloaded dependencies, and every module sits
+ * one layer above its deepest dependency, so the modules of one layer
+ * never depend on each other.
+ *
+ * ne_modgraph_load() loads the graph layer by layer.  On the POSIX host
+ * the modules of a layer are loaded, given their export tables and
+ * relocated by a pool of worker threads; imports are resolved straight
+ * from the dependencies' export tables, so the workers never touch the
+ * module table.  Once a layer is done it is registered in the table
+ * serially.  On the Watcom/DOS target the same code runs in a plain
+ * loop.  The discovery parse in ne_modgraph_build() is parallel in the
+ * same way, one breadth-first wave at a time.
+ *
+ * A cycle in the imports cannot be ordered: ne_modgraph_build() then
+ * reports NE_MODGRAPH_ERR_CYCLE and marks the modules on the cycle.
+ * ne_modgraph_critical_path() returns the chain of dependencies with the
+ * largest total load time, which bounds how fast the batch can finish.
+ *
+ * ne_modgraph_build_cached() takes the module files from an NEImgCache
+ * (ne_imgcache.h) instead of opening them: a module that was loaded
+ * before is then relocated from the cached relocation plan and resolved
+ * against the cached export table, and the validation verdict of the
+ * cached image selects the loader's trusted fast path.
+ *
+ * Reference: Microsoft "New Executable" format specification.
+ */
+
+#ifndef NE_MODGRAPH_H
+#define NE_MODGRAPH_H
+
+#include "ne_parser.h"
+#include "ne_loader.h"
+#include "ne_impexp.h"
+#include "ne_module.h"
+#include "ne_imgcache.h"
+
+#include <stdio.h>
+
+/* -------------------------------------------------------------------------
+ * Error codes
+ * ---------------------------------------------------------------------- */
+#define NE_MODGRAPH_OK             0
+#define NE_MODGRAPH_ERR_NULL      -1   /* NULL pointer argument              */
+#define NE_MODGRAPH_ERR_ALLOC     -2   /* memory allocation failure          */
+#define NE_MODGRAPH_ERR_NOT_FOUND -3   /* referenced module cannot be found  */
+#define NE_MODGRAPH_ERR_LOAD      -4   /* parse, load or relocation failed   */
+#define NE_MODGRAPH_ERR_CYCLE     -5   /* imports form a cycle               */
+#define NE_MODGRAPH_ERR_FULL      -6   /* graph or module table is full      */
+
+/* -------------------------------------------------------------------------
+ * Configuration
+ * ---------------------------------------------------------------------- */
+#define NE_MODGRAPH_MAX_NODES   256u  /* modules in one graph              */
+#define NE_MODGRAPH_PATH_MAX    260u  /* max path length incl. NUL         */
+#define NE_MODGRAPH_MAX_WORKERS  64u  /* upper bound on worker threads     */
+#define NE_MODGRAPH_NONE     0xFFFFu  /* no node / no layer                */
+
+/*
+ * NEModLocateFn - find the file for module 'module' (a module-reference
+ * name such as "USER").  Writes a NUL-terminated path of at most
+ * 'path_size' bytes to 'path' and returns 0, or returns non-zero when the
+ * module cannot be found.  ne_modgraph_locate_dir() is a ready-made one.
+ */
+typedef int (*NEModLocateFn)(const char *module, char *path,
+                             size_t path_size, void *user);
+
+/* -------------------------------------------------------------------------
+ * Graph
+ * ---------------------------------------------------------------------- */
+
+/*
+ * NEModGraphNode - one module of the closure.
+ *
+ * 'deps' has one node index per module-reference entry, so import
+ * relocation ref1 = i maps to deps[i - 1].  A 'resident' node was already
+ * in the module table when the graph was built: it has no file, no deps
+ * and layer 0, and 'handle' is set from the start.
+ *
+ * 'status' is NE_MODGRAPH_OK, or the error that stopped this module; for
+ * NE_MODGRAPH_ERR_LOAD 'detail' holds the NE_ERR_*, NE_LOAD_ERR_* or
+ * NE_RELOC_ERR_* code of the failing step.
+ *
+ * The remaining fields are working state owned by the graph until the
+ * module is registered in the table.  'cached' is the image cache entry
+ * the module was read from (graphs built with ne_modgraph_build_cached());
+ * it is held until ne_modgraph_free().
+ */
+typedef struct {
+    char                 name[NE_MOD_NAME_MAX];   /* module name            */
+    char                 path[NE_MODGRAPH_PATH_MAX]; /* file ("" if resident) */
+    int                  status;     /* NE_MODGRAPH_OK or failure          */
+    int                  detail;     /* sub-module error code              */
+    uint16_t             resident;   /* non-zero: already in the table     */
+    uint16_t             layer;      /* load layer, or NE_MODGRAPH_NONE    */
+    uint16_t            *deps;       /* [module-ref index - 1] -> node     */
+    uint16_t             dep_count;  /* entries in deps                    */
+    NEModuleHandle       handle;     /* table handle once registered       */
+    uint32_t             load_us;    /* parse + load + relocate time       */
+
+    NEImage              image;      /* open file image                    */
+    const NEImgCacheEntry *cached;   /* cache entry held, or NULL          */
+    NEParserContext      parser;     /* parsed headers (copied tables)     */
+    NELoaderContext      loader;     /* loaded segments                    */
+    NEExportTable        own_exports;/* built exports before registration  */
+    const NEExportTable *exports;    /* exports used to resolve importers  */
+} NEModGraphNode;
+
+/*
+ * NEModGraph - the closure of one root module.  Node 0 is the root.
+ * 'order' lists the node indices layer by layer (ascending); layer L
+ * occupies order[layer_start[L] .. layer_start[L + 1] - 1].
+ *
+ * Release with ne_modgraph_free().
+ */
+typedef struct {
+    NEModGraphNode *nodes;        /* heap array [0 .. count-1]             */
+    uint16_t        count;        /* nodes in the closure                  */
+    uint16_t        capacity;     /* allocated nodes                       */
+    uint16_t       *order;        /* node indices sorted by layer          */
+    uint16_t       *layer_start;  /* [layer_count + 1] offsets into order  */
+    uint16_t        layer_count;  /* number of layers                      */
+    uint16_t        cycle_count;  /* nodes on the cycle found, if any      */
+    uint16_t        failed;       /* first failing node, or NE_MODGRAPH_NONE */
+    NEImgCache     *cache;        /* image cache the files come from, or NULL */
+} NEModGraph;
+
+/* -------------------------------------------------------------------------
+ * Public API
+ * ---------------------------------------------------------------------- */
+
+/*
+ * ne_modgraph_build - build the dependency closure of the module file
+ * 'root_path' into *g.
+ *
+ * Referenced modules found in 'tbl' (by ne_mod_find()) become resident
+ * leaves; the others are located with 'locate' (called with 'user') and
+ * parsed.  'workers' is the number of parser threads per wave; 0 picks
+ * one per online CPU.  It is clamped to NE_MODGRAPH_MAX_WORKERS and
+ * ignored on the DOS target.
+ *
+ * Returns NE_MODGRAPH_OK, NE_MODGRAPH_ERR_NOT_FOUND (g->failed names the
+ * module that could not be located or opened), NE_MODGRAPH_ERR_LOAD for a
+ * parse error, NE_MODGRAPH_ERR_CYCLE, NE_MODGRAPH_ERR_FULL or another
+ * NE_MODGRAPH_ERR_* code.  On every return except ERR_NULL the caller
+ * must call ne_modgraph_free(); *g can still be printed.
+ */
+int ne_modgraph_build(NEModGraph    *g,
+                      NEModuleTable *tbl,
+                      const char    *root_path,
+                      NEModLocateFn  locate,
+                      void          *user,
+                      unsigned       workers);
+
+/*
+ * ne_modgraph_build_cached - ne_modgraph_build() with every module file
+ * acquired from 'cache' (which must stay alive until ne_modgraph_free()).
+ *
+ * Each node holds its entry until the graph is freed.  The header is
+ * still parsed into a private copy per node, since the module table
+ * takes ownership of it; relocation records and exports are not parsed
+ * again.  The cache is not thread-safe, so the discovery parse runs on
+ * the calling thread; ne_modgraph_load() stays parallel, as the workers
+ * only read the entries.  A file the cache rejects as not an NE image
+ * fails with NE_MODGRAPH_ERR_LOAD, any other cache error with
+ * NE_MODGRAPH_ERR_NOT_FOUND ('detail' holds the NE_IMGCACHE_ERR_* code).
+ */
+int ne_modgraph_build_cached(NEModGraph    *g,
+                             NEModuleTable *tbl,
+                             NEImgCache    *cache,
+                             const char    *root_path,
+                             NEModLocateFn  locate,
+                             void          *user,
+                             unsigned       workers);
+
+/*
+ * ne_modgraph_load - load every non-resident module of a built graph into
+ * 'tbl', dependencies first, and return the root's handle in *out_root.
+ *
+ * Each module is loaded with ne_load_buffer(), relocated with imports
+ * resolved against its dependencies' export tables, then registered with
+ * ne_mod_load(), ne_mod_set_exports() and ne_mod_add_dep() (dependencies
+ * beyond NE_MOD_DEP_MAX are not recorded).  Modules from an image cache
+ * are relocated with ne_reloc_plan_apply() and registered without an
+ * export table; the table builds its own on first use.  A resident root gets an extra
+ * reference instead.  'workers' is as for ne_modgraph_build().
+ *
+ * On failure the modules this call registered are unloaded again, the
+ * failing node carries the error and g->failed its index, and
+ * NE_MODGRAPH_ERR_LOAD or NE_MODGRAPH_ERR_FULL is returned.
+ */
+int ne_modgraph_load(NEModGraph     *g,
+                     NEModuleTable  *tbl,
+                     unsigned        workers,
+                     NEModuleHandle *out_root);
+
+/*
+ * ne_modgraph_critical_path - write the node indices of the dependency
+ * chain with the largest total load_us (each node counting at least 1,
+ * so before loading this is the longest chain) to 'out', starting at the
+ * root, at most 'max' of them.
+ *
+ * Returns the number of nodes on the path (which may exceed 'max'), and
+ * stores the chain's total time in *total_us if non-NULL.  Returns 0 for
+ * an empty or cyclic graph.
+ */
+uint16_t ne_modgraph_critical_path(const NEModGraph *g,
+                                   uint16_t         *out,
+                                   uint16_t          max,
+                                   uint32_t         *total_us);
+
+/*
+ * ne_modgraph_locate_dir - NEModLocateFn that looks for MODULE.DLL,
+ * MODULE.EXE and MODULE.DRV (as given, then in lower case) in the
+ * directory 'user' (a const char *).
+ */
+int ne_modgraph_locate_dir(const char *module, char *path,
+                           size_t path_size, void *user);
+
+/*
+ * ne_modgraph_print - write the layers, each module's dependencies and
+ * status, and the critical path to 'out'.
+ */
+void ne_modgraph_print(const NEModGraph *g, FILE *out);
+
+/*
+ * ne_modgraph_free - release everything the graph still owns (modules
+ * that were registered in the table belong to the table).
+ * Safe to call on a zeroed graph and on NULL.
+ */
+void ne_modgraph_free(NEModGraph *g);
+
+/*
+ * ne_modgraph_strerror - return a static string describing error code 'err'.
+ */
+const char *ne_modgraph_strerror(int err);
+
+#endif /* NE_MODGRAPH_H */
@@ -11,25 +11,120 @@
 
 #include <string.h>
 
+/* -------------------------------------------------------------------------
+ * Name and handle indexes
+ * ---------------------------------------------------------------------- */
+
+/* ASCII upper case, independent of the C locale */
+static unsigned char fold_upper(char c)
+{
+    unsigned char u = (unsigned char)c;
+    return (u >= 'a' && u <= 'z') ? (unsigned char)(u - 0x20u) : u;
+}
+
+/*
+ * Compare like strncmp(stored, name, NE_MOD_NAME_MAX) == 0 but ignoring
+ * case, so a name longer than any stored one never matches.
+ */
+static int name_eq_nocase(const char *stored, const char *name)
+{
+    uint16_t i;
+
+    for (i = 0; i < NE_MOD_NAME_MAX; i++) {
+        if (fold_upper(stored[i]) != fold_upper(name[i]))
+            return 0;
+        if (stored[i] == '\0')
+            return 1;
+    }
+    return 1;
+}
+
+/* FNV-1a over the upper-cased name, at most as long as a stored one */
+static uint32_t name_hash(const char *name)
+{
+    uint32_t h = 2166136261UL;
+    uint16_t i;
+
+    for (i = 0; i < NE_MOD_NAME_MAX - 1u && name[i]; i++)
+        h = (h ^ fold_upper(name[i])) * 16777619UL;
+    return h;
+}
+
+/* Handles are handed out in sequence, so they spread over the slots as-is */
+static uint32_t slot_home(const NEModuleTable *tbl, const uint16_t *index,
+                          uint16_t value)
+{
+    const NEModuleEntry *e = &tbl->entries[value - 1u];
+
+    if (index == tbl->name_index)
+        return name_hash(e->name) & tbl->index_mask;
+    return (uint32_t)e->handle & tbl->index_mask;
+}
+
+static void index_insert(NEModuleTable *tbl, uint16_t *index, uint32_t pos,
+                         uint16_t value)
+{
+    while (index[pos] != 0u)
+        pos = (pos + 1u) & tbl->index_mask;
+    index[pos] = value;
+}
+
+/*
+ * index_remove - delete 'value', probing from 'pos', and shift later
+ * members of its cluster back so that no probe sequence is broken.
+ */
+static void index_remove(NEModuleTable *tbl, uint16_t *index, uint32_t pos,
+                         uint16_t value)
+{
+    uint32_t mask = tbl->index_mask;
+    uint32_t next;
+    uint32_t home;
+
+    while (index[pos] != value) {
+        if (index[pos] == 0u)
+            return;
+        pos = (pos + 1u) & mask;
+    }
+
+    for (;;) {
+        index[pos] = 0u;
+        next = pos;
+        for (;;) {
+            next = (next + 1u) & mask;
+            if (index[next] == 0u)
+                return;
+            home = slot_home(tbl, index, index[next]);
+            /* Movable when 'pos' lies on the path from its home to 'next' */
+            if (((next - home) & mask) >= ((next - pos) & mask))
+                break;
+        }
+        index[pos] = index[next];
+        pos = next;
+    }
+}
+
 /* -------------------------------------------------------------------------
  * Internal helpers
  * ---------------------------------------------------------------------- */
 
 /*
- * find_slot_by_handle - scan entries[] for an active slot with handle h.
- * Returns a pointer to the entry or NULL.
+ * find_slot_by_handle - look up the active slot with handle h in the
+ * handle index.  Returns a pointer to the entry or NULL.
  */
 static NEModuleEntry *find_slot_by_handle(NEModuleTable *tbl,
                                           NEModuleHandle h)
 {
-    uint16_t i;
+    uint32_t pos;
+    uint16_t v;
 
-    if (!tbl || !tbl->entries || h == NE_MOD_HANDLE_INVALID)
+    if (!tbl || !tbl->handle_index || h == NE_MOD_HANDLE_INVALID)
         return NULL;
 
-    for (i = 0; i < tbl->capacity; i++) {
-        if (tbl->entries[i].handle == h)
-            return &tbl->entries[i];
+    for (pos = (uint32_t)h & tbl->index_mask;
+         (v = tbl->handle_index[pos]) != 0u;
+         pos = (pos + 1u) & tbl->index_mask) {
+        if (tbl->entries[v - 1u].handle == h)
+            return &tbl->entries[v - 1u];
     }
     return NULL;
 }
@@ -79,10 +174,19 @@ static int is_depended_on(const NEModuleTable *tbl, NEModuleHandle target)
 /*
  * release_entry - free owned contexts and zero the slot so it can be reused.
  */
-static void release_entry(NEModuleEntry *e)
+static void release_entry(NEModuleTable *tbl, NEModuleEntry *e)
 {
+    uint16_t value = (uint16_t)(e - tbl->entries + 1);
+
+    index_remove(tbl, tbl->name_index,
+                 name_hash(e->name) & tbl->index_mask, value);
+    index_remove(tbl, tbl->handle_index,
+                 (uint32_t)e->handle & tbl->index_mask, value);
+
     ne_free(&e->parser);
     ne_loader_free(&e->loader);
+    ne_export_free(&e->exports);
+    NE_FREE(e->ref_handles);
     memset(e, 0, sizeof(*e));
 }
 
@@ -92,6 +196,8 @@ static void release_entry(NEModuleEntry *e)
 
 int ne_mod_table_init(NEModuleTable *tbl, uint16_t capacity)
 {
+    uint32_t slots;
+
     if (!tbl)
         return NE_MOD_ERR_NULL;
     if (capacity == 0)
@@ -99,9 +205,23 @@ int ne_mod_table_init(NEModuleTable *tbl, uint16_t capacity)
 
     memset(tbl, 0, sizeof(*tbl));
 
-    tbl->entries = (NEModuleEntry *)NE_CALLOC(capacity, sizeof(NEModuleEntry));
-    if (!tbl->entries)
+    /* Keep the indexes at most half full so probe runs stay short */
+    slots = 4u;
+    while (slots < 2u * (uint32_t)capacity)
+        slots <<= 1;
+
+    tbl->entries      = (NEModuleEntry *)NE_CALLOC(capacity,
+                                                   sizeof(NEModuleEntry));
+    tbl->name_index   = (uint16_t *)NE_CALLOC(slots, sizeof(uint16_t));
+    tbl->handle_index = (uint16_t *)NE_CALLOC(slots, sizeof(uint16_t));
+    if (!tbl->entries || !tbl->name_index || !tbl->handle_index) {
+        NE_FREE(tbl->entries);
+        NE_FREE(tbl->name_index);
+        NE_FREE(tbl->handle_index);
+        memset(tbl, 0, sizeof(*tbl));
         return NE_MOD_ERR_ALLOC;
+    }
+    tbl->index_mask = slots - 1u;
 
     tbl->capacity    = capacity;
     tbl->count       = 0;
@@ -124,10 +244,12 @@ void ne_mod_table_free(NEModuleTable *tbl)
     if (tbl->entries) {
         for (i = 0; i < tbl->capacity; i++) {
             if (tbl->entries[i].handle != NE_MOD_HANDLE_INVALID)
-                release_entry(&tbl->entries[i]);
+                release_entry(tbl, &tbl->entries[i]);
         }
         NE_FREE(tbl->entries);
     }
+    NE_FREE(tbl->name_index);
+    NE_FREE(tbl->handle_index);
 
     memset(tbl, 0, sizeof(*tbl));
 }
@@ -166,11 +288,14 @@ int ne_mod_load(NEModuleTable  *tbl,
     if (!slot)
         return NE_MOD_ERR_FULL;
 
-    /* Assign the next handle, wrapping around but skipping 0 */
-    h = tbl->next_handle;
-    tbl->next_handle++;
-    if (tbl->next_handle == NE_MOD_HANDLE_INVALID)
-        tbl->next_handle = 1;
+    /* Assign the next handle, wrapping around but skipping 0 and handles
+     * still held by long-lived modules */
+    do {
+        h = tbl->next_handle;
+        tbl->next_handle++;
+        if (tbl->next_handle == NE_MOD_HANDLE_INVALID)
+            tbl->next_handle = 1;
+    } while (find_slot_by_handle(tbl, h));
 
     /* Populate the entry; transfer ownership of parser and loader */
     memset(slot, 0, sizeof(*slot));
@@ -186,6 +311,11 @@ int ne_mod_load(NEModuleTable  *tbl,
     if (loader)
         slot->loader = *loader;
 
+    index_insert(tbl, tbl->name_index, name_hash(slot->name) & tbl->index_mask,
+                 (uint16_t)(slot - tbl->entries + 1));
+    index_insert(tbl, tbl->handle_index, (uint32_t)h & tbl->index_mask,
+                 (uint16_t)(slot - tbl->entries + 1));
+
     tbl->count++;
     *out_handle = h;
     return NE_MOD_OK;
@@ -242,7 +372,7 @@ int ne_mod_unload(NEModuleTable *tbl, NEModuleHandle handle)
         return NE_MOD_ERR_IN_USE;
 
     /* Free owned resources and mark the slot as available */
-    release_entry(e);
+    release_entry(tbl, e);
     tbl->count--;
 
     return NE_MOD_OK;
@@ -292,17 +422,17 @@ int ne_mod_add_dep(NEModuleTable *tbl,
 
 NEModuleHandle ne_mod_find(const NEModuleTable *tbl, const char *name)
 {
-    uint16_t i;
+    uint32_t pos;
+    uint16_t v;
 
-    if (!tbl || !tbl->entries || !name)
+    if (!tbl || !tbl->name_index || !name)
         return NE_MOD_HANDLE_INVALID;
 
-    for (i = 0; i < tbl->capacity; i++) {
-        const NEModuleEntry *e = &tbl->entries[i];
-        if (e->handle == NE_MOD_HANDLE_INVALID)
-            continue;
-        if (strncmp(e->name, name, NE_MOD_NAME_MAX) == 0)
-            return e->handle;
+    for (pos = name_hash(name) & tbl->index_mask;
+         (v = tbl->name_index[pos]) != 0u;
+         pos = (pos + 1u) & tbl->index_mask) {
+        if (name_eq_nocase(tbl->entries[v - 1u].name, name))
+            return tbl->entries[v - 1u].handle;
     }
     return NE_MOD_HANDLE_INVALID;
 }
@@ -316,6 +446,130 @@ NEModuleEntry *ne_mod_get(NEModuleTable *tbl, NEModuleHandle handle)
     return find_slot_by_handle(tbl, handle);
 }
 
+/* -------------------------------------------------------------------------
+ * Export tables and import resolution
+ * ---------------------------------------------------------------------- */
+
+const NEExportTable *ne_mod_exports(NEModuleTable *tbl, NEModuleHandle handle)
+{
+    NEModuleEntry *e = find_slot_by_handle(tbl, handle);
+
+    if (!e)
+        return NULL;
+
+    if (!e->exports_ready) {
+        if (ne_export_build_parsed(&e->parser, NE_EXPORT_NAMES,
+                                   &e->exports) != NE_IMPEXP_OK)
+            return NULL;
+        e->exports_ready = 1;
+    }
+    return &e->exports;
+}
+
+int ne_mod_set_exports(NEModuleTable  *tbl,
+                       NEModuleHandle  handle,
+                       NEExportTable  *exports)
+{
+    NEModuleEntry *e;
+
+    if (!tbl || !exports)
+        return NE_MOD_ERR_NULL;
+    if (handle == NE_MOD_HANDLE_INVALID)
+        return NE_MOD_ERR_BAD_HANDLE;
+
+    e = find_slot_by_handle(tbl, handle);
+    if (!e)
+        return NE_MOD_ERR_NOT_FOUND;
+
+    ne_export_free(&e->exports);
+    e->exports       = *exports;
+    e->exports_ready = 1;
+    memset(exports, 0, sizeof(*exports));
+    return NE_MOD_OK;
+}
+
+NEModuleHandle ne_mod_ref_handle(NEModuleTable  *tbl,
+                                 NEModuleHandle  importer,
+                                 uint16_t        ref_index)
+{
+    NEModuleEntry  *e = find_slot_by_handle(tbl, importer);
+    NEModuleEntry  *c;
+    NEModuleHandle  h;
+    char            name[NE_MOD_NAME_MAX];
+
+    if (!e || ref_index == 0 || ref_index > e->parser.module_ref_count)
+        return NE_MOD_HANDLE_INVALID;
+
+    if (ne_module_ref_name(&e->parser, ref_index, name, sizeof(name)) != NE_OK)
+        return NE_MOD_HANDLE_INVALID;
+
+    if (!e->ref_handles)
+        e->ref_handles = (NEModuleHandle *)NE_CALLOC(
+            e->parser.module_ref_count, sizeof(NEModuleHandle));
+
+    /*
+     * next_handle wraps, so the cached handle may since have been given to
+     * another module: only trust it while it still carries the same name.
+     */
+    if (e->ref_handles) {
+        h = e->ref_handles[ref_index - 1u];
+        if (h != NE_MOD_HANDLE_INVALID &&
+            (c = find_slot_by_handle(tbl, h)) != NULL &&
+            name_eq_nocase(c->name, name))
+            return h;
+    }
+
+    h = ne_mod_find(tbl, name);
+
+    if (e->ref_handles)
+        e->ref_handles[ref_index - 1u] = h;
+    return h;
+}
+
+int ne_mod_import_resolver(uint16_t       mod_idx,
+                           uint16_t       ref2,
+                           int            by_name,
+                           const uint8_t *imported_names,
+                           uint16_t       imp_names_size,
+                           uint16_t      *out_seg,
+                           uint16_t      *out_offset,
+                           void          *userdata)
+{
+    const NEModImportContext *ic = (const NEModImportContext *)userdata;
+    const NEExportTable      *exports;
+    const NEExportEntry      *entry;
+    NEModuleHandle            h;
+    char                      name[NE_EXPORT_NAME_MAX];
+    uint8_t                   len;
+
+    if (!ic || !out_seg || !out_offset)
+        return NE_MOD_ERR_NOT_FOUND;
+
+    h = ne_mod_ref_handle(ic->table, ic->importer, mod_idx);
+    exports = ne_mod_exports(ic->table, h);
+    if (!exports)
+        return NE_MOD_ERR_NOT_FOUND;
+
+    if (by_name) {
+        if (!imported_names || ref2 >= imp_names_size)
+            return NE_MOD_ERR_NOT_FOUND;
+        len = imported_names[ref2];
+        if ((uint32_t)ref2 + 1u + len > imp_names_size)
+            return NE_MOD_ERR_NOT_FOUND;
+        memcpy(name, imported_names + ref2 + 1u, len);
+        name[len] = '\0';
+        entry = ne_export_find_by_name_nocase(exports, name);
+    } else {
+        entry = ne_export_find_by_ordinal(exports, ref2);
+    }
+    if (!entry)
+        return NE_MOD_ERR_NOT_FOUND;
+
+    *out_seg    = entry->segment;
+    *out_offset = entry->offset;
+    return NE_MOD_OK;
+}
+
 /* -------------------------------------------------------------------------
  * ne_mod_strerror
  * ---------------------------------------------------------------------- */
@@ -18,6 +18,7 @@
 
 #include "ne_parser.h"
 #include "ne_loader.h"
+#include "ne_impexp.h"
 
 /* -------------------------------------------------------------------------
  * Error codes
@@ -34,12 +35,12 @@
 /* -------------------------------------------------------------------------
  * Configuration constants
  *
- * NE_MOD_TABLE_CAP : default initial capacity of the module table.
+ * NE_MOD_TABLE_CAP : default capacity of the module table.
  * NE_MOD_NAME_MAX  : maximum module name length including the NUL byte.
  *                    Matches the 8-character DOS base-name limit.
  * NE_MOD_DEP_MAX   : maximum number of direct dependencies per module.
  * ---------------------------------------------------------------------- */
-#define NE_MOD_TABLE_CAP  64u
+#define NE_MOD_TABLE_CAP 256u
 #define NE_MOD_NAME_MAX    9u   /* 8 chars + NUL */
 #define NE_MOD_DEP_MAX    16u
 
@@ -59,6 +60,10 @@ typedef uint16_t NEModuleHandle;
  * Owns the parser and loader contexts; they are freed when the entry is
  * removed from the table.  Callers must NOT call ne_free() or
  * ne_loader_free() on contexts that have been passed to ne_mod_load().
+ *
+ * 'exports' is built from the parser on first use by ne_mod_exports() (or
+ * supplied with ne_mod_set_exports()).  'ref_handles' caches, per entry of
+ * the module-reference table, the handle that reference resolved to.
  * ---------------------------------------------------------------------- */
 typedef struct {
     NEModuleHandle  handle;               /* unique 1-based handle (0 = free) */
@@ -68,6 +73,9 @@ typedef struct {
     NELoaderContext loader;               /* owned loader context              */
     NEModuleHandle  deps[NE_MOD_DEP_MAX]; /* direct dependency handles        */
     uint16_t        dep_count;            /* number of entries in deps[]       */
+    NEExportTable   exports;              /* owned export table               */
+    uint16_t        exports_ready;        /* non-zero once 'exports' is valid  */
+    NEModuleHandle *ref_handles;          /* [module-ref index - 1], 0: unset */
 } NEModuleEntry;
 
 /* -------------------------------------------------------------------------
@@ -75,12 +83,20 @@ typedef struct {
  *
  * Holds all currently loaded modules.  Initialise with ne_mod_table_init()
  * before use and release with ne_mod_table_free() when done.
+ *
+ * 'name_index' and 'handle_index' are open-addressed hash tables (linear
+ * probing, index_mask + 1 slots, at least twice the capacity) holding
+ * entry index + 1, keyed by upper-cased name and by handle.  They are
+ * kept up to date by ne_mod_load() and ne_mod_unload().
  * ---------------------------------------------------------------------- */
 typedef struct {
     NEModuleEntry *entries;    /* heap-allocated array of capacity entries   */
     uint16_t       capacity;   /* total slots allocated                      */
     uint16_t       count;      /* number of occupied (active) slots          */
     uint16_t       next_handle;/* next handle value to assign (starts at 1)  */
+    uint16_t      *name_index; /* name hash -> entry index + 1 (0: empty)    */
+    uint16_t      *handle_index;/* handle hash -> entry index + 1 (0: empty) */
+    uint32_t       index_mask; /* slots in each index, minus one             */
 } NEModuleTable;
 
 /* -------------------------------------------------------------------------
@@ -168,8 +184,9 @@ int ne_mod_add_dep(NEModuleTable *tbl,
 /*
  * ne_mod_find - look up a module by name.
  *
- * Returns the handle of the first active entry whose name matches 'name'
- * (case-sensitive), or NE_MOD_HANDLE_INVALID if not found.
+ * Returns the handle of the active entry whose name matches 'name',
+ * ignoring case as Windows does, or NE_MOD_HANDLE_INVALID if not found.
+ * The lookup goes through the table's name index.
  */
 NEModuleHandle ne_mod_find(const NEModuleTable *tbl, const char *name);
 
@@ -182,6 +199,71 @@ NEModuleHandle ne_mod_find(const NEModuleTable *tbl, const char *name);
  */
 NEModuleEntry *ne_mod_get(NEModuleTable *tbl, NEModuleHandle handle);
 
+/*
+ * ne_mod_exports - return the export table of module 'handle', building it
+ * from the module's parser context on the first call.
+ *
+ * Returns NULL for an unknown handle or when the table cannot be built.
+ * The pointer is valid until the module is unloaded.
+ */
+const NEExportTable *ne_mod_exports(NEModuleTable *tbl, NEModuleHandle handle);
+
+/*
+ * ne_mod_set_exports - give module 'handle' a ready-made export table, e.g.
+ * for a built-in module without an NE image.  Ownership of *exports is
+ * transferred (it is zeroed); any previous table is freed.
+ *
+ * Returns NE_MOD_OK, NE_MOD_ERR_NULL, NE_MOD_ERR_BAD_HANDLE or
+ * NE_MOD_ERR_NOT_FOUND.
+ */
+int ne_mod_set_exports(NEModuleTable  *tbl,
+                       NEModuleHandle  handle,
+                       NEExportTable  *exports);
+
+/*
+ * ne_mod_ref_handle - return the handle of the module that entry
+ * 'ref_index' (1-based, as in relocation records) of the importer's
+ * module-reference table names, or NE_MOD_HANDLE_INVALID if it is not
+ * loaded.
+ *
+ * The first lookup of each reference goes through ne_mod_find(); the
+ * result is cached in the importer's entry and re-checked on later calls,
+ * so an unloaded dependency is looked up again.
+ */
+NEModuleHandle ne_mod_ref_handle(NEModuleTable  *tbl,
+                                 NEModuleHandle  importer,
+                                 uint16_t        ref_index);
+
+/*
+ * NEModImportContext - userdata for ne_mod_import_resolver(): the module
+ * table and the module whose relocations are being applied.
+ */
+typedef struct {
+    NEModuleTable  *table;
+    NEModuleHandle  importer;
+} NEModImportContext;
+
+/*
+ * ne_mod_import_resolver - import resolver (same signature and return
+ * convention as NEImportResolver in ne_reloc.h) that looks imports up in
+ * the export tables of the modules loaded in the table.
+ *
+ * 'mod_idx' is mapped to a module with ne_mod_ref_handle(); ordinal
+ * imports use that module's ordinal index, name imports read the
+ * length-prefixed name at offset 'ref2' of 'imported_names' and match it
+ * ignoring case.  'userdata' is an NEModImportContext.
+ *
+ * Returns 0 on success or NE_MOD_ERR_NOT_FOUND.
+ */
+int ne_mod_import_resolver(uint16_t       mod_idx,
+                           uint16_t       ref2,
+                           int            by_name,
+                           const uint8_t *imported_names,
+                           uint16_t       imp_names_size,
+                           uint16_t      *out_seg,
+                           uint16_t      *out_offset,
+                           void          *userdata);
+
 /*
  * ne_mod_strerror - return a static string describing error code 'err'.
  */
@@ -10,6 +10,13 @@
 
 #include <string.h>
 
+#ifndef __WATCOMC__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 /* -------------------------------------------------------------------------
  * Internal helpers
  * ---------------------------------------------------------------------- */
@@ -104,23 +111,345 @@ static void parse_segment_descriptor(const uint8_t *buf, NESegmentDescriptor *se
     seg->min_alloc = read_u16(buf + 6);
 }
 
-/* Allocate and copy a region from the file buffer */
-static uint8_t *dup_region(const uint8_t *buf, size_t buf_len,
-                            uint32_t offset, uint16_t size)
+/* -------------------------------------------------------------------------
+ * Byte source
+ *
+ * parse_core() reads the file through an NESource: either a complete
+ * in-memory image, or a read-at callback seen through a small window so
+ * that only the headers and tables are ever held in memory.
+ * ---------------------------------------------------------------------- */
+typedef struct {
+    const uint8_t *buf;      /* whole image, or NULL when streaming     */
+    uint32_t       len;      /* byte length of the file                 */
+    NEReadAtFn     read_at;  /* streaming: reader callback              */
+    void          *user;     /* streaming: callback argument            */
+    uint8_t       *win;      /* streaming: NE_STREAM_WINDOW-byte window */
+    uint32_t       win_off;  /* file offset of win[0]                   */
+    uint32_t       win_fill; /* valid bytes in win                      */
+} NESource;
+
+/*
+ * src_get - return a pointer to 'n' contiguous bytes at file offset 'off',
+ * or NULL if they lie outside the file or cannot be read.  When streaming
+ * the pointer is valid only until the next src_get(), and 'n' must not
+ * exceed NE_STREAM_WINDOW.
+ */
+static const uint8_t *src_get(NESource *src, uint32_t off, uint32_t n)
 {
-    uint8_t *p;
-    if (size == 0)
+    uint32_t want;
+
+    if (off > src->len || n > src->len - off)
         return NULL;
-    if ((uint32_t)offset + size > buf_len)
+    if (src->buf)
+        return src->buf + off;
+    if (n > NE_STREAM_WINDOW)
         return NULL;
-    p = (uint8_t *)NE_MALLOC(size);
-    if (p)
-        memcpy(p, buf + offset, size);
-    return p;
+
+    if (src->win_fill > 0 && off >= src->win_off &&
+            off + n <= src->win_off + src->win_fill)
+        return src->win + (off - src->win_off);
+
+    /* Refill the window starting at 'off' */
+    want = src->len - off;
+    if (want > NE_STREAM_WINDOW)
+        want = NE_STREAM_WINDOW;
+    if (src->read_at(src->user, off, src->win, want) != (size_t)want) {
+        src->win_fill = 0;
+        return NULL;
+    }
+    src->win_off  = off;
+    src->win_fill = want;
+    return src->win;
+}
+
+/*
+ * ctx_alloc - allocate 'n' bytes of parser state for *ctx: from its arena
+ * when it has one (always zeroed), otherwise from the heap (zeroed only
+ * when 'zero' is set).
+ */
+static void *ctx_alloc(NEParserContext *ctx, uint32_t n, int zero)
+{
+    if (ctx->arena)
+        return ne_arena_alloc(ctx->arena, n);
+    if ((uint32_t)(size_t)n != n)
+        return NULL;  /* does not fit a 16-bit size_t */
+    return zero ? NE_CALLOC(1, (size_t)n) : NE_MALLOC((size_t)n);
+}
+
+/*
+ * take_region - return a table region of the file in *out: a view into the
+ * image when ctx->borrowed is set and the source is in memory, otherwise a
+ * fresh copy.  *out is NULL for an empty region.
+ */
+static int take_region(NESource *src, NEParserContext *ctx,
+                       uint32_t offset, uint16_t size, const uint8_t **out)
+{
+    uint8_t *p;
+
+    *out = NULL;
+    if (size == 0)
+        return NE_OK;
+    if (offset > src->len || (uint32_t)size > src->len - offset)
+        return NE_ERR_BAD_OFFSET;
+    if (ctx->borrowed && src->buf) {
+        *out = src->buf + offset;
+        return NE_OK;
+    }
+
+    p = (uint8_t *)ctx_alloc(ctx, size, 0);
+    if (!p)
+        return NE_ERR_ALLOC;
+    if (src->buf) {
+        memcpy(p, src->buf + offset, size);
+    } else if (src->read_at(src->user, offset, p, size) != (size_t)size) {
+        if (!ctx->arena)
+            NE_FREE(p);
+        return NE_ERR_IO;
+    }
+    *out = p;
+    return NE_OK;
 }
 
 /* -------------------------------------------------------------------------
- * Core buffer parser
+ * Name tables
+ * ---------------------------------------------------------------------- */
+
+/*
+ * walk_names - decode one length-prefixed name table at [pos..end).
+ *
+ * With nt == NULL only *count (names to index) and *bytes (pool bytes) are
+ * accumulated.  Otherwise every name is appended to nt->pool (at most
+ * *bytes in total), up to *count of them are indexed in nt->entries, and
+ * the pool offset of the table's first name (module name or description)
+ * is stored in *first.
+ */
+static void walk_names(NESource *src, uint32_t pos, uint32_t end,
+                       uint8_t flags, NENameTable *nt,
+                       uint32_t *count, uint32_t *bytes, uint32_t *first)
+{
+    const uint8_t *p;
+    int      is_first = 1;
+    uint8_t  n;
+    uint16_t ordinal;
+    uint32_t off;
+
+    while (pos < end) {
+        p = src_get(src, pos, 1u);
+        if (!p)
+            break;
+        n = p[0];
+        pos++;
+        if (n == 0u || pos + (uint32_t)n + 2u > end)
+            break; /* end marker or truncated entry */
+
+        p = src_get(src, pos, (uint32_t)n + 2u);
+        if (!p)
+            break;
+        ordinal = read_u16(p + n);
+
+        if (!nt) {
+            *bytes += (uint32_t)n + 1u;
+            if (!is_first && ordinal != 0u)
+                (*count)++;
+        } else {
+            off = nt->pool_size;
+            if (off + (uint32_t)n + 1u > *bytes)
+                break; /* source changed between passes */
+            memcpy(nt->pool + off, p, n);
+            nt->pool[off + n] = '\0';
+            nt->pool_size += (uint32_t)n + 1u;
+
+            if (is_first) {
+                *first = off;
+            } else if (ordinal != 0u && nt->count < *count) {
+                NENameEntry *e = &nt->entries[nt->count++];
+                e->name_off = off;
+                e->ordinal  = ordinal;
+                e->name_len = n;
+                e->flags    = flags;
+            }
+        }
+
+        is_first = 0;
+        pos += (uint32_t)n + 2u;
+    }
+}
+
+/* Order by name; a resident name sorts before a non-resident duplicate */
+static int name_cmp(const NENameTable *nt,
+                    const NENameEntry *a, const NENameEntry *b)
+{
+    int c = strcmp(nt->pool + a->name_off, nt->pool + b->name_off);
+    if (c != 0)
+        return c;
+    return (int)(b->flags & NE_NAME_RESIDENT)
+         - (int)(a->flags & NE_NAME_RESIDENT);
+}
+
+/* Order entry indices by ordinal, resident first on ties */
+static int ordinal_cmp(const NENameTable *nt, uint16_t a, uint16_t b)
+{
+    const NENameEntry *ea = &nt->entries[a];
+    const NENameEntry *eb = &nt->entries[b];
+
+    if (ea->ordinal != eb->ordinal)
+        return (ea->ordinal < eb->ordinal) ? -1 : 1;
+    return (int)(eb->flags & NE_NAME_RESIDENT)
+         - (int)(ea->flags & NE_NAME_RESIDENT);
+}
+
+/*
+ * sort_names - shell-sort the entries by name and build the ordinal index.
+ * (qsort() has no context argument, and parsing must stay re-entrant.)
+ */
+static void sort_names(NENameTable *nt)
+{
+    uint32_t    gap = 1u;
+    uint32_t    i, j;
+    NENameEntry tmp;
+    uint16_t    idx;
+
+    while (gap < nt->count / 3u)
+        gap = gap * 3u + 1u;
+
+    for (; gap > 0u; gap /= 3u) {
+        for (i = gap; i < nt->count; i++) {
+            tmp = nt->entries[i];
+            for (j = i; j >= gap &&
+                        name_cmp(nt, &nt->entries[j - gap], &tmp) > 0;
+                 j -= gap)
+                nt->entries[j] = nt->entries[j - gap];
+            nt->entries[j] = tmp;
+        }
+    }
+
+    for (i = 0; i < nt->count; i++)
+        nt->by_ordinal[i] = (uint16_t)i;
+
+    gap = 1u;
+    while (gap < nt->count / 3u)
+        gap = gap * 3u + 1u;
+
+    for (; gap > 0u; gap /= 3u) {
+        for (i = gap; i < nt->count; i++) {
+            idx = nt->by_ordinal[i];
+            for (j = i; j >= gap &&
+                        ordinal_cmp(nt, nt->by_ordinal[j - gap], idx) > 0;
+                 j -= gap)
+                nt->by_ordinal[j] = nt->by_ordinal[j - gap];
+            nt->by_ordinal[j] = idx;
+        }
+    }
+}
+
+/*
+ * resident_names_end - the resident name table has no size field; it ends
+ * at the nearest table that follows it (module-ref, imported names or
+ * entry table), or at the end of the image.
+ */
+static uint32_t resident_names_end(const NEParserContext *ctx, uint32_t len)
+{
+    const NEHeader *h    = &ctx->header;
+    uint16_t        rel  = h->resident_name_table_offset;
+    uint16_t        next = 0;
+    uint32_t        end;
+
+    if (h->module_ref_table_offset > rel)
+        next = h->module_ref_table_offset;
+    if (h->imported_names_offset > rel &&
+            (next == 0 || h->imported_names_offset < next))
+        next = h->imported_names_offset;
+    if (h->entry_table_offset > rel &&
+            (next == 0 || h->entry_table_offset < next))
+        next = h->entry_table_offset;
+
+    end = next ? ctx->ne_offset + next : len;
+    return (end > len) ? len : end;
+}
+
+/* Extents and sizes of the two name tables, from the counting pass */
+typedef struct {
+    uint32_t res_pos, res_end;  /* resident table [pos..end), 0 if none   */
+    uint32_t nr_pos,  nr_end;   /* non-resident table [pos..end)          */
+    uint32_t count;             /* names to index (clamped to 0xFFFF)     */
+    uint32_t bytes;             /* pool bytes, including pool[0]          */
+} NENameExtent;
+
+/*
+ * names_extent - locate the name tables of ctx's image and count the names
+ * and pool bytes they hold, without allocating.
+ */
+static void names_extent(NESource *src, const NEParserContext *ctx,
+                         NENameExtent *ext)
+{
+    uint32_t        len = src->len;
+    const NEHeader *h   = &ctx->header;
+
+    memset(ext, 0, sizeof(*ext));
+    ext->bytes = 1u;  /* pool[0] is the empty string */
+
+    if (h->resident_name_table_offset != 0) {
+        ext->res_pos = ctx->ne_offset + h->resident_name_table_offset;
+        ext->res_end = resident_names_end(ctx, len);
+        if (ext->res_pos >= ext->res_end)
+            ext->res_pos = ext->res_end = 0;
+    }
+
+    if (h->nonresident_name_offset != 0 && h->nonresident_name_size != 0) {
+        ext->nr_pos = h->nonresident_name_offset;
+        ext->nr_end = ext->nr_pos + h->nonresident_name_size;
+        if (ext->nr_end > len)
+            ext->nr_end = len;
+        if (ext->nr_pos >= ext->nr_end)
+            ext->nr_pos = ext->nr_end = 0;
+    }
+
+    walk_names(src, ext->res_pos, ext->res_end, NE_NAME_RESIDENT, NULL,
+               &ext->count, &ext->bytes, NULL);
+    walk_names(src, ext->nr_pos, ext->nr_end, 0, NULL,
+               &ext->count, &ext->bytes, NULL);
+
+    if (ext->count > 0xFFFFu)
+        ext->count = 0xFFFFu;
+}
+
+/*
+ * parse_names - build ctx->names from the resident and non-resident name
+ * tables.  Malformed tables are truncated rather than rejected, matching
+ * the export builder; only allocation failure is an error.
+ */
+static int parse_names(NESource *src, NEParserContext *ctx)
+{
+    NENameTable  *nt = &ctx->names;
+    NENameExtent  ext;
+
+    names_extent(src, ctx, &ext);
+
+    nt->pool = (char *)ctx_alloc(ctx, ext.bytes, 0);
+    if (!nt->pool)
+        return NE_ERR_ALLOC;
+    nt->pool[0]   = '\0';
+    nt->pool_size = 1u;
+
+    if (ext.count > 0) {
+        nt->entries    = (NENameEntry *)ctx_alloc(ctx,
+                             ext.count * (uint32_t)sizeof(NENameEntry), 1);
+        nt->by_ordinal = (uint16_t *)ctx_alloc(ctx,
+                             ext.count * (uint32_t)sizeof(uint16_t), 1);
+        if (!nt->entries || !nt->by_ordinal)
+            return NE_ERR_ALLOC;
+    }
+
+    walk_names(src, ext.res_pos, ext.res_end, NE_NAME_RESIDENT, nt,
+               &ext.count, &ext.bytes, &nt->module_name);
+    walk_names(src, ext.nr_pos, ext.nr_end, 0, nt, &ext.count, &ext.bytes,
+               &nt->description);
+    sort_names(nt);
+    return NE_OK;
+}
+
+/* -------------------------------------------------------------------------
+ * Core parser
  * ---------------------------------------------------------------------- */
 
 /*
@@ -131,26 +460,59 @@ static uint8_t *dup_region(const uint8_t *buf, size_t buf_len,
 #define NE_HEADER_SIZE      64u
 #define NE_SEG_DESC_SIZE     8u
 
-int ne_parse_buffer(const uint8_t *buf, size_t len, NEParserContext *ctx)
+/*
+ * resource_table_size - the resource table has no size field either; it
+ * runs up to the resident name table.  Returns 0 when the table is absent
+ * or precedes / overlaps the segment table.
+ */
+static uint16_t resource_table_size(const NEHeader *h)
 {
-    MZHeader   mz;
-    uint32_t   ne_off;
-    uint32_t   seg_table_abs;
-    uint32_t   res_table_abs;
-    uint32_t   entry_table_abs;
-    uint32_t   imp_names_abs;
-    uint16_t   i;
+    if (h->resource_table_offset < h->segment_table_offset
+            + (uint32_t)h->segment_count * NE_SEG_DESC_SIZE)
+        return 0;
+    if (h->resident_name_table_offset > h->resource_table_offset)
+        return (uint16_t)(h->resident_name_table_offset
+                          - h->resource_table_offset);
+    return 0;
+}
 
-    if (!buf || !ctx)
-        return NE_ERR_NULL_ARG;
+/*
+ * imported_names_size - the imported-names table ends at whichever table
+ * follows it: linkers place the entry table there, but some images put
+ * the module-ref table after the imported names instead.
+ */
+static uint16_t imported_names_size(const NEHeader *h)
+{
+    if (h->imported_names_offset == 0)
+        return 0;
+    if (h->module_ref_table_offset > h->imported_names_offset)
+        return (uint16_t)(h->module_ref_table_offset
+                          - h->imported_names_offset);
+    if (h->entry_table_offset > h->imported_names_offset)
+        return (uint16_t)(h->entry_table_offset - h->imported_names_offset);
+    return 0;
+}
 
-    memset(ctx, 0, sizeof(*ctx));
+/*
+ * parse_headers - read and validate the MZ and NE headers into *ctx
+ * (header, ne_offset) and check that the segment table lies in the file.
+ */
+static int parse_headers(NESource *src, NEParserContext *ctx)
+{
+    MZHeader       mz;
+    const uint8_t *p;
+    uint32_t       len = src->len;
+    uint32_t       ne_off;
+    uint32_t       seg_table_abs;
 
     /* ---- MZ header ---- */
     if (len < MZ_HEADER_MIN_SIZE)
         return NE_ERR_NOT_MZ;
 
-    parse_mz_header(buf, &mz);
+    p = src_get(src, 0, MZ_HEADER_MIN_SIZE);
+    if (!p)
+        return NE_ERR_IO;
+    parse_mz_header(p, &mz);
 
     if (mz.magic != MZ_MAGIC)
         return NE_ERR_NOT_MZ;
@@ -162,7 +524,10 @@ int ne_parse_buffer(const uint8_t *buf, size_t len, NEParserContext *ctx)
         return NE_ERR_BAD_OFFSET;
 
     /* ---- NE header ---- */
-    parse_ne_header(buf + ne_off, &ctx->header);
+    p = src_get(src, ne_off, NE_HEADER_SIZE);
+    if (!p)
+        return NE_ERR_IO;
+    parse_ne_header(p, &ctx->header);
 
     if (ctx->header.magic != NE_MAGIC)
         return NE_ERR_NOT_NE;
@@ -178,98 +543,433 @@ int ne_parse_buffer(const uint8_t *buf, size_t len, NEParserContext *ctx)
             return NE_ERR_BAD_OFFSET;
     }
 
+    return NE_OK;
+}
+
+static int parse_core(NESource *src, NEParserContext *ctx, int borrow,
+                      NEArena *arena)
+{
+    const uint8_t *p;
+    uint32_t       len = src->len;
+    uint32_t       seg_table_abs;
+    uint32_t       res_table_abs;
+    uint32_t       entry_table_abs;
+    uint32_t       imp_names_abs;
+    uint32_t       mod_ref_abs;
+    uint16_t       res_size;
+    uint16_t       imp_size;
+    uint16_t       i;
+    int            rc;
+
+    memset(ctx, 0, sizeof(*ctx));
+
+    rc = parse_headers(src, ctx);
+    if (rc != NE_OK)
+        return rc;
+    ctx->borrowed = borrow;
+    ctx->arena    = arena;
+
     /* ---- Parse segment table ---- */
+    seg_table_abs = ctx->ne_offset + ctx->header.segment_table_offset;
     if (ctx->header.segment_count > 0) {
-        ctx->segments = (NESegmentDescriptor *)NE_CALLOC(
-                            ctx->header.segment_count,
-                            sizeof(NESegmentDescriptor));
+        ctx->segments = (NESegmentDescriptor *)ctx_alloc(ctx,
+                            (uint32_t)ctx->header.segment_count
+                            * (uint32_t)sizeof(NESegmentDescriptor), 1);
         if (!ctx->segments) {
             ne_free(ctx);
             return NE_ERR_ALLOC;
         }
         for (i = 0; i < ctx->header.segment_count; i++) {
-            parse_segment_descriptor(
-                buf + seg_table_abs + (uint32_t)i * NE_SEG_DESC_SIZE,
-                &ctx->segments[i]);
+            p = src_get(src, seg_table_abs + (uint32_t)i * NE_SEG_DESC_SIZE,
+                        NE_SEG_DESC_SIZE);
+            if (!p) {
+                ne_free(ctx);
+                return NE_ERR_IO;
+            }
+            parse_segment_descriptor(p, &ctx->segments[i]);
         }
     }
 
     /* ---- Resource table ---- */
-    res_table_abs = ne_off + ctx->header.resource_table_offset;
-    if (ctx->header.resource_table_offset < ctx->header.segment_table_offset
-            + (uint32_t)ctx->header.segment_count * NE_SEG_DESC_SIZE) {
-        /* resource table precedes or overlaps segment table – skip */
-        ctx->resource_size = 0;
-    } else {
-        /* size = distance to next table (resident names) or entry table */
-        uint16_t res_size = 0;
-        if (ctx->header.resident_name_table_offset > ctx->header.resource_table_offset)
-            res_size = (uint16_t)(ctx->header.resident_name_table_offset
-                                  - ctx->header.resource_table_offset);
-        ctx->resource_size = res_size;
-        if (res_size > 0) {
-            if ((uint32_t)res_table_abs + res_size > len) {
-                ne_free(ctx);
-                return NE_ERR_BAD_OFFSET;
-            }
-            ctx->resource_data = dup_region(buf, len, res_table_abs, res_size);
-            if (!ctx->resource_data) {
-                ne_free(ctx);
-                return NE_ERR_ALLOC;
-            }
+    res_table_abs = ctx->ne_offset + ctx->header.resource_table_offset;
+    res_size      = resource_table_size(&ctx->header);
+    ctx->resource_size = res_size;
+    if (res_size > 0) {
+        if ((uint32_t)res_table_abs + res_size > len) {
+            ne_free(ctx);
+            return NE_ERR_BAD_OFFSET;
+        }
+        rc = take_region(src, ctx, res_table_abs, res_size,
+                         &ctx->resource_data);
+        if (rc != NE_OK) {
+            ne_free(ctx);
+            return rc;
         }
     }
 
     /* ---- Entry table ---- */
-    entry_table_abs = ne_off + ctx->header.entry_table_offset;
+    entry_table_abs = ctx->ne_offset + ctx->header.entry_table_offset;
     if (ctx->header.entry_table_length > 0) {
         if ((uint32_t)entry_table_abs + ctx->header.entry_table_length > len) {
             ne_free(ctx);
             return NE_ERR_BAD_OFFSET;
         }
         ctx->entry_size = ctx->header.entry_table_length;
-        ctx->entry_data = dup_region(buf, len,
-                                     entry_table_abs, ctx->entry_size);
-        if (!ctx->entry_data) {
+        rc = take_region(src, ctx, entry_table_abs, ctx->entry_size,
+                         &ctx->entry_data);
+        if (rc != NE_OK) {
             ne_free(ctx);
-            return NE_ERR_ALLOC;
+            return rc;
         }
     }
 
     /* ---- Imported-names table ---- */
-    imp_names_abs = ne_off + ctx->header.imported_names_offset;
-    if (ctx->header.imported_names_offset > 0
+    imp_names_abs = ctx->ne_offset + ctx->header.imported_names_offset;
+    imp_size      = imported_names_size(&ctx->header);
+    if (imp_size > 0 && (uint32_t)imp_names_abs + imp_size <= len) {
+        ctx->imported_names_size = imp_size;
+        rc = take_region(src, ctx, imp_names_abs, imp_size,
+                         &ctx->imported_names);
+        if (rc != NE_OK) {
+            ne_free(ctx);
+            return rc;
+        }
+    }
+
+    /* ---- Module-reference table (skipped when out of bounds) ---- */
+    mod_ref_abs = ctx->ne_offset + ctx->header.module_ref_table_offset;
+    if (ctx->header.module_ref_count > 0
             && ctx->header.module_ref_table_offset > 0
-            && ctx->header.module_ref_table_offset > ctx->header.imported_names_offset) {
-        uint16_t imp_size = (uint16_t)(ctx->header.module_ref_table_offset
-                                       - ctx->header.imported_names_offset);
-        if (imp_size > 0 && (uint32_t)imp_names_abs + imp_size <= len) {
-            ctx->imported_names_size = imp_size;
-            ctx->imported_names = dup_region(buf, len, imp_names_abs, imp_size);
-            if (!ctx->imported_names) {
+            && (uint32_t)mod_ref_abs
+               + (uint32_t)ctx->header.module_ref_count * 2u <= len) {
+        ctx->module_refs = (uint16_t *)ctx_alloc(ctx,
+                               (uint32_t)ctx->header.module_ref_count * 2u, 1);
+        if (!ctx->module_refs) {
+            ne_free(ctx);
+            return NE_ERR_ALLOC;
+        }
+        for (i = 0; i < ctx->header.module_ref_count; i++) {
+            p = src_get(src, mod_ref_abs + 2u * i, 2u);
+            if (!p) {
                 ne_free(ctx);
-                return NE_ERR_ALLOC;
+                return NE_ERR_IO;
             }
+            ctx->module_refs[i] = read_u16(p);
         }
+        ctx->module_ref_count = ctx->header.module_ref_count;
+    }
+
+    /* ---- Resident and non-resident name tables ---- */
+    if (parse_names(src, ctx) != NE_OK) {
+        ne_free(ctx);
+        return NE_ERR_ALLOC;
+    }
+
+    return NE_OK;
+}
+
+int ne_parse_buffer(const uint8_t *buf, size_t len, NEParserContext *ctx)
+{
+    NESource src;
+
+    if (!buf || !ctx)
+        return NE_ERR_NULL_ARG;
+
+    memset(&src, 0, sizeof(src));
+    src.buf = buf;
+    src.len = (uint32_t)len;
+    return parse_core(&src, ctx, 0, NULL);
+}
+
+int ne_parse_image(const NEImage *img, NEParserContext *ctx)
+{
+    NESource src;
+
+    if (!img || !img->data || !ctx)
+        return NE_ERR_NULL_ARG;
+
+    memset(&src, 0, sizeof(src));
+    src.buf = img->data;
+    src.len = (uint32_t)img->len;
+    return parse_core(&src, ctx, 1, NULL);
+}
+
+/* -------------------------------------------------------------------------
+ * Arena-backed parsing
+ * ---------------------------------------------------------------------- */
+
+int ne_parse_buffer_arena(const uint8_t *buf, size_t len,
+                          NEParserContext *ctx, NEArena *arena)
+{
+    NESource src;
+
+    if (!buf || !ctx || !arena || !arena->base)
+        return NE_ERR_NULL_ARG;
+
+    memset(&src, 0, sizeof(src));
+    src.buf = buf;
+    src.len = (uint32_t)len;
+    return parse_core(&src, ctx, 0, arena);
+}
+
+int ne_parse_arena_size(const uint8_t *buf, size_t len,
+                        NEParserContext *hdr, uint32_t *size)
+{
+    NESource         src;
+    NENameExtent     ext;
+    const NEHeader  *h;
+    uint32_t         total;
+    int              rc;
+
+    if (!buf || !hdr || !size)
+        return NE_ERR_NULL_ARG;
+    *size = 0;
+
+    memset(&src, 0, sizeof(src));
+    memset(hdr, 0, sizeof(*hdr));
+    src.buf = buf;
+    src.len = (uint32_t)len;
+
+    rc = parse_headers(&src, hdr);
+    if (rc != NE_OK) {
+        memset(hdr, 0, sizeof(*hdr));
+        return rc;
     }
+    h = &hdr->header;
 
+    /* One rounded block per ctx_alloc() made by parse_core() */
+    total  = NE_ARENA_ROUND((uint32_t)h->segment_count
+                            * (uint32_t)sizeof(NESegmentDescriptor));
+    total += NE_ARENA_ROUND(resource_table_size(h));
+    total += NE_ARENA_ROUND(h->entry_table_length);
+    total += NE_ARENA_ROUND(imported_names_size(h));
+    total += NE_ARENA_ROUND((uint32_t)h->module_ref_count * 2u);
+
+    names_extent(&src, hdr, &ext);
+    total += NE_ARENA_ROUND(ext.bytes);
+    total += NE_ARENA_ROUND(ext.count * (uint32_t)sizeof(NENameEntry));
+    total += NE_ARENA_ROUND(ext.count * (uint32_t)sizeof(uint16_t));
+
+    *size = total;
     return NE_OK;
 }
 
 /* -------------------------------------------------------------------------
- * File-based entry point
+ * Arena allocator
  * ---------------------------------------------------------------------- */
 
-int ne_parse_file(const char *path, NEParserContext *ctx)
+int ne_arena_init(NEArena *arena, uint32_t size)
 {
-    FILE    *fp;
-    long     file_len;
-    uint8_t *buf;
+    if (!arena)
+        return NE_ERR_NULL_ARG;
+
+    memset(arena, 0, sizeof(*arena));
+    if (size == 0)
+        size = NE_ARENA_ALIGN;
+    if ((uint32_t)(size_t)size != size)
+        return NE_ERR_ALLOC;  /* does not fit a 16-bit size_t */
+
+    arena->base = (uint8_t *)NE_MALLOC((size_t)size);
+    if (!arena->base)
+        return NE_ERR_ALLOC;
+    arena->size = size;
+    return NE_OK;
+}
+
+void *ne_arena_alloc(NEArena *arena, uint32_t n)
+{
+    uint8_t  *p;
+    uint32_t  need;
+
+    if (!arena || !arena->base)
+        return NULL;
+
+    need = NE_ARENA_ROUND(n);
+    if (need < n || need > arena->size - arena->used)
+        return NULL;
+
+    p = arena->base + arena->used;
+    arena->used += need;
+    memset(p, 0, (size_t)n);
+    return p;
+}
+
+void ne_arena_free(NEArena *arena)
+{
+    if (!arena)
+        return;
+    NE_FREE(arena->base);
+    memset(arena, 0, sizeof(*arena));
+}
+
+/* -------------------------------------------------------------------------
+ * Streaming parser
+ * ---------------------------------------------------------------------- */
+
+int ne_parse_stream(NEReadAtFn read_at, void *user, uint32_t file_len,
+                    NEParserContext *ctx)
+{
+    NESource src;
     int      ret;
 
-    if (!path || !ctx)
+    if (!read_at || !ctx)
         return NE_ERR_NULL_ARG;
 
+    memset(&src, 0, sizeof(src));
+    src.len     = file_len;
+    src.read_at = read_at;
+    src.user    = user;
+    src.win     = (uint8_t *)NE_MALLOC(NE_STREAM_WINDOW);
+    if (!src.win) {
+        memset(ctx, 0, sizeof(*ctx));
+        return NE_ERR_ALLOC;
+    }
+
+    ret = parse_core(&src, ctx, 0, NULL);
+    NE_FREE(src.win);
+    return ret;
+}
+
+/* NEReadAtFn over a stdio stream */
+static size_t fp_read_at(void *user, uint32_t offset, void *dst, size_t n)
+{
+    FILE *fp = (FILE *)user;
+
+    if (fseek(fp, (long)offset, SEEK_SET) != 0)
+        return 0;
+    return fread(dst, 1, n, fp);
+}
+
+int ne_parse_fp(FILE *fp, NEParserContext *ctx)
+{
+    long file_len;
+
+    if (!fp || !ctx)
+        return NE_ERR_NULL_ARG;
+
+    if (fseek(fp, 0, SEEK_END) != 0 || (file_len = ftell(fp)) <= 0) {
+        memset(ctx, 0, sizeof(*ctx));
+        return NE_ERR_IO;
+    }
+
+    return ne_parse_stream(fp_read_at, fp, (uint32_t)file_len, ctx);
+}
+
+/* -------------------------------------------------------------------------
+ * Module-reference names
+ * ---------------------------------------------------------------------- */
+
+int ne_module_ref_name(const NEParserContext *ctx, uint16_t index,
+                       char *out, size_t out_size)
+{
+    uint16_t off;
+    uint8_t  n;
+
+    if (!ctx || !out || out_size == 0)
+        return NE_ERR_NULL_ARG;
+
+    out[0] = '\0';
+
+    if (index == 0 || index > ctx->module_ref_count || !ctx->module_refs)
+        return NE_ERR_BAD_OFFSET;
+
+    /* Imported-names entries are Pascal strings: length byte + chars */
+    off = ctx->module_refs[index - 1u];
+    if (!ctx->imported_names || off >= ctx->imported_names_size)
+        return NE_ERR_BAD_OFFSET;
+
+    n = ctx->imported_names[off];
+    if ((uint32_t)off + 1u + n > ctx->imported_names_size)
+        return NE_ERR_BAD_OFFSET;
+
+    if ((size_t)n >= out_size)
+        n = (uint8_t)(out_size - 1u);
+    memcpy(out, ctx->imported_names + off + 1u, n);
+    out[n] = '\0';
+    return NE_OK;
+}
+
+/* -------------------------------------------------------------------------
+ * Name lookups
+ * ---------------------------------------------------------------------- */
+
+int ne_name_to_ordinal(const NEParserContext *ctx, const char *name,
+                       uint16_t *ordinal)
+{
+    const NENameTable *nt;
+    uint16_t lo, hi, mid;
+
+    if (!ctx || !name || !ordinal)
+        return NE_ERR_NULL_ARG;
+
+    nt = &ctx->names;
+    lo = 0;
+    hi = nt->count;
+    while (lo < hi) {
+        mid = (uint16_t)(lo + (hi - lo) / 2u);
+        if (strcmp(nt->pool + nt->entries[mid].name_off, name) < 0)
+            lo = (uint16_t)(mid + 1u);
+        else
+            hi = mid;
+    }
+
+    if (lo < nt->count &&
+            strcmp(nt->pool + nt->entries[lo].name_off, name) == 0) {
+        *ordinal = nt->entries[lo].ordinal;
+        return NE_OK;
+    }
+    return NE_ERR_NOT_FOUND;
+}
+
+const char *ne_ordinal_to_name(const NEParserContext *ctx, uint16_t ordinal)
+{
+    const NENameTable *nt;
+    uint16_t lo, hi, mid;
+
+    if (!ctx || ordinal == 0)
+        return NULL;
+
+    nt = &ctx->names;
+    lo = 0;
+    hi = nt->count;
+    while (lo < hi) {
+        mid = (uint16_t)(lo + (hi - lo) / 2u);
+        if (nt->entries[nt->by_ordinal[mid]].ordinal < ordinal)
+            lo = (uint16_t)(mid + 1u);
+        else
+            hi = mid;
+    }
+
+    if (lo < nt->count && nt->entries[nt->by_ordinal[lo]].ordinal == ordinal)
+        return nt->pool + nt->entries[nt->by_ordinal[lo]].name_off;
+    return NULL;
+}
+
+const char *ne_module_name(const NEParserContext *ctx)
+{
+    if (!ctx || !ctx->names.pool)
+        return "";
+    return ctx->names.pool + ctx->names.module_name;
+}
+
+int ne_parser_trusted(const NEParserContext *ctx,
+                      const uint8_t *buf, size_t len)
+{
+    return ctx && buf && ctx->validated_data == buf &&
+           ctx->validated_len == len;
+}
+
+/* -------------------------------------------------------------------------
+ * Shared file image
+ * ---------------------------------------------------------------------- */
+
+/* Read the whole file into one NE_MALLOC buffer (DOS / mmap fallback). */
+static int image_read_all(const char *path, NEImage *img)
+{
+    FILE    *fp;
+    long     file_len;
+    uint8_t *buf;
+
     fp = fopen(path, "rb");
     if (!fp)
         return NE_ERR_IO;
@@ -300,8 +1000,85 @@ int ne_parse_file(const char *path, NEParserContext *ctx)
     }
     fclose(fp);
 
-    ret = ne_parse_buffer(buf, (size_t)file_len, ctx);
-    NE_FREE(buf);
+    img->data   = buf;
+    img->len    = (size_t)file_len;
+    img->mapped = 0;
+    return NE_OK;
+}
+
+int ne_image_open(const char *path, NEImage *img)
+{
+#ifndef __WATCOMC__
+    int          fd;
+    struct stat  st;
+    void        *view;
+#endif
+
+    if (!path || !img)
+        return NE_ERR_NULL_ARG;
+
+    memset(img, 0, sizeof(*img));
+
+#ifndef __WATCOMC__
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NE_ERR_IO;
+
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NE_ERR_IO;
+    }
+
+    view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view != MAP_FAILED) {
+        img->data   = (const uint8_t *)view;
+        img->len    = (size_t)st.st_size;
+        img->mapped = 1;
+        return NE_OK;
+    }
+    /* Mapping not supported for this file: fall back to a single read. */
+#endif
+
+    return image_read_all(path, img);
+}
+
+void ne_image_close(NEImage *img)
+{
+    if (!img)
+        return;
+#ifndef __WATCOMC__
+    if (img->mapped && img->data)
+        munmap((void *)img->data, img->len);
+    else
+#endif
+    NE_FREE((void *)img->data);
+    memset(img, 0, sizeof(*img));
+}
+
+/* -------------------------------------------------------------------------
+ * File-based entry point
+ * ---------------------------------------------------------------------- */
+
+int ne_parse_file(const char *path, NEParserContext *ctx)
+{
+    FILE *fp;
+    int   ret;
+
+    if (!path || !ctx)
+        return NE_ERR_NULL_ARG;
+
+    /*
+     * Stream the headers and tables through a small window rather than
+     * reading the whole file: the parsed context holds copies anyway, and
+     * segment data is not needed here.
+     */
+    fp = fopen(path, "rb");
+    if (!fp)
+        return NE_ERR_IO;
+
+    ret = ne_parse_fp(fp, ctx);
+    fclose(fp);
     return ret;
 }
 
@@ -313,10 +1090,21 @@ void ne_free(NEParserContext *ctx)
 {
     if (!ctx)
         return;
+    if (ctx->arena) {
+        /* everything lives in the arena; ne_arena_free() releases it */
+        memset(ctx, 0, sizeof(*ctx));
+        return;
+    }
     NE_FREE(ctx->segments);
-    NE_FREE(ctx->resource_data);
-    NE_FREE(ctx->entry_data);
-    NE_FREE(ctx->imported_names);
+    NE_FREE(ctx->module_refs);
+    NE_FREE(ctx->names.pool);
+    NE_FREE(ctx->names.entries);
+    NE_FREE(ctx->names.by_ordinal);
+    if (!ctx->borrowed) {
+        NE_FREE((void *)ctx->resource_data);
+        NE_FREE((void *)ctx->entry_data);
+        NE_FREE((void *)ctx->imported_names);
+    }
     memset(ctx, 0, sizeof(*ctx));
 }
 
@@ -347,6 +1135,7 @@ void ne_print_info(const NEParserContext *ctx, FILE *out)
     h = &ctx->header;
 
     fprintf(out, "=== NE Executable Information ===\n");
+    fprintf(out, "Module name        : %s\n", ne_module_name(ctx));
     fprintf(out, "NE header offset   : 0x%08X\n", ctx->ne_offset);
     fprintf(out, "Linker version     : %u.%u\n",
             h->linker_major, h->linker_minor);
@@ -373,6 +1162,7 @@ void ne_print_info(const NEParserContext *ctx, FILE *out)
     fprintf(out, "Movable entries    : %u\n",   h->movable_entry_count);
     fprintf(out, "Resource segs      : %u\n",   h->resource_seg_count);
     fprintf(out, "Non-res name size  : %u bytes\n", h->nonresident_name_size);
+    fprintf(out, "Named exports      : %u\n", ctx->names.count);
     fprintf(out, "\n");
 
     if (h->segment_count > 0) {
@@ -409,6 +1199,7 @@ const char *ne_strerror(int err)
     case NE_ERR_ALLOC:       return "memory allocation failure";
     case NE_ERR_BAD_HEADER:  return "invalid header field";
     case NE_ERR_NULL_ARG:    return "NULL argument";
+    case NE_ERR_NOT_FOUND:   return "name or ordinal not found";
     default:                 return "unknown error";
     }
 }
@@ -30,6 +30,7 @@
 #define NE_ERR_ALLOC      -5   /* memory allocation failure         */
 #define NE_ERR_BAD_HEADER -6   /* other header field validation err */
 #define NE_ERR_NULL_ARG   -7   /* NULL pointer argument             */
+#define NE_ERR_NOT_FOUND  -8   /* name or ordinal not in the table  */
 
 /* -------------------------------------------------------------------------
  * Target OS codes stored in NEHeader.target_os
@@ -157,20 +158,135 @@ typedef struct {
 #pragma pack(pop)
 
 /* -------------------------------------------------------------------------
- * Parser context – filled in by ne_parse_file() / ne_parse_buffer()
+ * Shared file image
+ *
+ * A read-only view of one complete NE file, opened once and shared by the
+ * parser, loader, relocation and export builders (ne_parse_image,
+ * ne_load_buffer, ne_reloc_parse and ne_export_build all accept
+ * image.data / image.len).  On the POSIX host the file is mapped with
+ * mmap(); on the Watcom/DOS target, or when mapping fails, it is read once
+ * into a single NE_MALLOC buffer.
+ *
+ * Open with ne_image_open(); release with ne_image_close().
+ * ---------------------------------------------------------------------- */
+typedef struct {
+    const uint8_t *data;    /* first byte of the file image              */
+    size_t         len;     /* byte length of the image                  */
+    int            mapped;  /* non-zero when data is an mmap() view      */
+} NEImage;
+
+/* -------------------------------------------------------------------------
+ * Streaming source
+ *
+ * ne_parse_stream() reads the file through a callback instead of a whole
+ * in-memory image.  Headers and name tables are fetched through one
+ * NE_STREAM_WINDOW-byte window; the segment, entry, resource and
+ * imported-names tables are read straight into their final heap copies.
+ * Peak memory is the window plus the parsed tables, independent of the
+ * size of the segment data in the file.
+ * ---------------------------------------------------------------------- */
+#define NE_STREAM_WINDOW  4096u   /* bytes in the streaming read window */
+
+/*
+ * NEReadAtFn - read 'n' bytes at absolute file offset 'offset' into 'dst'.
+ * Returns the number of bytes read; anything short of 'n' is an error.
+ */
+typedef size_t (*NEReadAtFn)(void *user, uint32_t offset, void *dst,
+                             size_t n);
+
+/* -------------------------------------------------------------------------
+ * Per-module arena
+ *
+ * A single NE_MALLOC block from which the parser, loader and relocation
+ * state of one module is bump-allocated (see ne_parse_buffer_arena(),
+ * ne_load_buffer_arena() and ne_reloc_parse_arena()).  Size it with
+ * ne_arena_size_for_image(); release everything with one ne_arena_free().
+ * Contexts built on an arena record it in their 'arena' field, and the
+ * matching ne_free() / ne_loader_free() / ne_reloc_free() then only reset
+ * the context.
+ *
+ * On the DOS target this turns one INT 21h AH=48h call (with its MCB and
+ * paragraph rounding) per table and segment into a single call.  Because
+ * NE_MALLOC takes a 16-bit size_t there, modules whose total state exceeds
+ * 64 KB cannot use an arena and must use the ordinary heap path.
+ * ---------------------------------------------------------------------- */
+#define NE_ARENA_ALIGN  8u        /* alignment of every arena allocation */
+
+/* Round 'n' up to the arena alignment */
+#define NE_ARENA_ROUND(n) \
+    (((uint32_t)(n) + (NE_ARENA_ALIGN - 1u)) & ~(uint32_t)(NE_ARENA_ALIGN - 1u))
+
+typedef struct {
+    uint8_t  *base;   /* start of the block (NULL when not initialised) */
+    uint32_t  size;   /* usable bytes in the block                      */
+    uint32_t  used;   /* bytes handed out so far                        */
+} NEArena;
+
+/* -------------------------------------------------------------------------
+ * Name tables
+ *
+ * The resident and non-resident name tables are decoded once at parse time
+ * into a single string pool.  Every (name, ordinal) pair with a non-zero
+ * ordinal gets an NENameEntry; the entries are sorted by name and a second
+ * index sorts them by ordinal, so both lookups are binary searches.  The
+ * first entry of each table (module name / description, ordinal 0) is
+ * kept in the pool but not indexed.
+ * ---------------------------------------------------------------------- */
+
+/* NENameEntry.flags */
+#define NE_NAME_RESIDENT  0x01u  /* from the resident name table        */
+
+typedef struct {
+    uint32_t name_off;  /* offset of the NUL-terminated name in the pool */
+    uint16_t ordinal;   /* export ordinal (never 0)                      */
+    uint8_t  name_len;  /* name length, excluding the NUL                */
+    uint8_t  flags;     /* NE_NAME_* flags                               */
+} NENameEntry;
+
+typedef struct {
+    char        *pool;        /* names back to back; pool[0] is ""       */
+    uint32_t     pool_size;   /* bytes used in pool                      */
+    NENameEntry *entries;     /* sorted by name, resident first on ties  */
+    uint16_t    *by_ordinal;  /* indices into entries, sorted by ordinal */
+    uint16_t     count;       /* number of indexed names                 */
+    uint32_t     module_name; /* pool offset of the module name (0: none)*/
+    uint32_t     description; /* pool offset of the description (0: none)*/
+} NENameTable;
+
+/* -------------------------------------------------------------------------
+ * Parser context – filled in by ne_parse_file() / ne_parse_buffer() /
+ * ne_parse_image() / ne_parse_stream()
  * ---------------------------------------------------------------------- */
 typedef struct {
     NEHeader             header;          /* parsed NE header                  */
     uint32_t             ne_offset;       /* absolute file offset of NE header */
     NESegmentDescriptor *segments;        /* heap-allocated segment array      */
 
-    /* raw byte blobs for the variable-length tables */
-    uint8_t             *resource_data;   /* resource table bytes              */
+    /* raw byte blobs for the variable-length tables; heap copies, or views
+     * into the caller's NEImage when 'borrowed' is set */
+    const uint8_t       *resource_data;   /* resource table bytes              */
     uint16_t             resource_size;   /* size of resource_data in bytes    */
-    uint8_t             *entry_data;      /* entry table bytes                 */
+    const uint8_t       *entry_data;      /* entry table bytes                 */
     uint16_t             entry_size;      /* size of entry_data in bytes       */
-    uint8_t             *imported_names;  /* imported-names table bytes        */
+    const uint8_t       *imported_names;  /* imported-names table bytes        */
     uint16_t             imported_names_size;
+    int                  borrowed;        /* non-zero: blobs point into image  */
+
+    /* private: the image that passed ne_validate_parsed() for this
+     * context (NULL: none).  Read through ne_parser_trusted(), which
+     * only vouches for exactly these bytes. */
+    const uint8_t       *validated_data;
+    size_t               validated_len;
+
+    /* module-reference table: one imported-names offset per referenced
+     * module (heap-allocated; NULL when absent or out of bounds) */
+    uint16_t            *module_refs;
+    uint16_t             module_ref_count;
+
+    /* resident + non-resident names (heap- or arena-allocated) */
+    NENameTable          names;
+
+    NEArena             *arena;           /* owning arena, or NULL for heap   */
 } NEParserContext;
 
 /* -------------------------------------------------------------------------
@@ -194,7 +310,137 @@ int ne_parse_file(const char *path, NEParserContext *ctx);
 int ne_parse_buffer(const uint8_t *buf, size_t len, NEParserContext *ctx);
 
 /*
- * ne_free - release all heap memory owned by *ctx.
+ * ne_parse_image - parse an open NEImage without copying its tables.
+ *
+ * Behaves like ne_parse_buffer() except that resource_data, entry_data and
+ * imported_names point directly into img->data instead of being copied
+ * (ctx->borrowed is set).  The image must stay open until ne_free() has
+ * been called on *ctx.
+ */
+int ne_parse_image(const NEImage *img, NEParserContext *ctx);
+
+/*
+ * ne_parse_stream - parse an NE file of 'file_len' bytes read on demand
+ * through 'read_at' (called with 'user').
+ *
+ * Produces the same context as ne_parse_buffer() on the whole file while
+ * never holding more than NE_STREAM_WINDOW bytes of raw file data.
+ * Returns NE_OK, or NE_ERR_IO when a read comes back short, or another
+ * NE_ERR_* code; caller must call ne_free() when done.
+ */
+int ne_parse_stream(NEReadAtFn read_at, void *user, uint32_t file_len,
+                    NEParserContext *ctx);
+
+/*
+ * ne_parse_fp - ne_parse_stream() over an open, seekable binary stream.
+ * The stream position is left unspecified.  ne_parse_file() uses this.
+ */
+int ne_parse_fp(FILE *fp, NEParserContext *ctx);
+
+/*
+ * ne_parse_buffer_arena - ne_parse_buffer() with every table allocated
+ * from 'arena' instead of the heap.
+ *
+ * Returns NE_OK, or NE_ERR_ALLOC when the arena is too small, or another
+ * NE_ERR_* code.  ne_free() on the result only resets *ctx; the memory
+ * goes back with ne_arena_free().
+ */
+int ne_parse_buffer_arena(const uint8_t *buf, size_t len,
+                          NEParserContext *ctx, NEArena *arena);
+
+/*
+ * ne_parse_arena_size - number of arena bytes ne_parse_buffer_arena()
+ * needs for the image in 'buf', computed from the headers and table
+ * extents without allocating.
+ *
+ * On success *hdr holds only the header and ne_offset (no tables; it
+ * need not be freed) so that callers can size their own state from the
+ * segment table.  Returns NE_OK or the NE_ERR_* code of a bad header.
+ */
+int ne_parse_arena_size(const uint8_t *buf, size_t len,
+                        NEParserContext *hdr, uint32_t *size);
+
+/*
+ * ne_arena_init - allocate a 'size'-byte arena with one NE_MALLOC.
+ * Returns NE_OK, NE_ERR_NULL_ARG, or NE_ERR_ALLOC (also when 'size' does
+ * not fit size_t on the target).
+ */
+int ne_arena_init(NEArena *arena, uint32_t size);
+
+/*
+ * ne_arena_alloc - carve 'n' zeroed bytes, aligned to NE_ARENA_ALIGN, out
+ * of 'arena'.  Returns NULL when the arena is exhausted.
+ */
+void *ne_arena_alloc(NEArena *arena, uint32_t n);
+
+/*
+ * ne_arena_free - release the arena block and zero *arena.
+ * Safe to call on a zeroed arena and on NULL.
+ */
+void ne_arena_free(NEArena *arena);
+
+/*
+ * ne_module_ref_name - copy the name of referenced module 'index' into
+ * 'out' as a NUL-terminated string.
+ *
+ * 'index' is 1-based, as used by NE relocation records (ref1).  The name
+ * is looked up through ctx->module_refs in the imported-names table and
+ * truncated to out_size - 1 characters if necessary.
+ *
+ * Returns NE_OK, NE_ERR_NULL_ARG, or NE_ERR_BAD_OFFSET if the index or the
+ * table offset is out of range.
+ */
+int ne_module_ref_name(const NEParserContext *ctx, uint16_t index,
+                       char *out, size_t out_size);
+
+/*
+ * ne_name_to_ordinal - look up an exported name in the resident and
+ * non-resident name tables (case-sensitive, binary search).
+ *
+ * Returns NE_OK and sets *ordinal, NE_ERR_NOT_FOUND, or NE_ERR_NULL_ARG.
+ */
+int ne_name_to_ordinal(const NEParserContext *ctx, const char *name,
+                       uint16_t *ordinal);
+
+/*
+ * ne_ordinal_to_name - return the name exported under 'ordinal', or NULL
+ * when the ordinal has no name.  A resident name wins over a non-resident
+ * one.  The string lives in ctx->names.pool until ne_free().
+ */
+const char *ne_ordinal_to_name(const NEParserContext *ctx, uint16_t ordinal);
+
+/*
+ * ne_module_name - return the module name (first resident name), or ""
+ * when the image has none.  Never returns NULL for a non-NULL ctx.
+ */
+const char *ne_module_name(const NEParserContext *ctx);
+
+/*
+ * ne_parser_trusted - non-zero when 'buf' / 'len' is the very image that
+ * passed ne_validate_parsed() for *ctx, so the bounds checks the sweep
+ * covers may be skipped for it.  Any other image, and every context that
+ * was not validated, gets 0.
+ */
+int ne_parser_trusted(const NEParserContext *ctx,
+                      const uint8_t *buf, size_t len);
+
+/*
+ * ne_image_open - map (host) or read (DOS) the file at 'path' into *img.
+ *
+ * Returns NE_OK on success, NE_ERR_IO if the file cannot be opened or is
+ * empty, or NE_ERR_ALLOC.  Call ne_image_close() when done.
+ */
+int ne_image_open(const char *path, NEImage *img);
+
+/*
+ * ne_image_close - unmap or free the image and zero *img.
+ * Safe to call on a zeroed image and on NULL.
+ */
+void ne_image_close(NEImage *img);
+
+/*
+ * ne_free - release all heap memory owned by *ctx (nothing when the
+ * context lives in an arena).
  * Safe to call even if ne_parse_* returned an error.
  */
 void ne_free(NEParserContext *ctx);
@@ -9,12 +9,25 @@
  * Chain following         : non-ADDITIVE records follow the linked-list chain
  *                           embedded in the segment data (terminated by
  *                           0xFFFF for 16-bit types, 0xFF for LOBYTE)
+ * Relocation plans        : chains walked once into a flat patch list that
+ *                           later loads apply without reading links
  */
 
+#ifndef __WATCOMC__
+#define _POSIX_C_SOURCE 200809L   /* pthreads, sysconf under -std=c99 */
+#endif
+
 #include "ne_reloc.h"
 #include "ne_dosalloc.h"
 
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#ifndef __WATCOMC__
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 /* -------------------------------------------------------------------------
  * Internal byte-order helpers
@@ -31,22 +44,68 @@ static void rl_write_u16(uint8_t *p, uint16_t v)
     p[1] = (uint8_t)((v >> 8) & 0xFF);
 }
 
+/*
+ * Allocate 'n' zeroed bytes for 'ctx': from its arena when it has one,
+ * otherwise from the heap.
+ */
+static void *rl_alloc(NERelocContext *ctx, uint32_t n)
+{
+    if (ctx->arena)
+        return ne_arena_alloc(ctx->arena, n);
+    if ((uint32_t)(size_t)n != n)
+        return NULL;  /* does not fit a 16-bit size_t */
+    return NE_CALLOC(1, (size_t)n);
+}
+
 /* -------------------------------------------------------------------------
  * ne_reloc_parse
  * ---------------------------------------------------------------------- */
 
-int ne_reloc_parse(const uint8_t        *buf,
-                   size_t                len,
-                   const NEParserContext *parser,
-                   NERelocContext        *ctx)
+/*
+ * Append the table of segment 'seg_idx' to ctx, decoding 'count' raw
+ * 8-byte records from 'raw'.
+ */
+static int rl_add_table(NERelocContext *ctx, uint16_t seg_idx,
+                        uint16_t count, const uint8_t *raw)
 {
-    uint16_t i;
+    NESegRelocTable *tbl = &ctx->tables[ctx->count];
     uint16_t k;
 
+    tbl->seg_idx = seg_idx;
+    tbl->count   = count;
+    tbl->records = (NERelocRecord *)rl_alloc(ctx,
+                       (uint32_t)count * (uint32_t)sizeof(NERelocRecord));
+    if (!tbl->records)
+        return NE_RELOC_ERR_ALLOC;
+
+    for (k = 0; k < count; k++) {
+        const uint8_t *rec = raw + (uint32_t)k * 8u;
+        tbl->records[k].address_type  = rec[0];
+        tbl->records[k].reloc_type    = rec[1];
+        tbl->records[k].target_offset = rl_read_u16(rec + 2);
+        tbl->records[k].ref1          = rl_read_u16(rec + 4);
+        tbl->records[k].ref2          = rl_read_u16(rec + 6);
+    }
+
+    ctx->count++;
+    return NE_RELOC_OK;
+}
+
+static int reloc_parse_core(const uint8_t         *buf,
+                            size_t                 len,
+                            const NEParserContext *parser,
+                            NERelocContext        *ctx,
+                            NEArena               *arena)
+{
+    uint16_t i;
+    int      trusted;
+
     if (!buf || !parser || !ctx)
         return NE_RELOC_ERR_NULL;
 
     memset(ctx, 0, sizeof(*ctx));
+    ctx->arena = arena;
+    trusted    = ne_parser_trusted(parser, buf, len);
 
     if (parser->header.segment_count == 0 || !parser->segments)
         return NE_RELOC_OK;
@@ -55,14 +114,14 @@ int ne_reloc_parse(const uint8_t        *buf,
      * Allocate one NESegRelocTable slot per segment.  ctx->count tracks how
      * many slots are actually populated.
      */
-    ctx->tables = (NESegRelocTable *)NE_CALLOC(parser->header.segment_count,
-                                            sizeof(NESegRelocTable));
+    ctx->tables = (NESegRelocTable *)rl_alloc(ctx,
+                      (uint32_t)parser->header.segment_count
+                      * (uint32_t)sizeof(NESegRelocTable));
     if (!ctx->tables)
         return NE_RELOC_ERR_ALLOC;
 
     for (i = 0; i < parser->header.segment_count; i++) {
         const NESegmentDescriptor *sd = &parser->segments[i];
-        NESegRelocTable *tbl;
         uint32_t file_off;
         uint32_t data_size;
         uint32_t reloc_off;
@@ -77,7 +136,7 @@ int ne_reloc_parse(const uint8_t        *buf,
         reloc_off = file_off + data_size;
 
         /* Need at least 2 bytes for the record count field */
-        if ((uint32_t)reloc_off + 2u > (uint32_t)len) {
+        if (!trusted && (uint32_t)reloc_off + 2u > (uint32_t)len) {
             ne_reloc_free(ctx);
             return NE_RELOC_ERR_IO;
         }
@@ -87,62 +146,217 @@ int ne_reloc_parse(const uint8_t        *buf,
             continue;
 
         /* Validate that all record bytes are within the buffer */
-        if ((uint32_t)reloc_off + 2u + (uint32_t)count * 8u > (uint32_t)len) {
+        if (!trusted &&
+            (uint32_t)reloc_off + 2u + (uint32_t)count * 8u > (uint32_t)len) {
             ne_reloc_free(ctx);
             return NE_RELOC_ERR_IO;
         }
 
-        tbl = &ctx->tables[ctx->count];
-        tbl->seg_idx = i;
-        tbl->count   = count;
-        tbl->records = (NERelocRecord *)NE_CALLOC(count, sizeof(NERelocRecord));
-        if (!tbl->records) {
+        if (rl_add_table(ctx, i, count, buf + reloc_off + 2u) != NE_RELOC_OK) {
             ne_reloc_free(ctx);
             return NE_RELOC_ERR_ALLOC;
         }
+    }
+
+    return NE_RELOC_OK;
+}
+
+int ne_reloc_parse(const uint8_t        *buf,
+                   size_t                len,
+                   const NEParserContext *parser,
+                   NERelocContext        *ctx)
+{
+    return reloc_parse_core(buf, len, parser, ctx, NULL);
+}
+
+int ne_reloc_parse_arena(const uint8_t         *buf,
+                         size_t                 len,
+                         const NEParserContext *parser,
+                         NERelocContext        *ctx,
+                         NEArena               *arena)
+{
+    if (!arena || !arena->base)
+        return NE_RELOC_ERR_NULL;
+    return reloc_parse_core(buf, len, parser, ctx, arena);
+}
+
+int ne_reloc_parse_stream(NEReadAtFn             read_at,
+                          void                  *user,
+                          uint32_t               file_len,
+                          const NEParserContext *parser,
+                          const NELoaderContext *loader,
+                          NERelocContext        *ctx)
+{
+    uint8_t *raw = NULL;
+    uint16_t i;
+    int      rc  = NE_RELOC_OK;
+
+    if (!read_at || !parser || !ctx)
+        return NE_RELOC_ERR_NULL;
+
+    memset(ctx, 0, sizeof(*ctx));
+
+    if (parser->header.segment_count == 0 || !parser->segments)
+        return NE_RELOC_OK;
+
+    ctx->tables = (NESegRelocTable *)rl_alloc(ctx,
+                      (uint32_t)parser->header.segment_count
+                      * (uint32_t)sizeof(NESegRelocTable));
+    if (!ctx->tables)
+        return NE_RELOC_ERR_ALLOC;
+
+    for (i = 0; i < parser->header.segment_count && rc == NE_RELOC_OK; i++) {
+        const NESegmentDescriptor *sd = &parser->segments[i];
+        const NELoadedSegment *ls = NULL;
+        uint32_t reloc_off;
+        uint32_t size;
+        uint8_t  cnt[2];
+        uint16_t count;
+
+        if (!(sd->flags & NE_SEG_RELOC) || sd->offset == 0)
+            continue;
+
+        /* Block already read by ne_load_stream() along with a segment */
+        if (loader && i < loader->count)
+            ls = &loader->segments[i];
+        if (ls && ls->relocs) {
+            count = rl_read_u16(ls->relocs);
+            if (count > 0)
+                rc = rl_add_table(ctx, i, count, ls->relocs + 2);
+            continue;
+        }
+
+        reloc_off = ((uint32_t)sd->offset << parser->header.align_shift)
+                  + ((sd->length == 0) ? 0x10000u : (uint32_t)sd->length);
+        if (reloc_off > file_len || file_len - reloc_off < 2u ||
+            read_at(user, reloc_off, cnt, 2u) != 2u) {
+            rc = NE_RELOC_ERR_IO;
+            break;
+        }
+        count = rl_read_u16(cnt);
+        if (count == 0)
+            continue;
 
-        /* Parse each 8-byte record */
-        for (k = 0; k < count; k++) {
-            const uint8_t *rec = buf + reloc_off + 2u + (uint32_t)k * 8u;
-            tbl->records[k].address_type  = rec[0];
-            tbl->records[k].reloc_type    = rec[1];
-            tbl->records[k].target_offset = rl_read_u16(rec + 2);
-            tbl->records[k].ref1          = rl_read_u16(rec + 4);
-            tbl->records[k].ref2          = rl_read_u16(rec + 6);
+        size = (uint32_t)count * 8u;
+        if (file_len - reloc_off - 2u < size ||
+            (uint32_t)(size_t)size != size) {
+            rc = NE_RELOC_ERR_IO;
+            break;
         }
+        raw = (uint8_t *)NE_MALLOC((size_t)size);
+        if (!raw) {
+            rc = NE_RELOC_ERR_ALLOC;
+            break;
+        }
+        if (read_at(user, reloc_off + 2u, raw, (size_t)size) != (size_t)size)
+            rc = NE_RELOC_ERR_IO;
+        else
+            rc = rl_add_table(ctx, i, count, raw);
+        NE_FREE(raw);
+        raw = NULL;
+    }
+
+    if (rc != NE_RELOC_OK)
+        ne_reloc_free(ctx);
+    return rc;
+}
+
+/* -------------------------------------------------------------------------
+ * ne_arena_size_for_image
+ * ---------------------------------------------------------------------- */
+
+int ne_arena_size_for_image(const uint8_t *buf, size_t len, uint32_t *size)
+{
+    NEParserContext hdr;
+    const NEHeader *h;
+    uint32_t total;
+    uint32_t seg_abs;
+    uint16_t i;
+
+    if (!buf || !size)
+        return NE_RELOC_ERR_NULL;
+    *size = 0;
+
+    /* Parser state; also locates the (already bounds-checked) segment table */
+    if (ne_parse_arena_size(buf, len, &hdr, &total) != NE_OK)
+        return NE_RELOC_ERR_IO;
+    h = &hdr.header;
+    if (h->segment_count == 0)
+        goto done;
 
-        ctx->count++;
+    /* Loader segment array and relocation table array */
+    total += NE_ARENA_ROUND((uint32_t)h->segment_count
+                            * (uint32_t)sizeof(NELoadedSegment));
+    total += NE_ARENA_ROUND((uint32_t)h->segment_count
+                            * (uint32_t)sizeof(NESegRelocTable));
+
+    seg_abs = hdr.ne_offset + h->segment_table_offset;
+    for (i = 0; i < h->segment_count; i++) {
+        const uint8_t *sd = buf + seg_abs + (uint32_t)i * 8u;
+        uint16_t sector   = rl_read_u16(sd);
+        uint16_t seg_len  = rl_read_u16(sd + 2);
+        uint16_t flags    = rl_read_u16(sd + 4);
+        uint16_t min_alloc = rl_read_u16(sd + 6);
+        uint32_t data_sz  = (seg_len == 0) ? 0x10000u : (uint32_t)seg_len;
+        uint32_t alloc_sz = (min_alloc == 0) ? 0x10000u : (uint32_t)min_alloc;
+        uint32_t reloc_off;
+
+        /* Segment image, as sized by the loader */
+        total += NE_ARENA_ROUND(alloc_sz < data_sz ? data_sz : alloc_sz);
+
+        /* Relocation records, when the block lies inside the image */
+        if (!(flags & NE_SEG_RELOC) || sector == 0)
+            continue;
+        reloc_off = ((uint32_t)sector << h->align_shift) + data_sz;
+        if (reloc_off + 2u > (uint32_t)len)
+            continue;
+        total += NE_ARENA_ROUND((uint32_t)rl_read_u16(buf + reloc_off)
+                                * (uint32_t)sizeof(NERelocRecord));
     }
 
+done:
+    *size = total;
     return NE_RELOC_OK;
 }
 
 /* -------------------------------------------------------------------------
- * patch_location – write a relocation value at a single target offset
+ * patch_value – write a relocation value at a single target offset
  *
- * For non-ADDITIVE (chain) calls the caller must save the chain-next word
- * from data[off] BEFORE invoking this function, as the write will overwrite
- * those bytes.
+ * The caller has already checked that rl_addr_width(addr_type) bytes at
+ * 'off' lie inside the segment.  For non-ADDITIVE (chain) calls the caller
+ * must also save the chain-next word from data[off] BEFORE invoking this
+ * function, as the write will overwrite those bytes.
  *
  * seg_val  : 1-based segment index (used for SEG16, SEL16, FAR32 high word)
  * off_val  : byte offset within the target segment (used for OFF16, FAR32
  *            low word, PTR32, LOBYTE)
  * additive : non-zero → add to existing value; zero → replace
  * ---------------------------------------------------------------------- */
-static int patch_location(uint8_t  *data,
-                           uint32_t  seg_size,
-                           uint32_t  off,
-                           uint8_t   addr_type,
-                           uint16_t  seg_val,
-                           uint16_t  off_val,
-                           int       additive)
+
+/* Bytes patched by one relocation of 'addr_type'; 0 for unsupported types */
+static uint32_t rl_addr_width(uint8_t addr_type)
+{
+    switch (addr_type) {
+    case NE_RELOC_ADDR_LOBYTE: return 1u;
+    case NE_RELOC_ADDR_SEG16:
+    case NE_RELOC_ADDR_SEL16:
+    case NE_RELOC_ADDR_OFF16:  return 2u;
+    case NE_RELOC_ADDR_FAR32:
+    case NE_RELOC_ADDR_PTR32:  return 4u;
+    default:                   return 0u;
+    }
+}
+
+static void patch_value(uint8_t  *data,
+                        uint32_t  off,
+                        uint8_t   addr_type,
+                        uint16_t  seg_val,
+                        uint16_t  off_val,
+                        int       additive)
 {
     uint16_t old16;
     uint16_t old_seg;
 
-    if (off >= seg_size)
-        return NE_RELOC_ERR_BAD_SEG;
-
     if (addr_type == NE_RELOC_ADDR_LOBYTE) {
         if (additive)
             data[off] = (uint8_t)(data[off] + (uint8_t)(off_val & 0xFF));
@@ -151,8 +365,6 @@ static int patch_location(uint8_t  *data,
 
     } else if (addr_type == NE_RELOC_ADDR_SEG16
             || addr_type == NE_RELOC_ADDR_SEL16) {
-        if (off + 2u > seg_size)
-            return NE_RELOC_ERR_BAD_SEG;
         old16 = rl_read_u16(data + off);
         if (additive)
             rl_write_u16(data + off, (uint16_t)(old16 + seg_val));
@@ -160,8 +372,6 @@ static int patch_location(uint8_t  *data,
             rl_write_u16(data + off, seg_val);
 
     } else if (addr_type == NE_RELOC_ADDR_OFF16) {
-        if (off + 2u > seg_size)
-            return NE_RELOC_ERR_BAD_SEG;
         old16 = rl_read_u16(data + off);
         if (additive)
             rl_write_u16(data + off, (uint16_t)(old16 + off_val));
@@ -169,8 +379,6 @@ static int patch_location(uint8_t  *data,
             rl_write_u16(data + off, off_val);
 
     } else if (addr_type == NE_RELOC_ADDR_FAR32) {
-        if (off + 4u > seg_size)
-            return NE_RELOC_ERR_BAD_SEG;
         old16    = rl_read_u16(data + off);
         old_seg  = rl_read_u16(data + off + 2u);
         if (additive) {
@@ -181,9 +389,7 @@ static int patch_location(uint8_t  *data,
             rl_write_u16(data + off + 2u, seg_val);
         }
 
-    } else if (addr_type == NE_RELOC_ADDR_PTR32) {
-        if (off + 4u > seg_size)
-            return NE_RELOC_ERR_BAD_SEG;
+    } else { /* NE_RELOC_ADDR_PTR32 */
         old16 = rl_read_u16(data + off);
         if (additive)
             rl_write_u16(data + off, (uint16_t)(old16 + off_val));
@@ -191,136 +397,1553 @@ static int patch_location(uint8_t  *data,
             rl_write_u16(data + off,      off_val);
             rl_write_u16(data + off + 2u, 0); /* clear upper word */
         }
+    }
+}
+
+/* -------------------------------------------------------------------------
+ * Statistics helpers
+ * ---------------------------------------------------------------------- */
+
+/* Running totals for ne_reloc_apply_stats(); NULL everywhere else */
+typedef struct {
+    NERelocStats     *stats;
+    NERelocHotImport *log;        /* one entry per import record, or NULL */
+    uint32_t          log_count;
+    uint32_t          log_cap;
+    uint32_t          resolve_ns; /* sub-microsecond remainders           */
+    uint32_t          memo_ns;
+    const NEImportMemo *memo;     /* memo in front of the resolver, or NULL */
+} RelocTally;
+
+/* Monotonic time in nanoseconds, modulo 2^32 (differences only) */
+static uint32_t rl_now_ns(void)
+{
+#ifndef __WATCOMC__
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec * 1000000000UL + (uint32_t)ts.tv_nsec;
+#else
+    return (uint32_t)((unsigned long)clock() *
+                      (1000000000UL / (unsigned long)CLOCKS_PER_SEC));
+#endif
+}
+
+static void tally_resolve(RelocTally *tally, uint32_t ns, int memo_hit)
+{
+    NERelocStats *st = tally->stats;
 
+    if (memo_hit) {
+        st->memo_hits++;
+        tally->memo_ns += ns;
+        st->memo_us += tally->memo_ns / 1000u;
+        tally->memo_ns %= 1000u;
     } else {
-        return NE_RELOC_ERR_ADDR_TYPE;
+        st->resolver_calls++;
+        tally->resolve_ns += ns;
+        st->resolve_us += tally->resolve_ns / 1000u;
+        tally->resolve_ns %= 1000u;
     }
+}
 
-    return NE_RELOC_OK;
+/* Note one patched record; 'patches' locations were written */
+static void tally_record(RelocTally *tally, const NERelocRecord *rec,
+                         uint8_t rtype, int additive, uint32_t patches)
+{
+    NERelocStats *st = tally->stats;
+
+    st->patched += patches;
+    if (!additive) {
+        st->chains++;
+        if (patches > st->longest_chain)
+            st->longest_chain = patches;
+    }
+    if (tally->log && tally->log_count < tally->log_cap &&
+        (rtype == NE_RELOC_TYPE_IMP_ORD || rtype == NE_RELOC_TYPE_IMP_NAME)) {
+        NERelocHotImport *h = &tally->log[tally->log_count++];
+        h->mod_idx  = rec->ref1;
+        h->ref2     = rec->ref2;
+        h->by_name  = (uint8_t)(rtype == NE_RELOC_TYPE_IMP_NAME);
+        h->reserved = 0;
+        h->records  = 1;
+        h->patches  = patches;
+    }
 }
 
 /* -------------------------------------------------------------------------
  * ne_reloc_apply
  * ---------------------------------------------------------------------- */
 
+/*
+ * apply_table - apply every record of one segment's relocation table to
+ * that segment's (resident) image.  'tally' is NULL unless statistics
+ * were asked for.
+ */
+static int apply_table(NELoaderContext        *loader,
+                       const NESegRelocTable  *tbl,
+                       const NEParserContext  *parser,
+                       NEImportResolver        resolver,
+                       void                   *resolver_data,
+                       RelocTally             *tally)
+{
+    uint16_t  k;
+    uint8_t  *seg_data;
+    uint32_t  seg_size;
+    uint32_t  t0 = 0;
+    uint32_t  hits0 = 0;
+
+    if (tbl->seg_idx >= loader->count)
+        return NE_RELOC_ERR_BAD_SEG;
+
+    seg_data = loader->segments[tbl->seg_idx].data;
+    seg_size = loader->segments[tbl->seg_idx].alloc_size;
+
+    for (k = 0; k < tbl->count; k++) {
+        const NERelocRecord *rec = &tbl->records[k];
+        uint8_t  rtype    = (uint8_t)(rec->reloc_type & 0x03u);
+        int      additive = (rec->reloc_type & NE_RELOC_FLAG_ADDITIVE) != 0;
+        uint16_t seg_val  = 0;
+        uint16_t off_val  = 0;
+        uint32_t width;
+        int      rc;
+        uint32_t next;
+        uint16_t chain_next;
+        uint8_t  chain_next8;
+        uint32_t patches = 0;
+
+        if (tally)
+            tally->stats->records[rtype]++;
+
+        /* ---- Compute the value to patch ---- */
+        if (rtype == NE_RELOC_TYPE_INTERNAL) {
+            /*
+             * ref1 = target segment number (1-based).
+             * The "segment value" we write is the 1-based segment index
+             * (in a real DOS loader this would be the paragraph address).
+             * ref2 = byte offset within that segment (for FAR / OFF16).
+             */
+            if (rec->ref1 == 0 || rec->ref1 > parser->header.segment_count)
+                return NE_RELOC_ERR_BAD_SEG;
+            seg_val = rec->ref1;
+            off_val = rec->ref2;
+
+        } else if (rtype == NE_RELOC_TYPE_IMP_ORD
+                || rtype == NE_RELOC_TYPE_IMP_NAME) {
+            if (!resolver)
+                return NE_RELOC_ERR_UNRESOLVED;
+            if (tally) {
+                hits0 = tally->memo ? tally->memo->hits : 0;
+                t0    = rl_now_ns();
+            }
+            rc = resolver(rec->ref1,
+                          rec->ref2,
+                          (rtype == NE_RELOC_TYPE_IMP_NAME) ? 1 : 0,
+                          parser->imported_names,
+                          parser->imported_names_size,
+                          &seg_val,
+                          &off_val,
+                          resolver_data);
+            if (tally)
+                tally_resolve(tally, rl_now_ns() - t0,
+                              tally->memo && tally->memo->hits != hits0);
+            if (rc != NE_RELOC_OK)
+                return NE_RELOC_ERR_UNRESOLVED;
+
+        } else {
+            /* OS_FIXUP: silently skip */
+            continue;
+        }
+
+        /* ---- Apply the patch ---- */
+        width = rl_addr_width(rec->address_type);
+        if (width == 0)
+            return NE_RELOC_ERR_ADDR_TYPE;
+
+        if (additive) {
+            next = (uint32_t)rec->target_offset;
+            if (next + width > seg_size)
+                return NE_RELOC_ERR_BAD_SEG;
+            patch_value(seg_data, next, rec->address_type,
+                        seg_val, off_val, 1);
+            patches = 1;
+
+        } else if (rec->address_type == NE_RELOC_ADDR_LOBYTE) {
+            /*
+             * 1-byte chain: each byte gives the next offset to patch;
+             * 0xFF marks the end of the chain.  Links come from segment
+             * data, so every step is checked.
+             */
+            next = (uint32_t)rec->target_offset;
+            while (next != 0xFFu) {
+                if (next >= seg_size)
+                    return NE_RELOC_ERR_BAD_SEG;
+                chain_next8 = seg_data[next];
+                patch_value(seg_data, next, rec->address_type,
+                            seg_val, off_val, 0);
+                next = (uint32_t)chain_next8;
+                patches++;
+            }
+
+        } else {
+            /*
+             * 2-byte chain: each word gives the next offset to patch;
+             * 0xFFFF marks the end of the chain.
+             */
+            next = (uint32_t)rec->target_offset;
+            while (next != 0xFFFFu) {
+                if (next + width > seg_size)
+                    return NE_RELOC_ERR_BAD_SEG;
+                /* Save chain pointer before we overwrite those bytes */
+                chain_next = rl_read_u16(seg_data + next);
+                patch_value(seg_data, next, rec->address_type,
+                            seg_val, off_val, 0);
+                next = (uint32_t)chain_next;
+                patches++;
+            }
+        }
+
+        if (tally)
+            tally_record(tally, rec, rtype, additive, patches);
+    }
+
+    return NE_RELOC_OK;
+}
+
+/* Number of import records in 'ctx' (an upper bound on distinct imports) */
+static uint32_t rl_import_count(const NERelocContext *ctx)
+{
+    uint32_t n = 0;
+    uint16_t t, k;
+
+    for (t = 0; t < ctx->count; t++) {
+        const NESegRelocTable *tbl = &ctx->tables[t];
+        for (k = 0; k < tbl->count; k++) {
+            uint8_t rtype = (uint8_t)(tbl->records[k].reloc_type & 0x03u);
+            if (rtype == NE_RELOC_TYPE_IMP_ORD ||
+                rtype == NE_RELOC_TYPE_IMP_NAME)
+                n++;
+        }
+    }
+    return n;
+}
+
+/*
+ * Memoise imports for the duration of one call unless the caller already
+ * passes a memo: with more than one import record, *resolver / *data are
+ * redirected through 'memo'.  Without memory for the table every record
+ * is resolved directly.  'memo' must be released with
+ * ne_import_memo_free() either way.
+ */
+static void rl_memo_wrap(NEImportMemo *memo, uint32_t imports,
+                         NEImportResolver *resolver, void **data)
+{
+    memset(memo, 0, sizeof(*memo));
+    if (!*resolver || *resolver == ne_import_memo_resolver ||
+        *resolver == ne_bind_resolver || imports < 2u)
+        return;
+    if (ne_import_memo_init(memo, (uint16_t)(imports > 0x4000u ? 0x4000u
+                                                               : imports),
+                            *resolver, *data) != NE_RELOC_OK)
+        return;
+    *resolver = ne_import_memo_resolver;
+    *data     = memo;
+}
+
+/* Fold the import log into the NE_RELOC_STATS_TOP most-patched targets */
+static int hot_key_cmp(const void *a, const void *b)
+{
+    const NERelocHotImport *x = (const NERelocHotImport *)a;
+    const NERelocHotImport *y = (const NERelocHotImport *)b;
+
+    if (x->mod_idx != y->mod_idx)
+        return (x->mod_idx < y->mod_idx) ? -1 : 1;
+    if (x->by_name != y->by_name)
+        return (x->by_name < y->by_name) ? -1 : 1;
+    if (x->ref2 != y->ref2)
+        return (x->ref2 < y->ref2) ? -1 : 1;
+    return 0;
+}
+
+static int hot_rank_cmp(const void *a, const void *b)
+{
+    const NERelocHotImport *x = (const NERelocHotImport *)a;
+    const NERelocHotImport *y = (const NERelocHotImport *)b;
+
+    if (x->patches != y->patches)
+        return (x->patches > y->patches) ? -1 : 1;
+    if (x->records != y->records)
+        return (x->records > y->records) ? -1 : 1;
+    return hot_key_cmp(a, b);
+}
+
+static void tally_finish_hot(RelocTally *tally)
+{
+    NERelocHotImport *log = tally->log;
+    uint32_t          i, n = 0;
+
+    if (!log || tally->log_count == 0)
+        return;
+
+    qsort(log, (size_t)tally->log_count, sizeof(*log), hot_key_cmp);
+    for (i = 0; i < tally->log_count; i++) {
+        if (n && hot_key_cmp(&log[n - 1u], &log[i]) == 0) {
+            log[n - 1u].records += log[i].records;
+            log[n - 1u].patches += log[i].patches;
+        } else {
+            log[n++] = log[i];
+        }
+    }
+    qsort(log, (size_t)n, sizeof(*log), hot_rank_cmp);
+
+    if (n > NE_RELOC_STATS_TOP)
+        n = NE_RELOC_STATS_TOP;
+    memcpy(tally->stats->hot, log, (size_t)n * sizeof(*log));
+    tally->stats->hot_count = (uint16_t)n;
+}
+
+static int reloc_apply_core(NELoaderContext        *loader,
+                            const NERelocContext   *reloc_ctx,
+                            const NEParserContext  *parser,
+                            NEImportResolver        resolver,
+                            void                   *resolver_data,
+                            RelocTally             *tally)
+{
+    NEImportMemo memo;
+    uint16_t     t;
+    int          rc;
+
+    rl_memo_wrap(&memo, rl_import_count(reloc_ctx), &resolver,
+                 &resolver_data);
+    if (tally && resolver == ne_import_memo_resolver)
+        tally->memo = (const NEImportMemo *)resolver_data;
+
+    rc = NE_RELOC_OK;
+    for (t = 0; t < reloc_ctx->count && rc == NE_RELOC_OK; t++) {
+        const NESegRelocTable *tbl = &reloc_ctx->tables[t];
+
+        if (tbl->seg_idx >= loader->count) {
+            rc = NE_RELOC_ERR_BAD_SEG;
+            break;
+        }
+
+        /* Deferred segments are fixed up by ne_reloc_materialize() */
+        if (loader->segments[tbl->seg_idx].deferred)
+            continue;
+
+        rc = apply_table(loader, tbl, parser, resolver, resolver_data,
+                         tally);
+    }
+
+    ne_import_memo_free(&memo);
+    return rc;
+}
+
 int ne_reloc_apply(NELoaderContext        *loader,
                    const NERelocContext   *reloc_ctx,
                    const NEParserContext  *parser,
                    NEImportResolver        resolver,
                    void                   *resolver_data)
 {
-    uint16_t t;
-    uint16_t k;
+    if (!loader || !reloc_ctx || !parser)
+        return NE_RELOC_ERR_NULL;
+
+    return reloc_apply_core(loader, reloc_ctx, parser, resolver,
+                            resolver_data, NULL);
+}
 
+int ne_reloc_apply_stats(NELoaderContext        *loader,
+                         const NERelocContext   *reloc_ctx,
+                         const NEParserContext  *parser,
+                         NEImportResolver        resolver,
+                         void                   *resolver_data,
+                         NERelocStats           *stats)
+{
+    RelocTally tally;
+    uint32_t   imports;
+    uint32_t   t0, total_us;
+    int        rc;
+
+    if (!stats)
+        return ne_reloc_apply(loader, reloc_ctx, parser, resolver,
+                              resolver_data);
     if (!loader || !reloc_ctx || !parser)
         return NE_RELOC_ERR_NULL;
 
-    for (t = 0; t < reloc_ctx->count; t++) {
-        const NESegRelocTable *tbl = &reloc_ctx->tables[t];
-        uint16_t seg_idx = tbl->seg_idx;
-        uint8_t  *seg_data;
-        uint32_t  seg_size;
+    memset(stats, 0, sizeof(*stats));
+    memset(&tally, 0, sizeof(tally));
+    tally.stats = stats;
 
-        if (seg_idx >= loader->count)
-            return NE_RELOC_ERR_BAD_SEG;
+    imports = rl_import_count(reloc_ctx);
+    if (imports &&
+        imports <= (uint32_t)((size_t)-1 / sizeof(NERelocHotImport))) {
+        tally.log = (NERelocHotImport *)NE_MALLOC((size_t)imports *
+                                                  sizeof(NERelocHotImport));
+        if (tally.log)
+            tally.log_cap = imports;
+    }
 
-        seg_data = loader->segments[seg_idx].data;
-        seg_size = loader->segments[seg_idx].alloc_size;
+    t0 = rl_now_ns();
+    rc = reloc_apply_core(loader, reloc_ctx, parser, resolver,
+                          resolver_data, &tally);
+    total_us = (rl_now_ns() - t0) / 1000u;
+    stats->patch_us = (total_us > stats->resolve_us + stats->memo_us)
+                      ? total_us - stats->resolve_us - stats->memo_us : 0;
 
-        for (k = 0; k < tbl->count; k++) {
-            const NERelocRecord *rec = &tbl->records[k];
-            uint8_t  rtype    = (uint8_t)(rec->reloc_type & 0x03u);
-            int      additive = (rec->reloc_type & NE_RELOC_FLAG_ADDITIVE) != 0;
-            uint16_t seg_val  = 0;
-            uint16_t off_val  = 0;
-            int      rc;
-            uint32_t next;
-            uint16_t chain_next;
-            uint8_t  chain_next8;
-
-            /* ---- Compute the value to patch ---- */
-            if (rtype == NE_RELOC_TYPE_INTERNAL) {
-                /*
-                 * ref1 = target segment number (1-based).
-                 * The "segment value" we write is the 1-based segment index
-                 * (in a real DOS loader this would be the paragraph address).
-                 * ref2 = byte offset within that segment (for FAR / OFF16).
-                 */
-                if (rec->ref1 == 0 || rec->ref1 > parser->header.segment_count)
-                    return NE_RELOC_ERR_BAD_SEG;
-                seg_val = rec->ref1;
-                off_val = rec->ref2;
-
-            } else if (rtype == NE_RELOC_TYPE_IMP_ORD
-                    || rtype == NE_RELOC_TYPE_IMP_NAME) {
-                if (!resolver)
-                    return NE_RELOC_ERR_UNRESOLVED;
-                rc = resolver(rec->ref1,
-                              rec->ref2,
-                              (rtype == NE_RELOC_TYPE_IMP_NAME) ? 1 : 0,
-                              parser->imported_names,
-                              parser->imported_names_size,
-                              &seg_val,
-                              &off_val,
+    tally_finish_hot(&tally);
+    NE_FREE(tally.log);
+    return rc;
+}
+
+void ne_reloc_print_stats(const NERelocStats *stats, FILE *out)
+{
+    uint16_t i;
+
+    if (!stats || !out)
+        return;
+
+    fprintf(out, "=== NE Relocation Statistics ===\n");
+    fprintf(out, "Records         : %lu internal, %lu ordinal, %lu name, "
+                 "%lu OS fixup\n",
+            (unsigned long)stats->records[NE_RELOC_TYPE_INTERNAL],
+            (unsigned long)stats->records[NE_RELOC_TYPE_IMP_ORD],
+            (unsigned long)stats->records[NE_RELOC_TYPE_IMP_NAME],
+            (unsigned long)stats->records[NE_RELOC_TYPE_OS_FIXUP]);
+    fprintf(out, "Patched         : %lu locations, %lu chains, "
+                 "longest %lu\n",
+            (unsigned long)stats->patched,
+            (unsigned long)stats->chains,
+            (unsigned long)stats->longest_chain);
+    fprintf(out, "Resolver        : %lu calls, %lu us\n",
+            (unsigned long)stats->resolver_calls,
+            (unsigned long)stats->resolve_us);
+    fprintf(out, "Import memo     : %lu hits, %lu us\n",
+            (unsigned long)stats->memo_hits,
+            (unsigned long)stats->memo_us);
+    fprintf(out, "Patching        : %lu us\n",
+            (unsigned long)stats->patch_us);
+
+    if (stats->hot_count > 0) {
+        fprintf(out, "  %-6s  %-4s  %-6s  %-8s  %s\n",
+                "Module", "By", "Ref", "Records", "Patches");
+        for (i = 0; i < stats->hot_count; i++) {
+            const NERelocHotImport *h = &stats->hot[i];
+            fprintf(out, "  %-6u  %-4s  %-6u  %-8lu  %lu\n",
+                    (unsigned)h->mod_idx,
+                    h->by_name ? "name" : "ord",
+                    (unsigned)h->ref2,
+                    (unsigned long)h->records,
+                    (unsigned long)h->patches);
+        }
+    }
+
+    fprintf(out, "\n");
+}
+
+/* -------------------------------------------------------------------------
+ * ne_reloc_apply_parallel (worker pool on the POSIX host only)
+ * ---------------------------------------------------------------------- */
+
+#ifndef __WATCOMC__
+
+typedef struct {
+    NELoaderContext        *loader;
+    const NERelocContext   *ctx;
+    const NEParserContext  *parser;
+    NEImportResolver        resolver;
+    void                   *resolver_data;
+    uint32_t                imports;  /* import records, sizes each memo  */
+    int                    *results;  /* per-table status                 */
+    uint16_t                next;     /* next table to claim              */
+    int                     failed;   /* stop claiming after a failure    */
+    pthread_mutex_t         lock;
+} RelocQueue;
+
+static void *reloc_worker(void *arg)
+{
+    RelocQueue      *q = (RelocQueue *)arg;
+    NEImportMemo     memo;
+    NEImportResolver resolver = q->resolver;
+    void            *data     = q->resolver_data;
+    uint16_t         t;
+    int              rc;
+
+    rl_memo_wrap(&memo, q->imports, &resolver, &data);
+
+    for (;;) {
+        /*
+         * Tables are claimed in index order, so once one has failed every
+         * lower table is already claimed and will still finish: the
+         * lowest failing index is always reported.
+         */
+        pthread_mutex_lock(&q->lock);
+        t = q->next;
+        if (q->failed || t >= q->ctx->count) {
+            pthread_mutex_unlock(&q->lock);
+            break;
+        }
+        q->next++;
+        pthread_mutex_unlock(&q->lock);
+
+        rc = NE_RELOC_OK;
+        if (q->ctx->tables[t].seg_idx >= q->loader->count)
+            rc = NE_RELOC_ERR_BAD_SEG;
+        else if (!q->loader->segments[q->ctx->tables[t].seg_idx].deferred)
+            rc = apply_table(q->loader, &q->ctx->tables[t], q->parser,
+                             resolver, data, NULL);
+        q->results[t] = rc;
+
+        if (rc != NE_RELOC_OK) {
+            pthread_mutex_lock(&q->lock);
+            q->failed = 1;
+            pthread_mutex_unlock(&q->lock);
+        }
+    }
+
+    ne_import_memo_free(&memo);
+    return NULL;
+}
+
+#endif /* !__WATCOMC__ */
+
+int ne_reloc_apply_parallel(NELoaderContext        *loader,
+                            const NERelocContext   *reloc_ctx,
+                            const NEParserContext  *parser,
+                            NEImportResolver        resolver,
+                            void                   *resolver_data,
+                            unsigned                workers)
+{
+#ifndef __WATCOMC__
+    pthread_t  threads[NE_RELOC_MAX_WORKERS];
+    RelocQueue q;
+    unsigned   started = 0;
+    unsigned   w;
+    uint16_t   t;
+    int        rc = NE_RELOC_OK;
+
+    if (!loader || !reloc_ctx || !parser)
+        return NE_RELOC_ERR_NULL;
+
+    if (workers == 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = (ncpu > 0) ? (unsigned)ncpu : 1u;
+    }
+    if (workers > NE_RELOC_MAX_WORKERS)
+        workers = NE_RELOC_MAX_WORKERS;
+    if (workers > reloc_ctx->count)
+        workers = reloc_ctx->count;
+    if (workers < 2u || resolver == ne_import_memo_resolver)
+        return ne_reloc_apply(loader, reloc_ctx, parser, resolver,
                               resolver_data);
-                if (rc != NE_RELOC_OK)
-                    return NE_RELOC_ERR_UNRESOLVED;
 
-            } else {
-                /* OS_FIXUP: silently skip */
-                continue;
-            }
+    memset(&q, 0, sizeof(q));
+    q.loader        = loader;
+    q.ctx           = reloc_ctx;
+    q.parser        = parser;
+    q.resolver      = resolver;
+    q.resolver_data = resolver_data;
+    q.imports       = rl_import_count(reloc_ctx);
+    q.results       = (int *)NE_CALLOC(reloc_ctx->count, sizeof(int));
+    if (!q.results)
+        return NE_RELOC_ERR_ALLOC;
+    if (pthread_mutex_init(&q.lock, NULL) != 0) {
+        NE_FREE(q.results);
+        return ne_reloc_apply(loader, reloc_ctx, parser, resolver,
+                              resolver_data);
+    }
 
-            /* ---- Apply the patch ---- */
-            if (additive) {
-                rc = patch_location(seg_data, seg_size,
-                                    (uint32_t)rec->target_offset,
-                                    rec->address_type,
-                                    seg_val, off_val, 1);
-                if (rc != NE_RELOC_OK)
-                    return rc;
-
-            } else if (rec->address_type == NE_RELOC_ADDR_LOBYTE) {
-                /*
-                 * 1-byte chain: each byte gives the next offset to patch;
-                 * 0xFF marks the end of the chain.
-                 */
-                next = (uint32_t)rec->target_offset;
-                while (next != 0xFFu) {
-                    if (next >= seg_size)
-                        return NE_RELOC_ERR_BAD_SEG;
-                    chain_next8 = seg_data[next];
-                    rc = patch_location(seg_data, seg_size, next,
-                                        rec->address_type,
-                                        seg_val, off_val, 0);
-                    if (rc != NE_RELOC_OK)
-                        return rc;
-                    next = (uint32_t)chain_next8;
-                }
-
-            } else {
-                /*
-                 * 2-byte chain: each word gives the next offset to patch;
-                 * 0xFFFF marks the end of the chain.
-                 */
-                next = (uint32_t)rec->target_offset;
-                while (next != 0xFFFFu) {
-                    if (next + 2u > seg_size)
-                        return NE_RELOC_ERR_BAD_SEG;
-                    /* Save chain pointer before we overwrite those bytes */
-                    chain_next = rl_read_u16(seg_data + next);
-                    rc = patch_location(seg_data, seg_size, next,
-                                        rec->address_type,
-                                        seg_val, off_val, 0);
-                    if (rc != NE_RELOC_OK)
-                        return rc;
-                    next = (uint32_t)chain_next;
-                }
-            }
+    /* The calling thread is one of the workers */
+    for (w = 1; w < workers; w++) {
+        if (pthread_create(&threads[started], NULL, reloc_worker, &q) != 0)
+            break;
+        started++;
+    }
+    reloc_worker(&q);
+
+    for (w = 0; w < started; w++)
+        pthread_join(threads[w], NULL);
+    pthread_mutex_destroy(&q.lock);
+
+    for (t = 0; t < reloc_ctx->count; t++) {
+        if (q.results[t] != NE_RELOC_OK) {
+            rc = q.results[t];
+            break;
         }
     }
+    NE_FREE(q.results);
+    return rc;
+#else
+    (void)workers;
+    return ne_reloc_apply(loader, reloc_ctx, parser, resolver, resolver_data);
+#endif
+}
 
-    return NE_RELOC_OK;
+/* -------------------------------------------------------------------------
+ * ne_reloc_materialize
+ * ---------------------------------------------------------------------- */
+
+/*
+ * Put segment 'seg_idx' back in the deferred state after its fixups failed,
+ * so that a retry copies in a clean image instead of finding a resident,
+ * half-patched one.  'image' / 'image_len' are the loader's borrowed view as
+ * it was before ne_loader_materialize(), which drops it once the last
+ * deferred segment is in.
+ */
+static void reloc_unmaterialize(NELoaderContext *loader, uint16_t seg_idx,
+                                const uint8_t *image, size_t image_len)
+{
+    NELoadedSegment *ls = &loader->segments[seg_idx];
+
+    NE_FREE(ls->data);
+    ls->data     = NULL;
+    ls->deferred = 1;
+    if (loader->deferred_count++ == 0) {
+        loader->image     = image;
+        loader->image_len = image_len;
+    }
+}
+
+int ne_reloc_materialize(NELoaderContext        *loader,
+                         const NERelocContext   *reloc_ctx,
+                         const NEParserContext  *parser,
+                         uint16_t                seg_idx,
+                         NEImportResolver        resolver,
+                         void                   *resolver_data)
+{
+    const uint8_t *image;
+    size_t         image_len;
+    uint16_t       t;
+    int            rc;
+
+    if (!loader || !reloc_ctx || !parser)
+        return NE_RELOC_ERR_NULL;
+    if (seg_idx >= loader->count || !loader->segments)
+        return NE_RELOC_ERR_BAD_SEG;
+
+    /* Already resident: its fixups were applied by ne_reloc_apply() */
+    if (!loader->segments[seg_idx].deferred)
+        return NE_RELOC_OK;
+
+    image     = loader->image;
+    image_len = loader->image_len;
+    rc = ne_loader_materialize(loader, seg_idx);
+    if (rc == NE_LOAD_ERR_NOMEM)
+        return NE_RELOC_ERR_ALLOC;
+    if (rc != NE_LOAD_OK)
+        return NE_RELOC_ERR_IO;
+
+    for (t = 0; t < reloc_ctx->count; t++) {
+        if (reloc_ctx->tables[t].seg_idx != seg_idx)
+            continue;
+        rc = apply_table(loader, &reloc_ctx->tables[t], parser,
+                         resolver, resolver_data, NULL);
+        if (rc != NE_RELOC_OK)
+            reloc_unmaterialize(loader, seg_idx, image, image_len);
+        return rc;
+    }
+
+    return NE_RELOC_OK;
+}
+
+/* -------------------------------------------------------------------------
+ * Import memo
+ * ---------------------------------------------------------------------- */
+
+int ne_import_memo_init(NEImportMemo     *memo,
+                        uint16_t          entries,
+                        NEImportResolver  resolver,
+                        void             *userdata)
+{
+    uint32_t cap = 8u;
+
+    if (!memo || !resolver)
+        return NE_RELOC_ERR_NULL;
+
+    memset(memo, 0, sizeof(*memo));
+
+    /* Keep the table at most half full so probe runs stay short */
+    while (cap < 2u * (uint32_t)entries && cap < 0x8000u)
+        cap <<= 1;
+
+    memo->slots = (NEImportMemoEntry *)NE_CALLOC((size_t)cap,
+                                                 sizeof(NEImportMemoEntry));
+    if (!memo->slots)
+        return NE_RELOC_ERR_ALLOC;
+
+    memo->capacity = (uint16_t)cap;
+    memo->resolver = resolver;
+    memo->userdata = userdata;
+    return NE_RELOC_OK;
+}
+
+int ne_import_memo_resolver(uint16_t       mod_idx,
+                            uint16_t       ref2,
+                            int            by_name,
+                            const uint8_t *imported_names,
+                            uint16_t       imp_names_size,
+                            uint16_t      *out_seg,
+                            uint16_t      *out_offset,
+                            void          *userdata)
+{
+    NEImportMemo      *memo = (NEImportMemo *)userdata;
+    NEImportMemoEntry *e    = NULL;
+    uint16_t           mask;
+    uint16_t           h;
+    uint8_t            bn   = (uint8_t)(by_name ? 1 : 0);
+    int                rc;
+
+    if (!memo || !memo->resolver)
+        return NE_RELOC_ERR_UNRESOLVED;
+
+    if (memo->slots) {
+        mask = (uint16_t)(memo->capacity - 1u);
+        h    = (uint16_t)(((uint32_t)mod_idx * 0x9E37u
+                           ^ (uint32_t)ref2 * 0x85EBu ^ bn) & mask);
+        for (;;) {
+            e = &memo->slots[h];
+            if (!e->used)
+                break;
+            if (e->mod_idx == mod_idx && e->ref2 == ref2 &&
+                e->by_name == bn) {
+                memo->hits++;
+                *out_seg    = e->seg;
+                *out_offset = e->offset;
+                return NE_RELOC_OK;
+            }
+            h = (uint16_t)((h + 1u) & mask);
+        }
+    }
+
+    memo->misses++;
+    rc = memo->resolver(mod_idx, ref2, by_name, imported_names,
+                        imp_names_size, out_seg, out_offset, memo->userdata);
+
+    /* Store successes while the table is under half full */
+    if (rc == NE_RELOC_OK && e && memo->count < memo->capacity / 2u) {
+        e->mod_idx = mod_idx;
+        e->ref2    = ref2;
+        e->by_name = bn;
+        e->seg     = *out_seg;
+        e->offset  = *out_offset;
+        e->used    = 1;
+        memo->count++;
+    }
+    return rc;
+}
+
+void ne_import_memo_free(NEImportMemo *memo)
+{
+    if (!memo)
+        return;
+    NE_FREE(memo->slots);
+    memset(memo, 0, sizeof(*memo));
+}
+
+/* -------------------------------------------------------------------------
+ * Bound imports
+ * ---------------------------------------------------------------------- */
+
+/* Resolver wrapper used by ne_reloc_bind() to note each result */
+typedef struct {
+    NEImportResolver  resolver;
+    void             *userdata;
+    NEBoundImport    *out;
+    uint32_t          count;
+    uint32_t          cap;
+} BindRecorder;
+
+static int bind_record(uint16_t mod_idx, uint16_t ref2, int by_name,
+                       const uint8_t *imported_names,
+                       uint16_t imp_names_size,
+                       uint16_t *out_seg, uint16_t *out_offset,
+                       void *userdata)
+{
+    BindRecorder *rec = (BindRecorder *)userdata;
+    int           rc;
+
+    rc = rec->resolver(mod_idx, ref2, by_name, imported_names,
+                       imp_names_size, out_seg, out_offset, rec->userdata);
+    if (rc == NE_RELOC_OK && rec->count < rec->cap) {
+        NEBoundImport *b = &rec->out[rec->count++];
+        b->mod_idx  = mod_idx;
+        b->ref2     = ref2;
+        b->seg      = *out_seg;
+        b->offset   = *out_offset;
+        b->by_name  = (uint8_t)(by_name ? 1 : 0);
+        b->reserved = 0;
+    }
+    return rc;
+}
+
+static int bound_cmp_key(const NEBoundImport *b, uint16_t mod_idx,
+                         uint8_t by_name, uint16_t ref2)
+{
+    if (b->mod_idx != mod_idx)
+        return (b->mod_idx < mod_idx) ? -1 : 1;
+    if (b->by_name != by_name)
+        return (b->by_name < by_name) ? -1 : 1;
+    if (b->ref2 != ref2)
+        return (b->ref2 < ref2) ? -1 : 1;
+    return 0;
+}
+
+static int bound_cmp(const void *a, const void *b)
+{
+    const NEBoundImport *y = (const NEBoundImport *)b;
+
+    return bound_cmp_key((const NEBoundImport *)a, y->mod_idx, y->by_name,
+                         y->ref2);
+}
+
+int ne_reloc_bind(NELoaderContext        *loader,
+                  const NERelocContext   *reloc_ctx,
+                  const NEParserContext  *parser,
+                  NEImportResolver        resolver,
+                  void                   *resolver_data,
+                  const uint32_t         *dep_stamps,
+                  uint16_t                dep_count,
+                  NEBindInfo             *bind)
+{
+    BindRecorder rec;
+    uint32_t     imports;
+    uint32_t     i, n;
+    int          rc;
+
+    if (!loader || !reloc_ctx || !parser || !bind ||
+        (dep_count && !dep_stamps))
+        return NE_RELOC_ERR_NULL;
+
+    memset(bind, 0, sizeof(*bind));
+    memset(&rec, 0, sizeof(rec));
+
+    /* Every import record yields at most one distinct target */
+    imports = rl_import_count(reloc_ctx);
+    if (imports > (uint32_t)((size_t)-1 / sizeof(NEBoundImport)))
+        return NE_RELOC_ERR_ALLOC;
+    if (imports) {
+        rec.out = (NEBoundImport *)NE_MALLOC((size_t)imports *
+                                             sizeof(NEBoundImport));
+        if (!rec.out)
+            return NE_RELOC_ERR_ALLOC;
+    }
+    if (dep_count) {
+        bind->dep_stamps = (uint32_t *)NE_MALLOC((size_t)dep_count *
+                                                 sizeof(uint32_t));
+        if (!bind->dep_stamps) {
+            NE_FREE(rec.out);
+            return NE_RELOC_ERR_ALLOC;
+        }
+        memcpy(bind->dep_stamps, dep_stamps,
+               (size_t)dep_count * sizeof(uint32_t));
+    }
+
+    rec.resolver = resolver;
+    rec.userdata = resolver_data;
+    rec.cap      = imports;
+    rc = ne_reloc_apply(loader, reloc_ctx, parser,
+                        resolver ? bind_record : NULL, &rec);
+    if (rc != NE_RELOC_OK) {
+        NE_FREE(rec.out);
+        ne_bind_free(bind);
+        return rc;
+    }
+
+    /* The per-call memo already dedups unless it could not be allocated */
+    if (rec.count > 1u)
+        qsort(rec.out, (size_t)rec.count, sizeof(NEBoundImport), bound_cmp);
+    for (i = 0, n = 0; i < rec.count; i++) {
+        if (n && bound_cmp(&rec.out[n - 1u], &rec.out[i]) == 0)
+            continue;
+        rec.out[n++] = rec.out[i];
+    }
+
+    bind->dep_count = dep_count;
+    bind->imports   = rec.out;
+    bind->count     = n;
+    return NE_RELOC_OK;
+}
+
+int ne_bind_resolver(uint16_t       mod_idx,
+                     uint16_t       ref2,
+                     int            by_name,
+                     const uint8_t *imported_names,
+                     uint16_t       imp_names_size,
+                     uint16_t      *out_seg,
+                     uint16_t      *out_offset,
+                     void          *userdata)
+{
+    const NEBindInfo *bind = (const NEBindInfo *)userdata;
+    uint8_t           bn   = (uint8_t)(by_name ? 1 : 0);
+    uint32_t          lo, hi, mid;
+    int               c;
+
+    (void)imported_names;
+    (void)imp_names_size;
+
+    if (!bind)
+        return NE_RELOC_ERR_UNRESOLVED;
+
+    lo = 0;
+    hi = bind->count;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2u;
+        c   = bound_cmp_key(&bind->imports[mid], mod_idx, bn, ref2);
+        if (c == 0) {
+            *out_seg    = bind->imports[mid].seg;
+            *out_offset = bind->imports[mid].offset;
+            return NE_RELOC_OK;
+        }
+        if (c < 0)
+            lo = mid + 1u;
+        else
+            hi = mid;
+    }
+    return NE_RELOC_ERR_UNRESOLVED;
+}
+
+int ne_reloc_apply_bound(NELoaderContext        *loader,
+                         const NERelocContext   *reloc_ctx,
+                         const NEParserContext  *parser,
+                         const NEBindInfo       *bind,
+                         const uint32_t         *dep_stamps,
+                         uint16_t                dep_count)
+{
+    if (!loader || !reloc_ctx || !parser || !bind ||
+        (dep_count && !dep_stamps))
+        return NE_RELOC_ERR_NULL;
+
+    if (dep_count != bind->dep_count ||
+        (dep_count && memcmp(dep_stamps, bind->dep_stamps,
+                             (size_t)dep_count * sizeof(uint32_t)) != 0))
+        return NE_RELOC_ERR_STALE;
+
+    return ne_reloc_apply(loader, reloc_ctx, parser, ne_bind_resolver,
+                          (void *)bind);
+}
+
+/*
+ * Sidecar layout (little-endian):
+ *   [0]  magic  NE_BIND_MAGIC      [4]  version   [6]  dep_count
+ *   [8]  import count              [12] reserved (0)
+ *   then dep_count 4-byte stamps and count 10-byte records
+ *   (mod_idx, ref2, seg, offset, by_name, reserved).
+ */
+#define BIND_HDR_SIZE  16u
+#define BIND_REC_SIZE  10u
+
+static void bind_put_u32(uint8_t *p, uint32_t v)
+{
+    rl_write_u16(p,      (uint16_t)(v & 0xFFFFu));
+    rl_write_u16(p + 2u, (uint16_t)(v >> 16));
+}
+
+static uint32_t bind_get_u32(const uint8_t *p)
+{
+    return (uint32_t)rl_read_u16(p) | ((uint32_t)rl_read_u16(p + 2u) << 16);
+}
+
+int ne_bind_save(const char *path, const NEBindInfo *bind)
+{
+    uint8_t  hdr[BIND_HDR_SIZE];
+    uint8_t  rec[BIND_REC_SIZE];
+    FILE    *fp;
+    uint32_t i;
+    int      ok = 1;
+
+    if (!path || !bind)
+        return NE_RELOC_ERR_NULL;
+
+    fp = fopen(path, "wb");
+    if (!fp)
+        return NE_RELOC_ERR_IO;
+
+    bind_put_u32(hdr,      (uint32_t)NE_BIND_MAGIC);
+    rl_write_u16(hdr + 4,  (uint16_t)NE_BIND_VERSION);
+    rl_write_u16(hdr + 6,  bind->dep_count);
+    bind_put_u32(hdr + 8,  bind->count);
+    bind_put_u32(hdr + 12, 0);
+    ok = fwrite(hdr, 1, sizeof(hdr), fp) == sizeof(hdr);
+
+    for (i = 0; ok && i < bind->dep_count; i++) {
+        bind_put_u32(rec, bind->dep_stamps[i]);
+        ok = fwrite(rec, 1, 4, fp) == 4;
+    }
+    for (i = 0; ok && i < bind->count; i++) {
+        const NEBoundImport *b = &bind->imports[i];
+        rl_write_u16(rec,     b->mod_idx);
+        rl_write_u16(rec + 2, b->ref2);
+        rl_write_u16(rec + 4, b->seg);
+        rl_write_u16(rec + 6, b->offset);
+        rec[8] = b->by_name;
+        rec[9] = 0;
+        ok = fwrite(rec, 1, sizeof(rec), fp) == sizeof(rec);
+    }
+
+    if (fclose(fp) != 0)
+        ok = 0;
+    if (!ok) {
+        remove(path);
+        return NE_RELOC_ERR_IO;
+    }
+    return NE_RELOC_OK;
+}
+
+int ne_bind_load(const char *path, NEBindInfo *bind)
+{
+    uint8_t  hdr[BIND_HDR_SIZE];
+    uint8_t  rec[BIND_REC_SIZE];
+    FILE    *fp;
+    uint32_t i, count;
+    uint16_t deps;
+    int      rc = NE_RELOC_OK;
+
+    if (!path || !bind)
+        return NE_RELOC_ERR_NULL;
+    memset(bind, 0, sizeof(*bind));
+
+    fp = fopen(path, "rb");
+    if (!fp)
+        return NE_RELOC_ERR_IO;
+
+    if (fread(hdr, 1, sizeof(hdr), fp) != sizeof(hdr) ||
+        bind_get_u32(hdr) != (uint32_t)NE_BIND_MAGIC ||
+        rl_read_u16(hdr + 4) != NE_BIND_VERSION) {
+        fclose(fp);
+        return NE_RELOC_ERR_IO;
+    }
+    deps  = rl_read_u16(hdr + 6);
+    count = bind_get_u32(hdr + 8);
+
+    if (count > (uint32_t)((size_t)-1 / sizeof(NEBoundImport))) {
+        fclose(fp);
+        return NE_RELOC_ERR_ALLOC;
+    }
+    if (deps) {
+        bind->dep_stamps = (uint32_t *)NE_MALLOC((size_t)deps *
+                                                 sizeof(uint32_t));
+        if (!bind->dep_stamps)
+            rc = NE_RELOC_ERR_ALLOC;
+    }
+    if (rc == NE_RELOC_OK && count) {
+        bind->imports = (NEBoundImport *)NE_MALLOC((size_t)count *
+                                                   sizeof(NEBoundImport));
+        if (!bind->imports)
+            rc = NE_RELOC_ERR_ALLOC;
+    }
+
+    for (i = 0; rc == NE_RELOC_OK && i < deps; i++) {
+        if (fread(rec, 1, 4, fp) != 4)
+            rc = NE_RELOC_ERR_IO;
+        else
+            bind->dep_stamps[i] = bind_get_u32(rec);
+    }
+    for (i = 0; rc == NE_RELOC_OK && i < count; i++) {
+        NEBoundImport *b = &bind->imports[i];
+
+        if (fread(rec, 1, sizeof(rec), fp) != sizeof(rec)) {
+            rc = NE_RELOC_ERR_IO;
+            break;
+        }
+        b->mod_idx  = rl_read_u16(rec);
+        b->ref2     = rl_read_u16(rec + 2);
+        b->seg      = rl_read_u16(rec + 4);
+        b->offset   = rl_read_u16(rec + 6);
+        b->by_name  = (uint8_t)(rec[8] ? 1 : 0);
+        b->reserved = 0;
+        /* ne_bind_resolver() depends on the sort order */
+        if (i && bound_cmp(&bind->imports[i - 1u], b) >= 0)
+            rc = NE_RELOC_ERR_IO;
+    }
+    fclose(fp);
+
+    if (rc != NE_RELOC_OK) {
+        ne_bind_free(bind);
+        return rc;
+    }
+    bind->dep_count = deps;
+    bind->count     = count;
+    return NE_RELOC_OK;
+}
+
+void ne_bind_free(NEBindInfo *bind)
+{
+    if (!bind)
+        return;
+    NE_FREE(bind->dep_stamps);
+    NE_FREE(bind->imports);
+    memset(bind, 0, sizeof(*bind));
+}
+
+/* -------------------------------------------------------------------------
+ * Relocation plans
+ * ---------------------------------------------------------------------- */
+
+/* Resolved value of one plan target */
+typedef struct {
+    uint16_t seg_val;
+    uint16_t off_val;
+} NEPlanValue;
+
+/*
+ * Unrelocated bytes of one segment in the file image.  Bytes from
+ * 'size' up to the allocation read as zero, as they do once loaded.
+ */
+typedef struct {
+    const uint8_t *data;   /* segment data in the image (NULL: none)      */
+    uint32_t       size;   /* file bytes available at 'data'              */
+    uint32_t       alloc;  /* segment allocation size                     */
+} PlanSegView;
+
+static uint8_t pv_byte(const PlanSegView *v, uint32_t off)
+{
+    return (off < v->size) ? v->data[off] : 0u;
+}
+
+static uint16_t pv_u16(const PlanSegView *v, uint32_t off)
+{
+    return (uint16_t)(pv_byte(v, off) | ((uint16_t)pv_byte(v, off + 1u) << 8));
+}
+
+/* NE_PLAN_* kind for 'addr_type'; the type has already passed
+ * rl_addr_width() */
+static uint8_t plan_kind(uint8_t addr_type)
+{
+    switch (addr_type) {
+    case NE_RELOC_ADDR_LOBYTE: return NE_PLAN_LOBYTE;
+    case NE_RELOC_ADDR_OFF16:  return NE_PLAN_OFF16;
+    case NE_RELOC_ADDR_FAR32:  return NE_PLAN_FAR32;
+    case NE_RELOC_ADDR_PTR32:  return NE_PLAN_PTR32;
+    default:                   return NE_PLAN_SEG16;   /* SEG16, SEL16 */
+    }
+}
+
+/*
+ * plan_walk - walk the records of one table over the unrelocated segment
+ * 'v'.  With 'patches' / 'targets' NULL it only counts; otherwise it also
+ * fills them.  *n_patches / *n_targets receive the counts.
+ */
+static int plan_walk(const NESegRelocTable *tbl, const PlanSegView *v,
+                     const NEParserContext *parser,
+                     NERelocPatch *patches, NERelocTarget *targets,
+                     uint32_t *n_patches, uint16_t *n_targets)
+{
+    uint32_t np = 0;
+    uint16_t nt = 0;
+    uint16_t k;
+
+    for (k = 0; k < tbl->count; k++) {
+        const NERelocRecord *rec = &tbl->records[k];
+        uint8_t  rtype    = (uint8_t)(rec->reloc_type & 0x03u);
+        int      additive = (rec->reloc_type & NE_RELOC_FLAG_ADDITIVE) != 0;
+        uint32_t width;
+        uint32_t next;
+        uint32_t end_mark;
+        uint32_t steps;
+        uint8_t  kind;
+
+        if (rtype == NE_RELOC_TYPE_OS_FIXUP)
+            continue;
+        if (rtype == NE_RELOC_TYPE_INTERNAL &&
+            (rec->ref1 == 0 || rec->ref1 > parser->header.segment_count))
+            return NE_RELOC_ERR_BAD_SEG;
+
+        width = rl_addr_width(rec->address_type);
+        if (width == 0)
+            return NE_RELOC_ERR_ADDR_TYPE;
+        kind = plan_kind(rec->address_type);
+
+        if (targets) {
+            targets[nt].reloc_type = rtype;
+            targets[nt].ref1       = rec->ref1;
+            targets[nt].ref2       = rec->ref2;
+        }
+
+        next = (uint32_t)rec->target_offset;
+        if (additive) {
+            if (next + width > v->alloc)
+                return NE_RELOC_ERR_BAD_SEG;
+            if (patches) {
+                patches[np].offset   = (uint16_t)next;
+                patches[np].kind     = (uint8_t)(kind | NE_PLAN_ADDITIVE);
+                patches[np].reserved = 0;
+                patches[np].slot     = nt;
+            }
+            np++;
+            nt++;
+            continue;
+        }
+
+        /*
+         * Chain: same bounds rules as apply_table().  A well-formed chain
+         * visits each location once, so more steps than bytes in the
+         * segment means the links form a cycle.
+         */
+        end_mark = (rec->address_type == NE_RELOC_ADDR_LOBYTE) ? 0xFFu
+                                                               : 0xFFFFu;
+        steps = 0;
+        while (next != end_mark) {
+            if (next + width > v->alloc || ++steps > v->alloc)
+                return NE_RELOC_ERR_BAD_SEG;
+            if (patches) {
+                patches[np].offset   = (uint16_t)next;
+                patches[np].kind     = kind;
+                patches[np].reserved = 0;
+                patches[np].slot     = nt;
+            }
+            np++;
+            next = (end_mark == 0xFFu) ? (uint32_t)pv_byte(v, next)
+                                       : (uint32_t)pv_u16(v, next);
+        }
+        nt++;
+    }
+
+    *n_patches = np;
+    *n_targets = nt;
+    return NE_RELOC_OK;
+}
+
+/* NE_MALLOC 'n' elements of 'size' bytes; NULL when the total does not
+ * fit a 16-bit size_t */
+static void *rl_plan_alloc(uint32_t n, size_t size)
+{
+    uint32_t bytes = n * (uint32_t)size;
+
+    if (bytes / (uint32_t)size != n || (uint32_t)(size_t)bytes != bytes)
+        return NULL;
+    return NE_MALLOC((size_t)bytes);
+}
+
+/* Unrelocated view of segment 'seg_idx' within the file image */
+static int plan_seg_view(const uint8_t *buf, uint32_t len,
+                         const NEParserContext *parser, uint16_t seg_idx,
+                         PlanSegView *v)
+{
+    const NESegmentDescriptor *sd;
+    uint32_t file_off;
+
+    if (seg_idx >= parser->header.segment_count)
+        return NE_RELOC_ERR_BAD_SEG;
+
+    sd       = &parser->segments[seg_idx];
+    file_off = (uint32_t)sd->offset << parser->header.align_shift;
+    v->size  = (sd->length == 0) ? 0x10000u : (uint32_t)sd->length;
+    v->alloc = (sd->min_alloc == 0) ? 0x10000u : (uint32_t)sd->min_alloc;
+    if (v->alloc < v->size)
+        v->alloc = v->size;
+    if (file_off > len || v->size > len - file_off)
+        return NE_RELOC_ERR_IO;
+    v->data = buf + file_off;
+    return NE_RELOC_OK;
+}
+
+int ne_reloc_plan_build(const uint8_t         *buf,
+                        size_t                 len,
+                        const NEParserContext *parser,
+                        const NERelocContext  *reloc_ctx,
+                        NERelocPlan           *plan)
+{
+    PlanSegView view;
+    uint32_t    total_p = 0;
+    uint32_t    total_t = 0;
+    uint32_t    np;
+    uint16_t    nt;
+    uint16_t    t;
+    int         rc;
+
+    if (!buf || !parser || !reloc_ctx || !plan)
+        return NE_RELOC_ERR_NULL;
+
+    memset(plan, 0, sizeof(*plan));
+    if (reloc_ctx->count == 0)
+        return NE_RELOC_OK;
+
+    /* Pass 1: check every record and chain, and size the arrays */
+    plan->segs = (NESegRelocPlan *)NE_CALLOC(reloc_ctx->count,
+                                             sizeof(NESegRelocPlan));
+    if (!plan->segs)
+        return NE_RELOC_ERR_ALLOC;
+    plan->count = reloc_ctx->count;
+
+    for (t = 0; t < reloc_ctx->count; t++) {
+        const NESegRelocTable *tbl = &reloc_ctx->tables[t];
+        NESegRelocPlan        *sp  = &plan->segs[t];
+
+        rc = plan_seg_view(buf, (uint32_t)len, parser, tbl->seg_idx, &view);
+        if (rc == NE_RELOC_OK)
+            rc = plan_walk(tbl, &view, parser, NULL, NULL, &np, &nt);
+        if (rc != NE_RELOC_OK) {
+            ne_reloc_plan_free(plan);
+            return rc;
+        }
+
+        sp->seg_idx      = tbl->seg_idx;
+        sp->seg_size     = view.alloc;
+        sp->first_patch  = total_p;
+        sp->patch_count  = np;
+        sp->first_target = total_t;
+        sp->target_count = nt;
+        if (nt > plan->max_targets)
+            plan->max_targets = nt;
+        total_p += np;
+        total_t += nt;
+    }
+
+    /* Pass 2: fill the flat arrays */
+    if (total_p > 0)
+        plan->patches = (NERelocPatch *)rl_plan_alloc(total_p,
+                                                      sizeof(NERelocPatch));
+    if (total_t > 0)
+        plan->targets = (NERelocTarget *)rl_plan_alloc(total_t,
+                                                       sizeof(NERelocTarget));
+    if ((total_p > 0 && !plan->patches) || (total_t > 0 && !plan->targets)) {
+        ne_reloc_plan_free(plan);
+        return NE_RELOC_ERR_ALLOC;
+    }
+    plan->patch_count  = total_p;
+    plan->target_count = total_t;
+
+    for (t = 0; t < reloc_ctx->count; t++) {
+        const NESegRelocPlan *sp = &plan->segs[t];
+
+        plan_seg_view(buf, (uint32_t)len, parser, sp->seg_idx, &view);
+        plan_walk(&reloc_ctx->tables[t], &view, parser,
+                  plan->patches + sp->first_patch,
+                  plan->targets + sp->first_target, &np, &nt);
+    }
+
+    return NE_RELOC_OK;
+}
+
+/*
+ * plan_resolve - compute the value of each of 'n' targets into 'vals'.
+ * Imports go through 'resolver' once per target.
+ */
+static int plan_resolve(const NERelocTarget *tg, uint16_t n,
+                        const NEParserContext *parser,
+                        NEImportResolver resolver, void *resolver_data,
+                        NEPlanValue *vals)
+{
+    uint16_t i;
+
+    for (i = 0; i < n; i++) {
+        if (tg[i].reloc_type == NE_RELOC_TYPE_INTERNAL) {
+            vals[i].seg_val = tg[i].ref1;
+            vals[i].off_val = tg[i].ref2;
+            continue;
+        }
+        if (!resolver ||
+            resolver(tg[i].ref1, tg[i].ref2,
+                     (tg[i].reloc_type == NE_RELOC_TYPE_IMP_NAME) ? 1 : 0,
+                     parser->imported_names, parser->imported_names_size,
+                     &vals[i].seg_val, &vals[i].off_val,
+                     resolver_data) != NE_RELOC_OK)
+            return NE_RELOC_ERR_UNRESOLVED;
+    }
+    return NE_RELOC_OK;
+}
+
+/*
+ * plan_run - write every patch of 'sp' into 'data'.  Offsets were checked
+ * against sp->seg_size when the plan was built.
+ */
+static void plan_run(const NERelocPlan *plan, const NESegRelocPlan *sp,
+                     uint8_t *data, const NEPlanValue *vals)
+{
+    const NERelocPatch *p   = plan->patches + sp->first_patch;
+    const NERelocPatch *end = p + sp->patch_count;
+
+    for (; p < end; p++) {
+        uint8_t           *d = data + p->offset;
+        const NEPlanValue *v = &vals[p->slot];
+
+        switch (p->kind) {
+        case NE_PLAN_LOBYTE:
+            d[0] = (uint8_t)v->off_val;
+            break;
+        case NE_PLAN_SEG16:
+            rl_write_u16(d, v->seg_val);
+            break;
+        case NE_PLAN_OFF16:
+            rl_write_u16(d, v->off_val);
+            break;
+        case NE_PLAN_FAR32:
+            rl_write_u16(d,      v->off_val);
+            rl_write_u16(d + 2u, v->seg_val);
+            break;
+        case NE_PLAN_PTR32:
+            rl_write_u16(d,      v->off_val);
+            rl_write_u16(d + 2u, 0);
+            break;
+        case NE_PLAN_LOBYTE | NE_PLAN_ADDITIVE:
+            d[0] = (uint8_t)(d[0] + (uint8_t)v->off_val);
+            break;
+        case NE_PLAN_SEG16 | NE_PLAN_ADDITIVE:
+            rl_write_u16(d, (uint16_t)(rl_read_u16(d) + v->seg_val));
+            break;
+        case NE_PLAN_OFF16 | NE_PLAN_ADDITIVE:
+        case NE_PLAN_PTR32 | NE_PLAN_ADDITIVE:
+            rl_write_u16(d, (uint16_t)(rl_read_u16(d) + v->off_val));
+            break;
+        case NE_PLAN_FAR32 | NE_PLAN_ADDITIVE:
+            rl_write_u16(d,      (uint16_t)(rl_read_u16(d) + v->off_val));
+            rl_write_u16(d + 2u, (uint16_t)(rl_read_u16(d + 2u) + v->seg_val));
+            break;
+        }
+    }
+}
+
+/* Apply one segment's part of the plan using the scratch array 'vals' */
+static int plan_apply_one(const NERelocPlan *plan, const NESegRelocPlan *sp,
+                          uint8_t *data, uint32_t size,
+                          const NEParserContext *parser,
+                          NEImportResolver resolver, void *resolver_data,
+                          NEPlanValue *vals)
+{
+    int rc;
+
+    if (!data || size != sp->seg_size)
+        return NE_RELOC_ERR_BAD_SEG;
+
+    rc = plan_resolve(plan->targets + sp->first_target, sp->target_count,
+                      parser, resolver, resolver_data, vals);
+    if (rc != NE_RELOC_OK)
+        return rc;
+
+    plan_run(plan, sp, data, vals);
+    return NE_RELOC_OK;
+}
+
+static NEPlanValue *plan_values_alloc(const NERelocPlan *plan)
+{
+    /* one extra slot so a plan without targets still gets a buffer */
+    return (NEPlanValue *)NE_MALLOC(((size_t)plan->max_targets + 1u)
+                                    * sizeof(NEPlanValue));
+}
+
+int ne_reloc_plan_apply(NELoaderContext        *loader,
+                        const NERelocPlan      *plan,
+                        const NEParserContext  *parser,
+                        NEImportResolver        resolver,
+                        void                   *resolver_data)
+{
+    NEImportMemo memo;
+    NEPlanValue *vals;
+    uint32_t     imports = 0;
+    uint32_t     i;
+    uint16_t     t;
+    int          rc = NE_RELOC_OK;
+
+    if (!loader || !plan || !parser)
+        return NE_RELOC_ERR_NULL;
+    if (plan->count == 0)
+        return NE_RELOC_OK;
+
+    vals = plan_values_alloc(plan);
+    if (!vals)
+        return NE_RELOC_ERR_ALLOC;
+
+    for (i = 0; i < plan->target_count; i++)
+        if (plan->targets[i].reloc_type != NE_RELOC_TYPE_INTERNAL)
+            imports++;
+    rl_memo_wrap(&memo, imports, &resolver, &resolver_data);
+
+    for (t = 0; t < plan->count && rc == NE_RELOC_OK; t++) {
+        const NESegRelocPlan *sp = &plan->segs[t];
+        NELoadedSegment      *ls;
+
+        if (sp->seg_idx >= loader->count) {
+            rc = NE_RELOC_ERR_BAD_SEG;
+            break;
+        }
+        ls = &loader->segments[sp->seg_idx];
+
+        /* Deferred segments are fixed up by ne_reloc_plan_materialize() */
+        if (ls->deferred)
+            continue;
+
+        rc = plan_apply_one(plan, sp, ls->data, ls->alloc_size, parser,
+                            resolver, resolver_data, vals);
+    }
+
+    ne_import_memo_free(&memo);
+    NE_FREE(vals);
+    return rc;
+}
+
+int ne_reloc_plan_apply_segment(const NERelocPlan     *plan,
+                                uint16_t               seg_idx,
+                                uint8_t               *data,
+                                uint32_t               size,
+                                const NEParserContext *parser,
+                                NEImportResolver       resolver,
+                                void                  *resolver_data)
+{
+    NEPlanValue *vals;
+    uint16_t     t;
+    int          rc;
+
+    if (!plan || !data || !parser)
+        return NE_RELOC_ERR_NULL;
+
+    for (t = 0; t < plan->count; t++) {
+        if (plan->segs[t].seg_idx != seg_idx)
+            continue;
+
+        vals = plan_values_alloc(plan);
+        if (!vals)
+            return NE_RELOC_ERR_ALLOC;
+        rc = plan_apply_one(plan, &plan->segs[t], data, size, parser,
+                            resolver, resolver_data, vals);
+        NE_FREE(vals);
+        return rc;
+    }
+
+    return NE_RELOC_OK;
+}
+
+int ne_reloc_plan_materialize(NELoaderContext        *loader,
+                              const NERelocPlan      *plan,
+                              const NEParserContext  *parser,
+                              uint16_t                seg_idx,
+                              NEImportResolver        resolver,
+                              void                   *resolver_data)
+{
+    NELoadedSegment *ls;
+    const uint8_t   *image;
+    size_t           image_len;
+    int rc;
+
+    if (!loader || !plan || !parser)
+        return NE_RELOC_ERR_NULL;
+    if (seg_idx >= loader->count || !loader->segments)
+        return NE_RELOC_ERR_BAD_SEG;
+
+    ls = &loader->segments[seg_idx];
+    if (!ls->deferred)
+        return NE_RELOC_OK;
+
+    image     = loader->image;
+    image_len = loader->image_len;
+    rc = ne_loader_materialize(loader, seg_idx);
+    if (rc == NE_LOAD_ERR_NOMEM)
+        return NE_RELOC_ERR_ALLOC;
+    if (rc != NE_LOAD_OK)
+        return NE_RELOC_ERR_IO;
+
+    rc = ne_reloc_plan_apply_segment(plan, seg_idx, ls->data,
+                                     ls->alloc_size, parser,
+                                     resolver, resolver_data);
+    if (rc != NE_RELOC_OK)
+        reloc_unmaterialize(loader, seg_idx, image, image_len);
+    return rc;
+}
+
+void ne_reloc_plan_free(NERelocPlan *plan)
+{
+    if (!plan)
+        return;
+    NE_FREE(plan->patches);
+    NE_FREE(plan->targets);
+    NE_FREE(plan->segs);
+    memset(plan, 0, sizeof(*plan));
 }
 
 /* -------------------------------------------------------------------------
@@ -334,7 +1957,8 @@ void ne_reloc_free(NERelocContext *ctx)
     if (!ctx)
         return;
 
-    if (ctx->tables) {
+    /* Arena-backed tables go back with ne_arena_free() */
+    if (ctx->tables && !ctx->arena) {
         for (i = 0; i < ctx->count; i++)
             NE_FREE(ctx->tables[i].records);
         NE_FREE(ctx->tables);
@@ -357,6 +1981,7 @@ const char *ne_reloc_strerror(int err)
     case NE_RELOC_ERR_BAD_SEG:     return "segment index out of range";
     case NE_RELOC_ERR_UNRESOLVED:  return "unresolvable imported reference";
     case NE_RELOC_ERR_ADDR_TYPE:   return "unsupported address type";
+    case NE_RELOC_ERR_STALE:       return "bound imports out of date";
     default:                       return "unknown error";
     }
 }
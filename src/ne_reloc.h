@@ -29,6 +29,7 @@
 #define NE_RELOC_ERR_BAD_SEG    -4   /* segment index out of range          */
 #define NE_RELOC_ERR_UNRESOLVED -5   /* imported symbol unresolvable        */
 #define NE_RELOC_ERR_ADDR_TYPE  -6   /* unsupported address type            */
+#define NE_RELOC_ERR_STALE      -7   /* bound imports out of date           */
 
 /* -------------------------------------------------------------------------
  * Address type codes  (NERelocRecord.address_type)
@@ -48,6 +49,9 @@
 #define NE_RELOC_TYPE_IMP_NAME  2   /* imported reference – by name        */
 #define NE_RELOC_TYPE_OS_FIXUP  3   /* OS-specific fixup (skip)            */
 
+/* Upper bound on ne_reloc_apply_parallel() worker threads */
+#define NE_RELOC_MAX_WORKERS    64u
+
 /* Modifier flag in the reloc_type byte */
 #define NE_RELOC_FLAG_ADDITIVE  0x04 /* add to existing value (not chain)  */
 
@@ -93,14 +97,77 @@ typedef struct {
     NESegRelocTable *tables; /* heap-allocated; one entry per segment with
                                 NE_SEG_RELOC set and non-zero file data     */
     uint16_t         count;  /* number of filled entries in tables[]        */
+    NEArena         *arena;  /* owning arena (ne_reloc_parse_arena), or NULL */
 } NERelocContext;
 
+/* -------------------------------------------------------------------------
+ * Relocation plan
+ *
+ * A module's fixups compiled once, with every non-ADDITIVE chain already
+ * walked: one NERelocPatch per location to write, grouped by segment in
+ * the order ne_reloc_apply() would patch them.  Each patch names a target
+ * slot; applying the plan resolves each slot once and then runs a flat
+ * loop over the patches with no chain reads.
+ *
+ * A plan is read-only once built, so one plan can be shared by every
+ * instance of a cached module and reused when a discarded segment is
+ * loaded again.
+ * ---------------------------------------------------------------------- */
+
+/* Patch kinds (NERelocPatch.kind); SEL16 is written like SEG16 */
+#define NE_PLAN_LOBYTE     0
+#define NE_PLAN_SEG16      1
+#define NE_PLAN_OFF16      2
+#define NE_PLAN_FAR32      3
+#define NE_PLAN_PTR32      4
+#define NE_PLAN_ADDITIVE   0x08  /* add to the existing value            */
+
+typedef struct {
+    uint16_t offset;     /* byte offset of the patch within the segment   */
+    uint8_t  kind;       /* NE_PLAN_* | NE_PLAN_ADDITIVE                  */
+    uint8_t  reserved;
+    uint16_t slot;       /* target index relative to the segment's first  */
+} NERelocPatch;
+
+typedef struct {
+    uint8_t  reloc_type; /* NE_RELOC_TYPE_INTERNAL / IMP_ORD / IMP_NAME   */
+    uint16_t ref1;       /* as in NERelocRecord                           */
+    uint16_t ref2;
+} NERelocTarget;
+
+typedef struct {
+    uint16_t seg_idx;      /* 0-based segment the patches apply to        */
+    uint16_t target_count; /* targets used by this segment                */
+    uint32_t first_target; /* index of its first entry in targets[]       */
+    uint32_t first_patch;  /* index of its first entry in patches[]       */
+    uint32_t patch_count;  /* patches for this segment                    */
+    uint32_t seg_size;     /* alloc_size every patch was checked against  */
+} NESegRelocPlan;
+
+typedef struct {
+    NESegRelocPlan *segs;        /* one per relocation table              */
+    uint16_t        count;       /* entries in segs[]                     */
+    uint16_t        max_targets; /* largest target_count of any segment   */
+    NERelocTarget  *targets;     /* all targets, grouped by segment       */
+    uint32_t        target_count;
+    NERelocPatch   *patches;     /* all patches, grouped by segment       */
+    uint32_t        patch_count;
+} NERelocPlan;
+
 /* -------------------------------------------------------------------------
  * Import resolver callback
  *
- * Invoked by ne_reloc_apply() for every IMPORTED_ORDINAL or IMPORTED_NAME
- * record.  The implementation must locate the symbol in the referenced
- * module and return the target segment index (0-based) and offset.
+ * Invoked for IMPORTED_ORDINAL and IMPORTED_NAME records.  The
+ * implementation must locate the symbol in the referenced module and
+ * return the target segment index (0-based) and offset.
+ *
+ * The apply functions put a per-call NEImportMemo in front of the
+ * resolver whenever a module has two or more import records, so it is
+ * called once per distinct (mod_idx, ref2, by_name) key per call (per
+ * worker for ne_reloc_apply_parallel()), not once per record.  Its answer
+ * for a key must therefore not depend on which record asked; a failure is
+ * not remembered, and stops the call.  A resolver that is itself
+ * ne_import_memo_resolver or ne_bind_resolver is not wrapped again.
  *
  * Parameters:
  *   mod_idx        – 1-based index into the NE module-reference table
@@ -124,6 +191,108 @@ typedef int (*NEImportResolver)(uint16_t       mod_idx,
                                 uint16_t      *out_offset,
                                 void          *userdata);
 
+/* -------------------------------------------------------------------------
+ * Import memo
+ *
+ * Remembers what a resolver returned for each distinct (mod_idx, ref2,
+ * by_name) key so that every import is resolved once, however many
+ * records refer to it.  Pass ne_import_memo_resolver as the resolver and
+ * the memo as its userdata; the memo forwards misses to the resolver it
+ * was initialised with.  Failed lookups are not remembered.
+ *
+ * ne_reloc_apply() already memoises within one call (see NEImportResolver
+ * above).  A memo kept by the
+ * caller extends that across calls for the same module, e.g. to
+ * ne_reloc_materialize() of deferred segments.  IMP_NAME keys are offsets
+ * into one module's imported-names table, so a memo must not be shared
+ * between modules.
+ * ---------------------------------------------------------------------- */
+typedef struct {
+    uint16_t mod_idx;
+    uint16_t ref2;
+    uint16_t seg;        /* resolved segment                               */
+    uint16_t offset;     /* resolved offset                                */
+    uint8_t  by_name;
+    uint8_t  used;       /* non-zero when the slot holds a result          */
+} NEImportMemoEntry;
+
+typedef struct {
+    NEImportMemoEntry *slots;     /* open-addressed table, 'capacity' slots */
+    uint16_t           capacity;  /* power of two                          */
+    uint16_t           count;     /* slots in use                          */
+    NEImportResolver   resolver;  /* called on a miss                      */
+    void              *userdata;  /* passed to 'resolver'                  */
+    uint32_t           hits;      /* lookups answered from the table       */
+    uint32_t           misses;    /* lookups forwarded to 'resolver'       */
+} NEImportMemo;
+
+/* -------------------------------------------------------------------------
+ * Relocation statistics
+ *
+ * Filled by ne_reloc_apply_stats() to show where a module's load time
+ * goes.  Times are wall-clock microseconds (clock_gettime() on the host,
+ * clock() ticks on DOS, so short loads read 0 there).  Each import
+ * lookup is counted once: in 'resolver_calls' / 'resolve_us' when it
+ * reached the caller's resolver, in 'memo_hits' / 'memo_us' when the
+ * import memo answered it.  'patch_us' is the rest of the call.
+ * ---------------------------------------------------------------------- */
+#define NE_RELOC_STATS_TOP  8u   /* hottest import targets kept          */
+
+typedef struct {
+    uint16_t mod_idx;    /* 1-based module reference                      */
+    uint16_t ref2;       /* ordinal or imported-names offset              */
+    uint8_t  by_name;
+    uint8_t  reserved;
+    uint32_t records;    /* relocation records naming this import         */
+    uint32_t patches;    /* locations patched with it                     */
+} NERelocHotImport;
+
+typedef struct {
+    uint32_t records[4];      /* records seen, by NE_RELOC_TYPE_*         */
+    uint32_t patched;         /* locations written                        */
+    uint32_t chains;          /* non-ADDITIVE records (chain heads)       */
+    uint32_t longest_chain;   /* most locations patched by one record     */
+    uint32_t resolver_calls;  /* lookups passed to the caller's resolver  */
+    uint32_t memo_hits;       /* lookups answered by the import memo      */
+    uint32_t resolve_us;      /* time in the caller's resolver            */
+    uint32_t memo_us;         /* time in memo hits                        */
+    uint32_t patch_us;
+    NERelocHotImport hot[NE_RELOC_STATS_TOP]; /* most patches first       */
+    uint16_t hot_count;
+} NERelocStats;
+
+/* -------------------------------------------------------------------------
+ * Bound imports
+ *
+ * The import targets a module was last relocated with, together with one
+ * stamp per module reference (normally ne_export_fingerprint() of that
+ * dependency's export table).  While every dependency still has the same
+ * stamp, ne_reloc_apply_bound() replays the recorded targets and the
+ * resolver is not called at all.  ne_bind_save() / ne_bind_load() keep a
+ * binding in a sidecar file next to the module.
+ *
+ * A binding is tied to one module file: the caller must drop it when the
+ * module itself changes (e.g. together with its NEImageCache entry).
+ * ---------------------------------------------------------------------- */
+#define NE_BIND_MAGIC    0x444E4942UL /* "BIND" little-endian            */
+#define NE_BIND_VERSION  1u
+
+typedef struct {
+    uint16_t mod_idx;    /* 1-based module reference                      */
+    uint16_t ref2;       /* ordinal or imported-names offset              */
+    uint16_t seg;        /* resolved segment                              */
+    uint16_t offset;     /* resolved offset                               */
+    uint8_t  by_name;
+    uint8_t  reserved;
+} NEBoundImport;
+
+typedef struct {
+    uint32_t      *dep_stamps; /* one per module reference, [mod_idx - 1] */
+    uint16_t       dep_count;
+    NEBoundImport *imports;    /* sorted by (mod_idx, by_name, ref2)      */
+    uint32_t       count;
+} NEBindInfo;
+
 /* -------------------------------------------------------------------------
  * Public API
  * ---------------------------------------------------------------------- */
@@ -147,6 +316,55 @@ int ne_reloc_parse(const uint8_t      *buf,
                    const NEParserContext *parser,
                    NERelocContext      *ctx);
 
+/*
+ * ne_reloc_parse_arena - ne_reloc_parse() with the table array and all
+ * record arrays bump-allocated from 'arena'.
+ *
+ * Returns NE_RELOC_OK, NE_RELOC_ERR_ALLOC when the arena is too small, or
+ * another NE_RELOC_ERR_* code.  ne_reloc_free() on the result only resets
+ * *ctx; the memory goes back with ne_arena_free().
+ */
+int ne_reloc_parse_arena(const uint8_t         *buf,
+                         size_t                 len,
+                         const NEParserContext *parser,
+                         NERelocContext        *ctx,
+                         NEArena               *arena);
+
+/*
+ * ne_reloc_parse_stream - ne_reloc_parse() for a module loaded with
+ * ne_load_stream(), reading through 'read_at' (called with 'user') from
+ * a file of 'file_len' bytes instead of a complete image.
+ *
+ * Relocation blocks that 'loader' kept from its coalesced reads (see
+ * NELoadedSegment.relocs) are decoded from memory; each remaining block
+ * costs two read_at calls, one for the record count and one for the
+ * records.  'loader' may be NULL, in which case every block is read.
+ *
+ * Returns NE_RELOC_OK, NE_RELOC_ERR_IO for a block outside the file or a
+ * short read, or another NE_RELOC_ERR_* code.  On failure *ctx is zeroed
+ * and no memory is leaked.
+ */
+int ne_reloc_parse_stream(NEReadAtFn             read_at,
+                          void                  *user,
+                          uint32_t               file_len,
+                          const NEParserContext *parser,
+                          const NELoaderContext *loader,
+                          NERelocContext        *ctx);
+
+/*
+ * ne_arena_size_for_image - size one arena for the parser, loader and
+ * relocation state of the module in 'buf'.
+ *
+ * The figure is computed from the NE header, the name tables, the segment
+ * table and the per-segment relocation counts, without allocating.  It is
+ * exactly what ne_parse_buffer_arena(), ne_load_buffer_arena() and
+ * ne_reloc_parse_arena() consume, in that order, on the same image.
+ *
+ * Returns NE_RELOC_OK, NE_RELOC_ERR_NULL, or NE_RELOC_ERR_IO when the
+ * headers or segment table are not a valid NE image.
+ */
+int ne_arena_size_for_image(const uint8_t *buf, size_t len, uint32_t *size);
+
 /*
  * ne_reloc_apply - apply all parsed relocations to the loaded segment images.
  *
@@ -160,6 +378,8 @@ int ne_reloc_parse(const uint8_t      *buf,
  *
  * Non-ADDITIVE records follow the embedded linked-list chain; ADDITIVE
  * records add the computed value to whatever is already at the target.
+ * Each distinct import is passed to 'resolver' once per call (see
+ * NEImportResolver).
  *
  * Returns NE_RELOC_OK on success or a negative NE_RELOC_ERR_* code.
  */
@@ -170,7 +390,230 @@ int ne_reloc_apply(NELoaderContext        *loader,
                    void                   *resolver_data);
 
 /*
- * ne_reloc_free - release all heap memory owned by *ctx.
+ * ne_reloc_apply_stats - ne_reloc_apply() that also fills *stats (may be
+ * NULL).  The counters describe the records processed before any error.
+ * The hot-import list is left empty if there is no memory for it.
+ */
+int ne_reloc_apply_stats(NELoaderContext        *loader,
+                         const NERelocContext   *reloc_ctx,
+                         const NEParserContext  *parser,
+                         NEImportResolver        resolver,
+                         void                   *resolver_data,
+                         NERelocStats           *stats);
+
+/*
+ * ne_reloc_print_stats - write a human-readable summary of *stats to
+ * 'out', in the style of ne_loader_print_info().
+ */
+void ne_reloc_print_stats(const NERelocStats *stats, FILE *out);
+
+/*
+ * ne_reloc_apply_parallel - ne_reloc_apply() with the relocation tables
+ * spread over 'workers' threads (0: one per online CPU, clamped to
+ * NE_RELOC_MAX_WORKERS).
+ *
+ * Each table writes only into its own segment, so tables are applied
+ * independently.  'resolver' may be called from several threads at once
+ * and must be thread-safe; each worker memoises imports on its own.  A
+ * caller-held NEImportMemo is not thread-safe, so passing
+ * ne_import_memo_resolver makes the call run serially.
+ *
+ * When several tables fail, the error of the one with the lowest segment
+ * index is returned, as ne_reloc_apply() would; segments after it may or
+ * may not have been patched.  On the DOS target this is ne_reloc_apply().
+ */
+int ne_reloc_apply_parallel(NELoaderContext        *loader,
+                            const NERelocContext   *reloc_ctx,
+                            const NEParserContext  *parser,
+                            NEImportResolver        resolver,
+                            void                   *resolver_data,
+                            unsigned                workers);
+
+/*
+ * ne_reloc_materialize - bring a deferred segment into memory and apply
+ * its relocations.
+ *
+ * Used with ne_load_buffer_lazy(): ne_reloc_apply() skips segments that are
+ * still deferred, and this call performs both the copy-in and the fixups
+ * for 'seg_idx' (0-based) on first use.  A segment that is already resident
+ * is left untouched, so calling this more than once is harmless.  If a
+ * fixup fails the segment is released and stays deferred, so it can be
+ * retried.
+ *
+ * Returns NE_RELOC_OK on success or a negative NE_RELOC_ERR_* code.
+ */
+int ne_reloc_materialize(NELoaderContext        *loader,
+                         const NERelocContext   *reloc_ctx,
+                         const NEParserContext  *parser,
+                         uint16_t                seg_idx,
+                         NEImportResolver        resolver,
+                         void                   *resolver_data);
+
+/*
+ * ne_reloc_plan_build - compile the records in 'reloc_ctx' into *plan.
+ *
+ * 'buf' / 'len' are the file image the records were parsed from; chains
+ * are walked over the unrelocated segment data in it (bytes past a
+ * segment's file data read as zero, as in a loaded image).  Every record
+ * and chain link is checked once here, with the same rules and errors as
+ * ne_reloc_apply().  Chains are walked over the original links, so the
+ * plan matches ne_reloc_apply() for any image whose chains do not cross.
+ *
+ * Returns NE_RELOC_OK; the caller must call ne_reloc_plan_free().  On
+ * failure *plan is zeroed.
+ */
+int ne_reloc_plan_build(const uint8_t         *buf,
+                        size_t                 len,
+                        const NEParserContext *parser,
+                        const NERelocContext  *reloc_ctx,
+                        NERelocPlan           *plan);
+
+/*
+ * ne_reloc_plan_apply - apply *plan to every resident segment in *loader.
+ *
+ * Equivalent to ne_reloc_apply() with the relocation context the plan was
+ * built from.  Deferred segments are skipped; use
+ * ne_reloc_plan_materialize() for them.
+ *
+ * Returns NE_RELOC_OK, NE_RELOC_ERR_BAD_SEG when a segment does not match
+ * the plan, NE_RELOC_ERR_UNRESOLVED, or NE_RELOC_ERR_ALLOC.
+ */
+int ne_reloc_plan_apply(NELoaderContext        *loader,
+                        const NERelocPlan      *plan,
+                        const NEParserContext  *parser,
+                        NEImportResolver        resolver,
+                        void                   *resolver_data);
+
+/*
+ * ne_reloc_plan_apply_segment - apply the part of *plan for segment
+ * 'seg_idx' (0-based) to the freshly loaded image 'data' of 'size' bytes.
+ *
+ * Suitable for an NESegFixupFn that re-relocates a discarded segment when
+ * the segment manager loads it again.  A segment without fixups is left
+ * untouched.  Returns the same codes as ne_reloc_plan_apply().
+ */
+int ne_reloc_plan_apply_segment(const NERelocPlan     *plan,
+                                uint16_t               seg_idx,
+                                uint8_t               *data,
+                                uint32_t               size,
+                                const NEParserContext *parser,
+                                NEImportResolver       resolver,
+                                void                  *resolver_data);
+
+/*
+ * ne_reloc_plan_materialize - ne_reloc_materialize() driven by a plan.
+ * A segment whose fixups fail is left deferred, as there.
+ */
+int ne_reloc_plan_materialize(NELoaderContext        *loader,
+                              const NERelocPlan      *plan,
+                              const NEParserContext  *parser,
+                              uint16_t                seg_idx,
+                              NEImportResolver        resolver,
+                              void                   *resolver_data);
+
+/*
+ * ne_reloc_plan_free - release the plan's arrays and zero *plan.
+ * Safe to call on a zeroed plan or NULL.
+ */
+void ne_reloc_plan_free(NERelocPlan *plan);
+
+/*
+ * ne_import_memo_init - set up a memo with room for at least 'entries'
+ * distinct imports that forwards misses to 'resolver' / 'userdata'.
+ * When the table is full, further imports are resolved but not stored.
+ *
+ * Returns NE_RELOC_OK, NE_RELOC_ERR_NULL, or NE_RELOC_ERR_ALLOC.
+ */
+int ne_import_memo_init(NEImportMemo     *memo,
+                        uint16_t          entries,
+                        NEImportResolver  resolver,
+                        void             *userdata);
+
+/*
+ * ne_import_memo_resolver - NEImportResolver that looks the key up in the
+ * NEImportMemo passed as 'userdata' before calling its resolver.
+ */
+int ne_import_memo_resolver(uint16_t       mod_idx,
+                            uint16_t       ref2,
+                            int            by_name,
+                            const uint8_t *imported_names,
+                            uint16_t       imp_names_size,
+                            uint16_t      *out_seg,
+                            uint16_t      *out_offset,
+                            void          *userdata);
+
+/*
+ * ne_import_memo_free - release the table and zero *memo.
+ * Safe to call on a zeroed memo or NULL.
+ */
+void ne_import_memo_free(NEImportMemo *memo);
+
+/*
+ * ne_reloc_bind - ne_reloc_apply() that also records every import target
+ * in *bind, stamped with the 'dep_count' entries of 'dep_stamps' (may be
+ * NULL when dep_count is 0).
+ *
+ * Returns the ne_reloc_apply() result, or NE_RELOC_ERR_ALLOC.  *bind is
+ * filled only on success; the caller must call ne_bind_free().
+ */
+int ne_reloc_bind(NELoaderContext        *loader,
+                  const NERelocContext   *reloc_ctx,
+                  const NEParserContext  *parser,
+                  NEImportResolver        resolver,
+                  void                   *resolver_data,
+                  const uint32_t         *dep_stamps,
+                  uint16_t                dep_count,
+                  NEBindInfo             *bind);
+
+/*
+ * ne_reloc_apply_bound - relocate from a binding without calling a
+ * resolver.
+ *
+ * Returns NE_RELOC_ERR_STALE, leaving the segments untouched, when
+ * 'dep_stamps' differs from the stamps in *bind; the caller then rebinds
+ * with ne_reloc_bind().  Otherwise returns the ne_reloc_apply() result;
+ * an import missing from the binding is NE_RELOC_ERR_UNRESOLVED.
+ */
+int ne_reloc_apply_bound(NELoaderContext        *loader,
+                         const NERelocContext   *reloc_ctx,
+                         const NEParserContext  *parser,
+                         const NEBindInfo       *bind,
+                         const uint32_t         *dep_stamps,
+                         uint16_t                dep_count);
+
+/*
+ * ne_bind_resolver - NEImportResolver answering from the NEBindInfo
+ * passed as 'userdata', e.g. for ne_reloc_materialize() of a deferred
+ * segment of a bound module.
+ */
+int ne_bind_resolver(uint16_t       mod_idx,
+                     uint16_t       ref2,
+                     int            by_name,
+                     const uint8_t *imported_names,
+                     uint16_t       imp_names_size,
+                     uint16_t      *out_seg,
+                     uint16_t      *out_offset,
+                     void          *userdata);
+
+/*
+ * ne_bind_save - write *bind to the sidecar file 'path'.
+ * ne_bind_load - read it back into *bind (caller calls ne_bind_free()).
+ *
+ * Return NE_RELOC_OK, NE_RELOC_ERR_NULL, NE_RELOC_ERR_IO for a missing,
+ * short or foreign file, or NE_RELOC_ERR_ALLOC.
+ */
+int ne_bind_save(const char *path, const NEBindInfo *bind);
+int ne_bind_load(const char *path, NEBindInfo *bind);
+
+/*
+ * ne_bind_free - release the binding's arrays and zero *bind.
+ * Safe to call on a zeroed binding or NULL.
+ */
+void ne_bind_free(NEBindInfo *bind);
+
+/*
+ * ne_reloc_free - release all heap memory owned by *ctx (nothing for an
+ * arena-backed context).
  * Safe to call on a zeroed context or NULL.
  */
 void ne_reloc_free(NERelocContext *ctx);
@@ -0,0 +1,433 @@
+/*
+ * ne_scan.c - Batch NE directory scanner implementation
+ *
+ * Two phases: a serial directory walk collects the candidate paths, then
+ * the records are filled in by the worker pool (POSIX host) or in a plain
+ * loop (Watcom/DOS).  The walk is cheap compared with parsing, so only
+ * the second phase is parallel.
+ */
+
+#ifndef __WATCOMC__
+#define _POSIX_C_SOURCE 200809L   /* pthreads, dirent, sysconf under -std=c99 */
+#endif
+
+#include "ne_scan.h"
+#include "ne_parser.h"
+#include "ne_impexp.h"
+#include "ne_dosalloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef __WATCOMC__
+#include <direct.h>     /* opendir / readdir / closedir */
+#define NE_SCAN_SEP '\\'
+#else
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#define NE_SCAN_SEP '/'
+#endif
+
+/* -------------------------------------------------------------------------
+ * Internal helpers
+ * ---------------------------------------------------------------------- */
+
+/* Upper-case one ASCII character */
+static char sc_upper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+}
+
+/*
+ * has_ne_extension - non-zero for names ending in .EXE, .DLL or .DRV
+ * (case-insensitive).
+ */
+static int has_ne_extension(const char *name)
+{
+    static const char *const exts[] = { ".EXE", ".DLL", ".DRV" };
+    size_t n = strlen(name);
+    size_t e;
+    size_t k;
+
+    if (n < 4)
+        return 0;
+
+    for (e = 0; e < sizeof(exts) / sizeof(exts[0]); e++) {
+        for (k = 0; k < 4; k++) {
+            if (sc_upper(name[n - 4 + k]) != exts[e][k])
+                break;
+        }
+        if (k == 4)
+            return 1;
+    }
+    return 0;
+}
+
+/*
+ * str_append - append 'sep' (if the string is non-empty) and 's' to the
+ * growable heap string *buf of length *len and capacity *cap.
+ */
+static int str_append(char **buf, size_t *len, size_t *cap,
+                      char sep, const char *s)
+{
+    size_t add = strlen(s) + 2u;   /* separator + NUL */
+    char  *p;
+
+    if (*len + add > *cap) {
+        size_t new_cap = (*cap != 0) ? *cap * 2u : 64u;
+        while (new_cap < *len + add)
+            new_cap *= 2u;
+        p = (char *)NE_MALLOC(new_cap);
+        if (!p)
+            return NE_SCAN_ERR_ALLOC;
+        if (*buf) {
+            memcpy(p, *buf, *len + 1u);
+            NE_FREE(*buf);
+        }
+        *buf = p;
+        *cap = new_cap;
+    }
+
+    if (*len > 0)
+        (*buf)[(*len)++] = sep;
+    strcpy(*buf + *len, s);
+    *len += strlen(s);
+    return NE_SCAN_OK;
+}
+
+/* -------------------------------------------------------------------------
+ * Single-file scan
+ * ---------------------------------------------------------------------- */
+
+int ne_scan_file(NEScanRecord *rec)
+{
+    NEImage         img;
+    NEParserContext parser;
+    NEExportTable   exports;
+    char            item[NE_EXPORT_NAME_MAX + 8];
+    size_t          len = 0;
+    size_t          cap = 0;
+    uint16_t        i;
+    int             rc;
+
+    if (!rec)
+        return NE_ERR_NULL_ARG;
+
+    rec->imports = NULL;
+    rec->exports = NULL;
+
+    rc = ne_image_open(rec->path, &img);
+    if (rc != NE_OK)
+        return rec->status = rc;
+
+    rc = ne_parse_image(&img, &parser);
+    if (rc != NE_OK) {
+        ne_image_close(&img);
+        return rec->status = rc;
+    }
+
+    strncpy(rec->module, ne_module_name(&parser), NE_SCAN_NAME_MAX - 1u);
+    rec->module[NE_SCAN_NAME_MAX - 1u] = '\0';
+    rec->segment_count = parser.header.segment_count;
+    rec->import_count  = parser.module_ref_count;
+
+    for (i = 1; i <= parser.module_ref_count; i++) {
+        if (ne_module_ref_name(&parser, i, item, sizeof(item)) != NE_OK)
+            continue;
+        if (str_append(&rec->imports, &len, &cap, ';', item) != NE_SCAN_OK) {
+            rc = NE_ERR_ALLOC;
+            goto done;
+        }
+    }
+
+    len = 0;
+    cap = 0;
+    if (ne_export_build_parsed(&parser, NE_EXPORT_NAMES, &exports) == NE_IMPEXP_OK) {
+        rec->export_count = exports.count;
+        for (i = 0; i < exports.count; i++) {
+            const NEExportEntry *e = &exports.entries[i];
+            if (e->name[0] != '\0')
+                sprintf(item, "%u=%.255s", (unsigned)e->ordinal, e->name);
+            else
+                sprintf(item, "%u", (unsigned)e->ordinal);
+            if (str_append(&rec->exports, &len, &cap, ';', item)
+                    != NE_SCAN_OK) {
+                rc = NE_ERR_ALLOC;
+                break;
+            }
+        }
+        ne_export_free(&exports);
+    }
+
+done:
+    ne_free(&parser);
+    ne_image_close(&img);
+    return rec->status = rc;
+}
+
+void ne_scan_record_free(NEScanRecord *rec)
+{
+    if (!rec)
+        return;
+    NE_FREE(rec->imports);
+    NE_FREE(rec->exports);
+    rec->imports = NULL;
+    rec->exports = NULL;
+}
+
+/* -------------------------------------------------------------------------
+ * Directory walk
+ * ---------------------------------------------------------------------- */
+
+static int index_add(NEScanIndex *idx, const char *path)
+{
+    NEScanRecord *rec;
+
+    if (idx->count == idx->capacity) {
+        uint32_t      new_cap = idx->capacity ? idx->capacity * 2u : 64u;
+        NEScanRecord *grown;
+
+        grown = (NEScanRecord *)NE_MALLOC((size_t)new_cap *
+                                          sizeof(NEScanRecord));
+        if (!grown)
+            return NE_SCAN_ERR_ALLOC;
+        if (idx->records) {
+            memcpy(grown, idx->records,
+                   (size_t)idx->count * sizeof(NEScanRecord));
+            NE_FREE(idx->records);
+        }
+        idx->records  = grown;
+        idx->capacity = new_cap;
+    }
+
+    rec = &idx->records[idx->count++];
+    memset(rec, 0, sizeof(*rec));
+    strncpy(rec->path, path, NE_SCAN_PATH_MAX - 1u);
+    return NE_SCAN_OK;
+}
+
+static int walk_dir(NEScanIndex *idx, const char *dir, unsigned depth)
+{
+    DIR           *d;
+    struct dirent *de;
+    struct stat    st;
+    char           child[NE_SCAN_PATH_MAX];
+    int            rc = NE_SCAN_OK;
+
+    d = opendir(dir);
+    if (!d)
+        return (depth == 0) ? NE_SCAN_ERR_IO : NE_SCAN_OK;
+
+    while (rc == NE_SCAN_OK && (de = readdir(d)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
+        if (strlen(dir) + 1u + strlen(de->d_name) >= sizeof(child))
+            continue;   /* path too long: skip rather than truncate */
+        sprintf(child, "%s%c%s", dir, NE_SCAN_SEP, de->d_name);
+
+        if (stat(child, &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode)) {
+            if (depth + 1u < NE_SCAN_MAX_DEPTH)
+                rc = walk_dir(idx, child, depth + 1u);
+        } else if (has_ne_extension(de->d_name)) {
+            rc = index_add(idx, child);
+        }
+    }
+
+    closedir(d);
+    return rc;
+}
+
+static int record_cmp(const void *a, const void *b)
+{
+    return strcmp(((const NEScanRecord *)a)->path,
+                  ((const NEScanRecord *)b)->path);
+}
+
+/* -------------------------------------------------------------------------
+ * Worker pool (POSIX host only)
+ * ---------------------------------------------------------------------- */
+
+#ifndef __WATCOMC__
+
+typedef struct {
+    NEScanIndex     *idx;
+    uint32_t         next;   /* next record to claim */
+    pthread_mutex_t  lock;
+} NEScanQueue;
+
+static void *scan_worker(void *arg)
+{
+    NEScanQueue *q = (NEScanQueue *)arg;
+    uint32_t     i;
+
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        i = q->next++;
+        pthread_mutex_unlock(&q->lock);
+        if (i >= q->idx->count)
+            break;
+        ne_scan_file(&q->idx->records[i]);
+    }
+    return NULL;
+}
+
+static int scan_parallel(NEScanIndex *idx, unsigned workers)
+{
+    pthread_t   threads[NE_SCAN_MAX_WORKERS];
+    NEScanQueue q;
+    unsigned    started = 0;
+    unsigned    t;
+
+    if (workers == 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = (ncpu > 0) ? (unsigned)ncpu : 1u;
+    }
+    if (workers > NE_SCAN_MAX_WORKERS)
+        workers = NE_SCAN_MAX_WORKERS;
+    if (workers > idx->count)
+        workers = idx->count;
+
+    q.idx  = idx;
+    q.next = 0;
+    if (pthread_mutex_init(&q.lock, NULL) != 0)
+        return NE_SCAN_ERR_THREAD;
+
+    for (t = 0; t < workers; t++) {
+        if (pthread_create(&threads[t], NULL, scan_worker, &q) != 0)
+            break;
+        started++;
+    }
+
+    /* With no thread started, do the work here; otherwise just help out */
+    scan_worker(&q);
+
+    for (t = 0; t < started; t++)
+        pthread_join(threads[t], NULL);
+    pthread_mutex_destroy(&q.lock);
+    return NE_SCAN_OK;
+}
+
+#endif /* !__WATCOMC__ */
+
+/* -------------------------------------------------------------------------
+ * ne_scan_dir
+ * ---------------------------------------------------------------------- */
+
+int ne_scan_dir(const char *root, unsigned workers, NEScanIndex *idx)
+{
+    uint32_t i;
+    int      rc;
+
+    if (!root || !idx)
+        return NE_SCAN_ERR_NULL;
+
+    memset(idx, 0, sizeof(*idx));
+
+    rc = walk_dir(idx, root, 0);
+    if (rc != NE_SCAN_OK) {
+        ne_scan_free(idx);
+        return rc;
+    }
+
+    if (idx->count > 1)
+        qsort(idx->records, idx->count, sizeof(NEScanRecord), record_cmp);
+
+#ifndef __WATCOMC__
+    rc = scan_parallel(idx, workers);
+    if (rc != NE_SCAN_OK) {
+        ne_scan_free(idx);
+        return rc;
+    }
+#else
+    (void)workers;
+    for (i = 0; i < idx->count; i++)
+        ne_scan_file(&idx->records[i]);
+#endif
+
+    for (i = 0; i < idx->count; i++) {
+        if (idx->records[i].status == NE_OK)
+            idx->parsed++;
+        else
+            idx->failed++;
+    }
+    return NE_SCAN_OK;
+}
+
+/* -------------------------------------------------------------------------
+ * CSV output
+ * ---------------------------------------------------------------------- */
+
+/* Write one CSV field, quoting it when it contains ',', '"', CR or LF */
+static void csv_field(FILE *out, const char *s)
+{
+    if (!s)
+        return;
+    if (!strpbrk(s, ",\"\r\n")) {
+        fputs(s, out);
+        return;
+    }
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"')
+            fputc('"', out);
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+int ne_scan_write_csv(const NEScanIndex *idx, FILE *out)
+{
+    uint32_t i;
+
+    if (!idx || !out)
+        return NE_SCAN_ERR_NULL;
+
+    fprintf(out, "path,status,module,segments,imports,exports\n");
+    for (i = 0; i < idx->count; i++) {
+        const NEScanRecord *r = &idx->records[i];
+        csv_field(out, r->path);
+        fprintf(out, ",%d,", r->status);
+        csv_field(out, r->module);
+        fprintf(out, ",%u,", (unsigned)r->segment_count);
+        csv_field(out, r->imports);
+        fputc(',', out);
+        csv_field(out, r->exports);
+        fputc('\n', out);
+    }
+    return ferror(out) ? NE_SCAN_ERR_IO : NE_SCAN_OK;
+}
+
+/* -------------------------------------------------------------------------
+ * Cleanup / error strings
+ * ---------------------------------------------------------------------- */
+
+void ne_scan_free(NEScanIndex *idx)
+{
+    uint32_t i;
+
+    if (!idx)
+        return;
+
+    if (idx->records) {
+        for (i = 0; i < idx->count; i++)
+            ne_scan_record_free(&idx->records[i]);
+        NE_FREE(idx->records);
+    }
+    memset(idx, 0, sizeof(*idx));
+}
+
+const char *ne_scan_strerror(int err)
+{
+    switch (err) {
+    case NE_SCAN_OK:         return "success";
+    case NE_SCAN_ERR_NULL:   return "NULL argument";
+    case NE_SCAN_ERR_ALLOC:  return "memory allocation failure";
+    case NE_SCAN_ERR_IO:     return "directory cannot be read";
+    case NE_SCAN_ERR_THREAD: return "worker thread could not be started";
+    default:                 return "unknown error";
+    }
+}
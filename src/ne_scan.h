@@ -0,0 +1,128 @@
+/*
+ * ne_scan.h - Batch NE directory scanner
+ *
+ * Walks a directory tree, parses every .EXE / .DLL / .DRV file found and
+ * collects a compact per-module summary: module name, segment count, the
+ * modules it imports (module-reference table) and the symbols it exports
+ * (ne_export_build).  The result can be written as a CSV index.
+ *
+ * On the POSIX host the files are parsed in parallel by a pool of worker
+ * threads; each worker claims the next unparsed file from a shared
+ * counter and fills that file's record, so no record is touched by more
+ * than one thread.  On the Watcom/DOS target the same code runs serially.
+ *
+ * Reference: Microsoft "New Executable" format specification.
+ */
+
+#ifndef NE_SCAN_H
+#define NE_SCAN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* -------------------------------------------------------------------------
+ * Error codes
+ * ---------------------------------------------------------------------- */
+#define NE_SCAN_OK           0
+#define NE_SCAN_ERR_NULL    -1   /* NULL pointer argument                  */
+#define NE_SCAN_ERR_ALLOC   -2   /* memory allocation failure              */
+#define NE_SCAN_ERR_IO      -3   /* root directory cannot be read          */
+#define NE_SCAN_ERR_THREAD  -4   /* worker thread could not be started     */
+
+/* -------------------------------------------------------------------------
+ * Configuration
+ * ---------------------------------------------------------------------- */
+#define NE_SCAN_PATH_MAX     260u /* max path length incl. NUL            */
+#define NE_SCAN_NAME_MAX      64u /* max module name length incl. NUL     */
+#define NE_SCAN_MAX_WORKERS   64u /* upper bound on worker threads        */
+#define NE_SCAN_MAX_DEPTH     32u /* directory recursion limit            */
+
+/* -------------------------------------------------------------------------
+ * Scan record
+ * ---------------------------------------------------------------------- */
+
+/*
+ * NEScanRecord - summary of one scanned file.
+ *
+ * 'status' is NE_OK when the file parsed, otherwise the NE_ERR_* code from
+ * the parser (the remaining fields are then empty).
+ *
+ * 'imports' is a heap string of module names separated by ';'.
+ * 'exports' is a heap string of "ordinal=name" items separated by ';'
+ * ("ordinal" alone for ordinal-only exports).  Either may be NULL when
+ * the list is empty.
+ */
+typedef struct {
+    char      path[NE_SCAN_PATH_MAX];   /* file path as found by the walk   */
+    int       status;                   /* NE_OK or NE_ERR_* from parsing   */
+    char      module[NE_SCAN_NAME_MAX]; /* module name (resident name 0)    */
+    uint16_t  segment_count;            /* NE segment count                 */
+    uint16_t  import_count;             /* entries in the module-ref table  */
+    uint16_t  export_count;             /* entries in the export table      */
+    char     *imports;                  /* ';'-separated module names       */
+    char     *exports;                  /* ';'-separated ordinal=name list  */
+} NEScanRecord;
+
+/*
+ * NEScanIndex - all records of one scan, sorted by path.
+ *
+ * Release with ne_scan_free().
+ */
+typedef struct {
+    NEScanRecord *records;   /* heap-allocated array [0..count-1]          */
+    uint32_t      count;     /* number of files scanned                    */
+    uint32_t      capacity;  /* allocated slots                            */
+    uint32_t      parsed;    /* records with status == NE_OK               */
+    uint32_t      failed;    /* records with a parse error                 */
+} NEScanIndex;
+
+/* -------------------------------------------------------------------------
+ * Public API
+ * ---------------------------------------------------------------------- */
+
+/*
+ * ne_scan_dir - scan the tree rooted at 'root' into *idx.
+ *
+ * 'workers' is the number of parser threads; 0 picks one per online CPU.
+ * It is clamped to NE_SCAN_MAX_WORKERS and ignored on the DOS target.
+ * Files that fail to parse are still listed, with their error status.
+ *
+ * Returns NE_SCAN_OK on success; the caller must call ne_scan_free().
+ * On failure *idx is zeroed and no memory is leaked.
+ */
+int ne_scan_dir(const char *root, unsigned workers, NEScanIndex *idx);
+
+/*
+ * ne_scan_file - parse one file into *rec (used by ne_scan_dir for each
+ * file; also usable on its own).  rec->path must already be set.
+ * Returns rec->status.  Free the strings with ne_scan_record_free().
+ */
+int ne_scan_file(NEScanRecord *rec);
+
+/*
+ * ne_scan_record_free - release the heap strings owned by *rec.
+ */
+void ne_scan_record_free(NEScanRecord *rec);
+
+/*
+ * ne_scan_write_csv - write *idx to 'out' as CSV with a header row:
+ *   path,status,module,segments,imports,exports
+ * Fields containing ',', '"', CR or LF are quoted, so a name holding a
+ * line break cannot split a record.
+ * Returns NE_SCAN_OK, NE_SCAN_ERR_NULL or NE_SCAN_ERR_IO.
+ */
+int ne_scan_write_csv(const NEScanIndex *idx, FILE *out);
+
+/*
+ * ne_scan_free - release all memory owned by *idx.
+ * Safe to call on a zeroed index and on NULL.
+ */
+void ne_scan_free(NEScanIndex *idx);
+
+/*
+ * ne_scan_strerror - return a static string describing error code 'err'.
+ */
+const char *ne_scan_strerror(int err);
+
+#endif /* NE_SCAN_H */
@@ -3,7 +3,8 @@
  *               Segment Manager implementation
  *
  * Provides discardable segment eviction / demand-reload from a file
- * image, movable segment compaction, and segment locking.
+ * image, deferred (load-on-first-lock) segments, movable segment
+ * compaction, and segment locking.
  *
  * Host-side: uses standard C malloc / calloc / free (via ne_dosalloc.h).
  * Watcom/DOS 16-bit target: the NE_MALLOC / NE_CALLOC / NE_FREE macros
@@ -79,6 +80,8 @@ int ne_segmgr_init(NESegMgrContext   *ctx,
     ctx->next_handle = 1;
     ctx->file_buf    = file_buf;
     ctx->file_len    = file_len;
+    ctx->fixup_fn    = NULL;
+    ctx->fixup_data  = NULL;
     ctx->initialized = 1;
     return NE_SEGMGR_OK;
 }
@@ -148,6 +151,43 @@ NESegHandle ne_segmgr_add_segment(NESegMgrContext *ctx,
     return slot->handle;
 }
 
+/* =========================================================================
+ * ne_segmgr_add_deferred / ne_segmgr_set_fixup
+ * ===================================================================== */
+
+NESegHandle ne_segmgr_add_deferred(NESegMgrContext *ctx,
+                                   uint16_t         ne_flags,
+                                   uint32_t         alloc_size,
+                                   uint32_t         file_off,
+                                   uint32_t         file_size)
+{
+    NESegHandle h;
+    NESegEntry *seg;
+
+    h = ne_segmgr_add_segment(ctx, ne_flags, NULL, alloc_size,
+                              file_off, file_size);
+    if (h == NE_SEGMGR_HANDLE_INVALID)
+        return h;
+
+    /* Keep alloc_size as the size to allocate on first lock */
+    seg = segmgr_find_entry(ctx, h);
+    seg->state &= ~NE_SEG_STATE_LOADED;
+    seg->state |=  NE_SEG_STATE_DEFERRED;
+    return h;
+}
+
+int ne_segmgr_set_fixup(NESegMgrContext *ctx,
+                        NESegFixupFn     fn,
+                        void            *userdata)
+{
+    if (!ctx || !ctx->initialized)
+        return NE_SEGMGR_ERR_NULL;
+
+    ctx->fixup_fn   = fn;
+    ctx->fixup_data = userdata;
+    return NE_SEGMGR_OK;
+}
+
 /* =========================================================================
  * ne_segmgr_evict
  * ===================================================================== */
@@ -171,6 +211,10 @@ int ne_segmgr_evict(NESegMgrContext *ctx, NESegHandle handle)
     if (seg->lock_count > 0)
         return NE_SEGMGR_ERR_LOCKED;
 
+    /* Never loaded: nothing to discard */
+    if (seg->state & NE_SEG_STATE_DEFERRED)
+        return NE_SEGMGR_OK;
+
     /* Free the data buffer and mark as evicted */
     if (seg->data) {
         NE_FREE(seg->data);
@@ -190,6 +234,7 @@ int ne_segmgr_reload(NESegMgrContext *ctx, NESegHandle handle)
 {
     NESegEntry *seg;
     uint8_t    *buf;
+    uint32_t    size;
 
     if (!ctx || !ctx->initialized)
         return NE_SEGMGR_ERR_NULL;
@@ -203,6 +248,13 @@ int ne_segmgr_reload(NESegMgrContext *ctx, NESegHandle handle)
     if (seg->state & NE_SEG_STATE_LOADED)
         return NE_SEGMGR_ERR_LOADED;
 
+    /*
+     * Evicted segments have alloc_size 0 and come back at file_size;
+     * deferred segments still carry their full recorded allocation.
+     */
+    size = (seg->alloc_size > seg->file_size) ? seg->alloc_size
+                                              : seg->file_size;
+
     /* Need a file image for non-BSS segments */
     if (seg->file_size > 0) {
         if (!ctx->file_buf || ctx->file_len == 0)
@@ -210,21 +262,28 @@ int ne_segmgr_reload(NESegMgrContext *ctx, NESegHandle handle)
 
         if ((size_t)seg->file_off + (size_t)seg->file_size > ctx->file_len)
             return NE_SEGMGR_ERR_IO;
+    }
 
-        buf = (uint8_t *)NE_CALLOC(1, seg->file_size);
+    if (size > 0) {
+        buf = (uint8_t *)NE_CALLOC(1, size);
         if (!buf)
             return NE_SEGMGR_ERR_ALLOC;
-
-        memcpy(buf, ctx->file_buf + seg->file_off, seg->file_size);
-        seg->alloc_size = seg->file_size;
+        if (seg->file_size > 0)
+            memcpy(buf, ctx->file_buf + seg->file_off, seg->file_size);
     } else {
         /* BSS segment: no file backing */
         buf = NULL;
-        seg->alloc_size = 0;
     }
 
-    seg->data   = buf;
-    seg->state &= ~NE_SEG_STATE_EVICTED;
+    if (ctx->fixup_fn && ctx->fixup_fn(handle, buf, size,
+                                       ctx->fixup_data) != 0) {
+        NE_FREE(buf);
+        return NE_SEGMGR_ERR_FIXUP;
+    }
+
+    seg->data       = buf;
+    seg->alloc_size = size;
+    seg->state &= ~(NE_SEG_STATE_EVICTED | NE_SEG_STATE_DEFERRED);
     seg->state |=  NE_SEG_STATE_LOADED;
     return NE_SEGMGR_OK;
 }
@@ -241,7 +300,15 @@ void *ne_segmgr_lock(NESegMgrContext *ctx, NESegHandle handle)
         return NULL;
 
     seg = segmgr_find_entry(ctx, handle);
-    if (!seg || !(seg->state & NE_SEG_STATE_LOADED))
+    if (!seg)
+        return NULL;
+
+    /* First touch of a deferred segment loads it from the file image */
+    if ((seg->state & NE_SEG_STATE_DEFERRED) &&
+        ne_segmgr_reload(ctx, handle) != NE_SEGMGR_OK)
+        return NULL;
+
+    if (!(seg->state & NE_SEG_STATE_LOADED))
         return NULL;
 
     seg->lock_count++;
@@ -336,6 +403,7 @@ const char *ne_segmgr_strerror(int err)
     case NE_SEGMGR_ERR_LOADED:     return "segment is already loaded";
     case NE_SEGMGR_ERR_NO_FILE:    return "no file image available for reload";
     case NE_SEGMGR_ERR_IO:         return "file bounds / read failure";
+    case NE_SEGMGR_ERR_FIXUP:      return "post-load fixup failed";
     default:                       return "unknown error";
     }
 }
@@ -51,6 +51,7 @@
 #define NE_SEGMGR_ERR_LOADED      -8   /* segment is already loaded         */
 #define NE_SEGMGR_ERR_NO_FILE     -9   /* no file image available to reload */
 #define NE_SEGMGR_ERR_IO         -10   /* file bounds / read failure        */
+#define NE_SEGMGR_ERR_FIXUP      -11   /* post-load fixup hook failed       */
 
 /* -------------------------------------------------------------------------
  * Segment state flags (stored in NESegEntry.state)
@@ -59,6 +60,7 @@
 #define NE_SEG_STATE_EVICTED   0x0002u  /* data was discarded; reload needed */
 #define NE_SEG_STATE_MOVEABLE  0x0004u  /* segment may be relocated          */
 #define NE_SEG_STATE_DISCARDABLE 0x0008u/* segment may be evicted when free  */
+#define NE_SEG_STATE_DEFERRED  0x0010u  /* never loaded; loaded on first lock */
 
 /* -------------------------------------------------------------------------
  * Configuration constants
@@ -75,6 +77,20 @@ typedef uint16_t NESegHandle;
 
 #define NE_SEGMGR_HANDLE_INVALID ((NESegHandle)0)
 
+/* -------------------------------------------------------------------------
+ * Fixup callback
+ *
+ * Invoked after a segment has been (re)loaded from the file image, before
+ * the data is handed out, so that the owner can re-apply the segment's
+ * relocation records.  A non-zero return aborts the load: the segment is
+ * returned to its previous unloaded state and the load fails with
+ * NE_SEGMGR_ERR_FIXUP.
+ * ---------------------------------------------------------------------- */
+typedef int (*NESegFixupFn)(NESegHandle handle,
+                            uint8_t    *data,
+                            uint32_t    alloc_size,
+                            void       *userdata);
+
 /* -------------------------------------------------------------------------
  * Segment entry  (internal)
  *
@@ -107,6 +123,9 @@ typedef struct {
     const uint8_t *file_buf;  /* pointer to the complete NE file image       */
     size_t         file_len;  /* byte length of file_buf                     */
 
+    NESegFixupFn   fixup_fn;  /* optional post-load fixup hook (may be NULL) */
+    void          *fixup_data;/* userdata passed to fixup_fn                 */
+
     int          initialized; /* non-zero after successful init              */
 } NESegMgrContext;
 
@@ -162,6 +181,32 @@ NESegHandle ne_segmgr_add_segment(NESegMgrContext *ctx,
                                   uint32_t         file_off,
                                   uint32_t         file_size);
 
+/*
+ * ne_segmgr_add_deferred - register a segment without loading it.
+ *
+ * The segment is recorded with its file extent and marked
+ * NE_SEG_STATE_DEFERRED.  Nothing is allocated until the first
+ * ne_segmgr_lock(), which loads 'alloc_size' bytes (at least 'file_size')
+ * from the file image and runs the fixup hook, if any.
+ *
+ * Returns a non-zero NESegHandle on success, NE_SEGMGR_HANDLE_INVALID on
+ * failure (table full or NULL context).
+ */
+NESegHandle ne_segmgr_add_deferred(NESegMgrContext *ctx,
+                                   uint16_t         ne_flags,
+                                   uint32_t         alloc_size,
+                                   uint32_t         file_off,
+                                   uint32_t         file_size);
+
+/*
+ * ne_segmgr_set_fixup - install the hook run after every load from the
+ * file image (deferred first load and demand-reload alike).  Pass NULL to
+ * remove it.  Returns NE_SEGMGR_OK or NE_SEGMGR_ERR_NULL.
+ */
+int ne_segmgr_set_fixup(NESegMgrContext *ctx,
+                        NESegFixupFn     fn,
+                        void            *userdata);
+
 /* =========================================================================
  * Public API – eviction and demand-reload
  * ===================================================================== */
@@ -184,11 +229,13 @@ int ne_segmgr_evict(NESegMgrContext *ctx, NESegHandle handle);
  * Re-allocates a buffer for the segment, copies file_size bytes from
  * file_buf[file_off], and marks the segment as loaded again.
  *
- * The segment must currently be in the evicted state.  A file image
+ * The segment must currently be in the evicted or deferred state.  A
+ * deferred segment gets its full recorded allocation; an evicted one gets
+ * file_size bytes.  The fixup hook, if set, runs before returning.  A file image
  * (file_buf != NULL) must have been supplied to ne_segmgr_init().
  *
  * Returns NE_SEGMGR_OK, NE_SEGMGR_ERR_LOADED, NE_SEGMGR_ERR_NO_FILE,
- * NE_SEGMGR_ERR_IO, NE_SEGMGR_ERR_ALLOC, NE_SEGMGR_ERR_NOT_FOUND, or
+ * NE_SEGMGR_ERR_IO, NE_SEGMGR_ERR_ALLOC, NE_SEGMGR_ERR_FIXUP, NE_SEGMGR_ERR_NOT_FOUND, or
  * NE_SEGMGR_ERR_BAD_HANDLE.
  */
 int ne_segmgr_reload(NESegMgrContext *ctx, NESegHandle handle);
@@ -201,8 +248,9 @@ int ne_segmgr_reload(NESegMgrContext *ctx, NESegHandle handle);
  * ne_segmgr_lock - increment the lock count of a segment and return a
  * pointer to its data.
  *
- * A locked segment cannot be evicted.  Returns NULL if the segment is
- * not found, is evicted, or handle is invalid.
+ * A locked segment cannot be evicted.  A deferred segment is loaded from
+ * the file image first.  Returns NULL if the segment is not found, is
+ * evicted, fails to load, or handle is invalid.
  */
 void *ne_segmgr_lock(NESegMgrContext *ctx, NESegHandle handle);
 
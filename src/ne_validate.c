@@ -0,0 +1,266 @@
+/*
+ * ne_validate.c - One-pass NE image integrity check implementation
+ *
+ * Reads the headers, tables, segment descriptors and relocation records
+ * straight from the caller's image in file order; nothing is copied or
+ * allocated.
+ */
+
+#include "ne_validate.h"
+#include "ne_parser.h"
+#include "ne_reloc.h"
+
+#include <string.h>
+
+/* -------------------------------------------------------------------------
+ * Internal helpers
+ * ---------------------------------------------------------------------- */
+
+#define VD_MZ_SIZE      64u
+#define VD_NE_SIZE      64u
+#define VD_SEG_DESC     8u
+#define VD_RELOC_REC    8u
+#define VD_MAX_SHIFT    15u   /* larger shifts overflow 32-bit file offsets */
+#define VD_NO_SEGMENT   0xFFFFu
+
+static uint16_t vd_read_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | ((uint16_t)p[1] << 8));
+}
+
+static uint32_t vd_read_u32(const uint8_t *p)
+{
+    return (uint32_t)(p[0]
+                    | ((uint32_t)p[1] <<  8)
+                    | ((uint32_t)p[2] << 16)
+                    | ((uint32_t)p[3] << 24));
+}
+
+/* Non-zero when [off, off + size) lies within an image of 'len' bytes */
+static int vd_in_image(uint32_t off, uint32_t size, uint32_t len)
+{
+    return off <= len && size <= len - off;
+}
+
+/* Bytes patched by one relocation of 'addr_type'; 0 for unknown types */
+static uint32_t vd_addr_width(uint8_t addr_type)
+{
+    switch (addr_type) {
+    case NE_RELOC_ADDR_LOBYTE: return 1u;
+    case NE_RELOC_ADDR_SEG16:
+    case NE_RELOC_ADDR_SEL16:
+    case NE_RELOC_ADDR_OFF16:  return 2u;
+    case NE_RELOC_ADDR_FAR32:
+    case NE_RELOC_ADDR_PTR32:  return 4u;
+    default:                   return 0u;
+    }
+}
+
+/* Record the first failure in *rep and return 'err' */
+static int vd_fail(NEValidateReport *rep, int err, uint32_t off,
+                   uint16_t seg)
+{
+    rep->status       = err;
+    rep->fail_offset  = off;
+    rep->fail_segment = seg;
+    return err;
+}
+
+/* -------------------------------------------------------------------------
+ * ne_validate_image
+ * ---------------------------------------------------------------------- */
+
+int ne_validate_image(const uint8_t *buf, size_t len_in, NEValidateReport *rep)
+{
+    NEValidateReport local;
+    const uint8_t *ne;
+    uint32_t len = (uint32_t)len_in;
+    uint32_t ne_off;
+    uint16_t seg_count, mod_count, shift;
+    uint16_t seg_rel, res_rel, resname_rel, modref_rel, imp_rel;
+    uint16_t entry_rel, entry_len, nonres_size;
+    uint32_t nonres_abs;
+    uint16_t i, k;
+
+    if (!rep)
+        rep = &local;
+    memset(rep, 0, sizeof(*rep));
+    rep->fail_segment = VD_NO_SEGMENT;
+    if (!buf)
+        return vd_fail(rep, NE_VALIDATE_ERR_NULL, 0, VD_NO_SEGMENT);
+
+    /* ---- Headers ---- */
+    if (len < VD_MZ_SIZE || vd_read_u16(buf) != MZ_MAGIC)
+        return vd_fail(rep, NE_VALIDATE_ERR_HEADER, 0, VD_NO_SEGMENT);
+    ne_off = vd_read_u32(buf + 0x3C);
+    if (ne_off < VD_MZ_SIZE || !vd_in_image(ne_off, VD_NE_SIZE, len))
+        return vd_fail(rep, NE_VALIDATE_ERR_HEADER, 0x3Cu, VD_NO_SEGMENT);
+    ne = buf + ne_off;
+    if (vd_read_u16(ne) != NE_MAGIC)
+        return vd_fail(rep, NE_VALIDATE_ERR_HEADER, ne_off, VD_NO_SEGMENT);
+
+    entry_rel   = vd_read_u16(ne + 0x04);
+    entry_len   = vd_read_u16(ne + 0x06);
+    seg_count   = vd_read_u16(ne + 0x1C);
+    mod_count   = vd_read_u16(ne + 0x1E);
+    nonres_size = vd_read_u16(ne + 0x20);
+    seg_rel     = vd_read_u16(ne + 0x22);
+    res_rel     = vd_read_u16(ne + 0x24);
+    resname_rel = vd_read_u16(ne + 0x26);
+    modref_rel  = vd_read_u16(ne + 0x28);
+    imp_rel     = vd_read_u16(ne + 0x2A);
+    nonres_abs  = vd_read_u32(ne + 0x2C);
+    shift       = vd_read_u16(ne + 0x32);
+
+    if (shift > VD_MAX_SHIFT)
+        return vd_fail(rep, NE_VALIDATE_ERR_HEADER, ne_off + 0x32u,
+                       VD_NO_SEGMENT);
+
+    /* ---- Header tables ---- */
+    if (seg_count > 0 &&
+        !vd_in_image(ne_off + seg_rel, (uint32_t)seg_count * VD_SEG_DESC, len))
+        return vd_fail(rep, NE_VALIDATE_ERR_TABLE, ne_off + seg_rel,
+                       VD_NO_SEGMENT);
+    /* the resource table runs up to the resident name table */
+    if (resname_rel > res_rel && !vd_in_image(ne_off + res_rel,
+                                    (uint32_t)(resname_rel - res_rel), len))
+        return vd_fail(rep, NE_VALIDATE_ERR_TABLE, ne_off + res_rel,
+                       VD_NO_SEGMENT);
+    if (resname_rel != 0 && !vd_in_image(ne_off + resname_rel, 1u, len))
+        return vd_fail(rep, NE_VALIDATE_ERR_TABLE, ne_off + resname_rel,
+                       VD_NO_SEGMENT);
+    if (entry_len > 0 && !vd_in_image(ne_off + entry_rel, entry_len, len))
+        return vd_fail(rep, NE_VALIDATE_ERR_TABLE, ne_off + entry_rel,
+                       VD_NO_SEGMENT);
+    if (mod_count > 0 &&
+        (!vd_in_image(ne_off + modref_rel, (uint32_t)mod_count * 2u, len) ||
+         !vd_in_image(ne_off + imp_rel, 1u, len)))
+        return vd_fail(rep, NE_VALIDATE_ERR_TABLE, ne_off + modref_rel,
+                       VD_NO_SEGMENT);
+    if (nonres_size > 0 && !vd_in_image(nonres_abs, nonres_size, len))
+        return vd_fail(rep, NE_VALIDATE_ERR_TABLE, nonres_abs,
+                       VD_NO_SEGMENT);
+
+    /* ---- Segments and their relocation blocks, in file order ---- */
+    for (i = 0; i < seg_count; i++) {
+        const uint8_t *sd = ne + seg_rel + (uint32_t)i * VD_SEG_DESC;
+        uint16_t sector    = vd_read_u16(sd);
+        uint16_t seg_len   = vd_read_u16(sd + 2);
+        uint16_t flags     = vd_read_u16(sd + 4);
+        uint16_t min_alloc = vd_read_u16(sd + 6);
+        uint32_t data_sz   = (seg_len == 0) ? 0x10000u : (uint32_t)seg_len;
+        uint32_t alloc_sz  = (min_alloc == 0) ? 0x10000u : (uint32_t)min_alloc;
+        uint32_t file_off;
+        uint32_t reloc_off;
+        uint16_t count;
+
+        if (alloc_sz < data_sz)
+            alloc_sz = data_sz;
+        rep->segments++;
+
+        if (sector == 0)
+            continue;   /* no file data, no relocations */
+
+        file_off = (uint32_t)sector << shift;
+        if ((file_off >> shift) != sector || !vd_in_image(file_off, data_sz, len))
+            return vd_fail(rep, NE_VALIDATE_ERR_SEGMENT, file_off, i);
+
+        if (!(flags & NE_SEG_RELOC))
+            continue;
+
+        reloc_off = file_off + data_sz;
+        if (!vd_in_image(reloc_off, 2u, len))
+            return vd_fail(rep, NE_VALIDATE_ERR_RELOC, reloc_off, i);
+        count = vd_read_u16(buf + reloc_off);
+        if (!vd_in_image(reloc_off + 2u, (uint32_t)count * VD_RELOC_REC, len))
+            return vd_fail(rep, NE_VALIDATE_ERR_RELOC, reloc_off, i);
+
+        for (k = 0; k < count; k++) {
+            uint32_t       rec_off = reloc_off + 2u + (uint32_t)k * VD_RELOC_REC;
+            const uint8_t *rec     = buf + rec_off;
+            uint8_t        rtype   = (uint8_t)(rec[1] & 0x03u);
+            int            additive = (rec[1] & NE_RELOC_FLAG_ADDITIVE) != 0;
+            uint16_t       target  = vd_read_u16(rec + 2);
+            uint16_t       ref1    = vd_read_u16(rec + 4);
+            uint32_t       width   = vd_addr_width(rec[0]);
+            int            ok;
+
+            if (rtype == NE_RELOC_TYPE_OS_FIXUP) {
+                rep->relocs++;   /* skipped by the relocator */
+                continue;
+            }
+            if (width == 0)
+                return vd_fail(rep, NE_VALIDATE_ERR_RELOC, rec_off, i);
+
+            if (rtype == NE_RELOC_TYPE_INTERNAL)
+                ok = ref1 != 0 && ref1 <= seg_count;
+            else if (rtype == NE_RELOC_TYPE_IMP_ORD)
+                ok = ref1 != 0 && ref1 <= mod_count;
+            else
+                ok = ref1 != 0 && ref1 <= mod_count &&
+                     vd_in_image(ne_off + imp_rel + vd_read_u16(rec + 6),
+                                 1u, len);
+
+            /* The first target must fit; a chain may also be empty */
+            if (ok) {
+                uint32_t end_mark = (rec[0] == NE_RELOC_ADDR_LOBYTE)
+                                    ? 0xFFu : 0xFFFFu;
+                if (additive || target != end_mark)
+                    ok = (uint32_t)target + width <= alloc_sz;
+            }
+            if (!ok)
+                return vd_fail(rep, NE_VALIDATE_ERR_RELOC, rec_off, i);
+            rep->relocs++;
+        }
+    }
+
+    rep->status = NE_VALIDATE_OK;
+    return NE_VALIDATE_OK;
+}
+
+/* -------------------------------------------------------------------------
+ * ne_validate_parsed / ne_validate_inherit
+ * ---------------------------------------------------------------------- */
+
+int ne_validate_parsed(NEParserContext *ctx, const uint8_t *buf, size_t len,
+                       NEValidateReport *rep)
+{
+    int rc;
+
+    if (!ctx)
+        return NE_VALIDATE_ERR_NULL;
+
+    ctx->validated_data = NULL;
+    ctx->validated_len  = 0;
+    rc = ne_validate_image(buf, len, rep);
+    if (rc == NE_VALIDATE_OK) {
+        ctx->validated_data = buf;
+        ctx->validated_len  = len;
+    }
+    return rc;
+}
+
+void ne_validate_inherit(NEParserContext *dst, const NEParserContext *src)
+{
+    if (!dst)
+        return;
+    dst->validated_data = src ? src->validated_data : NULL;
+    dst->validated_len  = src ? src->validated_len  : 0;
+}
+
+/* -------------------------------------------------------------------------
+ * ne_validate_strerror
+ * ---------------------------------------------------------------------- */
+
+const char *ne_validate_strerror(int err)
+{
+    switch (err) {
+    case NE_VALIDATE_OK:          return "success";
+    case NE_VALIDATE_ERR_NULL:    return "NULL argument";
+    case NE_VALIDATE_ERR_HEADER:  return "invalid MZ/NE header";
+    case NE_VALIDATE_ERR_TABLE:   return "header table outside the image";
+    case NE_VALIDATE_ERR_SEGMENT: return "segment data outside the image";
+    case NE_VALIDATE_ERR_RELOC:   return "invalid relocation block or record";
+    default:                      return "unknown error";
+    }
+}
@@ -0,0 +1,101 @@
+/*
+ * ne_validate.h - One-pass NE image integrity check
+ *
+ * ne_validate_image() checks the whole structure of an NE file image in a
+ * single linear sweep: the MZ and NE headers, the bounds of every header
+ * table, the file range of every segment (sector << align_shift plus its
+ * length) and every relocation block and record.  It allocates nothing.
+ *
+ * ne_validate_parsed() runs the sweep for a parsed context and, when the
+ * image passes, records the image's address and length in the context.
+ * ne_load_buffer() and ne_reloc_parse() then skip the per-segment and
+ * per-record bounds checks that the sweep has already done, but only when
+ * they are handed those same bytes (ne_parser_trusted()).  The image
+ * cache stores the verdict with each cached file, so a system DLL loaded
+ * many times is checked once per file identity.
+ *
+ * ne_reloc_apply() works on the loaded segment copies, not on the image,
+ * so it keeps its per-record target segment and range checks, and follows
+ * relocation chains checking every step: their links live in segment
+ * data that changes as fixups are applied.
+ *
+ * Reference: Microsoft "New Executable" format specification.
+ */
+
+#ifndef NE_VALIDATE_H
+#define NE_VALIDATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ne_parser.h"
+
+/* -------------------------------------------------------------------------
+ * Error codes
+ * ---------------------------------------------------------------------- */
+#define NE_VALIDATE_OK           0
+#define NE_VALIDATE_ERR_NULL    -1   /* NULL pointer argument               */
+#define NE_VALIDATE_ERR_HEADER  -2   /* bad MZ / NE header or align shift   */
+#define NE_VALIDATE_ERR_TABLE   -3   /* header table outside the image      */
+#define NE_VALIDATE_ERR_SEGMENT -4   /* segment data outside the image      */
+#define NE_VALIDATE_ERR_RELOC   -5   /* relocation block or record invalid  */
+
+/* -------------------------------------------------------------------------
+ * Validation report
+ * ---------------------------------------------------------------------- */
+
+/*
+ * NEValidateReport - outcome of one ne_validate_image() sweep.
+ *
+ * On failure 'fail_offset' is the file offset of the offending structure
+ * and 'fail_segment' the 0-based segment it belongs to (0xFFFF for header
+ * tables).  The counts cover what was checked before the sweep stopped.
+ */
+typedef struct {
+    int       status;        /* NE_VALIDATE_OK or the first failure       */
+    uint32_t  fail_offset;   /* file offset of the failing structure      */
+    uint16_t  fail_segment;  /* segment of a SEGMENT / RELOC failure      */
+    uint16_t  segments;      /* segments checked                          */
+    uint32_t  relocs;        /* relocation records checked                */
+} NEValidateReport;
+
+/* -------------------------------------------------------------------------
+ * Public API
+ * ---------------------------------------------------------------------- */
+
+/*
+ * ne_validate_image - check the NE image 'buf' of 'len' bytes.
+ *
+ * Relocation records must have a known address type, an INTERNAL target
+ * segment within the segment table, an imported module index within the
+ * module-reference table, and a first target that fits the segment's
+ * allocation.  'rep' may be NULL.
+ *
+ * Returns NE_VALIDATE_OK or the first negative NE_VALIDATE_ERR_* found.
+ */
+int ne_validate_image(const uint8_t *buf, size_t len, NEValidateReport *rep);
+
+/*
+ * ne_validate_parsed - check 'buf' / 'len', the image *ctx was parsed
+ * from, with ne_validate_image().  When it passes, *ctx records the image
+ * identity and trusts it from then on; on failure any earlier verdict
+ * is dropped.  'rep' may be NULL.
+ *
+ * Returns as ne_validate_image(), or NE_VALIDATE_ERR_NULL for a NULL ctx.
+ */
+int ne_validate_parsed(NEParserContext *ctx, const uint8_t *buf, size_t len,
+                       NEValidateReport *rep);
+
+/*
+ * ne_validate_inherit - give *dst the verdict of *src, a context parsed
+ * from the same image bytes, without sweeping them again.  *dst trusts
+ * exactly the image *src trusts, if any.
+ */
+void ne_validate_inherit(NEParserContext *dst, const NEParserContext *src);
+
+/*
+ * ne_validate_strerror - return a static string describing error code 'err'.
+ */
+const char *ne_validate_strerror(int err);
+
+#endif /* NE_VALIDATE_H */
@@ -0,0 +1,532 @@
+/*
+ * bench_ne_load.c - Parser / loader micro-benchmarks over a synthetic corpus
+ *
+ * Generates NE images for a fixed set of profiles (segment count,
+ * relocation density, export count, resource count) and times each load
+ * phase on them:
+ *
+ *   parse      ne_parse_buffer
+ *   load       ne_load_buffer
+ *   reloc      ne_reloc_parse
+ *   apply      ne_reloc_apply
+ *   plan       ne_reloc_plan_apply with a plan built once at setup
+ *   exports    ne_export_build
+ *   module     parse + load + reloc on the heap, then the three frees
+ *   arena      the same three steps in one ne_arena_size_for_image() arena
+ *
+ * One line is printed per (profile, phase):
+ *
+ *   <profile> <phase> <ns/op> <allocs/op> <bytes/op>
+ *
+ * Save the output of a known-good build and pass it back with -c to fail
+ * (exit status 1) when any phase got slower than -f times its baseline.
+ *
+ * Usage:
+ *   bench_ne_load [-t min_ms] [-c baseline.txt] [-f factor]
+ *
+ * Host-only: built by `make host-bench` with -O2 -DNE_ALLOC_STATS.
+ */
+
+#ifndef __WATCOMC__
+#define _POSIX_C_SOURCE 200809L   /* clock_gettime() */
+#endif
+
+#include "../src/ne_parser.h"
+#include "../src/ne_loader.h"
+#include "../src/ne_reloc.h"
+#include "../src/ne_impexp.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Allocation counters behind NE_MALLOC / NE_CALLOC (see ne_dosalloc.h) */
+unsigned long ne_alloc_calls;
+unsigned long ne_alloc_bytes;
+
+/* -------------------------------------------------------------------------
+ * Corpus profiles
+ * ---------------------------------------------------------------------- */
+
+typedef struct {
+    const char *name;
+    uint16_t    segments;    /* segment count                        */
+    uint16_t    relocs;      /* relocation records per segment       */
+    uint16_t    exports;     /* entry-table exports (half named)     */
+    uint16_t    resources;   /* RT_RCDATA resources                  */
+} BenchProfile;
+
+static const BenchProfile g_profiles[] = {
+    { "tiny",        2,   0,   4,   0 },
+    { "app",        12,  32,  16,   8 },
+    { "reloc-heavy", 24, 400,  32,   4 },
+    { "user-like",  40,  96, 900, 120 },
+    { "gdi-like",   60,  64, 400,  40 },
+    { "large",     200, 120, 600, 200 },
+};
+
+#define PROFILE_COUNT (sizeof(g_profiles) / sizeof(g_profiles[0]))
+
+#define SEG_LEN        2048u  /* bytes of file data per segment   */
+#define ALIGN_SHIFT       4u  /* 16-byte sectors                  */
+#define MZ_SIZE          64u
+#define NE_HDR_SIZE      64u
+
+/* -------------------------------------------------------------------------
+ * Image generator
+ * ---------------------------------------------------------------------- */
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)(v & 0xFFFF));
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+/* Append a length-prefixed name followed by its ordinal */
+static size_t put_name(uint8_t *p, const char *name, uint16_t ordinal)
+{
+    size_t n = strlen(name);
+    p[0] = (uint8_t)n;
+    memcpy(p + 1, name, n);
+    put_u16(p + 1 + n, ordinal);
+    return n + 3u;
+}
+
+/*
+ * gen_image - build a complete NE image for profile 'pf'.
+ *
+ * Layout: MZ stub, NE header, segment table, resource table, resident
+ * names, module-ref table (KERNEL), imported names, entry table,
+ * non-resident names, then each segment's data and relocation block.
+ * Relocations are ADDITIVE (no chains) so ne_reloc_apply() can be
+ * repeated on the same segment images.
+ */
+static uint8_t *gen_image(const BenchProfile *pf, size_t *out_len)
+{
+    size_t   cap;
+    size_t   pos;
+    uint8_t *buf;
+    uint8_t *ne;
+    uint16_t named_res = (uint16_t)((pf->exports + 1u) / 2u);
+    uint16_t i, k;
+    char     name[24];
+
+    cap = 64u * 1024u
+        + (size_t)pf->segments * (SEG_LEN + 16u + 2u + 8u * pf->relocs);
+    buf = (uint8_t *)calloc(1, cap);
+    if (!buf)
+        return NULL;
+
+    put_u16(buf, MZ_MAGIC);
+    put_u32(buf + 0x3C, MZ_SIZE);
+    ne = buf + MZ_SIZE;
+    put_u16(ne + 0x00, NE_MAGIC);
+    ne[0x02] = 5;
+    ne[0x0C] = NE_PFLAG_MULTIDATA;
+    ne[0x0D] = NE_AFLAG_WINAPI;
+    put_u16(ne + 0x0E, 2);                       /* auto data segment */
+    put_u16(ne + 0x16, 1);                       /* CS                */
+    put_u16(ne + 0x1A, 2);                       /* SS                */
+    put_u16(ne + 0x1C, pf->segments);
+    put_u16(ne + 0x1E, 1);                       /* module refs       */
+    put_u16(ne + 0x22, NE_HDR_SIZE);
+    put_u16(ne + 0x32, ALIGN_SHIFT);
+    ne[0x36] = NE_OS_WINDOWS;
+    ne[0x3F] = 3;
+
+    /* Segment table is filled in once the data offsets are known */
+    pos = NE_HDR_SIZE + (size_t)pf->segments * 8u;
+
+    /* Resource table: align shift, one RT_RCDATA type block, terminator */
+    put_u16(ne + 0x24, (uint16_t)pos);
+    put_u16(ne + pos, ALIGN_SHIFT);
+    pos += 2;
+    if (pf->resources > 0) {
+        put_u16(ne + pos, 0x800Au);
+        put_u16(ne + pos + 2, pf->resources);
+        pos += 8;
+        for (i = 0; i < pf->resources; i++) {
+            put_u16(ne + pos + 2, 1);            /* length (sectors)  */
+            put_u16(ne + pos + 4, 0x0030);       /* MOVEABLE|PURE     */
+            put_u16(ne + pos + 6, (uint16_t)(0x8000u | (i + 1u)));
+            pos += 12;
+        }
+    }
+    put_u16(ne + pos, 0);
+    pos += 2;
+
+    /* Resident names: module name, then the first half of the exports */
+    put_u16(ne + 0x26, (uint16_t)pos);
+    pos += put_name(ne + pos, "BENCHMOD", 0);
+    for (i = 0; i < named_res; i++) {
+        sprintf(name, "BenchExport%05u", (unsigned)(i + 1u));
+        pos += put_name(ne + pos, name, (uint16_t)(i + 1u));
+    }
+    ne[pos++] = 0;
+
+    /* Module-ref table and imported names */
+    put_u16(ne + 0x28, (uint16_t)pos);
+    put_u16(ne + pos, 1);
+    pos += 2;
+    put_u16(ne + 0x2A, (uint16_t)pos);
+    ne[pos++] = 0;
+    ne[pos++] = 6;
+    memcpy(ne + pos, "KERNEL", 6);
+    pos += 6;
+
+    /* Entry table: fixed bundles of up to 255 entries in segment 1 */
+    put_u16(ne + 0x04, (uint16_t)pos);
+    {
+        size_t   start = pos;
+        uint16_t left  = pf->exports;
+        uint16_t ord   = 0;
+        while (left > 0) {
+            uint8_t n = (uint8_t)(left > 255u ? 255u : left);
+            ne[pos++] = n;
+            ne[pos++] = 1;
+            for (k = 0; k < n; k++, ord++) {
+                ne[pos++] = 0x01;
+                put_u16(ne + pos, (uint16_t)((ord * 4u) % SEG_LEN));
+                pos += 2;
+            }
+            left = (uint16_t)(left - n);
+        }
+        ne[pos++] = 0;
+        put_u16(ne + 0x06, (uint16_t)(pos - start));
+    }
+
+    /* Non-resident names: description, then the remaining exports */
+    {
+        size_t start = pos;
+        put_u32(ne + 0x2C, (uint32_t)(MZ_SIZE + pos));
+        pos += put_name(ne + pos, "Synthetic benchmark module", 0);
+        for (i = named_res; i < pf->exports; i++) {
+            sprintf(name, "BenchExport%05u", (unsigned)(i + 1u));
+            pos += put_name(ne + pos, name, (uint16_t)(i + 1u));
+        }
+        ne[pos++] = 0;
+        put_u16(ne + 0x20, (uint16_t)(pos - start));
+    }
+
+    /* Segment data and relocation blocks, sector aligned */
+    pos += MZ_SIZE;
+    for (i = 0; i < pf->segments; i++) {
+        uint8_t *sd = ne + NE_HDR_SIZE + (size_t)i * 8u;
+        uint16_t flags = (i == 1) ? NE_SEG_DATA : 0;
+
+        pos = (pos + (1u << ALIGN_SHIFT) - 1u) & ~(size_t)((1u << ALIGN_SHIFT) - 1u);
+        if (pf->relocs > 0)
+            flags |= NE_SEG_RELOC;
+        put_u16(sd + 0, (uint16_t)(pos >> ALIGN_SHIFT));
+        put_u16(sd + 2, SEG_LEN);
+        put_u16(sd + 4, flags);
+        put_u16(sd + 6, SEG_LEN);
+
+        memset(buf + pos, (int)(i & 0xFF), SEG_LEN);
+        pos += SEG_LEN;
+
+        if (pf->relocs == 0)
+            continue;
+        put_u16(buf + pos, pf->relocs);
+        pos += 2;
+        for (k = 0; k < pf->relocs; k++) {
+            uint8_t *rec = buf + pos;
+            rec[0] = NE_RELOC_ADDR_OFF16;
+            put_u16(rec + 2, (uint16_t)((k * 4u) % (SEG_LEN - 4u)));
+            if (k % 3u == 2u) {
+                rec[1] = NE_RELOC_TYPE_IMP_ORD | NE_RELOC_FLAG_ADDITIVE;
+                put_u16(rec + 4, 1);
+                put_u16(rec + 6, (uint16_t)(k + 1u));
+            } else {
+                rec[1] = NE_RELOC_TYPE_INTERNAL | NE_RELOC_FLAG_ADDITIVE;
+                put_u16(rec + 4, (uint16_t)(1u + k % pf->segments));
+                put_u16(rec + 6, (uint16_t)(k * 2u));
+            }
+            pos += 8;
+        }
+    }
+
+    *out_len = pos;
+    return buf;
+}
+
+/* Resolver used for the imported (KERNEL) relocations */
+static int bench_resolver(uint16_t mod_idx, uint16_t ref2, int by_name,
+                          const uint8_t *imported_names,
+                          uint16_t imp_names_size,
+                          uint16_t *out_seg, uint16_t *out_offset,
+                          void *userdata)
+{
+    (void)mod_idx; (void)by_name; (void)imported_names;
+    (void)imp_names_size; (void)userdata;
+    *out_seg    = 0;
+    *out_offset = ref2;
+    return NE_RELOC_OK;
+}
+
+/* -------------------------------------------------------------------------
+ * Timing
+ * ---------------------------------------------------------------------- */
+
+static double now_ns(void)
+{
+#if defined(CLOCK_MONOTONIC) && !defined(__WATCOMC__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#else
+    return (double)clock() * (1e9 / (double)CLOCKS_PER_SEC);
+#endif
+}
+
+enum { PH_PARSE, PH_LOAD, PH_RELOC, PH_APPLY, PH_PLAN, PH_EXPORTS,
+       PH_MODULE, PH_ARENA, PH_COUNT };
+
+static const char *const g_phase_names[PH_COUNT] = {
+    "parse", "load", "reloc", "apply", "plan", "exports", "module", "arena"
+};
+
+typedef struct {
+    double ns_per_op;
+    double allocs_per_op;
+    double bytes_per_op;
+} BenchResult;
+
+/* State shared by the phase bodies of one profile */
+typedef struct {
+    const uint8_t  *img;
+    size_t          len;
+    NEParserContext parser;   /* pre-parsed, for the later phases  */
+    NELoaderContext loader;   /* pre-loaded, for the apply phase   */
+    NERelocContext  relocs;   /* pre-parsed, for the apply phase   */
+    NERelocPlan     plan;     /* pre-built, for the plan phase     */
+} BenchState;
+
+/* Run phase 'ph' once; returns 0 on success */
+static int run_phase(BenchState *st, int ph)
+{
+    NEParserContext p;
+    NELoaderContext l;
+    NERelocContext  r;
+    NEExportTable   e;
+    NEArena         a;
+    uint32_t        sz;
+    int             rc = -1;
+
+    switch (ph) {
+    case PH_PARSE:
+        rc = ne_parse_buffer(st->img, st->len, &p);
+        ne_free(&p);
+        break;
+    case PH_LOAD:
+        rc = ne_load_buffer(st->img, st->len, &st->parser, &l);
+        ne_loader_free(&l);
+        break;
+    case PH_RELOC:
+        rc = ne_reloc_parse(st->img, st->len, &st->parser, &r);
+        ne_reloc_free(&r);
+        break;
+    case PH_APPLY:
+        rc = ne_reloc_apply(&st->loader, &st->relocs, &st->parser,
+                            bench_resolver, NULL);
+        break;
+    case PH_PLAN:
+        rc = ne_reloc_plan_apply(&st->loader, &st->plan, &st->parser,
+                                 bench_resolver, NULL);
+        break;
+    case PH_EXPORTS:
+        rc = ne_export_build_parsed(&st->parser, NE_EXPORT_NAMES, &e);
+        ne_export_free(&e);
+        break;
+    case PH_MODULE:
+        rc = ne_parse_buffer(st->img, st->len, &p);
+        if (rc == 0)
+            rc = ne_load_buffer(st->img, st->len, &p, &l);
+        if (rc == 0) {
+            rc = ne_reloc_parse(st->img, st->len, &p, &r);
+            ne_reloc_free(&r);
+            ne_loader_free(&l);
+        }
+        ne_free(&p);
+        break;
+    case PH_ARENA:
+        rc = ne_arena_size_for_image(st->img, st->len, &sz);
+        if (rc == 0)
+            rc = ne_arena_init(&a, sz);
+        if (rc != 0)
+            break;
+        rc = ne_parse_buffer_arena(st->img, st->len, &p, &a);
+        if (rc == 0)
+            rc = ne_load_buffer_arena(st->img, st->len, &p, &l, &a);
+        if (rc == 0)
+            rc = ne_reloc_parse_arena(st->img, st->len, &p, &r, &a);
+        ne_arena_free(&a);
+        break;
+    }
+    return rc;
+}
+
+/*
+ * time_phase - run phase 'ph' in doubling batches until one batch takes
+ * at least 'min_ns', then report that batch.
+ */
+static int time_phase(BenchState *st, int ph, double min_ns, BenchResult *res)
+{
+    unsigned long iters = 1;
+    unsigned long i;
+    unsigned long calls0, bytes0;
+    double        t0, dt;
+
+    for (;;) {
+        calls0 = ne_alloc_calls;
+        bytes0 = ne_alloc_bytes;
+        t0 = now_ns();
+        for (i = 0; i < iters; i++) {
+            if (run_phase(st, ph) != 0)
+                return -1;
+        }
+        dt = now_ns() - t0;
+        if (dt >= min_ns || iters >= (1ul << 30))
+            break;
+        iters *= 2;
+    }
+
+    res->ns_per_op     = dt / (double)iters;
+    res->allocs_per_op = (double)(ne_alloc_calls - calls0) / (double)iters;
+    res->bytes_per_op  = (double)(ne_alloc_bytes - bytes0) / (double)iters;
+    return 0;
+}
+
+/* -------------------------------------------------------------------------
+ * Baseline comparison
+ * ---------------------------------------------------------------------- */
+
+/* Look up the baseline ns/op for (profile, phase); 0.0 when absent */
+static double baseline_ns(FILE *fp, const char *profile, const char *phase)
+{
+    char   line[256];
+    char   prof[64], ph[32];
+    double ns;
+
+    rewind(fp);
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#')
+            continue;
+        if (sscanf(line, "%63s %31s %lf", prof, ph, &ns) == 3 &&
+            strcmp(prof, profile) == 0 && strcmp(ph, phase) == 0)
+            return ns;
+    }
+    return 0.0;
+}
+
+/* -------------------------------------------------------------------------
+ * Main
+ * ---------------------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+    double      min_ms   = 50.0;
+    double      factor   = 2.0;
+    const char *base_path = NULL;
+    FILE       *base = NULL;
+    int         regressions = 0;
+    size_t      pi;
+    int         ph, a;
+
+    for (a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "-t") == 0 && a + 1 < argc) {
+            min_ms = atof(argv[++a]);
+        } else if (strcmp(argv[a], "-c") == 0 && a + 1 < argc) {
+            base_path = argv[++a];
+        } else if (strcmp(argv[a], "-f") == 0 && a + 1 < argc) {
+            factor = atof(argv[++a]);
+        } else {
+            fprintf(stderr,
+                    "usage: %s [-t min_ms] [-c baseline.txt] [-f factor]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    if (base_path) {
+        base = fopen(base_path, "r");
+        if (!base) {
+            fprintf(stderr, "bench: cannot open %s\n", base_path);
+            return 2;
+        }
+    }
+
+    printf("# profile phase ns/op allocs/op bytes/op\n");
+
+    for (pi = 0; pi < PROFILE_COUNT; pi++) {
+        const BenchProfile *pf = &g_profiles[pi];
+        BenchState st;
+        uint8_t   *img;
+        size_t     len;
+
+        img = gen_image(pf, &len);
+        if (!img) {
+            fprintf(stderr, "bench: out of memory\n");
+            return 2;
+        }
+
+        memset(&st, 0, sizeof(st));
+        st.img = img;
+        st.len = len;
+        if (ne_parse_buffer(img, len, &st.parser) != NE_OK ||
+            ne_load_buffer(img, len, &st.parser, &st.loader) != NE_LOAD_OK ||
+            ne_reloc_parse(img, len, &st.parser, &st.relocs) != NE_RELOC_OK ||
+            ne_reloc_plan_build(img, len, &st.parser, &st.relocs,
+                                &st.plan) != NE_RELOC_OK) {
+            fprintf(stderr, "bench: profile %s: setup failed\n", pf->name);
+            return 2;
+        }
+
+        for (ph = 0; ph < PH_COUNT; ph++) {
+            BenchResult res;
+            double      ref;
+
+            if (time_phase(&st, ph, min_ms * 1e6, &res) != 0) {
+                fprintf(stderr, "bench: profile %s phase %s failed\n",
+                        pf->name, g_phase_names[ph]);
+                return 2;
+            }
+            printf("%-12s %-8s %12.0f %8.1f %10.0f",
+                   pf->name, g_phase_names[ph],
+                   res.ns_per_op, res.allocs_per_op, res.bytes_per_op);
+
+            if (base) {
+                ref = baseline_ns(base, pf->name, g_phase_names[ph]);
+                if (ref > 0.0 && res.ns_per_op > ref * factor) {
+                    printf("   REGRESSION (%.2fx)", res.ns_per_op / ref);
+                    regressions++;
+                }
+            }
+            printf("\n");
+        }
+
+        ne_reloc_plan_free(&st.plan);
+        ne_reloc_free(&st.relocs);
+        ne_loader_free(&st.loader);
+        ne_free(&st.parser);
+        free(img);
+    }
+
+    if (base) {
+        fclose(base);
+        if (regressions) {
+            fprintf(stderr, "bench: %d phase(s) slower than %.1fx baseline\n",
+                    regressions, factor);
+            return 1;
+        }
+    }
+    return 0;
+}
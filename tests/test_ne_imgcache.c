@@ -0,0 +1,401 @@
+/*
+ * test_ne_imgcache.c - Tests for the parsed NE image cache
+ *
+ * Each test writes a small NE image to a temporary file in the current
+ * directory, acquires it through the cache and checks hit / miss / eviction
+ * behaviour and the handling of files that change on disk.
+ *
+ * Build with:
+ *   wcc -ml -za99 -wx -d2 -i=../src ../src/ne_imgcache.c ... test_ne_imgcache.c
+ *   wlink system dos name test_ne_imgcache.exe file test_ne_imgcache.obj,...
+ */
+
+#include "../src/ne_parser.h"
+#include "../src/ne_loader.h"
+#include "../src/ne_imgcache.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------
+ * Minimal test framework (mirrors test_ne_parser.c)
+ * ---------------------------------------------------------------------- */
+
+static int g_tests_run    = 0;
+static int g_tests_passed = 0;
+static int g_tests_failed = 0;
+
+#define TEST_BEGIN(name) \
+    do { \
+        g_tests_run++; \
+        printf("  %-60s ", (name)); \
+        fflush(stdout); \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        g_tests_passed++; \
+        printf("PASS\n"); \
+    } while (0)
+
+#define TEST_FAIL(msg) \
+    do { \
+        g_tests_failed++; \
+        printf("FAIL \xe2\x80\x93 %s (line %d)\n", (msg), __LINE__); \
+        return; \
+    } while (0)
+
+#define ASSERT_EQ(a, b) \
+    do { \
+        if ((a) != (b)) { \
+            g_tests_failed++; \
+            printf("FAIL \xe2\x80\x93 expected %ld got %ld (line %d)\n", \
+                   (long)(b), (long)(a), __LINE__); \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_NE(a, b) \
+    do { \
+        if ((a) == (b)) { \
+            g_tests_failed++; \
+            printf("FAIL \xe2\x80\x93 unexpected equal value %ld (line %d)\n", \
+                   (long)(a), __LINE__); \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_NOT_NULL(p) \
+    do { \
+        if ((p) == NULL) { \
+            g_tests_failed++; \
+            printf("FAIL \xe2\x80\x93 unexpected NULL pointer (line %d)\n", __LINE__); \
+            return; \
+        } \
+    } while (0)
+
+/* -------------------------------------------------------------------------
+ * Binary image builder helpers
+ * ---------------------------------------------------------------------- */
+
+#define MZ_SIZE       64u
+#define NE_HDR_SIZE   64u
+#define SEG_DESC_SIZE  8u
+#define SEG_SECTOR     9u   /* data at 9 << 4 = 0x90 */
+#define SEG_LEN       16u
+
+#define PATH_A  "NEICA.EXE"
+#define PATH_B  "NEICB.EXE"
+
+static void put_u16(uint8_t *buf, size_t off, uint16_t v)
+{
+    buf[off]     = (uint8_t)(v & 0xFF);
+    buf[off + 1] = (uint8_t)((v >> 8) & 0xFF);
+}
+
+static void put_u32(uint8_t *buf, size_t off, uint32_t v)
+{
+    buf[off]     = (uint8_t)(v & 0xFF);
+    buf[off + 1] = (uint8_t)((v >>  8) & 0xFF);
+    buf[off + 2] = (uint8_t)((v >> 16) & 0xFF);
+    buf[off + 3] = (uint8_t)((v >> 24) & 0xFF);
+}
+
+/*
+ * write_image - write a one-segment NE file to 'path'.
+ *
+ * 'fill' is the segment content byte, 'crc' goes into the NE header CRC
+ * field and 'pad' extra zero bytes are appended (to change the file size).
+ * Returns 0 on success.
+ */
+static int write_image(const char *path, uint8_t fill, uint32_t crc,
+                       size_t pad)
+{
+    const uint16_t seg_tbl_rel = (uint16_t)NE_HDR_SIZE;
+    const uint16_t other_rel   = (uint16_t)(NE_HDR_SIZE + SEG_DESC_SIZE);
+    const uint32_t seg_off     = (uint32_t)SEG_SECTOR << 4;
+    const size_t   total       = seg_off + SEG_LEN + pad;
+    uint8_t *buf;
+    uint8_t *ne;
+    FILE    *fp;
+    size_t   n;
+
+    buf = (uint8_t *)calloc(1, total);
+    if (!buf)
+        return -1;
+
+    put_u16(buf, 0x00, MZ_MAGIC);
+    put_u32(buf, 0x3C, MZ_SIZE);
+
+    ne = buf + MZ_SIZE;
+    put_u16(ne, 0x00, NE_MAGIC);
+    ne[0x02] = 5;
+    put_u16(ne, 0x04, other_rel);   /* entry_table_offset  */
+    put_u32(ne, 0x08, crc);         /* file CRC            */
+    put_u16(ne, 0x0E, 1);           /* auto_data_seg = 1   */
+    put_u16(ne, 0x1C, 1);           /* segment_count = 1   */
+    put_u16(ne, 0x22, seg_tbl_rel);
+    put_u16(ne, 0x24, other_rel);
+    put_u16(ne, 0x26, other_rel);
+    put_u16(ne, 0x28, other_rel);
+    put_u16(ne, 0x2A, other_rel);
+    put_u16(ne, 0x32, 4);           /* align_shift = 4     */
+    ne[0x36] = NE_OS_WINDOWS;
+
+    put_u16(ne, seg_tbl_rel + 0, (uint16_t)SEG_SECTOR);
+    put_u16(ne, seg_tbl_rel + 2, (uint16_t)SEG_LEN);
+    put_u16(ne, seg_tbl_rel + 4, NE_SEG_DATA);
+    put_u16(ne, seg_tbl_rel + 6, (uint16_t)SEG_LEN);
+    memset(buf + seg_off, fill, SEG_LEN);
+
+    fp = fopen(path, "wb");
+    if (!fp) {
+        free(buf);
+        return -1;
+    }
+    n = fwrite(buf, 1, total, fp);
+    fclose(fp);
+    free(buf);
+    return (n == total) ? 0 : -1;
+}
+
+/* -------------------------------------------------------------------------
+ * Tests
+ * ---------------------------------------------------------------------- */
+
+/* 1 – init / free and argument checks */
+static void test_init_free(void)
+{
+    NEImgCache cache;
+
+    TEST_BEGIN("init / free and NULL / zero-capacity checks");
+    ASSERT_EQ(ne_imgcache_init(&cache, 4, 0), NE_IMGCACHE_OK);
+    ASSERT_EQ(cache.capacity, 4);
+    ASSERT_EQ(cache.count, 0);
+    ne_imgcache_free(&cache);
+    ASSERT_EQ(cache.entries == NULL, 1);
+    ne_imgcache_free(NULL);
+    ASSERT_EQ(ne_imgcache_init(NULL, 4, 0), NE_IMGCACHE_ERR_NULL);
+    ASSERT_EQ(ne_imgcache_init(&cache, 0, 0), NE_IMGCACHE_ERR_NULL);
+    TEST_PASS();
+}
+
+/* 2 – second acquire of an unchanged file is a hit on the same entry */
+static void test_acquire_hit(void)
+{
+    NEImgCache cache;
+    const NEImgCacheEntry *e1;
+    const NEImgCacheEntry *e2;
+    NELoaderContext loader;
+
+    TEST_BEGIN("repeated acquire of unchanged file hits the cache");
+    ASSERT_EQ(write_image(PATH_A, 0x3C, 0, 0), 0);
+    ASSERT_EQ(ne_imgcache_init(&cache, 4, 0), NE_IMGCACHE_OK);
+
+    ASSERT_EQ(ne_imgcache_acquire(&cache, PATH_A, &e1), NE_IMGCACHE_OK);
+    ASSERT_NOT_NULL(e1);
+    ASSERT_EQ(cache.misses, 1);
+    ASSERT_EQ(e1->parser.header.segment_count, 1);
+    ASSERT_NE(e1->parser.borrowed, 0);
+    ASSERT_NE(e1->validated, 0);
+    ASSERT_NE(ne_parser_trusted(&e1->parser, e1->image.data, e1->image.len),
+              0);
+
+    ASSERT_EQ(ne_imgcache_acquire(&cache, PATH_A, &e2), NE_IMGCACHE_OK);
+    ASSERT_EQ(e1 == e2, 1);
+    ASSERT_EQ(cache.hits, 1);
+    ASSERT_EQ(e2->ref_count, 2);
+
+    /* Cached products are enough to load an instance */
+    ASSERT_EQ(ne_load_buffer(e1->image.data, e1->image.len, &e1->parser,
+                             &loader), NE_LOAD_OK);
+    ASSERT_EQ(loader.segments[0].data[0], 0x3C);
+    ne_loader_free(&loader);
+
+    ASSERT_EQ(ne_imgcache_release(&cache, e1), NE_IMGCACHE_OK);
+    ASSERT_EQ(ne_imgcache_release(&cache, e2), NE_IMGCACHE_OK);
+    ASSERT_EQ(ne_imgcache_release(&cache, e2), NE_IMGCACHE_ERR_NOT_FOUND);
+
+    /* Released entries stay cached until purged */
+    ASSERT_EQ(cache.count, 1);
+    ASSERT_EQ(ne_imgcache_purge(&cache), 1);
+    ASSERT_EQ(cache.count, 0);
+
+    ne_imgcache_free(&cache);
+    remove(PATH_A);
+    TEST_PASS();
+}
+
+/* 3 – a file that changed on disk is reloaded; held entry goes stale */
+static void test_changed_file(void)
+{
+    NEImgCache cache;
+    const NEImgCacheEntry *old_e;
+    const NEImgCacheEntry *new_e;
+
+    TEST_BEGIN("changed file is reloaded; old entry freed on release");
+    ASSERT_EQ(write_image(PATH_A, 0x11, 0, 0), 0);
+    ASSERT_EQ(ne_imgcache_init(&cache, 4, 0), NE_IMGCACHE_OK);
+    ASSERT_EQ(ne_imgcache_acquire(&cache, PATH_A, &old_e), NE_IMGCACHE_OK);
+
+    /* Replace (not rewrite) the file; different size => new identity */
+    remove(PATH_A);
+    ASSERT_EQ(write_image(PATH_A, 0x22, 0, 16), 0);
+    ASSERT_EQ(ne_imgcache_acquire(&cache, PATH_A, &new_e), NE_IMGCACHE_OK);
+    ASSERT_EQ(old_e != new_e, 1);
+    ASSERT_EQ(cache.misses, 2);
+    ASSERT_NE(old_e->stale, 0);
+    ASSERT_EQ(cache.count, 2);
+
+    /* The old holder still sees its own bytes */
+    ASSERT_EQ(old_e->image.data[SEG_SECTOR << 4], 0x11);
+    ASSERT_EQ(new_e->image.data[SEG_SECTOR << 4], 0x22);
+
+    ASSERT_EQ(ne_imgcache_release(&cache, old_e), NE_IMGCACHE_OK);
+    ASSERT_EQ(cache.count, 1);
+    ASSERT_EQ(ne_imgcache_release(&cache, new_e), NE_IMGCACHE_OK);
+
+    ne_imgcache_free(&cache);
+    remove(PATH_A);
+    TEST_PASS();
+}
+
+/* 4 – CRC check catches a same-size rewrite */
+static void test_crc_check(void)
+{
+    NEImgCache cache;
+    const NEImgCacheEntry *e;
+
+    TEST_BEGIN("NE_IMGCACHE_CHECK_CRC detects same-size rewrite");
+    ASSERT_EQ(write_image(PATH_A, 0x11, 0x1234u, 0), 0);
+    ASSERT_EQ(ne_imgcache_init(&cache, 4, NE_IMGCACHE_CHECK_CRC),
+              NE_IMGCACHE_OK);
+    ASSERT_EQ(ne_imgcache_acquire(&cache, PATH_A, &e), NE_IMGCACHE_OK);
+    ASSERT_EQ((long)e->crc32, 0x1234L);
+    ASSERT_EQ(ne_imgcache_release(&cache, e), NE_IMGCACHE_OK);
+
+    ASSERT_EQ(write_image(PATH_A, 0x11, 0x5678u, 0), 0);
+    ASSERT_EQ(ne_imgcache_acquire(&cache, PATH_A, &e), NE_IMGCACHE_OK);
+    ASSERT_EQ(cache.misses, 2);
+    ASSERT_EQ(cache.hits, 0);
+    ASSERT_EQ((long)e->crc32, 0x5678L);
+    ASSERT_EQ(cache.count, 1);
+    ASSERT_EQ(ne_imgcache_release(&cache, e), NE_IMGCACHE_OK);
+
+    ne_imgcache_free(&cache);
+    remove(PATH_A);
+    TEST_PASS();
+}
+
+/* 5 – LRU eviction of unreferenced entries; full when all referenced */
+static void test_eviction(void)
+{
+    NEImgCache cache;
+    const NEImgCacheEntry *a;
+    const NEImgCacheEntry *b;
+
+    TEST_BEGIN("least recently used unreferenced entry is evicted");
+    ASSERT_EQ(write_image(PATH_A, 0x11, 0, 0), 0);
+    ASSERT_EQ(write_image(PATH_B, 0x22, 0, 0), 0);
+    ASSERT_EQ(ne_imgcache_init(&cache, 1, 0), NE_IMGCACHE_OK);
+
+    ASSERT_EQ(ne_imgcache_acquire(&cache, PATH_A, &a), NE_IMGCACHE_OK);
+    ASSERT_EQ(ne_imgcache_acquire(&cache, PATH_B, &b), NE_IMGCACHE_ERR_FULL);
+    ASSERT_EQ(ne_imgcache_release(&cache, a), NE_IMGCACHE_OK);
+
+    ASSERT_EQ(ne_imgcache_acquire(&cache, PATH_B, &b), NE_IMGCACHE_OK);
+    ASSERT_EQ(cache.evictions, 1);
+    ASSERT_EQ(cache.count, 1);
+    ASSERT_EQ(b->image.data[SEG_SECTOR << 4], 0x22);
+    ASSERT_EQ(ne_imgcache_release(&cache, b), NE_IMGCACHE_OK);
+
+    ne_imgcache_free(&cache);
+    remove(PATH_A);
+    remove(PATH_B);
+    TEST_PASS();
+}
+
+/* 6 – error paths */
+static void test_errors(void)
+{
+    NEImgCache cache;
+    const NEImgCacheEntry *e;
+    FILE *fp;
+    char  long_path[NE_IMGCACHE_PATH_MAX + 8u];
+
+    TEST_BEGIN("missing / non-NE files and bad arguments are rejected");
+    ASSERT_EQ(ne_imgcache_init(&cache, 2, 0), NE_IMGCACHE_OK);
+    ASSERT_EQ(ne_imgcache_acquire(&cache, "NXICACHE.EXE", &e),
+              NE_IMGCACHE_ERR_IO);
+    ASSERT_EQ(e == NULL, 1);
+
+    /* A path that would not fit the key is refused, not truncated */
+    memset(long_path, 'A', NE_IMGCACHE_PATH_MAX);
+    long_path[NE_IMGCACHE_PATH_MAX] = '\0';
+    ASSERT_EQ(ne_imgcache_acquire(&cache, long_path, &e),
+              NE_IMGCACHE_ERR_PATH);
+    ASSERT_EQ(e == NULL, 1);
+    ASSERT_EQ(cache.count, 0);
+
+    fp = fopen(PATH_B, "wb");
+    ASSERT_NOT_NULL(fp);
+    fputs("this is not an executable", fp);
+    fclose(fp);
+    ASSERT_EQ(ne_imgcache_acquire(&cache, PATH_B, &e),
+              NE_IMGCACHE_ERR_FORMAT);
+    ASSERT_EQ(cache.count, 0);
+    remove(PATH_B);
+
+    ASSERT_EQ(ne_imgcache_acquire(NULL, PATH_A, &e), NE_IMGCACHE_ERR_NULL);
+    ASSERT_EQ(ne_imgcache_acquire(&cache, NULL, &e), NE_IMGCACHE_ERR_NULL);
+    ASSERT_EQ(ne_imgcache_acquire(&cache, PATH_A, NULL),
+              NE_IMGCACHE_ERR_NULL);
+    ASSERT_EQ(ne_imgcache_release(&cache, NULL), NE_IMGCACHE_ERR_NULL);
+    ASSERT_EQ(ne_imgcache_release(&cache, (const NEImgCacheEntry *)&cache),
+              NE_IMGCACHE_ERR_NOT_FOUND);
+    ASSERT_EQ(ne_imgcache_purge(NULL), NE_IMGCACHE_ERR_NULL);
+    ne_imgcache_free(&cache);
+    TEST_PASS();
+}
+
+/* 7 – strerror */
+static void test_strerror(void)
+{
+    TEST_BEGIN("ne_imgcache_strerror returns non-NULL for all codes");
+    ASSERT_NOT_NULL(ne_imgcache_strerror(NE_IMGCACHE_OK));
+    ASSERT_NOT_NULL(ne_imgcache_strerror(NE_IMGCACHE_ERR_NULL));
+    ASSERT_NOT_NULL(ne_imgcache_strerror(NE_IMGCACHE_ERR_ALLOC));
+    ASSERT_NOT_NULL(ne_imgcache_strerror(NE_IMGCACHE_ERR_IO));
+    ASSERT_NOT_NULL(ne_imgcache_strerror(NE_IMGCACHE_ERR_FORMAT));
+    ASSERT_NOT_NULL(ne_imgcache_strerror(NE_IMGCACHE_ERR_FULL));
+    ASSERT_NOT_NULL(ne_imgcache_strerror(NE_IMGCACHE_ERR_NOT_FOUND));
+    ASSERT_NOT_NULL(ne_imgcache_strerror(NE_IMGCACHE_ERR_PATH));
+    ASSERT_NOT_NULL(ne_imgcache_strerror(-999));
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------
+ * Main
+ * ---------------------------------------------------------------------- */
+
+int main(void)
+{
+    printf("=== NE Image Cache Tests ===\n\n");
+
+    test_init_free();
+    test_acquire_hit();
+    test_changed_file();
+    test_crc_check();
+    test_eviction();
+    test_errors();
+    test_strerror();
+
+    printf("\n=== Results: %d/%d passed", g_tests_passed, g_tests_run);
+    if (g_tests_failed)
+        printf(", %d FAILED", g_tests_failed);
+    printf(" ===\n");
+
+    return (g_tests_failed == 0) ? 0 : 1;
+}
@@ -472,12 +472,91 @@ static void test_export_build_names(void)
     ASSERT_NOT_NULL(e);
     ASSERT_STR_EQ(e->name, "FuncB");
     ASSERT_EQ(e->offset, (uint16_t)0x0200u);
+    ne_export_free(&tbl);
+
+    /* From the parser alone: names only when asked for */
+    rc = ne_export_build_parsed(&parser, NE_EXPORT_NAMES, &tbl);
+    ASSERT_EQ(rc, NE_IMPEXP_OK);
+    ASSERT_STR_EQ(ne_export_find_by_ordinal(&tbl, 2u)->name, "FuncB");
+    ne_export_free(&tbl);
 
+    rc = ne_export_build_parsed(&parser, 0u, &tbl);
+    ASSERT_EQ(rc, NE_IMPEXP_OK);
+    ASSERT_EQ(tbl.count, (uint16_t)2);
+    ASSERT_STR_EQ(ne_export_find_by_ordinal(&tbl, 1u)->name, "");
+    ASSERT_NULL(ne_export_find_by_name(&tbl, "FuncA"));
     ne_export_free(&tbl);
+
     ne_free(&parser);
     TEST_PASS();
 }
 
+/* -------------------------------------------------------------------------
+ * Names from the non-resident table; names share one compact pool
+ * ---------------------------------------------------------------------- */
+static void test_export_build_nonresident_names(void)
+{
+    uint8_t          imgbuf[512];
+    NEParserContext  parser;
+    NEExportTable    tbl;
+    size_t           sz;
+    int              rc;
+    const NEExportEntry *e;
+
+    static const uint8_t rnt[] = {
+        0x07u, 'T','E','S','T','M','O','D', 0x00u, 0x00u,
+        0x05u, 'F','u','n','c','A',         0x01u, 0x00u,
+        0x00u
+    };
+    static const uint8_t etbl[] = {
+        0x03u, 0x01u,
+        0x00u, 0x00u, 0x01u,   /* ordinal 1: resident name     */
+        0x00u, 0x00u, 0x02u,   /* ordinal 2: non-resident name */
+        0x00u, 0x00u, 0x03u,   /* ordinal 3: no name           */
+        0x00u
+    };
+    static const uint8_t nrt[] = {
+        0x04u, 'D','E','S','C',             0x00u, 0x00u,
+        0x05u, 'F','u','n','c','B',         0x02u, 0x00u,
+        0x00u
+    };
+
+    TEST_BEGIN("export build: non-resident names, one shared name pool");
+
+    sz = build_image(imgbuf,
+                     rnt,  (uint16_t)sizeof(rnt),
+                     etbl, (uint16_t)sizeof(etbl));
+    memcpy(imgbuf + sz, nrt, sizeof(nrt));
+    write_u32le(imgbuf + MZ_SIZE + 0x2Cu, (uint32_t)sz);
+    write_u16le(imgbuf + MZ_SIZE + 0x20u, (uint16_t)sizeof(nrt));
+    sz += sizeof(nrt);
+
+    rc = ne_parse_buffer(imgbuf, sz, &parser);
+    ASSERT_EQ(rc, NE_OK);
+    rc = ne_export_build(imgbuf, sz, &parser, &tbl);
+    ASSERT_EQ(rc, NE_IMPEXP_OK);
+    ASSERT_EQ(tbl.count, (uint16_t)3);
+    ASSERT_NOT_NULL(tbl.names);
+
+    e = ne_export_find_by_ordinal(&tbl, 2u);
+    ASSERT_NOT_NULL(e);
+    ASSERT_STR_EQ(e->name, "FuncB");
+    e = ne_export_find_by_ordinal(&tbl, 3u);
+    ASSERT_NOT_NULL(e);
+    ASSERT_STR_EQ(e->name, "");
+
+    /* Names are packed back to back in the table's own pool */
+    ASSERT_EQ(tbl.entries[0].name, tbl.names);
+    ASSERT_EQ(tbl.entries[1].name, tbl.names + 6);
+
+    /* The table outlives the parser */
+    ne_free(&parser);
+    ASSERT_STR_EQ(ne_export_find_by_ordinal(&tbl, 1u)->name, "FuncA");
+
+    ne_export_free(&tbl);
+    TEST_PASS();
+}
+
 /* =========================================================================
  * Test cases – ne_export_find_by_ordinal / ne_export_find_by_name
  * ===================================================================== */
@@ -1021,6 +1100,161 @@ static void test_stub_fallback_and_replace(void)
     TEST_PASS();
 }
 
+/* -------------------------------------------------------------------------
+ * Ordinal index
+ * ---------------------------------------------------------------------- */
+static void test_export_ordinal_index(void)
+{
+    uint8_t          imgbuf[512];
+    NEParserContext  parser;
+    NEExportTable    tbl;
+    NEExportEntry    hand[4];
+    const NEExportEntry *e;
+
+    TEST_BEGIN("ordinal index: built by export_build and export_index");
+
+    ASSERT_EQ(make_two_export_table(imgbuf, sizeof(imgbuf), &parser, &tbl),
+              NE_IMPEXP_OK);
+    ASSERT_NOT_NULL(tbl.ord_index);
+    ASSERT_EQ(tbl.ord_limit, 3u);
+    e = ne_export_find_by_ordinal(&tbl, 2u);
+    ASSERT_NOT_NULL(e);
+    ASSERT_EQ(e->offset, (uint16_t)0x0200u);
+    ASSERT_NULL(ne_export_find_by_ordinal(&tbl, 0u));
+    ASSERT_NULL(ne_export_find_by_ordinal(&tbl, 3u));
+    ne_export_free(&tbl);
+    ASSERT_NULL(tbl.ord_index);
+    ne_free(&parser);
+
+    /* Unsorted hand-built table with a duplicate: first entry wins */
+    memset(hand, 0, sizeof(hand));
+    hand[0].ordinal = 9u;  hand[0].offset = 0x90u; hand[0].name = "";
+    hand[1].ordinal = 3u;  hand[1].offset = 0x30u; hand[1].name = "";
+    hand[2].ordinal = 5u;  hand[2].offset = 0x50u; hand[2].name = "";
+    hand[3].ordinal = 3u;  hand[3].offset = 0x31u; hand[3].name = "";
+    memset(&tbl, 0, sizeof(tbl));
+    tbl.entries = hand;
+    tbl.count   = 4u;
+    ASSERT_EQ(ne_export_index(&tbl), NE_IMPEXP_OK);
+    ASSERT_NOT_NULL(tbl.ord_index);
+    ASSERT_EQ(ne_export_find_by_ordinal(&tbl, 9u)->offset, (uint16_t)0x90u);
+    ASSERT_EQ(ne_export_find_by_ordinal(&tbl, 3u)->offset, (uint16_t)0x30u);
+    ASSERT_NULL(ne_export_find_by_ordinal(&tbl, 4u));
+
+    /* Up to count * NE_EXPORT_ORD_SPARSE + NE_EXPORT_ORD_SLACK slots */
+    hand[0].ordinal = (uint16_t)(4u * NE_EXPORT_ORD_SPARSE
+                                 + NE_EXPORT_ORD_SLACK - 1u);
+    ASSERT_EQ(ne_export_index(&tbl), NE_IMPEXP_OK);
+    ASSERT_NOT_NULL(tbl.ord_index);
+    hand[0].ordinal++;
+    ASSERT_EQ(ne_export_index(&tbl), NE_IMPEXP_OK);
+    ASSERT_NULL(tbl.ord_index);
+
+    /* Far too sparse for an index: lookups still work by scanning */
+    hand[0].ordinal = 60000u;
+    ASSERT_EQ(ne_export_index(&tbl), NE_IMPEXP_OK);
+    ASSERT_NULL(tbl.ord_index);
+    ASSERT_EQ(ne_export_find_by_ordinal(&tbl, 60000u)->offset,
+              (uint16_t)0x90u);
+    ASSERT_EQ(ne_export_index(NULL), NE_IMPEXP_ERR_NULL);
+    TEST_PASS();
+}
+
+static void test_export_name_index(void)
+{
+    uint8_t          imgbuf[512];
+    NEParserContext  parser;
+    NEExportTable    tbl;
+    NEExportEntry    hand[3];
+    uint16_t         seg = 0xFFFFu, off = 0xFFFFu;
+    const NEExportEntry *e;
+
+    TEST_BEGIN("name index: exact and case-insensitive lookups");
+
+    ASSERT_EQ(make_two_export_table(imgbuf, sizeof(imgbuf), &parser, &tbl),
+              NE_IMPEXP_OK);
+    ASSERT_NOT_NULL(tbl.name_index);
+    ASSERT_EQ(tbl.name_cap, 8u);
+
+    e = ne_export_find_by_name(&tbl, "FuncB");
+    ASSERT_NOT_NULL(e);
+    ASSERT_EQ(e->ordinal, (uint16_t)2u);
+    ASSERT_NULL(ne_export_find_by_name(&tbl, "FUNCB"));
+    e = ne_export_find_by_name_nocase(&tbl, "FUNCB");
+    ASSERT_NOT_NULL(e);
+    ASSERT_EQ(e->ordinal, (uint16_t)2u);
+    ASSERT_NULL(ne_export_find_by_name_nocase(&tbl, "FuncC"));
+    ASSERT_NULL(ne_export_find_by_name_nocase(&tbl, ""));
+
+    ASSERT_EQ(ne_import_resolve_name(&tbl, "funca", &seg, &off),
+              NE_IMPEXP_OK);
+    ASSERT_EQ(off, (uint16_t)0x0100u);
+    ne_export_free(&tbl);
+    ASSERT_NULL(tbl.name_index);
+    ne_free(&parser);
+
+    /* Names differing only in case: exact lookup tells them apart */
+    memset(hand, 0, sizeof(hand));
+    hand[0].ordinal = 1u; hand[0].offset = 0x10u; hand[0].name = "Open";
+    hand[1].ordinal = 2u; hand[1].offset = 0x20u; hand[1].name = "";
+    hand[2].ordinal = 3u; hand[2].offset = 0x30u; hand[2].name = "OPEN";
+    memset(&tbl, 0, sizeof(tbl));
+    tbl.entries = hand;
+    tbl.count   = 3u;
+
+    /* Before indexing: linear scan */
+    ASSERT_EQ(ne_export_find_by_name_nocase(&tbl, "open")->offset,
+              (uint16_t)0x10u);
+    ASSERT_EQ(ne_export_index(&tbl), NE_IMPEXP_OK);
+    ASSERT_NOT_NULL(tbl.name_index);
+    ASSERT_EQ(ne_export_find_by_name_nocase(&tbl, "open")->offset,
+              (uint16_t)0x10u);
+    ASSERT_EQ(ne_export_find_by_name(&tbl, "OPEN")->offset, (uint16_t)0x30u);
+    ASSERT_EQ(ne_export_find_by_name(&tbl, "Open")->offset, (uint16_t)0x10u);
+    ASSERT_NULL(ne_export_find_by_name(&tbl, "open"));
+
+    free(tbl.ord_index);
+    free(tbl.name_index);
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------
+ * ne_export_fingerprint
+ * ---------------------------------------------------------------------- */
+static void test_export_fingerprint(void)
+{
+    uint8_t          imgbuf[512];
+    NEParserContext  parser;
+    NEExportTable    tbl;
+    NEExportTable    empty;
+    uint32_t         fp;
+
+    TEST_BEGIN("fingerprint: stable, changes with address or name");
+
+    ASSERT_EQ(make_two_export_table(imgbuf, sizeof(imgbuf), &parser, &tbl),
+              NE_IMPEXP_OK);
+
+    fp = ne_export_fingerprint(&tbl);
+    ASSERT_NE(fp, 0u);
+    ASSERT_EQ(ne_export_fingerprint(&tbl), fp);
+
+    tbl.entries[1].offset++;
+    ASSERT_NE(ne_export_fingerprint(&tbl), fp);
+    tbl.entries[1].offset--;
+    ASSERT_EQ(ne_export_fingerprint(&tbl), fp);
+
+    tbl.entries[0].name = "FuncX";
+    ASSERT_NE(ne_export_fingerprint(&tbl), fp);
+
+    memset(&empty, 0, sizeof(empty));
+    ASSERT_NE(ne_export_fingerprint(&empty), 0u);
+    ASSERT_EQ(ne_export_fingerprint(NULL), 0u);
+
+    ne_export_free(&tbl);
+    ne_free(&parser);
+    TEST_PASS();
+}
+
 /* -------------------------------------------------------------------------
  * ne_impexp_strerror
  * ---------------------------------------------------------------------- */
@@ -1051,6 +1285,7 @@ int main(void)
     test_export_build_null_bundle();
     test_export_build_movable_entry();
     test_export_build_names();
+    test_export_build_nonresident_names();
 
     /* Find by ordinal */
     test_find_by_ordinal_hit();
@@ -1090,6 +1325,11 @@ int main(void)
     /* Stub fallback integration */
     test_stub_fallback_and_replace();
 
+    /* Ordinal index and fingerprint */
+    test_export_ordinal_index();
+    test_export_name_index();
+    test_export_fingerprint();
+
     /* Error strings */
     test_strerror();
 
@@ -507,6 +507,66 @@ static void test_get_proc_address(void)
     addr = ne_kernel_get_proc_address(&ctx, 0, "NoSuchFunc");
     ASSERT_EQ(addr, (uint32_t)0u);
 
+    /* Names match regardless of case, as in Windows */
+    ASSERT_EQ(ne_kernel_get_proc_address(&ctx, 0, "GLOBALALLOC"),
+              ne_kernel_get_proc_address(&ctx, 0, "GlobalAlloc"));
+    ASSERT_NOT_NULL(ctx.exports.name_index);
+
+    teardown_kernel(&gmem, &lmem, &tasks, &modules, &ctx);
+    TEST_PASS();
+}
+
+static void test_get_proc_address_module(void)
+{
+    NEGMemTable          gmem;
+    NELMemHeap           lmem;
+    NETaskTable          tasks;
+    NEModuleTable        modules;
+    NEKernelContext      ctx;
+    NEParserContext      parser;
+    NELoaderContext      loader;
+    NEExportTable        exports;
+    const NEExportEntry *ga;
+    uint16_t             h;
+
+    TEST_BEGIN("GetProcAddress: module handle and ordinal forms");
+
+    setup_kernel(&gmem, &lmem, &tasks, &modules, &ctx);
+    ne_kernel_register_exports(&ctx);
+
+    memset(&parser, 0, sizeof(parser));
+    memset(&loader, 0, sizeof(loader));
+    ASSERT_EQ(ne_mod_load(&modules, "USER", &parser, &loader, &h),
+              NE_MOD_OK);
+
+    memset(&exports, 0, sizeof(exports));
+    exports.entries = (NEExportEntry *)calloc(1, sizeof(NEExportEntry));
+    ASSERT_NOT_NULL(exports.entries);
+    exports.entries[0].ordinal = 1;
+    exports.entries[0].segment = 2;
+    exports.entries[0].offset  = 0x40;
+    exports.entries[0].name    = "MessageBox";
+    exports.count = 1;
+    ASSERT_EQ(ne_mod_set_exports(&modules, h, &exports), NE_MOD_OK);
+
+    /* Name and MAKEINTRESOURCE ordinal both reach USER's table */
+    ASSERT_EQ(ne_kernel_get_proc_address(&ctx, h, "messagebox"),
+              ((uint32_t)2u << 16) | 0x40u);
+    ASSERT_EQ(ne_kernel_get_proc_address(&ctx, h,
+                                         (const char *)(uintptr_t)1u),
+              ((uint32_t)2u << 16) | 0x40u);
+    ASSERT_EQ(ne_kernel_get_proc_address(&ctx, h, "GlobalAlloc"),
+              (uint32_t)0u);
+    ASSERT_EQ(ne_kernel_get_proc_address(&ctx, 999, "MessageBox"),
+              (uint32_t)0u);
+
+    /* KERNEL exports by ordinal */
+    ga = ne_export_find_by_name(&ctx.exports, "GlobalAlloc");
+    ASSERT_NOT_NULL(ga);
+    ASSERT_EQ(ne_kernel_get_proc_address(&ctx, 0,
+                                         (const char *)(uintptr_t)ga->ordinal),
+              ne_kernel_get_proc_address(&ctx, 0, "GlobalAlloc"));
+
     teardown_kernel(&gmem, &lmem, &tasks, &modules, &ctx);
     TEST_PASS();
 }
@@ -640,6 +700,61 @@ static void test_global_realloc(void)
     TEST_PASS();
 }
 
+static void test_global_realloc_budget(void)
+{
+    NEGMemTable     gmem;
+    NELMemHeap      lmem;
+    NETaskTable     tasks;
+    NEModuleTable   modules;
+    NEKernelContext ctx;
+    NEGMemHandle    h1, h2, other;
+    uint8_t        *ptr;
+
+    TEST_BEGIN("GlobalReAlloc under a heap limit never discards its source");
+
+    setup_kernel(&gmem, &lmem, &tasks, &modules, &ctx);
+    ASSERT_EQ(ne_gmem_set_limit(&gmem, 2000u), NE_MEM_OK);
+
+    h1 = ne_kernel_global_alloc(&ctx, NE_GMEM_MOVEABLE | NE_GMEM_DISCARDABLE,
+                                1000u);
+    ASSERT_NE(h1, NE_GMEM_HANDLE_INVALID);
+    ptr = (uint8_t *)ne_kernel_global_lock(&ctx, h1);
+    ASSERT_NOT_NULL(ptr);
+    memset(ptr, 0xAB, 1000u);
+    ne_kernel_global_unlock(&ctx, h1);
+
+    /* Old and new block cannot both fit: fail and keep the source */
+    h2 = ne_kernel_global_realloc(&ctx, h1, 1500u,
+                                  NE_GMEM_MOVEABLE | NE_GMEM_DISCARDABLE);
+    ASSERT_EQ(h2, NE_GMEM_HANDLE_INVALID);
+    ASSERT_EQ(ne_kernel_global_size(&ctx, h1), (uint32_t)1000u);
+    ptr = (uint8_t *)ne_kernel_global_lock(&ctx, h1);
+    ASSERT_NOT_NULL(ptr);
+    ASSERT_EQ(ptr[0], (uint8_t)0xAB);
+    ne_kernel_global_unlock(&ctx, h1);
+
+    /* With room after discarding another block the data is copied */
+    ASSERT_EQ(ne_gmem_set_limit(&gmem, 3000u), NE_MEM_OK);
+    other = ne_kernel_global_alloc(&ctx,
+                                   NE_GMEM_MOVEABLE | NE_GMEM_DISCARDABLE,
+                                   1500u);
+    ASSERT_NE(other, NE_GMEM_HANDLE_INVALID);
+    h2 = ne_kernel_global_realloc(&ctx, h1, 1500u,
+                                  NE_GMEM_MOVEABLE | NE_GMEM_DISCARDABLE);
+    ASSERT_NE(h2, NE_GMEM_HANDLE_INVALID);
+    ASSERT_EQ(ne_kernel_global_size(&ctx, other), (uint32_t)0u);
+    ptr = (uint8_t *)ne_kernel_global_lock(&ctx, h2);
+    ASSERT_NOT_NULL(ptr);
+    ASSERT_EQ(ptr[0], (uint8_t)0xAB);
+    ASSERT_EQ(ptr[999], (uint8_t)0xAB);
+    ne_kernel_global_unlock(&ctx, h2);
+
+    ne_kernel_global_free(&ctx, h2);
+    ne_kernel_global_free(&ctx, other);
+    teardown_kernel(&gmem, &lmem, &tasks, &modules, &ctx);
+    TEST_PASS();
+}
+
 static void test_global_null_ctx(void)
 {
     TEST_BEGIN("global memory APIs: NULL ctx return errors");
@@ -2309,13 +2424,33 @@ static void test_global_compact(void)
     NETaskTable     tasks;
     NEModuleTable   modules;
     NEKernelContext ctx;
+    NEGMemHandle    h;
+    NEGMemHandle    h2;
 
-    TEST_BEGIN("GlobalCompact: returns >= 0");
+    TEST_BEGIN("GlobalCompact: reports free space, discards to reach min");
 
     setup_kernel(&gmem, &lmem, &tasks, &modules, &ctx);
 
-    /* Stub returns 0, which is >= 0 */
+    /* Without a heap limit the host reports the simulated 1 MB */
+    ASSERT_EQ(ne_kernel_global_compact(&ctx, 0), 0x100000uL);
+
+    ASSERT_EQ(ne_gmem_set_limit(&gmem, 8192u), NE_MEM_OK);
+    h = ne_kernel_global_alloc(&ctx, NE_GMEM_MOVEABLE | NE_GMEM_DISCARDABLE,
+                               4096u);
+    ASSERT_NE(h, NE_GMEM_HANDLE_INVALID);
+    ASSERT_EQ(ne_kernel_global_compact(&ctx, 0), (uint32_t)4096u);
+    ASSERT_EQ(ne_kernel_get_free_space(&ctx, 0), (uint32_t)4096u);
+
+    /* Under a limit the free total is one block: it fits without a discard */
+    h2 = ne_kernel_global_alloc(&ctx, NE_GMEM_FIXED, 4096u);
+    ASSERT_NE(h2, NE_GMEM_HANDLE_INVALID);
+    ASSERT_EQ(ne_kernel_global_size(&ctx, h), (uint32_t)4096u);
     ASSERT_EQ(ne_kernel_global_compact(&ctx, 0), (uint32_t)0u);
+    ASSERT_EQ(ne_kernel_global_free(&ctx, h2), NE_MEM_OK);
+
+    ASSERT_EQ(ne_kernel_global_compact(&ctx, 8192u), (uint32_t)8192u);
+    ASSERT_EQ(ne_kernel_global_size(&ctx, h), (uint32_t)0u);
+    ASSERT_EQ(ne_kernel_global_free(&ctx, h), NE_MEM_OK);
 
     teardown_kernel(&gmem, &lmem, &tasks, &modules, &ctx);
     TEST_PASS();
@@ -2468,6 +2603,7 @@ int main(void)
     test_module_handle_not_found();
     test_module_filename_not_found();
     test_get_proc_address();
+    test_get_proc_address_module();
     test_load_library_unknown();
     test_free_library_invalid();
 
@@ -2476,6 +2612,7 @@ int main(void)
     test_global_alloc_free();
     test_global_lock_unlock();
     test_global_realloc();
+    test_global_realloc_budget();
     test_global_null_ctx();
 
     /* --- Local memory --- */
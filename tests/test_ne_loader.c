@@ -755,6 +755,257 @@ static void test_print_info(void)
     TEST_PASS();
 }
 
+/* 18 – lazy load defers segments not needed at start-up */
+static void test_lazy_defers_segments(void)
+{
+    NEParserContext  parser;
+    NELoaderContext  loader;
+    size_t   len;
+    uint8_t *buf = build_ne_image_with_data(0xAA, 0xBB, &len);
+    ASSERT_NOT_NULL(buf);
+
+    /* No entry point: only the auto-data/SS segment (2) is required */
+    put_u16(buf + MZ_SIZE, 0x16, 0);    /* initial_cs */
+
+    TEST_BEGIN("lazy load defers non-preload segment until materialised");
+    int ret = ne_parse_buffer(buf, len, &parser);
+    ASSERT_EQ(ret, NE_OK);
+
+    ret = ne_load_buffer_lazy(buf, len, &parser, &loader);
+    ASSERT_EQ(ret, NE_LOAD_OK);
+    ASSERT_EQ(loader.count, 2);
+    ASSERT_EQ(loader.deferred_count, 1);
+    ASSERT_EQ(loader.image == buf, 1);
+
+    /* Segment 1 (CODE) is deferred; extent recorded, nothing allocated */
+    ASSERT_NE(loader.segments[0].deferred, 0);
+    ASSERT_EQ(loader.segments[0].data == NULL, 1);
+    ASSERT_EQ((int)loader.segments[0].data_size, (int)SEG_CONTENT_LEN);
+    ASSERT_EQ((int)loader.segments[0].file_off,
+              (int)((uint32_t)SEG1_SECTOR << 4));
+
+    /* Segment 2 (auto data) is resident */
+    ASSERT_EQ(loader.segments[1].deferred, 0);
+    ASSERT_NOT_NULL(loader.segments[1].data);
+    ASSERT_EQ(loader.segments[1].data[0], 0xBB);
+
+    /* First use brings it in and releases the borrowed image */
+    ASSERT_EQ(ne_loader_materialize(&loader, 0), NE_LOAD_OK);
+    ASSERT_EQ(loader.segments[0].deferred, 0);
+    ASSERT_NOT_NULL(loader.segments[0].data);
+    ASSERT_EQ(loader.segments[0].data[0], 0xAA);
+    ASSERT_EQ(loader.segments[0].data[SEG_CONTENT_LEN - 1], 0xAA);
+    ASSERT_EQ(loader.deferred_count, 0);
+    ASSERT_EQ(loader.image == NULL, 1);
+
+    /* Resident segments are a no-op; bad indices are rejected */
+    ASSERT_EQ(ne_loader_materialize(&loader, 0), NE_LOAD_OK);
+    ASSERT_EQ(ne_loader_materialize(&loader, 2), NE_LOAD_ERR_BOUNDS);
+    ASSERT_EQ(ne_loader_materialize(NULL, 0), NE_LOAD_ERR_NULL);
+
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 19 – lazy load keeps preload and entry-point segments resident */
+static void test_lazy_preload_resident(void)
+{
+    NEParserContext  parser;
+    NELoaderContext  loader;
+    size_t   len;
+    uint8_t *buf = build_ne_image_with_data(0x11, 0x22, &len);
+    ASSERT_NOT_NULL(buf);
+
+    TEST_BEGIN("lazy load keeps PRELOAD and entry CS segments resident");
+    int ret = ne_parse_buffer(buf, len, &parser);
+    ASSERT_EQ(ret, NE_OK);
+
+    /* initial_cs = 1, auto_data = initial_ss = 2: nothing deferred */
+    ret = ne_load_buffer_lazy(buf, len, &parser, &loader);
+    ASSERT_EQ(ret, NE_LOAD_OK);
+    ASSERT_EQ(loader.deferred_count, 0);
+    ASSERT_EQ(loader.image == NULL, 1);
+    ASSERT_EQ(loader.segments[0].data[0], 0x11);
+    ne_loader_free(&loader);
+    ne_free(&parser);
+
+    /* No entry point, but segment 1 carries NE_SEG_PRELOAD */
+    put_u16(buf + MZ_SIZE, 0x16, 0);
+    put_u16(buf + MZ_SIZE + NE_HDR_SIZE, 4, NE_SEG_PRELOAD);
+    ret = ne_parse_buffer(buf, len, &parser);
+    ASSERT_EQ(ret, NE_OK);
+    ret = ne_load_buffer_lazy(buf, len, &parser, &loader);
+    ASSERT_EQ(ret, NE_LOAD_OK);
+    ASSERT_EQ(loader.deferred_count, 0);
+    ASSERT_EQ(loader.segments[0].deferred, 0);
+    ASSERT_EQ(loader.segments[0].data[0], 0x11);
+
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------
+ * Coalesced streaming loads
+ * ---------------------------------------------------------------------- */
+
+/* NEReadAtFn over an in-memory image that counts calls */
+typedef struct {
+    const uint8_t *buf;
+    size_t         len;
+    unsigned       calls;
+    size_t         short_by;   /* bytes to drop from every read */
+} MemReader;
+
+static size_t mem_read_at(void *user, uint32_t offset, void *dst, size_t n)
+{
+    MemReader *r = (MemReader *)user;
+
+    r->calls++;
+    if (offset > r->len || n > r->len - offset)
+        return 0;
+    memcpy(dst, r->buf + offset, n);
+    return n - (n < r->short_by ? n : r->short_by);
+}
+
+/* 20 – adjacent segments are fetched with a single read */
+static void test_stream_coalesces(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    MemReader       rd;
+    size_t   len;
+    uint8_t *buf = build_ne_image_with_data(0x11, 0x22, &len);
+    ASSERT_NOT_NULL(buf);
+
+    TEST_BEGIN("ne_load_stream: adjacent segments in one read");
+    ASSERT_EQ(ne_parse_buffer(buf, len, &parser), NE_OK);
+
+    memset(&rd, 0, sizeof(rd));
+    rd.buf = buf;
+    rd.len = len;
+    ASSERT_EQ(ne_load_stream(mem_read_at, &rd, (uint32_t)len, &parser,
+                             &loader), NE_LOAD_OK);
+    ASSERT_EQ(rd.calls, 1);
+    ASSERT_EQ(loader.reads, 1);
+    ASSERT_EQ(loader.count, 2);
+    ASSERT_EQ(loader.segments[0].data[0], 0x11);
+    ASSERT_EQ(loader.segments[0].data[SEG_CONTENT_LEN - 1u], 0x11);
+    ASSERT_EQ(loader.segments[1].data[0], 0x22);
+    ASSERT_EQ(loader.segments[1].data[SEG_CONTENT_LEN - 1u], 0x22);
+
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 21 – segments listed out of file order still coalesce and land right */
+static void test_stream_sorts_by_offset(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    MemReader       rd;
+    size_t   len;
+    uint8_t *buf = build_ne_image_with_data(0x11, 0x22, &len);
+    uint8_t *seg_tbl;
+    ASSERT_NOT_NULL(buf);
+
+    TEST_BEGIN("ne_load_stream: table order differs from file order");
+    /* segment 1 now lives at sector 11, segment 2 at sector 10 */
+    seg_tbl = buf + MZ_SIZE + NE_HDR_SIZE;
+    put_u16(seg_tbl, 0, (uint16_t)SEG2_SECTOR);
+    put_u16(seg_tbl + SEG_DESC_SIZE, 0, (uint16_t)SEG1_SECTOR);
+    ASSERT_EQ(ne_parse_buffer(buf, len, &parser), NE_OK);
+
+    memset(&rd, 0, sizeof(rd));
+    rd.buf = buf;
+    rd.len = len;
+    ASSERT_EQ(ne_load_stream(mem_read_at, &rd, (uint32_t)len, &parser,
+                             &loader), NE_LOAD_OK);
+    ASSERT_EQ(rd.calls, 1);
+    ASSERT_EQ(loader.segments[0].data[0], 0x22);
+    ASSERT_EQ(loader.segments[1].data[0], 0x11);
+
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 22 – a gap wider than NE_LOAD_GAP_MAX splits the read */
+static void test_stream_gap_splits(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    MemReader       rd;
+    const uint32_t far_off = ((uint32_t)SEG2_SECTOR << 4) + NE_LOAD_GAP_MAX
+                             + 0x100u;
+    size_t   len;
+    uint8_t *buf = build_ne_image_with_data(0x11, 0x22, &len);
+    uint8_t *big;
+    ASSERT_NOT_NULL(buf);
+
+    TEST_BEGIN("ne_load_stream: wide gap -> one read per segment");
+    big = (uint8_t *)calloc(1, far_off + SEG_CONTENT_LEN);
+    if (!big) {
+        free(buf);
+        TEST_FAIL("out of memory");
+    }
+    memcpy(big, buf, len);
+    memset(big + far_off, 0x33, SEG_CONTENT_LEN);
+    put_u16(big + MZ_SIZE + NE_HDR_SIZE + SEG_DESC_SIZE, 0,
+            (uint16_t)(far_off >> 4));
+    free(buf);
+    len = far_off + SEG_CONTENT_LEN;
+    ASSERT_EQ(ne_parse_buffer(big, len, &parser), NE_OK);
+
+    memset(&rd, 0, sizeof(rd));
+    rd.buf = big;
+    rd.len = len;
+    ASSERT_EQ(ne_load_stream(mem_read_at, &rd, (uint32_t)len, &parser,
+                             &loader), NE_LOAD_OK);
+    ASSERT_EQ(rd.calls, 2);
+    ASSERT_EQ(loader.segments[0].data[0], 0x11);
+    ASSERT_EQ(loader.segments[1].data[0], 0x33);
+
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(big);
+    TEST_PASS();
+}
+
+/* 23 – a short read fails cleanly */
+static void test_stream_short_read(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    MemReader       rd;
+    size_t   len;
+    uint8_t *buf = build_ne_image_with_data(0x11, 0x22, &len);
+    ASSERT_NOT_NULL(buf);
+
+    TEST_BEGIN("ne_load_stream: short read -> NE_LOAD_ERR_IO");
+    ASSERT_EQ(ne_parse_buffer(buf, len, &parser), NE_OK);
+
+    memset(&rd, 0, sizeof(rd));
+    rd.buf      = buf;
+    rd.len      = len;
+    rd.short_by = 1;
+    ASSERT_EQ(ne_load_stream(mem_read_at, &rd, (uint32_t)len, &parser,
+                             &loader), NE_LOAD_ERR_IO);
+    ASSERT_EQ(loader.segments == NULL, 1);
+    ASSERT_EQ(ne_load_stream(NULL, &rd, (uint32_t)len, &parser, &loader),
+              NE_LOAD_ERR_NULL);
+
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
 /* -------------------------------------------------------------------------
  * Main
  * ---------------------------------------------------------------------- */
@@ -780,6 +1031,12 @@ int main(void)
     test_free_safe();
     test_strerror();
     test_print_info();
+    test_lazy_defers_segments();
+    test_lazy_preload_resident();
+    test_stream_coalesces();
+    test_stream_sorts_by_offset();
+    test_stream_gap_splits();
+    test_stream_short_read();
 
     printf("\n=== Results: %d/%d passed", g_tests_passed, g_tests_run);
     if (g_tests_failed)
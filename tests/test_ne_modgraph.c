@@ -0,0 +1,609 @@
+/*
+ * test_ne_modgraph.c - Tests for dependency-graph batch module loading
+ *
+ * Writes a small set of NE modules into a directory in the current
+ * directory, each exporting FOO (ordinal 1) and importing ordinal 1 of
+ * its dependencies through FAR32 fixups, then builds, layers and loads
+ * the graph into a module table that already holds KERNEL.
+ *
+ * Build with:
+ *   wcc -ml -za99 -wx -d2 -i=../src ../src/ne_modgraph.c ... test_ne_modgraph.c
+ *   wlink system dos name test_ne_modgraph.exe file test_ne_modgraph.obj,...
+ */
+
+#include "../src/ne_parser.h"
+#include "../src/ne_module.h"
+#include "../src/ne_reloc.h"
+#include "../src/ne_modgraph.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef __WATCOMC__
+#include <direct.h>
+#define MAKE_DIR(p)  mkdir(p)
+#define SEP          "\\"
+#else
+#include <unistd.h>
+#define MAKE_DIR(p)  mkdir((p), 0755)
+#define SEP          "/"
+#endif
+
+/* -------------------------------------------------------------------------
+ * Minimal test framework (mirrors test_ne_scan.c)
+ * ---------------------------------------------------------------------- */
+
+static int g_tests_run    = 0;
+static int g_tests_passed = 0;
+static int g_tests_failed = 0;
+
+#define TEST_BEGIN(name) \
+    do { \
+        g_tests_run++; \
+        printf("  %-60s ", (name)); \
+        fflush(stdout); \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        g_tests_passed++; \
+        printf("PASS\n"); \
+    } while (0)
+
+#define ASSERT_EQ(a, b) \
+    do { \
+        if ((a) != (b)) { \
+            g_tests_failed++; \
+            printf("FAIL \xe2\x80\x93 expected %ld got %ld (line %d)\n", \
+                   (long)(b), (long)(a), __LINE__); \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_NE(a, b) \
+    do { \
+        if ((a) == (b)) { \
+            g_tests_failed++; \
+            printf("FAIL \xe2\x80\x93 unexpected equal value %ld (line %d)\n", \
+                   (long)(a), __LINE__); \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_NOT_NULL(p) \
+    do { \
+        if ((p) == NULL) { \
+            g_tests_failed++; \
+            printf("FAIL \xe2\x80\x93 unexpected NULL pointer (line %d)\n", __LINE__); \
+            return; \
+        } \
+    } while (0)
+
+/* -------------------------------------------------------------------------
+ * Fixture helpers
+ * ---------------------------------------------------------------------- */
+
+#define MZ_SIZE   64u
+#define ROOT      "NEMGTEST"
+#define CODE_LEN  16u          /* room for four FAR32 import slots */
+
+static void put_u16(uint8_t *buf, size_t off, uint16_t v)
+{
+    buf[off]     = (uint8_t)(v & 0xFF);
+    buf[off + 1] = (uint8_t)((v >> 8) & 0xFF);
+}
+
+static void put_u32(uint8_t *buf, size_t off, uint32_t v)
+{
+    buf[off]     = (uint8_t)(v & 0xFF);
+    buf[off + 1] = (uint8_t)((v >>  8) & 0xFF);
+    buf[off + 2] = (uint8_t)((v >> 16) & 0xFF);
+    buf[off + 3] = (uint8_t)((v >> 24) & 0xFF);
+}
+
+/*
+ * write_module - write ROOT/file as an NE module named 'mod' that exports
+ * FOO (ordinal 1) at offset 'foo_off' of its code segment and imports
+ * ordinal 'imp_ord' of each module in imports[] into the FAR32 slot at
+ * code offset 4 * i.  Layout relative to the NE header:
+ *   0x40 segment table (1 code segment)
+ *   0x48 resident names, module-ref table, imported names, entry table
+ *   then the code segment (sector aligned) and its relocation block.
+ */
+static int write_module(const char *file, const char *mod,
+                        const char *const *imports, uint16_t n_imp,
+                        uint16_t imp_ord, uint16_t foo_off)
+{
+    uint8_t   buf[512];
+    uint8_t  *ne = buf + MZ_SIZE;
+    uint16_t  rel;
+    uint16_t  modref_rel;
+    uint16_t  imp_rel;
+    uint16_t  name_off;
+    uint16_t  sector;
+    uint32_t  seg_abs;
+    uint32_t  rb;
+    uint16_t  i;
+    size_t    n = strlen(mod);
+    char      path[64];
+    FILE     *fp;
+    size_t    len;
+
+    memset(buf, 0, sizeof(buf));
+    put_u16(buf, 0x00, MZ_MAGIC);
+    put_u32(buf, 0x3C, MZ_SIZE);
+    put_u16(ne, 0x00, NE_MAGIC);
+    ne[0x02] = 5;
+    put_u16(ne, 0x1C, 1);            /* segment_count     */
+    put_u16(ne, 0x22, 0x40);         /* segment table     */
+    put_u16(ne, 0x32, 4);            /* align_shift       */
+    ne[0x36] = NE_OS_WINDOWS;
+
+    /* Resident names */
+    rel = 0x48;
+    put_u16(ne, 0x24, rel);          /* resource table (empty) */
+    put_u16(ne, 0x26, rel);
+    ne[rel++] = (uint8_t)n;
+    memcpy(ne + rel, mod, n);
+    rel = (uint16_t)(rel + n + 2u);  /* ordinal 0 */
+    ne[rel++] = 3;
+    memcpy(ne + rel, "FOO", 3);
+    rel += 3;
+    put_u16(ne, rel, 1);             /* ordinal 1 */
+    rel += 2;
+    ne[rel++] = 0;                   /* terminator */
+
+    /* Module-ref table and imported names */
+    modref_rel = rel;
+    imp_rel    = (uint16_t)(rel + 2u * n_imp);
+    put_u16(ne, 0x1E, n_imp);
+    put_u16(ne, 0x28, modref_rel);
+    put_u16(ne, 0x2A, imp_rel);
+    rel = imp_rel;
+    ne[rel++] = 0;
+    for (i = 0; i < n_imp; i++) {
+        size_t k = strlen(imports[i]);
+        name_off = (uint16_t)(rel - imp_rel);
+        put_u16(ne, modref_rel + 2u * i, name_off);
+        ne[rel++] = (uint8_t)k;
+        memcpy(ne + rel, imports[i], k);
+        rel = (uint16_t)(rel + k);
+    }
+
+    /* Entry table: one fixed bundle with one entry in segment 1 */
+    put_u16(ne, 0x04, rel);
+    put_u16(ne, 0x06, 6);
+    ne[rel++] = 1;
+    ne[rel++] = 1;
+    ne[rel++] = 0x01;
+    put_u16(ne, rel, foo_off);
+    rel += 2;
+    ne[rel++] = 0;
+
+    /* Code segment with one FAR32 import per slot, chains ended */
+    sector  = (uint16_t)((MZ_SIZE + rel + 15u) >> 4);
+    seg_abs = (uint32_t)sector << 4;
+    put_u16(ne, 0x40 + 0, sector);
+    put_u16(ne, 0x40 + 2, CODE_LEN);
+    put_u16(ne, 0x40 + 4, n_imp ? NE_SEG_RELOC : 0);
+    put_u16(ne, 0x40 + 6, CODE_LEN);
+    for (i = 0; i < n_imp; i++)
+        put_u16(buf, seg_abs + 4u * i, 0xFFFF);
+
+    rb  = seg_abs + CODE_LEN;
+    len = rb;
+    if (n_imp) {
+        put_u16(buf, rb, n_imp);
+        for (i = 0; i < n_imp; i++) {
+            uint8_t *r = buf + rb + 2u + 8u * i;
+            r[0] = NE_RELOC_ADDR_FAR32;
+            r[1] = NE_RELOC_TYPE_IMP_ORD;
+            put_u16(r, 2, (uint16_t)(4u * i));
+            put_u16(r, 4, (uint16_t)(i + 1u));
+            put_u16(r, 6, imp_ord);
+        }
+        len = rb + 2u + 8u * n_imp;
+    }
+
+    sprintf(path, "%s%s%s", ROOT, SEP, file);
+    fp = fopen(path, "wb");
+    if (!fp)
+        return -1;
+    n = fwrite(buf, 1, len, fp);
+    fclose(fp);
+    return (n == len) ? 0 : -1;
+}
+
+/*
+ * The fixture: KERNEL is resident; SOUND and GDI import only KERNEL,
+ * USER imports GDI and KERNEL, APP imports USER, GDI and SOUND.
+ */
+static const char *const k_app[]   = { "USER", "GDI", "SOUND" };
+static const char *const k_user[]  = { "GDI", "KERNEL" };
+static const char *const k_gdi[]   = { "KERNEL" };
+
+static int make_tree(void)
+{
+    MAKE_DIR(ROOT);
+    if (write_module("APP.EXE", "APP", k_app, 3, 1, 0x0A) != 0) return -1;
+    if (write_module("USER.DLL", "USER", k_user, 2, 1, 0x0B) != 0) return -1;
+    if (write_module("gdi.dll", "GDI", k_gdi, 1, 1, 0x0C) != 0) return -1;
+    if (write_module("SOUND.DRV", "SOUND", k_gdi, 1, 1, 0x0D) != 0) return -1;
+    return 0;
+}
+
+static void remove_tree(void)
+{
+    static const char *const files[] = {
+        "APP.EXE", "USER.DLL", "gdi.dll", "SOUND.DRV",
+        "LOOPA.DLL", "LOOPB.DLL", "BAD.EXE", "ORPHAN.EXE"
+    };
+    char     path[64];
+    unsigned i;
+
+    for (i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        sprintf(path, "%s%s%s", ROOT, SEP, files[i]);
+        remove(path);
+    }
+    rmdir(ROOT);
+}
+
+/* A module table holding KERNEL with FOO (ordinal 1) at 0:0x0100 */
+static int setup_table(NEModuleTable *tbl, NEModuleHandle *kernel)
+{
+    NEParserContext p;
+    NELoaderContext l;
+    NEExportTable   exports;
+
+    if (ne_mod_table_init(tbl, 16) != NE_MOD_OK)
+        return -1;
+    memset(&p, 0, sizeof(p));
+    memset(&l, 0, sizeof(l));
+    if (ne_mod_load(tbl, "KERNEL", &p, &l, kernel) != NE_MOD_OK)
+        return -1;
+
+    memset(&exports, 0, sizeof(exports));
+    exports.entries = (NEExportEntry *)calloc(1, sizeof(NEExportEntry));
+    if (!exports.entries)
+        return -1;
+    exports.entries[0].ordinal = 1;
+    exports.entries[0].segment = 0;
+    exports.entries[0].offset  = 0x0100;
+    exports.entries[0].name    = "FOO";
+    exports.count = 1;
+    return ne_mod_set_exports(tbl, *kernel, &exports);
+}
+
+static uint16_t node_of(const NEModGraph *g, const char *name)
+{
+    uint16_t i;
+
+    for (i = 0; i < g->count; i++) {
+        if (strcmp(g->nodes[i].name, name) == 0)
+            return i;
+    }
+    return NE_MODGRAPH_NONE;
+}
+
+static uint16_t read_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/* -------------------------------------------------------------------------
+ * Tests
+ * ---------------------------------------------------------------------- */
+
+/* 1 – closure, layers and critical path */
+static void test_build_layers(void)
+{
+    NEModuleTable  tbl;
+    NEModuleHandle kernel;
+    NEModGraph     g;
+    uint16_t       path[8];
+    uint32_t       total;
+    uint16_t       i;
+
+    TEST_BEGIN("build finds closure, layers it and skips residents");
+    ASSERT_EQ(make_tree(), 0);
+    ASSERT_EQ(setup_table(&tbl, &kernel), NE_MOD_OK);
+
+    ASSERT_EQ(ne_modgraph_build(&g, &tbl, ROOT SEP "APP.EXE",
+                                ne_modgraph_locate_dir, (void *)ROOT, 4),
+              NE_MODGRAPH_OK);
+    ASSERT_EQ(g.count, 5);
+    ASSERT_EQ(strcmp(g.nodes[0].name, "APP"), 0);
+    ASSERT_EQ(g.cycle_count, 0);
+
+    ASSERT_EQ(g.nodes[node_of(&g, "KERNEL")].resident, 1);
+    ASSERT_EQ(g.nodes[node_of(&g, "KERNEL")].handle, kernel);
+    ASSERT_EQ(g.nodes[node_of(&g, "GDI")].layer, 0);
+    ASSERT_EQ(g.nodes[node_of(&g, "SOUND")].layer, 0);
+    ASSERT_EQ(g.nodes[node_of(&g, "USER")].layer, 1);
+    ASSERT_EQ(g.nodes[node_of(&g, "APP")].layer, 2);
+    ASSERT_EQ(g.layer_count, 3);
+    ASSERT_EQ(g.layer_start[1] - g.layer_start[0], 3);   /* +KERNEL */
+    ASSERT_EQ(g.order[g.layer_start[2]], 0);
+
+    /* With equal weights the longest chain is APP -> USER -> GDI */
+    for (i = 0; i < g.count; i++)
+        g.nodes[i].load_us = 0;
+    ASSERT_EQ(ne_modgraph_critical_path(&g, path, 8, &total), 3);
+    ASSERT_EQ(path[0], 0);
+    ASSERT_EQ(path[1], node_of(&g, "USER"));
+    ASSERT_EQ(path[2], node_of(&g, "GDI"));
+    ASSERT_EQ(total, 3);
+
+    ne_modgraph_free(&g);
+    ne_mod_table_free(&tbl);
+    remove_tree();
+    TEST_PASS();
+}
+
+/* 2 – loading registers every module and applies cross-module fixups */
+static void test_load_graph(void)
+{
+    NEModuleTable   tbl;
+    NEModuleHandle  kernel;
+    NEModuleHandle  app;
+    NEModGraph      g;
+    NEModuleEntry  *e;
+    const uint8_t  *code;
+    FILE           *fp;
+    unsigned        workers;
+
+    TEST_BEGIN("load fixes up imports layer by layer (1 and 4 workers)");
+    ASSERT_EQ(make_tree(), 0);
+
+    for (workers = 1; workers <= 4; workers += 3) {
+        ASSERT_EQ(setup_table(&tbl, &kernel), NE_MOD_OK);
+        ASSERT_EQ(ne_modgraph_build(&g, &tbl, ROOT SEP "APP.EXE",
+                                    ne_modgraph_locate_dir, (void *)ROOT,
+                                    workers), NE_MODGRAPH_OK);
+        ASSERT_EQ(ne_modgraph_load(&g, &tbl, workers, &app), NE_MODGRAPH_OK);
+        ASSERT_NE(app, NE_MOD_HANDLE_INVALID);
+        ASSERT_EQ(tbl.count, 5);
+        ASSERT_EQ(app, ne_mod_find(&tbl, "APP"));
+
+        /* APP's slots hold USER, GDI and SOUND's FOO (segment 0) */
+        e = ne_mod_get(&tbl, app);
+        ASSERT_NOT_NULL(e);
+        ASSERT_EQ(e->dep_count, 3);
+        code = e->loader.segments[0].data;
+        ASSERT_EQ(read_u16(code + 0), 0x0B);
+        ASSERT_EQ(read_u16(code + 4), 0x0C);
+        ASSERT_EQ(read_u16(code + 8), 0x0D);
+
+        /* USER's second slot came from the resident KERNEL */
+        e = ne_mod_get(&tbl, ne_mod_find(&tbl, "USER"));
+        ASSERT_NOT_NULL(e);
+        ASSERT_EQ(read_u16(e->loader.segments[0].data + 4), 0x0100);
+        ASSERT_NOT_NULL(ne_mod_exports(&tbl, ne_mod_find(&tbl, "GDI")));
+
+        /* Dependencies hold their importers in place */
+        ASSERT_EQ(ne_mod_unload(&tbl, ne_mod_find(&tbl, "GDI")),
+                  NE_MOD_ERR_IN_USE);
+
+        fp = tmpfile();
+        ASSERT_NOT_NULL(fp);
+        ne_modgraph_print(&g, fp);
+        fclose(fp);
+
+        ne_modgraph_free(&g);
+        ne_mod_table_free(&tbl);
+    }
+
+    remove_tree();
+    TEST_PASS();
+}
+
+/* 3 – a root that is already loaded just gains a reference */
+static void test_resident_root(void)
+{
+    NEModuleTable  tbl;
+    NEModuleHandle kernel;
+    NEModuleHandle a;
+    NEModuleHandle b;
+    NEModGraph     g;
+
+    TEST_BEGIN("loading an already-loaded root adds a reference");
+    ASSERT_EQ(make_tree(), 0);
+    ASSERT_EQ(setup_table(&tbl, &kernel), NE_MOD_OK);
+
+    ASSERT_EQ(ne_modgraph_build(&g, &tbl, ROOT SEP "gdi.dll",
+                                ne_modgraph_locate_dir, (void *)ROOT, 2),
+              NE_MODGRAPH_OK);
+    ASSERT_EQ(ne_modgraph_load(&g, &tbl, 2, &a), NE_MODGRAPH_OK);
+    ne_modgraph_free(&g);
+
+    ASSERT_EQ(ne_modgraph_build(&g, &tbl, ROOT SEP "gdi.dll",
+                                ne_modgraph_locate_dir, (void *)ROOT, 2),
+              NE_MODGRAPH_OK);
+    ASSERT_EQ(g.count, 1);
+    ASSERT_EQ(g.nodes[0].resident, 1);
+    ASSERT_EQ(ne_modgraph_load(&g, &tbl, 2, &b), NE_MODGRAPH_OK);
+    ASSERT_EQ(b, a);
+    ASSERT_EQ(ne_mod_get(&tbl, a)->ref_count, 2);
+    ne_modgraph_free(&g);
+
+    ne_mod_table_free(&tbl);
+    remove_tree();
+    TEST_PASS();
+}
+
+/* 4 – missing modules and import cycles are reported */
+static void test_build_errors(void)
+{
+    static const char *const loop_a[] = { "LOOPB" };
+    static const char *const loop_b[] = { "LOOPA" };
+    static const char *const orphan[] = { "NOSUCH" };
+    NEModuleTable  tbl;
+    NEModuleHandle kernel;
+    NEModGraph     g;
+
+    TEST_BEGIN("missing dependency and import cycle are detected");
+    ASSERT_EQ(make_tree(), 0);
+    ASSERT_EQ(write_module("LOOPA.DLL", "LOOPA", loop_a, 1, 1, 1), 0);
+    ASSERT_EQ(write_module("LOOPB.DLL", "LOOPB", loop_b, 1, 1, 1), 0);
+    ASSERT_EQ(write_module("ORPHAN.EXE", "ORPHAN", orphan, 1, 1, 1), 0);
+    ASSERT_EQ(setup_table(&tbl, &kernel), NE_MOD_OK);
+
+    ASSERT_EQ(ne_modgraph_build(&g, &tbl, ROOT SEP "ORPHAN.EXE",
+                                ne_modgraph_locate_dir, (void *)ROOT, 1),
+              NE_MODGRAPH_ERR_NOT_FOUND);
+    ASSERT_NE(g.failed, NE_MODGRAPH_NONE);
+    ASSERT_EQ(strcmp(g.nodes[g.failed].name, "NOSUCH"), 0);
+    ne_modgraph_free(&g);
+
+    ASSERT_EQ(ne_modgraph_build(&g, &tbl, ROOT SEP "LOOPA.DLL",
+                                ne_modgraph_locate_dir, (void *)ROOT, 1),
+              NE_MODGRAPH_ERR_CYCLE);
+    ASSERT_EQ(g.cycle_count, 2);
+    ASSERT_EQ(g.nodes[0].status, NE_MODGRAPH_ERR_CYCLE);
+    ne_modgraph_free(&g);
+
+    ASSERT_EQ(tbl.count, 1);
+    ne_mod_table_free(&tbl);
+    remove_tree();
+    TEST_PASS();
+}
+
+/* 5 – a failing fixup unloads what the batch already registered */
+static void test_load_rollback(void)
+{
+    NEModuleTable  tbl;
+    NEModuleHandle kernel;
+    NEModuleHandle h;
+    NEModGraph     g;
+
+    TEST_BEGIN("unresolved import fails the batch and rolls back");
+    ASSERT_EQ(make_tree(), 0);
+    /* BAD imports ordinal 9 from USER, which only exports ordinal 1 */
+    ASSERT_EQ(write_module("BAD.EXE", "BAD", k_app, 1, 9, 1), 0);
+    ASSERT_EQ(setup_table(&tbl, &kernel), NE_MOD_OK);
+
+    ASSERT_EQ(ne_modgraph_build(&g, &tbl, ROOT SEP "BAD.EXE",
+                                ne_modgraph_locate_dir, (void *)ROOT, 2),
+              NE_MODGRAPH_OK);
+    ASSERT_EQ(ne_modgraph_load(&g, &tbl, 2, &h), NE_MODGRAPH_ERR_LOAD);
+    ASSERT_EQ(h, NE_MOD_HANDLE_INVALID);
+    ASSERT_EQ(g.failed, 0);
+    ASSERT_EQ(g.nodes[0].detail, NE_RELOC_ERR_UNRESOLVED);
+    ASSERT_EQ(tbl.count, 1);    /* only KERNEL is left */
+    ASSERT_EQ(ne_mod_find(&tbl, "USER"), NE_MOD_HANDLE_INVALID);
+    ne_modgraph_free(&g);
+
+    ne_mod_table_free(&tbl);
+    remove_tree();
+    TEST_PASS();
+}
+
+/* 6 – a graph built from the image cache reloads without re-reading */
+static void test_load_cached(void)
+{
+    NEModuleTable   tbl;
+    NEModuleHandle  kernel;
+    NEModuleHandle  app;
+    NEModGraph      g;
+    NEImgCache      cache;
+    NEModuleEntry  *e;
+    const uint8_t  *code;
+    unsigned        round;
+
+    TEST_BEGIN("cached graph loads reuse parsed images and plans");
+    ASSERT_EQ(make_tree(), 0);
+    ASSERT_EQ(ne_imgcache_init(&cache, NE_IMGCACHE_DEFAULT_CAP, 0),
+              NE_IMGCACHE_OK);
+
+    for (round = 0; round < 2; round++) {
+        ASSERT_EQ(setup_table(&tbl, &kernel), NE_MOD_OK);
+        ASSERT_EQ(ne_modgraph_build_cached(&g, &tbl, &cache,
+                                           ROOT SEP "APP.EXE",
+                                           ne_modgraph_locate_dir,
+                                           (void *)ROOT, 4), NE_MODGRAPH_OK);
+        ASSERT_NOT_NULL(g.nodes[0].cached);
+        ASSERT_EQ(ne_modgraph_load(&g, &tbl, 4, &app), NE_MODGRAPH_OK);
+
+        e = ne_mod_get(&tbl, app);
+        ASSERT_NOT_NULL(e);
+        code = e->loader.segments[0].data;
+        ASSERT_EQ(read_u16(code + 0), 0x0B);
+        ASSERT_EQ(read_u16(code + 4), 0x0C);
+        ASSERT_EQ(read_u16(code + 8), 0x0D);
+        e = ne_mod_get(&tbl, ne_mod_find(&tbl, "USER"));
+        ASSERT_NOT_NULL(e);
+        ASSERT_EQ(read_u16(e->loader.segments[0].data + 4), 0x0100);
+        ASSERT_NOT_NULL(ne_mod_exports(&tbl, ne_mod_find(&tbl, "GDI")));
+
+        ne_modgraph_free(&g);
+        ne_mod_table_free(&tbl);
+    }
+
+    /* APP, USER, GDI and SOUND were read once; the graph let go of them */
+    ASSERT_EQ(cache.misses, 4);
+    ASSERT_EQ(cache.hits, 4);
+    ASSERT_EQ(ne_imgcache_purge(&cache), 4);
+
+    ne_imgcache_free(&cache);
+    remove_tree();
+    TEST_PASS();
+}
+
+/* 7 – argument checks and strerror */
+static void test_errors(void)
+{
+    NEModuleTable  tbl;
+    NEModGraph     g;
+    NEModuleHandle h;
+    char           path[64];
+
+    TEST_BEGIN("NULL arguments, locate_dir misses and strerror");
+    memset(&tbl, 0, sizeof(tbl));
+    memset(&g, 0, sizeof(g));
+    ASSERT_EQ(ne_modgraph_build(NULL, &tbl, "X", ne_modgraph_locate_dir,
+                                (void *)ROOT, 1), NE_MODGRAPH_ERR_NULL);
+    ASSERT_EQ(ne_modgraph_build(&g, &tbl, "X", NULL, NULL, 1),
+              NE_MODGRAPH_ERR_NULL);
+    ASSERT_EQ(ne_modgraph_load(&g, &tbl, 1, &h), NE_MODGRAPH_ERR_NULL);
+    ASSERT_NE(ne_modgraph_locate_dir("NOSUCH", path, sizeof(path),
+                                     (void *)ROOT), 0);
+    ASSERT_EQ(ne_modgraph_critical_path(&g, NULL, 0, NULL), 0);
+    ne_modgraph_free(NULL);
+
+    ASSERT_NOT_NULL(ne_modgraph_strerror(NE_MODGRAPH_OK));
+    ASSERT_NOT_NULL(ne_modgraph_strerror(NE_MODGRAPH_ERR_NULL));
+    ASSERT_NOT_NULL(ne_modgraph_strerror(NE_MODGRAPH_ERR_ALLOC));
+    ASSERT_NOT_NULL(ne_modgraph_strerror(NE_MODGRAPH_ERR_NOT_FOUND));
+    ASSERT_NOT_NULL(ne_modgraph_strerror(NE_MODGRAPH_ERR_LOAD));
+    ASSERT_NOT_NULL(ne_modgraph_strerror(NE_MODGRAPH_ERR_CYCLE));
+    ASSERT_NOT_NULL(ne_modgraph_strerror(NE_MODGRAPH_ERR_FULL));
+    ASSERT_NOT_NULL(ne_modgraph_strerror(-999));
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------
+ * Main
+ * ---------------------------------------------------------------------- */
+
+int main(void)
+{
+    printf("=== NE Module Graph Loader Tests ===\n\n");
+
+    test_build_layers();
+    test_load_graph();
+    test_resident_root();
+    test_build_errors();
+    test_load_rollback();
+    test_load_cached();
+    test_errors();
+
+    printf("\n=== Results: %d/%d passed", g_tests_passed, g_tests_run);
+    if (g_tests_failed)
+        printf(", %d FAILED", g_tests_failed);
+    printf(" ===\n");
+
+    return (g_tests_failed == 0) ? 0 : 1;
+}
@@ -6,8 +6,8 @@
  *
  * Build with:
  *   wcc -ml -za99 -wx -d2 -i=../src ../src/ne_parser.c ../src/ne_loader.c
- *       ../src/ne_module.c test_ne_module.c
- *   wlink system dos name test_ne_module.exe file test_ne_module.obj,ne_parser.obj,ne_loader.obj,ne_module.obj
+ *       ../src/ne_impexp.c ../src/ne_module.c test_ne_module.c
+ *   wlink system dos name test_ne_module.exe file test_ne_module.obj,ne_parser.obj,ne_loader.obj,ne_impexp.obj,ne_module.obj
  */
 
 #include "../src/ne_parser.h"
@@ -523,23 +523,85 @@ static void test_find_not_found(void)
     TEST_PASS();
 }
 
-static void test_find_case_sensitive(void)
+static void test_find_case_insensitive(void)
 {
     NEModuleTable   tbl;
     NEParserContext p;
     NELoaderContext l;
-    NEModuleHandle  h;
+    NEModuleHandle  h, h2;
 
-    TEST_BEGIN("find is case-sensitive");
+    TEST_BEGIN("find and duplicate detection ignore case");
 
     ASSERT_EQ(ne_mod_table_init(&tbl, 4), NE_MOD_OK);
     make_blank_contexts(&p, &l);
     ASSERT_EQ(ne_mod_load(&tbl, "KERNEL", &p, &l, &h), NE_MOD_OK);
 
-    /* Lower-case version must not match */
-    ASSERT_EQ((long long)ne_mod_find(&tbl, "kernel"),
+    /* Module names are case-insensitive, as in Windows */
+    ASSERT_EQ((long long)ne_mod_find(&tbl, "kernel"), (long long)h);
+    ASSERT_EQ((long long)ne_mod_find(&tbl, "Kernel"), (long long)h);
+    ASSERT_EQ((long long)ne_mod_find(&tbl, "KERNE"),
+              (long long)NE_MOD_HANDLE_INVALID);
+    ASSERT_EQ((long long)ne_mod_find(&tbl, "KERNEL32"),
               (long long)NE_MOD_HANDLE_INVALID);
 
+    make_blank_contexts(&p, &l);
+    ASSERT_EQ(ne_mod_load(&tbl, "kernel", &p, &l, &h2), NE_MOD_OK);
+    ASSERT_EQ((long long)h2, (long long)h);
+    ASSERT_EQ(tbl.count, (uint16_t)1);
+
+    ne_mod_table_free(&tbl);
+    TEST_PASS();
+}
+
+static void test_index_churn(void)
+{
+    NEModuleTable   tbl;
+    NEParserContext p;
+    NELoaderContext l;
+    NEModuleHandle  h[200];
+    char            name[NE_MOD_NAME_MAX];
+    uint16_t        i;
+
+    TEST_BEGIN("name and handle indexes survive load/unload churn");
+
+    ASSERT_EQ(ne_mod_table_init(&tbl, NE_MOD_TABLE_CAP), NE_MOD_OK);
+
+    /* More modules than the old 64-entry default */
+    for (i = 0; i < 200u; i++) {
+        sprintf(name, "MOD%u", (unsigned)i);
+        make_blank_contexts(&p, &l);
+        ASSERT_EQ(ne_mod_load(&tbl, name, &p, &l, &h[i]), NE_MOD_OK);
+    }
+    ASSERT_EQ(tbl.count, (uint16_t)200);
+
+    /* Drop every third module; the rest must stay reachable */
+    for (i = 0; i < 200u; i += 3u)
+        ASSERT_EQ(ne_mod_unload(&tbl, h[i]), NE_MOD_OK);
+
+    for (i = 0; i < 200u; i++) {
+        sprintf(name, "mod%u", (unsigned)i);
+        if (i % 3u == 0u) {
+            ASSERT_EQ((long long)ne_mod_find(&tbl, name),
+                      (long long)NE_MOD_HANDLE_INVALID);
+            ASSERT_EQ(ne_mod_get(&tbl, h[i]), NULL);
+        } else {
+            ASSERT_EQ((long long)ne_mod_find(&tbl, name), (long long)h[i]);
+            ASSERT_NOT_NULL(ne_mod_get(&tbl, h[i]));
+        }
+    }
+
+    /* Reloaded modules get fresh handles and are found again */
+    for (i = 0; i < 200u; i += 3u) {
+        sprintf(name, "MOD%u", (unsigned)i);
+        make_blank_contexts(&p, &l);
+        ASSERT_EQ(ne_mod_load(&tbl, name, &p, &l, &h[i]), NE_MOD_OK);
+    }
+    for (i = 0; i < 200u; i++) {
+        sprintf(name, "MOD%u", (unsigned)i);
+        ASSERT_EQ((long long)ne_mod_find(&tbl, name), (long long)h[i]);
+        ASSERT_EQ(ne_mod_get(&tbl, h[i])->handle, h[i]);
+    }
+
     ne_mod_table_free(&tbl);
     TEST_PASS();
 }
@@ -612,6 +674,203 @@ static void test_name_truncation(void)
     TEST_PASS();
 }
 
+/* -------------------------------------------------------------------------
+ * Export tables and the module-table import resolver
+ * ---------------------------------------------------------------------- */
+
+/* Give module 'h' a two-entry export table built by hand. */
+static int set_user_exports(NEModuleTable *tbl, NEModuleHandle h,
+                            uint16_t off_base)
+{
+    NEExportTable exports;
+
+    memset(&exports, 0, sizeof(exports));
+    exports.entries = (NEExportEntry *)calloc(2, sizeof(NEExportEntry));
+    if (!exports.entries)
+        return NE_MOD_ERR_ALLOC;
+    exports.entries[0].ordinal = 1;
+    exports.entries[0].segment = 0;
+    exports.entries[0].offset  = off_base;
+    exports.entries[0].name    = "MessageBox";
+    exports.entries[1].ordinal = 2;
+    exports.entries[1].segment = 1;
+    exports.entries[1].offset  = (uint16_t)(off_base + 0x10u);
+    exports.entries[1].name    = "DialogBox";
+    exports.count = 2;
+    return ne_mod_set_exports(tbl, h, &exports);
+}
+
+/* Importer whose module-reference table names "USER" then "GDI". */
+static void make_importer_contexts(NEParserContext *parser,
+                                   NELoaderContext *loader)
+{
+    static const uint8_t names[] =
+        "\x04USER\x03GDI\x0AMESSAGEBOX";
+    uint8_t  *imp;
+    uint16_t *refs;
+
+    make_blank_contexts(parser, loader);
+    imp  = (uint8_t *)malloc(sizeof(names) - 1u);
+    refs = (uint16_t *)malloc(2u * sizeof(uint16_t));
+    if (!imp || !refs) {
+        free(imp);
+        free(refs);
+        return;
+    }
+    memcpy(imp, names, sizeof(names) - 1u);
+    refs[0] = 0;
+    refs[1] = 5;
+    parser->imported_names      = imp;
+    parser->imported_names_size = (uint16_t)(sizeof(names) - 1u);
+    parser->module_refs         = refs;
+    parser->module_ref_count    = 2;
+}
+
+static void test_exports_blank_module(void)
+{
+    NEModuleTable         tbl;
+    NEParserContext       p;
+    NELoaderContext       l;
+    NEModuleHandle        h;
+    const NEExportTable  *exports;
+
+    TEST_BEGIN("exports of a module without an entry table are empty");
+
+    ne_mod_table_init(&tbl, 4);
+    make_blank_contexts(&p, &l);
+    ASSERT_EQ(ne_mod_load(&tbl, "EMPTY", &p, &l, &h), NE_MOD_OK);
+
+    exports = ne_mod_exports(&tbl, h);
+    ASSERT_NOT_NULL(exports);
+    ASSERT_EQ(exports->count, (uint16_t)0);
+    ASSERT_EQ(ne_mod_exports(&tbl, 999), NULL);
+
+    ne_mod_table_free(&tbl);
+    TEST_PASS();
+}
+
+static void test_import_resolver(void)
+{
+    NEModuleTable      tbl;
+    NEParserContext    p;
+    NELoaderContext    l;
+    NEModuleHandle     user, app;
+    NEModImportContext ic;
+    NEModuleEntry     *e;
+    uint16_t           seg = 0, off = 0;
+
+    TEST_BEGIN("import resolver finds ordinal and name imports");
+
+    ne_mod_table_init(&tbl, 4);
+    make_blank_contexts(&p, &l);
+    ASSERT_EQ(ne_mod_load(&tbl, "USER", &p, &l, &user), NE_MOD_OK);
+    ASSERT_EQ(set_user_exports(&tbl, user, 0x100), NE_MOD_OK);
+
+    make_importer_contexts(&p, &l);
+    ASSERT_NOT_NULL(p.module_refs);
+    ASSERT_EQ(ne_mod_load(&tbl, "APP", &p, &l, &app), NE_MOD_OK);
+    ic.table    = &tbl;
+    ic.importer = app;
+
+    /* Ordinal 2 from module ref 1 (USER) */
+    ASSERT_EQ(ne_mod_import_resolver(1, 2, 0, NULL, 0, &seg, &off, &ic),
+              NE_MOD_OK);
+    ASSERT_EQ(seg, (uint16_t)1);
+    ASSERT_EQ(off, (uint16_t)0x110);
+
+    /* By name, ignoring case: "MESSAGEBOX" at offset 9 */
+    e = ne_mod_get(&tbl, app);
+    ASSERT_EQ(ne_mod_import_resolver(1, 9, 1, e->parser.imported_names,
+                                     e->parser.imported_names_size,
+                                     &seg, &off, &ic), NE_MOD_OK);
+    ASSERT_EQ(seg, (uint16_t)0);
+    ASSERT_EQ(off, (uint16_t)0x100);
+
+    /* The reference was cached */
+    ASSERT_NOT_NULL(e->ref_handles);
+    ASSERT_EQ(e->ref_handles[0], user);
+
+    /* GDI is not loaded; out-of-range refs and ordinals fail */
+    ASSERT_EQ(ne_mod_import_resolver(2, 1, 0, NULL, 0, &seg, &off, &ic),
+              NE_MOD_ERR_NOT_FOUND);
+    ASSERT_EQ(ne_mod_import_resolver(3, 1, 0, NULL, 0, &seg, &off, &ic),
+              NE_MOD_ERR_NOT_FOUND);
+    ASSERT_EQ(ne_mod_import_resolver(1, 7, 0, NULL, 0, &seg, &off, &ic),
+              NE_MOD_ERR_NOT_FOUND);
+
+    ne_mod_table_free(&tbl);
+    TEST_PASS();
+}
+
+static void test_import_resolver_reload(void)
+{
+    NEModuleTable      tbl;
+    NEParserContext    p;
+    NELoaderContext    l;
+    NEModuleHandle     user, user2, app;
+    NEModImportContext ic;
+    uint16_t           seg = 0, off = 0;
+
+    TEST_BEGIN("import resolver follows a reloaded dependency");
+
+    ne_mod_table_init(&tbl, 4);
+    make_blank_contexts(&p, &l);
+    ASSERT_EQ(ne_mod_load(&tbl, "USER", &p, &l, &user), NE_MOD_OK);
+    ASSERT_EQ(set_user_exports(&tbl, user, 0x100), NE_MOD_OK);
+
+    make_importer_contexts(&p, &l);
+    ASSERT_EQ(ne_mod_load(&tbl, "APP", &p, &l, &app), NE_MOD_OK);
+    ic.table    = &tbl;
+    ic.importer = app;
+
+    ASSERT_EQ(ne_mod_ref_handle(&tbl, app, 1), user);
+    ASSERT_EQ(ne_mod_unload(&tbl, user), NE_MOD_OK);
+    ASSERT_EQ(ne_mod_ref_handle(&tbl, app, 1), NE_MOD_HANDLE_INVALID);
+
+    make_blank_contexts(&p, &l);
+    ASSERT_EQ(ne_mod_load(&tbl, "USER", &p, &l, &user2), NE_MOD_OK);
+    ASSERT_NE(user2, user);
+    ASSERT_EQ(set_user_exports(&tbl, user2, 0x200), NE_MOD_OK);
+
+    ASSERT_EQ(ne_mod_import_resolver(1, 1, 0, NULL, 0, &seg, &off, &ic),
+              NE_MOD_OK);
+    ASSERT_EQ(off, (uint16_t)0x200);
+    ASSERT_EQ(ne_mod_ref_handle(&tbl, app, 1), user2);
+
+    ne_mod_table_free(&tbl);
+    TEST_PASS();
+}
+
+static void test_ref_handle_reused(void)
+{
+    NEModuleTable   tbl;
+    NEParserContext p;
+    NELoaderContext l;
+    NEModuleHandle  user, other, app;
+
+    TEST_BEGIN("cached reference ignores a handle reused by another module");
+
+    ne_mod_table_init(&tbl, 4);
+    make_blank_contexts(&p, &l);
+    ASSERT_EQ(ne_mod_load(&tbl, "USER", &p, &l, &user), NE_MOD_OK);
+    make_importer_contexts(&p, &l);
+    ASSERT_EQ(ne_mod_load(&tbl, "APP", &p, &l, &app), NE_MOD_OK);
+
+    ASSERT_EQ(ne_mod_ref_handle(&tbl, app, 1), user);
+    ASSERT_EQ(ne_mod_unload(&tbl, user), NE_MOD_OK);
+
+    /* Wrap the handle counter so the next load gets USER's old handle */
+    tbl.next_handle = user;
+    make_blank_contexts(&p, &l);
+    ASSERT_EQ(ne_mod_load(&tbl, "GDI", &p, &l, &other), NE_MOD_OK);
+    ASSERT_EQ(other, user);
+
+    ASSERT_EQ(ne_mod_ref_handle(&tbl, app, 1), NE_MOD_HANDLE_INVALID);
+
+    ne_mod_table_free(&tbl);
+    TEST_PASS();
+}
+
 /* -------------------------------------------------------------------------
  * ne_mod_strerror
  * ---------------------------------------------------------------------- */
@@ -669,7 +928,8 @@ int main(void)
     /* find */
     test_find_by_name();
     test_find_not_found();
-    test_find_case_sensitive();
+    test_find_case_insensitive();
+    test_index_churn();
 
     /* capacity */
     test_table_full();
@@ -677,6 +937,12 @@ int main(void)
     /* name handling */
     test_name_truncation();
 
+    /* exports and import resolution */
+    test_exports_blank_module();
+    test_import_resolver();
+    test_import_resolver_reload();
+    test_ref_handle_reused();
+
     /* error strings */
     test_strerror();
 
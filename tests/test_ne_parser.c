@@ -576,6 +576,376 @@ static void test_ne_offset_stored(void)
     TEST_PASS();
 }
 
+/* 21 – ne_parse_image borrows table views from the shared image */
+static void test_image_borrowed_tables(void)
+{
+    NEParserContext ctx;
+    NEImage img;
+    size_t  len;
+    const char *path = "NEIMG.EXE";
+    const uint16_t entry_size = 6;
+    const uint32_t entry_abs = MZ_SIZE + NE_HDR_SIZE + 2 * SEG_DESC_SIZE;
+
+    uint8_t *buf = build_ne_image(2, entry_size, &len);
+    ASSERT_NOT_NULL(buf);
+    buf[entry_abs] = 0x5A;
+
+    TEST_BEGIN("ne_parse_image borrows entry table from mapped image");
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp) { free(buf); TEST_FAIL("could not create temp file"); }
+    fwrite(buf, 1, len, fp);
+    fclose(fp);
+    free(buf);
+
+    int ret = ne_image_open(path, &img);
+    ASSERT_EQ(ret, NE_OK);
+    ASSERT_EQ((long)img.len, (long)len);
+
+    ret = ne_parse_image(&img, &ctx);
+    ASSERT_EQ(ret, NE_OK);
+    ASSERT_NE(ctx.borrowed, 0);
+    ASSERT_EQ(ctx.header.segment_count, 2);
+    ASSERT_EQ(ctx.entry_size, entry_size);
+    ASSERT_EQ(ctx.entry_data == img.data + entry_abs, 1);
+    ASSERT_EQ(ctx.entry_data[0], 0x5A);
+
+    ne_free(&ctx);          /* must not free the borrowed views */
+    ne_image_close(&img);
+    ASSERT_EQ(img.data == NULL, 1);
+    ne_image_close(NULL);   /* NULL is safe */
+    remove(path);
+    TEST_PASS();
+}
+
+/* 22 – ne_image_open error paths */
+static void test_image_open_errors(void)
+{
+    NEImage img;
+    NEParserContext ctx;
+    TEST_BEGIN("ne_image_open / ne_parse_image error paths");
+    ASSERT_EQ(ne_image_open("NXFILE3.EXE", &img), NE_ERR_IO);
+    ASSERT_EQ(ne_image_open(NULL, &img), NE_ERR_NULL_ARG);
+    ASSERT_EQ(ne_image_open("NXFILE3.EXE", NULL), NE_ERR_NULL_ARG);
+    memset(&img, 0, sizeof(img));
+    ASSERT_EQ(ne_parse_image(&img, &ctx), NE_ERR_NULL_ARG);
+    ASSERT_EQ(ne_parse_image(NULL, &ctx), NE_ERR_NULL_ARG);
+    TEST_PASS();
+}
+
+/* 23 – module-reference table and ne_module_ref_name */
+static void test_module_ref_names(void)
+{
+    static const uint8_t imp_names[13] = {
+        0x00,
+        6, 'K', 'E', 'R', 'N', 'E', 'L',
+        4, 'U', 'S', 'E', 'R'
+    };
+    NEParserContext ctx;
+    size_t   len;
+    uint8_t *base = build_ne_image(1, 0, &len);
+    uint8_t *buf;
+    uint8_t *ne;
+    uint16_t tbl_rel;
+    char     name[16];
+
+    ASSERT_NOT_NULL(base);
+    TEST_BEGIN("module-ref table parsed; ne_module_ref_name resolves names");
+
+    /* Append module-ref table (2 entries) then imported names */
+    buf = (uint8_t *)calloc(1, len + 4 + sizeof(imp_names));
+    if (!buf) { free(base); TEST_FAIL("out of memory"); }
+    memcpy(buf, base, len);
+    free(base);
+
+    ne      = buf + MZ_SIZE;
+    tbl_rel = (uint16_t)(len - MZ_SIZE);
+    put_u16(ne, 0x1E, 2);                             /* module_ref_count */
+    put_u16(ne, 0x28, tbl_rel);                       /* module-ref table */
+    put_u16(ne, 0x2A, (uint16_t)(tbl_rel + 4));       /* imported names   */
+    put_u16(ne, 0x04, (uint16_t)(tbl_rel + 4 + sizeof(imp_names)));
+    put_u16(buf, len + 0, 1);
+    put_u16(buf, len + 2, 8);
+    memcpy(buf + len + 4, imp_names, sizeof(imp_names));
+    len += 4 + sizeof(imp_names);
+
+    int ret = ne_parse_buffer(buf, len, &ctx);
+    ASSERT_EQ(ret, NE_OK);
+    ASSERT_EQ(ctx.module_ref_count, 2);
+    ASSERT_NOT_NULL(ctx.module_refs);
+    ASSERT_EQ(ctx.imported_names_size, (int)sizeof(imp_names));
+
+    ASSERT_EQ(ne_module_ref_name(&ctx, 1, name, sizeof(name)), NE_OK);
+    ASSERT_EQ(strcmp(name, "KERNEL"), 0);
+    ASSERT_EQ(ne_module_ref_name(&ctx, 2, name, sizeof(name)), NE_OK);
+    ASSERT_EQ(strcmp(name, "USER"), 0);
+
+    /* Truncation, bad index and NULL arguments */
+    ASSERT_EQ(ne_module_ref_name(&ctx, 1, name, 4), NE_OK);
+    ASSERT_EQ(strcmp(name, "KER"), 0);
+    ASSERT_EQ(ne_module_ref_name(&ctx, 0, name, sizeof(name)),
+              NE_ERR_BAD_OFFSET);
+    ASSERT_EQ(ne_module_ref_name(&ctx, 3, name, sizeof(name)),
+              NE_ERR_BAD_OFFSET);
+    ASSERT_EQ(ne_module_ref_name(NULL, 1, name, sizeof(name)),
+              NE_ERR_NULL_ARG);
+
+    ne_free(&ctx);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 24 – resident / non-resident name index and lookups */
+static void test_name_index(void)
+{
+    static const uint8_t res_names[] = {
+        4, 'T', 'E', 'S', 'T', 0, 0,           /* module name          */
+        5, 'G', 'a', 'm', 'm', 'a', 3, 0,
+        5, 'A', 'l', 'p', 'h', 'a', 1, 0,
+        4, 'B', 'e', 't', 'a', 2, 0,
+        0
+    };
+    static const uint8_t nonres_names[] = {
+        4, 'D', 'E', 'S', 'C', 0, 0,           /* description          */
+        4, 'B', 'e', 't', 'a', 5, 0,           /* shadowed by resident */
+        5, 'O', 't', 'h', 'e', 'r', 2, 0,      /* shadowed by resident */
+        5, 'D', 'e', 'l', 't', 'a', 4, 0,
+        0
+    };
+    NEParserContext ctx;
+    size_t   len;
+    uint8_t *base = build_ne_image(1, 0, &len);
+    uint8_t *buf;
+    uint8_t *ne;
+    uint16_t ord = 0;
+
+    ASSERT_NOT_NULL(base);
+    TEST_BEGIN("name index: sorted lookups both ways, resident wins");
+
+    buf = (uint8_t *)calloc(1, len + sizeof(res_names) + sizeof(nonres_names));
+    if (!buf) { free(base); TEST_FAIL("out of memory"); }
+    memcpy(buf, base, len);
+    free(base);
+
+    ne = buf + MZ_SIZE;
+    put_u16(ne, 0x26, (uint16_t)(len - MZ_SIZE));       /* resident names  */
+    memcpy(buf + len, res_names, sizeof(res_names));
+    len += sizeof(res_names);
+    put_u32(ne, 0x2C, (uint32_t)len);                   /* non-resident    */
+    put_u16(ne, 0x20, (uint16_t)sizeof(nonres_names));
+    memcpy(buf + len, nonres_names, sizeof(nonres_names));
+    len += sizeof(nonres_names);
+
+    ASSERT_EQ(ne_parse_buffer(buf, len, &ctx), NE_OK);
+    ASSERT_EQ(ctx.names.count, 6);
+    ASSERT_EQ(strcmp(ne_module_name(&ctx), "TEST"), 0);
+    ASSERT_EQ(strcmp(ctx.names.pool + ctx.names.description, "DESC"), 0);
+
+    ASSERT_EQ(ne_name_to_ordinal(&ctx, "Alpha", &ord), NE_OK);
+    ASSERT_EQ(ord, 1);
+    ASSERT_EQ(ne_name_to_ordinal(&ctx, "Gamma", &ord), NE_OK);
+    ASSERT_EQ(ord, 3);
+    ASSERT_EQ(ne_name_to_ordinal(&ctx, "Delta", &ord), NE_OK);
+    ASSERT_EQ(ord, 4);
+    ASSERT_EQ(ne_name_to_ordinal(&ctx, "Beta", &ord), NE_OK);
+    ASSERT_EQ(ord, 2);
+    ASSERT_EQ(ne_name_to_ordinal(&ctx, "beta", &ord), NE_ERR_NOT_FOUND);
+    ASSERT_EQ(ne_name_to_ordinal(&ctx, "TEST", &ord), NE_ERR_NOT_FOUND);
+
+    ASSERT_EQ(strcmp(ne_ordinal_to_name(&ctx, 2), "Beta"), 0);
+    ASSERT_EQ(strcmp(ne_ordinal_to_name(&ctx, 4), "Delta"), 0);
+    ASSERT_EQ(strcmp(ne_ordinal_to_name(&ctx, 5), "Beta"), 0);
+    ASSERT_EQ(ne_ordinal_to_name(&ctx, 6) == NULL, 1);
+    ASSERT_EQ(ne_ordinal_to_name(&ctx, 0) == NULL, 1);
+
+    ASSERT_EQ(ne_name_to_ordinal(NULL, "Alpha", &ord), NE_ERR_NULL_ARG);
+    ASSERT_EQ(ne_name_to_ordinal(&ctx, NULL, &ord), NE_ERR_NULL_ARG);
+
+    ne_free(&ctx);
+    ASSERT_EQ(strcmp(ne_module_name(&ctx), ""), 0);
+    free(buf);
+    TEST_PASS();
+}
+
+/* Memory-backed NEReadAtFn for the streaming tests */
+typedef struct {
+    const uint8_t *buf;
+    size_t         len;
+    size_t         max_req;    /* largest single read requested   */
+    size_t         total;      /* bytes read in all calls          */
+    int            fail_at;    /* call number that reads short (0: never) */
+    int            calls;
+} MemReader;
+
+static size_t mem_read_at(void *user, uint32_t offset, void *dst, size_t n)
+{
+    MemReader *r = (MemReader *)user;
+
+    r->calls++;
+    if (n > r->max_req)
+        r->max_req = n;
+    if (r->fail_at && r->calls >= r->fail_at)
+        return 0;
+    if (offset > r->len || n > r->len - offset)
+        return 0;
+    memcpy(dst, r->buf + offset, n);
+    r->total += n;
+    return n;
+}
+
+/* 25 – streaming parse matches buffer parse and stays within the window */
+static void test_stream_parse(void)
+{
+    static const uint8_t nonres_names[] = {
+        4, 'D', 'E', 'S', 'C', 0, 0,
+        5, 'A', 'l', 'p', 'h', 'a', 1, 0,
+        0
+    };
+    const size_t big = 300000u;  /* larger than a DOS conventional buffer */
+    NEParserContext ref;
+    NEParserContext ctx;
+    MemReader rd;
+    size_t   len;
+    uint8_t *base = build_ne_image(3, 6, &len);
+    uint8_t *buf;
+    uint16_t ord = 0;
+
+    ASSERT_NOT_NULL(base);
+    TEST_BEGIN("ne_parse_stream matches ne_parse_buffer on a large image");
+
+    /* Non-resident names at the far end of a large, mostly empty file */
+    buf = (uint8_t *)calloc(1, big);
+    if (!buf) { free(base); TEST_FAIL("out of memory"); }
+    memcpy(buf, base, len);
+    free(base);
+    put_u32(buf + MZ_SIZE, 0x2C, (uint32_t)(big - sizeof(nonres_names)));
+    put_u16(buf + MZ_SIZE, 0x20, (uint16_t)sizeof(nonres_names));
+    memcpy(buf + big - sizeof(nonres_names), nonres_names,
+           sizeof(nonres_names));
+
+    ASSERT_EQ(ne_parse_buffer(buf, big, &ref), NE_OK);
+
+    memset(&rd, 0, sizeof(rd));
+    rd.buf = buf;
+    rd.len = big;
+    ASSERT_EQ(ne_parse_stream(mem_read_at, &rd, (uint32_t)big, &ctx), NE_OK);
+
+    ASSERT_EQ(memcmp(&ctx.header, &ref.header, sizeof(NEHeader)), 0);
+    ASSERT_EQ(memcmp(ctx.segments, ref.segments,
+                     3 * sizeof(NESegmentDescriptor)), 0);
+    ASSERT_EQ(ctx.entry_size, ref.entry_size);
+    ASSERT_EQ(memcmp(ctx.entry_data, ref.entry_data, ctx.entry_size), 0);
+    ASSERT_EQ(ctx.names.count, 1);
+    ASSERT_EQ(ne_name_to_ordinal(&ctx, "Alpha", &ord), NE_OK);
+    ASSERT_EQ(ord, 1);
+    ASSERT_EQ(ctx.borrowed, 0);
+
+    /* Only headers and tables were read, never more than a window */
+    ASSERT_EQ(rd.max_req <= NE_STREAM_WINDOW, 1);
+    ASSERT_EQ(rd.total < 4u * NE_STREAM_WINDOW, 1);
+    ne_free(&ctx);
+
+    /* A short read surfaces as NE_ERR_IO */
+    memset(&rd, 0, sizeof(rd));
+    rd.buf     = buf;
+    rd.len     = big;
+    rd.fail_at = 2;
+    ASSERT_EQ(ne_parse_stream(mem_read_at, &rd, (uint32_t)big, &ctx),
+              NE_ERR_IO);
+    ne_free(&ctx);
+
+    ASSERT_EQ(ne_parse_stream(NULL, &rd, (uint32_t)big, &ctx),
+              NE_ERR_NULL_ARG);
+    ASSERT_EQ(ne_parse_fp(NULL, &ctx), NE_ERR_NULL_ARG);
+
+    ne_free(&ref);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 26 – ne_parse_fp over a temporary stream */
+static void test_parse_fp(void)
+{
+    NEParserContext ctx;
+    size_t   len;
+    uint8_t *buf = build_ne_image(2, 0, &len);
+    FILE    *fp;
+
+    ASSERT_NOT_NULL(buf);
+    TEST_BEGIN("ne_parse_fp parses a seekable stream");
+
+    fp = tmpfile();
+    if (!fp) { free(buf); TEST_FAIL("could not create temp file"); }
+    fwrite(buf, 1, len, fp);
+    free(buf);
+
+    ASSERT_EQ(ne_parse_fp(fp, &ctx), NE_OK);
+    ASSERT_EQ(ctx.header.segment_count, 2);
+    ASSERT_EQ(ctx.segments[1].flags, NE_SEG_DATA);
+    ne_free(&ctx);
+    fclose(fp);
+    TEST_PASS();
+}
+
+/* 27 – arena parse: exact sizing, same tables, ne_free only resets */
+static void test_parse_arena(void)
+{
+    static const uint8_t res_names[] = {
+        4, 'T', 'E', 'S', 'T', 0, 0,
+        5, 'A', 'l', 'p', 'h', 'a', 1, 0,
+        4, 'B', 'e', 't', 'a', 2, 0,
+        0
+    };
+    NEParserContext ctx;
+    NEParserContext hdr;
+    NEArena  arena;
+    size_t   len;
+    uint8_t *base = build_ne_image(3, 6, &len);
+    uint8_t *buf;
+    uint32_t size = 0;
+    uint16_t ord = 0;
+
+    ASSERT_NOT_NULL(base);
+    TEST_BEGIN("arena parse uses exactly ne_parse_arena_size bytes");
+
+    buf = (uint8_t *)calloc(1, len + sizeof(res_names));
+    if (!buf) { free(base); TEST_FAIL("out of memory"); }
+    memcpy(buf, base, len);
+    free(base);
+    put_u16(buf + MZ_SIZE, 0x26, (uint16_t)(len - MZ_SIZE));
+    memcpy(buf + len, res_names, sizeof(res_names));
+    len += sizeof(res_names);
+
+    ASSERT_EQ(ne_parse_arena_size(buf, len, &hdr, &size), NE_OK);
+    ASSERT_EQ(hdr.header.segment_count, 3);
+    ASSERT_EQ(hdr.segments == NULL, 1);
+    ASSERT_EQ(ne_arena_init(&arena, size), NE_OK);
+
+    ASSERT_EQ(ne_parse_buffer_arena(buf, len, &ctx, &arena), NE_OK);
+    ASSERT_EQ(arena.used, size);
+    ASSERT_EQ(ctx.arena == &arena, 1);
+    ASSERT_EQ(ctx.segments[1].flags, NE_SEG_DATA);
+    ASSERT_EQ(ctx.entry_size, 6);
+    ASSERT_EQ(ne_name_to_ordinal(&ctx, "Beta", &ord), NE_OK);
+    ASSERT_EQ(ord, 2);
+    ASSERT_EQ(strcmp(ne_module_name(&ctx), "TEST"), 0);
+
+    /* Allocations are aligned and the exhausted arena refuses more */
+    ASSERT_EQ(((uintptr_t)ctx.names.entries) % NE_ARENA_ALIGN, 0);
+    ASSERT_EQ(ne_arena_alloc(&arena, 1) == NULL, 1);
+
+    ne_free(&ctx);
+    ASSERT_EQ(ctx.segments == NULL, 1);
+    ne_arena_free(&arena);
+    ne_arena_free(&arena);    /* second free is harmless */
+
+    ASSERT_EQ(ne_parse_buffer_arena(buf, len, &ctx, &arena),
+              NE_ERR_NULL_ARG);
+    ASSERT_EQ(ne_parse_arena_size(buf, 10, &hdr, &size), NE_ERR_NOT_MZ);
+    free(buf);
+    TEST_PASS();
+}
+
 /* -------------------------------------------------------------------------
  * Main
  * ---------------------------------------------------------------------- */
@@ -604,6 +974,13 @@ int main(void)
     test_segment_align_shift();
     test_flags();
     test_ne_offset_stored();
+    test_image_borrowed_tables();
+    test_image_open_errors();
+    test_module_ref_names();
+    test_name_index();
+    test_stream_parse();
+    test_parse_fp();
+    test_parse_arena();
 
     printf("\n=== Results: %d/%d passed", g_tests_passed, g_tests_run);
     if (g_tests_failed)
@@ -1118,14 +1118,825 @@ static void test_strerror(void)
     ASSERT_NOT_NULL(ne_reloc_strerror(NE_RELOC_ERR_BAD_SEG));
     ASSERT_NOT_NULL(ne_reloc_strerror(NE_RELOC_ERR_UNRESOLVED));
     ASSERT_NOT_NULL(ne_reloc_strerror(NE_RELOC_ERR_ADDR_TYPE));
+    ASSERT_NOT_NULL(ne_reloc_strerror(NE_RELOC_ERR_STALE));
     ASSERT_NOT_NULL(ne_reloc_strerror(-999)); /* unknown */
     TEST_PASS();
 }
 
+/* 23 - Lazy load: fixups for a deferred segment run on materialisation */
+static void test_materialize_applies_relocs(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    NERelocContext  rctx;
+    uint8_t seg1[SEG_CONTENT_LEN];
+    uint8_t recs[1 * 8];
+    uint8_t *buf;
+    int rc;
+
+    TEST_BEGIN("deferred segment is fixed up on materialisation, retried");
+
+    memset(seg1, 0, sizeof(seg1));
+    seg1[0] = 0xFF; seg1[1] = 0xFF;
+    memset(recs, 0, sizeof(recs));
+    encode_reloc(recs, NE_RELOC_ADDR_SEG16, NE_RELOC_TYPE_INTERNAL,
+                 0x0000, 2, 0);
+
+    buf = build_reloc_ne_image(seg1, 0x55, recs, 1);
+    ASSERT_NOT_NULL(buf);
+    /* Drop the entry point so the CODE segment is not needed at load */
+    put_u16(buf + MZ_SIZE, 0x16, 0);
+
+    rc = ne_parse_buffer(buf, TOTAL_FILE_SIZE, &parser);
+    ASSERT_EQ(rc, NE_OK);
+    rc = ne_load_buffer_lazy(buf, TOTAL_FILE_SIZE, &parser, &loader);
+    ASSERT_EQ(rc, NE_LOAD_OK);
+    rc = ne_reloc_parse(buf, TOTAL_FILE_SIZE, &parser, &rctx);
+    ASSERT_EQ(rc, NE_RELOC_OK);
+    ASSERT_NE(loader.segments[0].deferred, 0);
+
+    /* Whole-module apply leaves the deferred segment alone */
+    rc = ne_reloc_apply(&loader, &rctx, &parser, NULL, NULL);
+    ASSERT_EQ(rc, NE_RELOC_OK);
+    ASSERT_EQ(loader.segments[0].data == NULL, 1);
+
+    rc = ne_reloc_materialize(&loader, &rctx, &parser, 0, NULL, NULL);
+    ASSERT_EQ(rc, NE_RELOC_OK);
+    ASSERT_EQ(loader.segments[0].deferred, 0);
+    ASSERT_EQ(loader.segments[0].data[0], 0x02);
+    ASSERT_EQ(loader.segments[0].data[1], 0x00);
+
+    /* Second call must not re-walk the (now overwritten) chain */
+    rc = ne_reloc_materialize(&loader, &rctx, &parser, 0, NULL, NULL);
+    ASSERT_EQ(rc, NE_RELOC_OK);
+    ASSERT_EQ(loader.segments[0].data[0], 0x02);
+
+    ASSERT_EQ(ne_reloc_materialize(&loader, &rctx, &parser, 9, NULL, NULL),
+              NE_RELOC_ERR_BAD_SEG);
+    ASSERT_EQ(ne_reloc_materialize(NULL, &rctx, &parser, 0, NULL, NULL),
+              NE_RELOC_ERR_NULL);
+
+    ne_reloc_free(&rctx);
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+
+    /* A failed fixup leaves the segment deferred, so it can be retried */
+    memset(seg1, 0, sizeof(seg1));
+    seg1[0] = 0xFF; seg1[1] = 0xFF;
+    memset(recs, 0, sizeof(recs));
+    encode_reloc(recs, NE_RELOC_ADDR_FAR32, NE_RELOC_TYPE_IMP_ORD,
+                 0x0000, 1, 7);
+
+    buf = build_reloc_ne_image(seg1, 0x55, recs, 1);
+    ASSERT_NOT_NULL(buf);
+    put_u16(buf + MZ_SIZE, 0x16, 0);
+
+    ASSERT_EQ(ne_parse_buffer(buf, TOTAL_FILE_SIZE, &parser), NE_OK);
+    ASSERT_EQ(ne_load_buffer_lazy(buf, TOTAL_FILE_SIZE, &parser, &loader),
+              NE_LOAD_OK);
+    ASSERT_EQ(ne_reloc_parse(buf, TOTAL_FILE_SIZE, &parser, &rctx),
+              NE_RELOC_OK);
+
+    rc = ne_reloc_materialize(&loader, &rctx, &parser, 0, NULL, NULL);
+    ASSERT_EQ(rc, NE_RELOC_ERR_UNRESOLVED);
+    ASSERT_NE(loader.segments[0].deferred, 0);
+    ASSERT_EQ(loader.segments[0].data == NULL, 1);
+    ASSERT_EQ(loader.image == buf, 1);
+
+    rc = ne_reloc_materialize(&loader, &rctx, &parser, 0,
+                              dummy_resolver, NULL);
+    ASSERT_EQ(rc, NE_RELOC_OK);
+    ASSERT_EQ(loader.segments[0].deferred, 0);
+    ASSERT_EQ(loader.segments[0].data[0], 0x42);
+    ASSERT_EQ(loader.segments[0].data[2], 0x01);
+
+    ne_reloc_free(&rctx);
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 24 - Whole module in one arena: sized exactly, applies like the heap path */
+static void test_arena_module(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    NERelocContext  rctx;
+    NEArena         arena;
+    uint8_t seg1[SEG_CONTENT_LEN];
+    uint8_t recs[2 * 8];
+    uint8_t *buf;
+    uint32_t size;
+    int rc;
+
+    TEST_BEGIN("arena-backed parse/load/reloc uses exactly the sized block");
+
+    memset(seg1, 0, sizeof(seg1));
+    seg1[0] = 0xFF; seg1[1] = 0xFF;
+    seg1[4] = 0xFF; seg1[5] = 0xFF;
+    memset(recs, 0, sizeof(recs));
+    encode_reloc(recs,     NE_RELOC_ADDR_SEG16, NE_RELOC_TYPE_INTERNAL,
+                 0x0000, 2, 0);
+    encode_reloc(recs + 8, NE_RELOC_ADDR_OFF16, NE_RELOC_TYPE_INTERNAL,
+                 0x0004, 2, 0x0010);
+
+    buf = build_reloc_ne_image(seg1, 0x55, recs, 2);
+    ASSERT_NOT_NULL(buf);
+
+    rc = ne_arena_size_for_image(buf, TOTAL_FILE_SIZE, &size);
+    ASSERT_EQ(rc, NE_RELOC_OK);
+    ASSERT_EQ(size > 2u * SEG_CONTENT_LEN, 1);
+    ASSERT_EQ(ne_arena_init(&arena, size), NE_OK);
+
+    ASSERT_EQ(ne_parse_buffer_arena(buf, TOTAL_FILE_SIZE, &parser, &arena),
+              NE_OK);
+    ASSERT_EQ(ne_load_buffer_arena(buf, TOTAL_FILE_SIZE, &parser, &loader,
+                                   &arena), NE_LOAD_OK);
+    ASSERT_EQ(ne_reloc_parse_arena(buf, TOTAL_FILE_SIZE, &parser, &rctx,
+                                   &arena), NE_RELOC_OK);
+    ASSERT_EQ(arena.used, size);
+    ASSERT_EQ(rctx.count, 1);
+    ASSERT_EQ(rctx.tables[0].count, 2);
+
+    rc = ne_reloc_apply(&loader, &rctx, &parser, NULL, NULL);
+    ASSERT_EQ(rc, NE_RELOC_OK);
+    ASSERT_EQ(loader.segments[0].data[0], 0x02);
+    ASSERT_EQ(loader.segments[0].data[4], 0x10);
+    ASSERT_EQ(loader.segments[1].data[0], 0x55);
+
+    /* Per-context frees only reset; the arena releases the memory */
+    ne_reloc_free(&rctx);
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    ASSERT_EQ(loader.segments == NULL, 1);
+    ne_arena_free(&arena);
+    ASSERT_EQ(arena.base == NULL, 1);
+
+    free(buf);
+    TEST_PASS();
+}
+
+/* 25 - Undersized arena fails cleanly with an allocation error */
+static void test_arena_too_small(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    NERelocContext  rctx;
+    NEArena         arena;
+    uint8_t *buf;
+    uint32_t size;
+
+    TEST_BEGIN("undersized arena -> allocation errors, NULL arena rejected");
+
+    buf = build_reloc_ne_image(NULL, 0x00, NULL, 0);
+    ASSERT_NOT_NULL(buf);
+    ASSERT_EQ(ne_parse_arena_size(buf, TOTAL_FILE_SIZE, &parser, &size),
+              NE_OK);
+
+    /* Room for the parser state only: loading must run out */
+    ASSERT_EQ(ne_arena_init(&arena, size), NE_OK);
+    ASSERT_EQ(ne_parse_buffer_arena(buf, TOTAL_FILE_SIZE, &parser, &arena),
+              NE_OK);
+    ASSERT_EQ(ne_load_buffer_arena(buf, TOTAL_FILE_SIZE, &parser, &loader,
+                                   &arena), NE_LOAD_ERR_NOMEM);
+    ASSERT_EQ(loader.segments == NULL, 1);
+    ne_free(&parser);
+    ne_arena_free(&arena);
+
+    ASSERT_EQ(ne_reloc_parse_arena(buf, TOTAL_FILE_SIZE, &parser, &rctx,
+                                   NULL), NE_RELOC_ERR_NULL);
+    ASSERT_EQ(ne_arena_size_for_image(NULL, 0, &size), NE_RELOC_ERR_NULL);
+    ASSERT_EQ(ne_arena_size_for_image(buf, 16, &size), NE_RELOC_ERR_IO);
+
+    free(buf);
+    TEST_PASS();
+}
+
 /* -------------------------------------------------------------------------
  * Main
  * ---------------------------------------------------------------------- */
 
+/*
+ * Mixed record set used by the plan tests: a 2-link SEG16 chain at 0/2,
+ * an additive OFF16 at 4, a FAR32 import at 8 and an OS fixup.
+ */
+static uint8_t *build_plan_image(void)
+{
+    uint8_t seg1[SEG_CONTENT_LEN];
+    uint8_t recs[4 * 8];
+
+    memset(seg1, 0, sizeof(seg1));
+    seg1[0] = 0x02; seg1[1] = 0x00;   /* chain -> offset 2 */
+    seg1[2] = 0xFF; seg1[3] = 0xFF;   /* chain end         */
+    seg1[4] = 0x10; seg1[5] = 0x00;   /* additive base     */
+    seg1[8] = 0xFF; seg1[9] = 0xFF;   /* chain end         */
+
+    encode_reloc(recs,      NE_RELOC_ADDR_SEG16, NE_RELOC_TYPE_INTERNAL,
+                 0x0000, 2, 0);
+    encode_reloc(recs + 8,  NE_RELOC_ADDR_OFF16,
+                 NE_RELOC_TYPE_INTERNAL | NE_RELOC_FLAG_ADDITIVE,
+                 0x0004, 2, 0x0005);
+    encode_reloc(recs + 16, NE_RELOC_ADDR_FAR32, NE_RELOC_TYPE_IMP_ORD,
+                 0x0008, 1, 7);
+    encode_reloc(recs + 24, NE_RELOC_ADDR_SEG16, NE_RELOC_TYPE_OS_FIXUP,
+                 0x000C, 1, 0);
+    return build_reloc_ne_image(seg1, 0x55, recs, 4);
+}
+
+/* 26 - A plan patches exactly what ne_reloc_apply patches */
+static void test_plan_matches_apply(void)
+{
+    NEParserContext parser;
+    NELoaderContext direct;
+    NELoaderContext planned;
+    NERelocContext  rctx;
+    NERelocPlan     plan;
+    uint8_t *buf;
+
+    TEST_BEGIN("plan apply == ne_reloc_apply (chain, additive, import)");
+    buf = build_plan_image();
+    ASSERT_NOT_NULL(buf);
+
+    ASSERT_EQ(parse_and_load(buf, &parser, &direct, &rctx), NE_RELOC_OK);
+    ASSERT_EQ(ne_reloc_apply(&direct, &rctx, &parser, dummy_resolver, NULL),
+              NE_RELOC_OK);
+
+    ASSERT_EQ(ne_reloc_plan_build(buf, TOTAL_FILE_SIZE, &parser, &rctx,
+                                  &plan), NE_RELOC_OK);
+    ASSERT_EQ(plan.count, 1);
+    ASSERT_EQ(plan.patch_count, 4);    /* 2 chain links + additive + FAR32 */
+    ASSERT_EQ(plan.target_count, 3);   /* OS fixup has no target          */
+    ASSERT_EQ(plan.patches[1].offset, 2);
+
+    ASSERT_EQ(ne_load_buffer(buf, TOTAL_FILE_SIZE, &parser, &planned),
+              NE_LOAD_OK);
+    ASSERT_EQ(ne_reloc_plan_apply(&planned, &plan, &parser,
+                                  dummy_resolver, NULL), NE_RELOC_OK);
+    ASSERT_EQ(memcmp(planned.segments[0].data, direct.segments[0].data,
+                     SEG_CONTENT_LEN), 0);
+    ASSERT_EQ(planned.segments[0].data[4], 0x15);
+    ASSERT_EQ(planned.segments[0].data[8], 0x42);
+
+    /* Imports still need a resolver */
+    ne_loader_free(&planned);
+    ASSERT_EQ(ne_load_buffer(buf, TOTAL_FILE_SIZE, &parser, &planned),
+              NE_LOAD_OK);
+    ASSERT_EQ(ne_reloc_plan_apply(&planned, &plan, &parser, NULL, NULL),
+              NE_RELOC_ERR_UNRESOLVED);
+
+    ne_reloc_plan_free(&plan);
+    ASSERT_EQ(plan.patches == NULL, 1);
+    ne_loader_free(&planned);
+    ne_loader_free(&direct);
+    ne_reloc_free(&rctx);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 27 - Bad chains are rejected when the plan is built */
+static void test_plan_bad_chain(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    NERelocContext  rctx;
+    NERelocPlan     plan;
+    uint8_t seg1[SEG_CONTENT_LEN];
+    uint8_t recs[8];
+    uint8_t *buf;
+
+    TEST_BEGIN("plan build rejects cyclic / out-of-range chains");
+    memset(seg1, 0, sizeof(seg1));
+    seg1[0] = 0x02; seg1[1] = 0x00;   /* 0 -> 2 */
+    seg1[2] = 0x00; seg1[3] = 0x00;   /* 2 -> 0 : cycle */
+    encode_reloc(recs, NE_RELOC_ADDR_SEG16, NE_RELOC_TYPE_INTERNAL,
+                 0x0000, 2, 0);
+    buf = build_reloc_ne_image(seg1, 0x55, recs, 1);
+    ASSERT_NOT_NULL(buf);
+
+    ASSERT_EQ(parse_and_load(buf, &parser, &loader, &rctx), NE_RELOC_OK);
+    ASSERT_EQ(ne_reloc_plan_build(buf, TOTAL_FILE_SIZE, &parser, &rctx,
+                                  &plan), NE_RELOC_ERR_BAD_SEG);
+    ASSERT_EQ(plan.segs == NULL, 1);
+
+    /* link past the end of the segment */
+    rctx.tables[0].records[0].target_offset = 0x0040;
+    ASSERT_EQ(ne_reloc_plan_build(buf, TOTAL_FILE_SIZE, &parser, &rctx,
+                                  &plan), NE_RELOC_ERR_BAD_SEG);
+    ASSERT_EQ(ne_reloc_plan_build(NULL, TOTAL_FILE_SIZE, &parser, &rctx,
+                                  &plan), NE_RELOC_ERR_NULL);
+
+    ne_reloc_free(&rctx);
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 28 - A discarded segment reloaded from the file is re-fixed by the plan */
+static void test_plan_apply_segment(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    NERelocContext  rctx;
+    NERelocPlan     plan;
+    uint8_t  copy[SEG_CONTENT_LEN];
+    uint8_t *buf;
+
+    TEST_BEGIN("plan re-fixes a reloaded segment without the chain");
+    buf = build_plan_image();
+    ASSERT_NOT_NULL(buf);
+    ASSERT_EQ(parse_and_load(buf, &parser, &loader, &rctx), NE_RELOC_OK);
+    ASSERT_EQ(ne_reloc_plan_build(buf, TOTAL_FILE_SIZE, &parser, &rctx,
+                                  &plan), NE_RELOC_OK);
+    ASSERT_EQ(ne_reloc_plan_apply(&loader, &plan, &parser,
+                                  dummy_resolver, NULL), NE_RELOC_OK);
+
+    /* Reload the pristine bytes as the segment manager would */
+    memcpy(copy, buf + SEG1_SECTOR * TEST_SECTOR_SIZE, SEG_CONTENT_LEN);
+    ASSERT_EQ(ne_reloc_plan_apply_segment(&plan, 0, copy, SEG_CONTENT_LEN,
+                                          &parser, dummy_resolver, NULL),
+              NE_RELOC_OK);
+    ASSERT_EQ(memcmp(copy, loader.segments[0].data, SEG_CONTENT_LEN), 0);
+
+    /* Segment without fixups: untouched; wrong size: rejected */
+    ASSERT_EQ(ne_reloc_plan_apply_segment(&plan, 1, copy, SEG_CONTENT_LEN,
+                                          &parser, NULL, NULL), NE_RELOC_OK);
+    ASSERT_EQ(ne_reloc_plan_apply_segment(&plan, 0, copy, 8, &parser,
+                                          dummy_resolver, NULL),
+              NE_RELOC_ERR_BAD_SEG);
+
+    ne_reloc_plan_free(&plan);
+    ne_reloc_free(&rctx);
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 29 - Lazy load driven by a plan */
+static void test_plan_materialize(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    NERelocContext  rctx;
+    NERelocPlan     plan;
+    uint8_t *buf;
+
+    TEST_BEGIN("plan materialises and fixes a deferred segment, retries");
+    buf = build_plan_image();
+    ASSERT_NOT_NULL(buf);
+    put_u16(buf + MZ_SIZE, 0x16, 0);   /* no entry point */
+
+    ASSERT_EQ(ne_parse_buffer(buf, TOTAL_FILE_SIZE, &parser), NE_OK);
+    ASSERT_EQ(ne_load_buffer_lazy(buf, TOTAL_FILE_SIZE, &parser, &loader),
+              NE_LOAD_OK);
+    ASSERT_EQ(ne_reloc_parse(buf, TOTAL_FILE_SIZE, &parser, &rctx),
+              NE_RELOC_OK);
+    ASSERT_EQ(ne_reloc_plan_build(buf, TOTAL_FILE_SIZE, &parser, &rctx,
+                                  &plan), NE_RELOC_OK);
+
+    ASSERT_EQ(ne_reloc_plan_apply(&loader, &plan, &parser,
+                                  dummy_resolver, NULL), NE_RELOC_OK);
+    ASSERT_EQ(loader.segments[0].data == NULL, 1);
+
+    /* A failed attempt leaves the segment deferred for the next one */
+    ASSERT_EQ(ne_reloc_plan_materialize(&loader, &plan, &parser, 0,
+                                        NULL, NULL),
+              NE_RELOC_ERR_UNRESOLVED);
+    ASSERT_NE(loader.segments[0].deferred, 0);
+    ASSERT_EQ(loader.segments[0].data == NULL, 1);
+
+    ASSERT_EQ(ne_reloc_plan_materialize(&loader, &plan, &parser, 0,
+                                        dummy_resolver, NULL), NE_RELOC_OK);
+    ASSERT_EQ(loader.segments[0].data[2], 0x02);
+    ASSERT_EQ(loader.segments[0].data[4], 0x15);
+    ASSERT_EQ(loader.segments[0].data[10], 0x01);
+
+    ne_reloc_plan_free(&plan);
+    ne_reloc_free(&rctx);
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* Resolver that counts its calls and otherwise behaves like dummy_resolver */
+static unsigned g_resolver_calls;
+
+static int counting_resolver(uint16_t mod_idx, uint16_t ref2, int by_name,
+                             const uint8_t *imported_names,
+                             uint16_t imp_names_size,
+                             uint16_t *out_seg, uint16_t *out_offset,
+                             void *userdata)
+{
+    g_resolver_calls++;
+    return dummy_resolver(mod_idx, ref2, by_name, imported_names,
+                          imp_names_size, out_seg, out_offset, userdata);
+}
+
+/* Three ADDITIVE OFF16 imports of module 1 ordinal 7 at offsets 0, 2, 4 */
+static uint8_t *build_repeat_import_image(void)
+{
+    uint8_t seg1[SEG_CONTENT_LEN];
+    uint8_t recs[3 * 8];
+    uint16_t k;
+
+    memset(seg1, 0, sizeof(seg1));
+    for (k = 0; k < 3; k++)
+        encode_reloc(recs + k * 8u, NE_RELOC_ADDR_OFF16,
+                     NE_RELOC_TYPE_IMP_ORD | NE_RELOC_FLAG_ADDITIVE,
+                     (uint16_t)(k * 2u), 1, 7);
+    return build_reloc_ne_image(seg1, 0x55, recs, 3);
+}
+
+/* 30 - ne_reloc_apply resolves a repeated import once per call */
+static void test_apply_memoises_imports(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    NERelocContext  rctx;
+    NERelocPlan     plan;
+    uint8_t *buf;
+
+    TEST_BEGIN("repeated import resolved once per apply / plan apply");
+    buf = build_repeat_import_image();
+    ASSERT_NOT_NULL(buf);
+    ASSERT_EQ(parse_and_load(buf, &parser, &loader, &rctx), NE_RELOC_OK);
+
+    g_resolver_calls = 0;
+    ASSERT_EQ(ne_reloc_apply(&loader, &rctx, &parser, counting_resolver,
+                             NULL), NE_RELOC_OK);
+    ASSERT_EQ(g_resolver_calls, 1);
+    ASSERT_EQ(loader.segments[0].data[0], 0x42);
+    ASSERT_EQ(loader.segments[0].data[2], 0x42);
+    ASSERT_EQ(loader.segments[0].data[4], 0x42);
+
+    ASSERT_EQ(ne_reloc_plan_build(buf, TOTAL_FILE_SIZE, &parser, &rctx,
+                                  &plan), NE_RELOC_OK);
+    g_resolver_calls = 0;
+    ASSERT_EQ(ne_reloc_plan_apply(&loader, &plan, &parser,
+                                  counting_resolver, NULL), NE_RELOC_OK);
+    ASSERT_EQ(g_resolver_calls, 1);
+    ASSERT_EQ(loader.segments[0].data[4], 0x84);
+
+    ne_reloc_plan_free(&plan);
+    ne_reloc_free(&rctx);
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 31 - A caller-held memo carries results across calls and counts them */
+static void test_import_memo_persistent(void)
+{
+    NEImportMemo memo;
+    uint16_t     seg = 0, off = 0;
+    int          k;
+
+    TEST_BEGIN("import memo: hits / misses across calls, failures retried");
+    ASSERT_EQ(ne_import_memo_init(&memo, 4, counting_resolver, NULL),
+              NE_RELOC_OK);
+    g_resolver_calls = 0;
+
+    for (k = 0; k < 3; k++) {
+        ASSERT_EQ(ne_import_memo_resolver(1, 7, 0, NULL, 0, &seg, &off,
+                                          &memo), NE_RELOC_OK);
+        ASSERT_EQ(seg, 1);
+        ASSERT_EQ(off, 0x0042);
+    }
+    /* Same ref2 by name is a different key */
+    ASSERT_EQ(ne_import_memo_resolver(1, 7, 1, NULL, 0, &seg, &off, &memo),
+              NE_RELOC_OK);
+    /* Unresolvable imports are not cached */
+    ASSERT_EQ(ne_import_memo_resolver(2, 9, 0, NULL, 0, &seg, &off, &memo),
+              NE_RELOC_ERR_UNRESOLVED);
+    ASSERT_EQ(ne_import_memo_resolver(2, 9, 0, NULL, 0, &seg, &off, &memo),
+              NE_RELOC_ERR_UNRESOLVED);
+
+    ASSERT_EQ(memo.hits, 2);
+    ASSERT_EQ(memo.misses, 4);
+    ASSERT_EQ(memo.count, 2);
+    ASSERT_EQ(g_resolver_calls, 4);
+
+    ne_import_memo_free(&memo);
+    ASSERT_EQ(memo.slots == NULL, 1);
+    ASSERT_EQ(ne_import_memo_init(NULL, 4, counting_resolver, NULL),
+              NE_RELOC_ERR_NULL);
+    ASSERT_EQ(ne_import_memo_init(&memo, 4, NULL, NULL), NE_RELOC_ERR_NULL);
+    TEST_PASS();
+}
+
+/* 32 - Parallel apply patches what the serial apply patches */
+static void test_apply_parallel_matches_serial(void)
+{
+    NEParserContext parser;
+    NELoaderContext serial;
+    NELoaderContext parallel;
+    NERelocContext  rctx;
+    NERelocContext  two;
+    NESegRelocTable tables[2];
+    uint8_t *buf;
+
+    TEST_BEGIN("parallel apply == ne_reloc_apply over two segments");
+    buf = build_repeat_import_image();
+    ASSERT_NOT_NULL(buf);
+    ASSERT_EQ(parse_and_load(buf, &parser, &serial, &rctx), NE_RELOC_OK);
+    ASSERT_EQ(ne_load_buffer(buf, TOTAL_FILE_SIZE, &parser, &parallel),
+              NE_LOAD_OK);
+
+    /* Same additive records against both segments */
+    tables[0] = rctx.tables[0];
+    tables[1] = rctx.tables[0];
+    tables[1].seg_idx = 1;
+    memset(&two, 0, sizeof(two));
+    two.tables = tables;
+    two.count  = 2;
+
+    ASSERT_EQ(ne_reloc_apply(&serial, &two, &parser, dummy_resolver, NULL),
+              NE_RELOC_OK);
+    ASSERT_EQ(ne_reloc_apply_parallel(&parallel, &two, &parser,
+                                      dummy_resolver, NULL, 2), NE_RELOC_OK);
+    ASSERT_EQ(memcmp(parallel.segments[0].data, serial.segments[0].data,
+                     serial.segments[0].alloc_size), 0);
+    ASSERT_EQ(memcmp(parallel.segments[1].data, serial.segments[1].data,
+                     serial.segments[1].alloc_size), 0);
+    ASSERT_EQ(parallel.segments[1].data[0], 0x97);   /* 0x55 + 0x42 */
+
+    /* One worker takes the serial path */
+    ASSERT_EQ(ne_reloc_apply_parallel(&parallel, &two, &parser,
+                                      dummy_resolver, NULL, 1), NE_RELOC_OK);
+    ASSERT_EQ(ne_reloc_apply_parallel(NULL, &two, &parser,
+                                      dummy_resolver, NULL, 2),
+              NE_RELOC_ERR_NULL);
+
+    ne_reloc_free(&rctx);
+    ne_loader_free(&parallel);
+    ne_loader_free(&serial);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 33 - The lowest failing table decides the parallel result */
+static void test_apply_parallel_lowest_error(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    NERelocContext  rctx;
+    NERelocContext  two;
+    NESegRelocTable tables[2];
+    uint8_t *buf;
+    int k;
+
+    TEST_BEGIN("parallel apply reports the lowest failing table");
+    buf = build_repeat_import_image();
+    ASSERT_NOT_NULL(buf);
+    ASSERT_EQ(parse_and_load(buf, &parser, &loader, &rctx), NE_RELOC_OK);
+
+    memset(&two, 0, sizeof(two));
+    two.tables = tables;
+    two.count  = 2;
+
+    /* Without a resolver table 0 fails UNRESOLVED, table 1 BAD_SEG */
+    for (k = 0; k < 16; k++) {
+        tables[0] = rctx.tables[0];
+        tables[1] = rctx.tables[0];
+        tables[1].seg_idx = 9;
+        ASSERT_EQ(ne_reloc_apply_parallel(&loader, &two, &parser, NULL,
+                                          NULL, 2),
+                  NE_RELOC_ERR_UNRESOLVED);
+
+        tables[0].seg_idx = 9;
+        tables[1].seg_idx = 0;
+        ASSERT_EQ(ne_reloc_apply_parallel(&loader, &two, &parser, NULL,
+                                          NULL, 2),
+                  NE_RELOC_ERR_BAD_SEG);
+    }
+
+    ne_reloc_free(&rctx);
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 34 - A saved binding replays imports without the resolver */
+static void test_bind_replay(void)
+{
+    const char *path = "NERLTEST.BND";
+    NEParserContext parser;
+    NELoaderContext first;
+    NELoaderContext again;
+    NERelocContext  rctx;
+    NEBindInfo      bind;
+    NEBindInfo      loaded;
+    uint32_t        stamps[1];
+    uint8_t *buf;
+
+    TEST_BEGIN("bound imports: save, load, replay; stale stamps rejected");
+    buf = build_repeat_import_image();
+    ASSERT_NOT_NULL(buf);
+    ASSERT_EQ(parse_and_load(buf, &parser, &first, &rctx), NE_RELOC_OK);
+
+    stamps[0] = 0x12345678UL;
+    g_resolver_calls = 0;
+    ASSERT_EQ(ne_reloc_bind(&first, &rctx, &parser, counting_resolver, NULL,
+                            stamps, 1, &bind), NE_RELOC_OK);
+    ASSERT_EQ(g_resolver_calls, 1);
+    ASSERT_EQ(bind.count, 1);
+    ASSERT_EQ(bind.imports[0].mod_idx, 1);
+    ASSERT_EQ(bind.imports[0].ref2, 7);
+    ASSERT_EQ(bind.imports[0].offset, 0x0042);
+
+    ASSERT_EQ(ne_bind_save(path, &bind), NE_RELOC_OK);
+    ASSERT_EQ(ne_bind_load(path, &loaded), NE_RELOC_OK);
+    remove(path);
+    ASSERT_EQ(loaded.dep_count, 1);
+    ASSERT_EQ(loaded.dep_stamps[0], 0x12345678UL);
+    ASSERT_EQ(loaded.count, 1);
+    ASSERT_EQ(memcmp(loaded.imports, bind.imports, sizeof(NEBoundImport)),
+              0);
+
+    /* Same dependencies: same bytes, no resolver */
+    ASSERT_EQ(ne_load_buffer(buf, TOTAL_FILE_SIZE, &parser, &again),
+              NE_LOAD_OK);
+    g_resolver_calls = 0;
+    ASSERT_EQ(ne_reloc_apply_bound(&again, &rctx, &parser, &loaded,
+                                   stamps, 1), NE_RELOC_OK);
+    ASSERT_EQ(g_resolver_calls, 0);
+    ASSERT_EQ(memcmp(again.segments[0].data, first.segments[0].data,
+                     first.segments[0].alloc_size), 0);
+
+    /* A changed dependency leaves the segments alone */
+    stamps[0]++;
+    again.segments[0].data[0] = 0xAA;
+    ASSERT_EQ(ne_reloc_apply_bound(&again, &rctx, &parser, &loaded,
+                                   stamps, 1), NE_RELOC_ERR_STALE);
+    ASSERT_EQ(again.segments[0].data[0], 0xAA);
+    ASSERT_EQ(ne_reloc_apply_bound(&again, &rctx, &parser, &loaded,
+                                   NULL, 0), NE_RELOC_ERR_STALE);
+
+    ne_bind_free(&loaded);
+    ASSERT_EQ(ne_bind_load("NOSUCH.BND", &loaded),
+              NE_RELOC_ERR_IO);
+    ASSERT_EQ(loaded.imports == NULL, 1);
+
+    ne_bind_free(&bind);
+    ne_bind_free(&loaded);
+    ne_reloc_free(&rctx);
+    ne_loader_free(&again);
+    ne_loader_free(&first);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 35 - Statistics count records, chains, resolver calls and hot imports */
+static void test_apply_stats(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    NERelocContext  rctx;
+    NERelocStats    st;
+    FILE           *out;
+    uint8_t *buf;
+
+    TEST_BEGIN("apply stats: per-type counts, chains, hot imports, print");
+    buf = build_plan_image();
+    ASSERT_NOT_NULL(buf);
+    ASSERT_EQ(parse_and_load(buf, &parser, &loader, &rctx), NE_RELOC_OK);
+
+    ASSERT_EQ(ne_reloc_apply_stats(&loader, &rctx, &parser, dummy_resolver,
+                                   NULL, &st), NE_RELOC_OK);
+    ASSERT_EQ(st.records[NE_RELOC_TYPE_INTERNAL], 2);
+    ASSERT_EQ(st.records[NE_RELOC_TYPE_IMP_ORD], 1);
+    ASSERT_EQ(st.records[NE_RELOC_TYPE_IMP_NAME], 0);
+    ASSERT_EQ(st.records[NE_RELOC_TYPE_OS_FIXUP], 1);
+    ASSERT_EQ(st.patched, 4);          /* 2 chain links + additive + FAR32 */
+    ASSERT_EQ(st.chains, 2);
+    ASSERT_EQ(st.longest_chain, 2);
+    ASSERT_EQ(st.resolver_calls, 1);
+    ASSERT_EQ(st.hot_count, 1);
+    ASSERT_EQ(st.hot[0].mod_idx, 1);
+    ASSERT_EQ(st.hot[0].ref2, 7);
+
+    out = tmpfile();
+    ASSERT_NOT_NULL(out);
+    ne_reloc_print_stats(&st, out);
+    ASSERT_EQ(ftell(out) > 0, 1);
+    fclose(out);
+    ne_reloc_print_stats(NULL, stdout);   /* no-op */
+
+    ne_reloc_free(&rctx);
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+
+    /* Three records of one import: one hot entry, memo answers twice */
+    buf = build_repeat_import_image();
+    ASSERT_NOT_NULL(buf);
+    ASSERT_EQ(parse_and_load(buf, &parser, &loader, &rctx), NE_RELOC_OK);
+    ASSERT_EQ(ne_reloc_apply_stats(&loader, &rctx, &parser, dummy_resolver,
+                                   NULL, &st), NE_RELOC_OK);
+    ASSERT_EQ(st.resolver_calls, 1);
+    ASSERT_EQ(st.memo_hits, 2);
+    ASSERT_EQ(st.chains, 0);
+    ASSERT_EQ(st.hot_count, 1);
+    ASSERT_EQ(st.hot[0].records, 3);
+    ASSERT_EQ(st.hot[0].patches, 3);
+
+    /* Without a stats block it is plain ne_reloc_apply */
+    ASSERT_EQ(ne_reloc_apply_stats(&loader, &rctx, &parser, NULL, NULL,
+                                   NULL), NE_RELOC_ERR_UNRESOLVED);
+
+    ne_reloc_free(&rctx);
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* read_at over an in-memory file, counting calls */
+typedef struct {
+    const uint8_t *buf;
+    size_t         len;
+    unsigned       calls;
+} StreamReader;
+
+static size_t stream_read_at(void *user, uint32_t offset, void *dst, size_t n)
+{
+    StreamReader *r = (StreamReader *)user;
+
+    r->calls++;
+    if (offset > r->len || n > r->len - offset)
+        return 0;
+    memcpy(dst, r->buf + offset, n);
+    return n;
+}
+
+/* 36 - Streamed load: relocation blocks come from the loader's reads */
+static void test_parse_stream(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    NERelocContext  rctx;
+    StreamReader    rd;
+    uint8_t seg[SEG_CONTENT_LEN];
+    uint8_t recs[8];
+    uint8_t *buf;
+
+    TEST_BEGIN("stream parse reuses reloc blocks read by ne_load_stream");
+    memset(seg, 0, sizeof(seg));
+    seg[0] = 0xFF;   /* the chain ends at its first target */
+    seg[1] = 0xFF;
+    encode_reloc(recs, NE_RELOC_ADDR_SEG16, NE_RELOC_TYPE_INTERNAL,
+                 0x0000, 2, 0);
+    buf = build_reloc_ne_image(seg, 0x55, recs, 1);
+    ASSERT_NOT_NULL(buf);
+    ASSERT_EQ(ne_parse_buffer(buf, TOTAL_FILE_SIZE, &parser), NE_OK);
+
+    memset(&rd, 0, sizeof(rd));
+    rd.buf = buf;
+    rd.len = TOTAL_FILE_SIZE;
+    ASSERT_EQ(ne_load_stream(stream_read_at, &rd, TOTAL_FILE_SIZE, &parser,
+                             &loader), NE_LOAD_OK);
+    ASSERT_EQ(rd.calls, 1u);
+    ASSERT_NOT_NULL(loader.segments[0].relocs);
+    ASSERT_EQ(loader.segments[0].reloc_size, 10u);
+
+    /* The block sat between the two segments: no further reads */
+    ASSERT_EQ(ne_reloc_parse_stream(stream_read_at, &rd, TOTAL_FILE_SIZE,
+                                    &parser, &loader, &rctx), NE_RELOC_OK);
+    ASSERT_EQ(rd.calls, 1u);
+    ASSERT_EQ(rctx.count, 1);
+    ASSERT_EQ(rctx.tables[0].records[0].ref1, 2);
+    ASSERT_EQ(ne_reloc_apply(&loader, &rctx, &parser, NULL, NULL),
+              NE_RELOC_OK);
+    ASSERT_EQ(loader.segments[0].data[0], 0x02);
+    ne_reloc_free(&rctx);
+
+    /* Without the loader's copy the block is read: count, then records */
+    ASSERT_EQ(ne_reloc_parse_stream(stream_read_at, &rd, TOTAL_FILE_SIZE,
+                                    &parser, NULL, &rctx), NE_RELOC_OK);
+    ASSERT_EQ(rd.calls, 3u);
+    ASSERT_EQ(rctx.tables[0].count, 1);
+    ASSERT_EQ(rctx.tables[0].records[0].ref1, 2);
+    ne_reloc_free(&rctx);
+
+    ASSERT_EQ(ne_reloc_parse_stream(stream_read_at, &rd, RELOC_BLOCK_OFF + 4u,
+                                    &parser, NULL, &rctx), NE_RELOC_ERR_IO);
+    ASSERT_EQ(rctx.tables, NULL);
+
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
 int main(void)
 {
     printf("=== NE Relocation Management Tests ===\n\n");
@@ -1152,6 +1963,20 @@ int main(void)
     test_apply_internal_ptr32();
     test_free_safe();
     test_strerror();
+    test_materialize_applies_relocs();
+    test_arena_module();
+    test_arena_too_small();
+    test_plan_matches_apply();
+    test_plan_bad_chain();
+    test_plan_apply_segment();
+    test_plan_materialize();
+    test_apply_memoises_imports();
+    test_import_memo_persistent();
+    test_apply_parallel_matches_serial();
+    test_apply_parallel_lowest_error();
+    test_bind_replay();
+    test_apply_stats();
+    test_parse_stream();
 
     printf("\n=== Results: %d/%d passed", g_tests_passed, g_tests_run);
     if (g_tests_failed)
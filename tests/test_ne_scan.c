@@ -0,0 +1,391 @@
+/*
+ * test_ne_scan.c - Tests for the batch NE directory scanner
+ *
+ * Builds a small directory tree in the current directory containing NE
+ * images, a non-NE file with an NE extension and an unrelated file, then
+ * checks the scan index, the per-file summaries and the CSV output.
+ *
+ * Build with:
+ *   wcc -ml -za99 -wx -d2 -i=../src ../src/ne_scan.c ... test_ne_scan.c
+ *   wlink system dos name test_ne_scan.exe file test_ne_scan.obj,...
+ */
+
+#include "../src/ne_parser.h"
+#include "../src/ne_scan.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef __WATCOMC__
+#include <direct.h>
+#define MAKE_DIR(p)  mkdir(p)
+#define SEP          "\\"
+#else
+#include <unistd.h>
+#define MAKE_DIR(p)  mkdir((p), 0755)
+#define SEP          "/"
+#endif
+
+/* -------------------------------------------------------------------------
+ * Minimal test framework (mirrors test_ne_parser.c)
+ * ---------------------------------------------------------------------- */
+
+static int g_tests_run    = 0;
+static int g_tests_passed = 0;
+static int g_tests_failed = 0;
+
+#define TEST_BEGIN(name) \
+    do { \
+        g_tests_run++; \
+        printf("  %-60s ", (name)); \
+        fflush(stdout); \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        g_tests_passed++; \
+        printf("PASS\n"); \
+    } while (0)
+
+#define TEST_FAIL(msg) \
+    do { \
+        g_tests_failed++; \
+        printf("FAIL \xe2\x80\x93 %s (line %d)\n", (msg), __LINE__); \
+        return; \
+    } while (0)
+
+#define ASSERT_EQ(a, b) \
+    do { \
+        if ((a) != (b)) { \
+            g_tests_failed++; \
+            printf("FAIL \xe2\x80\x93 expected %ld got %ld (line %d)\n", \
+                   (long)(b), (long)(a), __LINE__); \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_NE(a, b) \
+    do { \
+        if ((a) == (b)) { \
+            g_tests_failed++; \
+            printf("FAIL \xe2\x80\x93 unexpected equal value %ld (line %d)\n", \
+                   (long)(a), __LINE__); \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_NOT_NULL(p) \
+    do { \
+        if ((p) == NULL) { \
+            g_tests_failed++; \
+            printf("FAIL \xe2\x80\x93 unexpected NULL pointer (line %d)\n", __LINE__); \
+            return; \
+        } \
+    } while (0)
+
+/* -------------------------------------------------------------------------
+ * Fixture helpers
+ * ---------------------------------------------------------------------- */
+
+#define MZ_SIZE   64u
+#define ROOT      "NESCANT"
+#define SUBDIR    ROOT SEP "SUB"
+#define FILE_A    ROOT SEP "APP.EXE"
+#define FILE_B    SUBDIR SEP "lib.dll"
+#define FILE_C    ROOT SEP "BAD.DRV"
+#define FILE_D    ROOT SEP "README.TXT"
+
+static void put_u16(uint8_t *buf, size_t off, uint16_t v)
+{
+    buf[off]     = (uint8_t)(v & 0xFF);
+    buf[off + 1] = (uint8_t)((v >> 8) & 0xFF);
+}
+
+static void put_u32(uint8_t *buf, size_t off, uint32_t v)
+{
+    buf[off]     = (uint8_t)(v & 0xFF);
+    buf[off + 1] = (uint8_t)((v >>  8) & 0xFF);
+    buf[off + 2] = (uint8_t)((v >> 16) & 0xFF);
+    buf[off + 3] = (uint8_t)((v >> 24) & 0xFF);
+}
+
+static int write_bytes(const char *path, const uint8_t *data, size_t len)
+{
+    FILE  *fp = fopen(path, "wb");
+    size_t n;
+
+    if (!fp)
+        return -1;
+    n = fwrite(data, 1, len, fp);
+    fclose(fp);
+    return (n == len) ? 0 : -1;
+}
+
+/*
+ * write_module - write an NE image named 'mod' that imports KERNEL and
+ * exports FOO (ordinal 1).  Layout relative to the NE header:
+ *   0x40 segment table (1 BSS segment)
+ *   0x48 resident names: mod (0), FOO (1), terminator
+ *   ...  module-ref table (1 entry), imported names, entry table
+ */
+static int write_module(const char *path, const char *mod)
+{
+    uint8_t  buf[256];
+    uint8_t *ne = buf + MZ_SIZE;
+    uint16_t rel;
+    uint16_t modref_rel;
+    uint16_t imp_rel;
+    size_t   n = strlen(mod);
+
+    memset(buf, 0, sizeof(buf));
+    put_u16(buf, 0x00, MZ_MAGIC);
+    put_u32(buf, 0x3C, MZ_SIZE);
+    put_u16(ne, 0x00, NE_MAGIC);
+    ne[0x02] = 5;
+    put_u16(ne, 0x1C, 1);            /* segment_count     */
+    put_u16(ne, 0x22, 0x40);         /* segment table     */
+    put_u16(ne, 0x32, 4);            /* align_shift       */
+    ne[0x36] = NE_OS_WINDOWS;
+    put_u16(ne, 0x40 + 6, 0x100);    /* min_alloc; no file data */
+
+    /* Resident names */
+    rel = 0x48;
+    put_u16(ne, 0x24, rel);          /* resource table (empty) */
+    put_u16(ne, 0x26, rel);
+    ne[rel++] = (uint8_t)n;
+    memcpy(ne + rel, mod, n);
+    rel = (uint16_t)(rel + n + 2u);  /* ordinal 0 */
+    ne[rel++] = 3;
+    memcpy(ne + rel, "FOO", 3);
+    rel += 3;
+    put_u16(ne, rel, 1);             /* ordinal 1 */
+    rel += 2;
+    ne[rel++] = 0;                   /* terminator */
+
+    /* Module-ref table and imported names */
+    modref_rel = rel;
+    imp_rel    = (uint16_t)(rel + 2u);
+    put_u16(ne, 0x1E, 1);
+    put_u16(ne, 0x28, modref_rel);
+    put_u16(ne, 0x2A, imp_rel);
+    put_u16(ne, modref_rel, 1);
+    rel = imp_rel;
+    ne[rel++] = 0;
+    ne[rel++] = 6;
+    memcpy(ne + rel, "KERNEL", 6);
+    rel += 6;
+
+    /* Entry table: one fixed bundle with one entry in segment 1 */
+    put_u16(ne, 0x04, rel);
+    put_u16(ne, 0x06, 6);
+    ne[rel++] = 1;
+    ne[rel++] = 1;
+    ne[rel++] = 0x01;
+    put_u16(ne, rel, 0x0010);
+    rel += 2;
+    ne[rel++] = 0;
+
+    return write_bytes(path, buf, MZ_SIZE + rel);
+}
+
+static int make_tree(void)
+{
+    static const uint8_t junk[] = "not an NE file at all, just text";
+
+    MAKE_DIR(ROOT);
+    MAKE_DIR(SUBDIR);
+    if (write_module(FILE_A, "APP") != 0) return -1;
+    if (write_module(FILE_B, "LIB") != 0) return -1;
+    if (write_bytes(FILE_C, junk, sizeof(junk)) != 0) return -1;
+    if (write_bytes(FILE_D, junk, sizeof(junk)) != 0) return -1;
+    return 0;
+}
+
+static void remove_tree(void)
+{
+    remove(FILE_A);
+    remove(FILE_B);
+    remove(FILE_C);
+    remove(FILE_D);
+    rmdir(SUBDIR);
+    rmdir(ROOT);
+}
+
+/* -------------------------------------------------------------------------
+ * Tests
+ * ---------------------------------------------------------------------- */
+
+/* 1 – a single file is summarised */
+static void test_scan_file(void)
+{
+    NEScanRecord rec;
+
+    TEST_BEGIN("ne_scan_file reports module, imports and exports");
+    ASSERT_EQ(make_tree(), 0);
+    memset(&rec, 0, sizeof(rec));
+    strcpy(rec.path, FILE_A);
+
+    ASSERT_EQ(ne_scan_file(&rec), NE_OK);
+    ASSERT_EQ(rec.status, NE_OK);
+    ASSERT_EQ(strcmp(rec.module, "APP"), 0);
+    ASSERT_EQ(rec.segment_count, 1);
+    ASSERT_EQ(rec.import_count, 1);
+    ASSERT_EQ(rec.export_count, 1);
+    ASSERT_NOT_NULL(rec.imports);
+    ASSERT_EQ(strcmp(rec.imports, "KERNEL"), 0);
+    ASSERT_NOT_NULL(rec.exports);
+    ASSERT_EQ(strcmp(rec.exports, "1=FOO"), 0);
+    ne_scan_record_free(&rec);
+    ASSERT_EQ(rec.imports == NULL, 1);
+
+    /* A file with an NE extension that is not NE */
+    memset(&rec, 0, sizeof(rec));
+    strcpy(rec.path, FILE_C);
+    ASSERT_NE(ne_scan_file(&rec), NE_OK);
+    ASSERT_EQ(rec.imports == NULL, 1);
+    remove_tree();
+    TEST_PASS();
+}
+
+/* 2 – directory scan, serial and parallel give the same sorted index */
+static void test_scan_dir(void)
+{
+    NEScanIndex serial;
+    NEScanIndex par;
+    uint32_t    i;
+
+    TEST_BEGIN("ne_scan_dir walks tree; 1 and 4 workers agree");
+    ASSERT_EQ(make_tree(), 0);
+
+    ASSERT_EQ(ne_scan_dir(ROOT, 1, &serial), NE_SCAN_OK);
+    ASSERT_EQ(serial.count, 3);       /* README.TXT is not a candidate */
+    ASSERT_EQ(serial.parsed, 2);
+    ASSERT_EQ(serial.failed, 1);
+
+    ASSERT_EQ(ne_scan_dir(ROOT, 4, &par), NE_SCAN_OK);
+    ASSERT_EQ(par.count, serial.count);
+    for (i = 0; i < serial.count; i++) {
+        ASSERT_EQ(strcmp(serial.records[i].path, par.records[i].path), 0);
+        ASSERT_EQ(serial.records[i].status, par.records[i].status);
+        ASSERT_EQ(strcmp(serial.records[i].module,
+                         par.records[i].module), 0);
+    }
+
+    /* Sorted by path: APP.EXE < BAD.DRV < SUB/lib.dll */
+    ASSERT_EQ(strcmp(serial.records[0].path, FILE_A), 0);
+    ASSERT_EQ(strcmp(serial.records[2].path, FILE_B), 0);
+    ASSERT_EQ(strcmp(serial.records[2].module, "LIB"), 0);
+
+    ne_scan_free(&serial);
+    ne_scan_free(&par);
+    remove_tree();
+    TEST_PASS();
+}
+
+/* 3 – CSV output */
+static void test_scan_csv(void)
+{
+    NEScanIndex  idx;
+    NEScanRecord rec;
+    FILE        *fp;
+    char         line[512];
+    int          lines = 0;
+
+    TEST_BEGIN("ne_scan_write_csv: header, a row per file, quoted breaks");
+    ASSERT_EQ(make_tree(), 0);
+    ASSERT_EQ(ne_scan_dir(ROOT, 2, &idx), NE_SCAN_OK);
+
+    fp = tmpfile();
+    ASSERT_NOT_NULL(fp);
+    ASSERT_EQ(ne_scan_write_csv(&idx, fp), NE_SCAN_OK);
+    rewind(fp);
+
+    ASSERT_NOT_NULL(fgets(line, sizeof(line), fp));
+    ASSERT_EQ(strcmp(line, "path,status,module,segments,imports,exports\n"),
+              0);
+    ASSERT_NOT_NULL(fgets(line, sizeof(line), fp));
+    ASSERT_NOT_NULL(strstr(line, ",0,APP,1,KERNEL,1=FOO"));
+    lines = 2;
+    while (fgets(line, sizeof(line), fp))
+        lines++;
+    ASSERT_EQ(lines, 4);
+    fclose(fp);
+
+    ne_scan_free(&idx);
+    remove_tree();
+
+    /* Line breaks inside a field are quoted like separators */
+    memset(&rec, 0, sizeof(rec));
+    strcpy(rec.path, "A.DLL");
+    strcpy(rec.module, "TWO\nLINES");
+    rec.exports = (char *)"1=X\r";
+    memset(&idx, 0, sizeof(idx));
+    idx.records = &rec;
+    idx.count   = 1;
+
+    fp = tmpfile();
+    ASSERT_NOT_NULL(fp);
+    ASSERT_EQ(ne_scan_write_csv(&idx, fp), NE_SCAN_OK);
+    rewind(fp);
+    ASSERT_NOT_NULL(fgets(line, sizeof(line), fp));
+    ASSERT_NOT_NULL(fgets(line, sizeof(line), fp));
+    ASSERT_EQ(strcmp(line, "A.DLL,0,\"TWO\n"), 0);
+    ASSERT_NOT_NULL(fgets(line, sizeof(line), fp));
+    ASSERT_EQ(strcmp(line, "LINES\",0,,\"1=X\r\"\n"), 0);
+    fclose(fp);
+    TEST_PASS();
+}
+
+/* 4 – error paths */
+static void test_scan_errors(void)
+{
+    NEScanIndex idx;
+
+    TEST_BEGIN("missing root and NULL arguments are rejected");
+    ASSERT_EQ(ne_scan_dir("NXSCANDIR", 1, &idx), NE_SCAN_ERR_IO);
+    ASSERT_EQ(idx.records == NULL, 1);
+    ASSERT_EQ(ne_scan_dir(NULL, 1, &idx), NE_SCAN_ERR_NULL);
+    ASSERT_EQ(ne_scan_dir(ROOT, 1, NULL), NE_SCAN_ERR_NULL);
+    ASSERT_EQ(ne_scan_write_csv(NULL, stdout), NE_SCAN_ERR_NULL);
+    ASSERT_EQ(ne_scan_file(NULL), NE_ERR_NULL_ARG);
+    ne_scan_free(NULL);
+    TEST_PASS();
+}
+
+/* 5 – strerror */
+static void test_scan_strerror(void)
+{
+    TEST_BEGIN("ne_scan_strerror returns non-NULL for all codes");
+    ASSERT_NOT_NULL(ne_scan_strerror(NE_SCAN_OK));
+    ASSERT_NOT_NULL(ne_scan_strerror(NE_SCAN_ERR_NULL));
+    ASSERT_NOT_NULL(ne_scan_strerror(NE_SCAN_ERR_ALLOC));
+    ASSERT_NOT_NULL(ne_scan_strerror(NE_SCAN_ERR_IO));
+    ASSERT_NOT_NULL(ne_scan_strerror(NE_SCAN_ERR_THREAD));
+    ASSERT_NOT_NULL(ne_scan_strerror(-999));
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------
+ * Main
+ * ---------------------------------------------------------------------- */
+
+int main(void)
+{
+    printf("=== NE Directory Scanner Tests ===\n\n");
+
+    test_scan_file();
+    test_scan_dir();
+    test_scan_csv();
+    test_scan_errors();
+    test_scan_strerror();
+
+    printf("\n=== Results: %d/%d passed", g_tests_passed, g_tests_run);
+    if (g_tests_failed)
+        printf(", %d FAILED", g_tests_failed);
+    printf(" ===\n");
+
+    return (g_tests_failed == 0) ? 0 : 1;
+}
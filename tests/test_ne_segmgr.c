@@ -391,6 +391,104 @@ static void test_segmgr_reload_io_out_of_bounds(void)
     TEST_PASS();
 }
 
+/* =========================================================================
+ * Deferred (load-on-first-lock) tests
+ * ===================================================================== */
+
+static int g_fixup_calls;
+
+static int count_fixup(NESegHandle handle, uint8_t *data,
+                       uint32_t alloc_size, void *userdata)
+{
+    (void)handle;
+    (void)userdata;
+    g_fixup_calls++;
+    if (data && alloc_size > 0)
+        data[0] = 0x5A;   /* simulate a relocation patch */
+    return 0;
+}
+
+static int failing_fixup(NESegHandle handle, uint8_t *data,
+                         uint32_t alloc_size, void *userdata)
+{
+    (void)handle; (void)data; (void)alloc_size; (void)userdata;
+    return -1;
+}
+
+static void test_segmgr_deferred_lock(void)
+{
+    static const uint8_t fake_file[12] = {
+        0,0,0,0,
+        0x10,0x20,0x30,0x40,0x50,0x60,0x70,0x80
+    };
+    NESegMgrContext ctx;
+    NESegHandle     h;
+    NESegEntry     *e;
+    uint8_t        *p;
+
+    TEST_BEGIN("deferred segment loads and runs fixup on first lock");
+    ne_segmgr_init(&ctx, 8, fake_file, sizeof(fake_file));
+    ASSERT_EQ(ne_segmgr_set_fixup(&ctx, count_fixup, NULL), NE_SEGMGR_OK);
+    g_fixup_calls = 0;
+
+    h = ne_segmgr_add_deferred(&ctx, NE_SEG_DISCARDABLE, 32, 4, 8);
+    ASSERT_NE(h, NE_SEGMGR_HANDLE_INVALID);
+    e = ne_segmgr_find(&ctx, h);
+    ASSERT_NOT_NULL(e);
+    ASSERT_EQ(e->data == NULL, 1);
+    ASSERT_EQ((int)(e->state & NE_SEG_STATE_DEFERRED),
+              (int)NE_SEG_STATE_DEFERRED);
+    ASSERT_EQ((int)(e->state & NE_SEG_STATE_LOADED), 0);
+
+    /* Evicting a never-loaded segment is a no-op */
+    ASSERT_EQ(ne_segmgr_evict(&ctx, h), NE_SEGMGR_OK);
+    ASSERT_EQ(g_fixup_calls, 0);
+
+    p = (uint8_t *)ne_segmgr_lock(&ctx, h);
+    ASSERT_NOT_NULL(p);
+    ASSERT_EQ(g_fixup_calls, 1);
+    ASSERT_EQ((int)e->alloc_size, 32);
+    ASSERT_EQ(p[0], 0x5A);    /* patched by the fixup hook */
+    ASSERT_EQ(p[1], 0x20);
+    ASSERT_EQ(p[7], 0x80);
+    ASSERT_EQ(p[31], 0x00);   /* tail beyond file data is zero-filled */
+    ASSERT_EQ((int)(e->state & NE_SEG_STATE_DEFERRED), 0);
+    ASSERT_EQ(e->lock_count, 1);
+
+    /* Second lock does not reload */
+    ASSERT_EQ(ne_segmgr_lock(&ctx, h) == p, 1);
+    ASSERT_EQ(g_fixup_calls, 1);
+    ne_segmgr_free(&ctx);
+    TEST_PASS();
+}
+
+static void test_segmgr_deferred_fixup_fails(void)
+{
+    static const uint8_t fake_file[8] = { 1,2,3,4,5,6,7,8 };
+    NESegMgrContext ctx;
+    NESegHandle     h;
+    NESegEntry     *e;
+
+    TEST_BEGIN("failed fixup leaves deferred segment unloaded");
+    ne_segmgr_init(&ctx, 8, fake_file, sizeof(fake_file));
+    ne_segmgr_set_fixup(&ctx, failing_fixup, NULL);
+
+    h = ne_segmgr_add_deferred(&ctx, 0, 8, 0, 8);
+    ASSERT_NE(h, NE_SEGMGR_HANDLE_INVALID);
+    ASSERT_EQ(ne_segmgr_lock(&ctx, h) == NULL, 1);
+    ASSERT_EQ(ne_segmgr_reload(&ctx, h), NE_SEGMGR_ERR_FIXUP);
+
+    e = ne_segmgr_find(&ctx, h);
+    ASSERT_NOT_NULL(e);
+    ASSERT_EQ(e->data == NULL, 1);
+    ASSERT_EQ(e->lock_count, 0);
+    ASSERT_EQ((int)(e->state & NE_SEG_STATE_DEFERRED),
+              (int)NE_SEG_STATE_DEFERRED);
+    ASSERT_EQ(ne_segmgr_set_fixup(NULL, NULL, NULL), NE_SEGMGR_ERR_NULL);
+    ne_segmgr_free(&ctx);
+    TEST_PASS();
+}
+
 /* =========================================================================
  * Lock / unlock tests
  * ===================================================================== */
@@ -629,6 +727,10 @@ int main(void)
     test_segmgr_reload_no_file();
     test_segmgr_reload_io_out_of_bounds();
 
+    printf("\n--- Deferred segment tests ---\n");
+    test_segmgr_deferred_lock();
+    test_segmgr_deferred_fixup_fails();
+
     printf("\n--- Lock / unlock tests ---\n");
     test_segmgr_lock_unlock();
     test_segmgr_lock_evicted();
@@ -620,7 +620,8 @@ static void test_gmem_table_init_free(void)
     ASSERT_NOT_NULL(tbl.blocks);
     ASSERT_EQ(tbl.capacity,    (uint16_t)NE_GMEM_TABLE_CAP);
     ASSERT_EQ(tbl.count,       (uint16_t)0);
-    ASSERT_EQ(tbl.next_handle, (uint16_t)1);
+    ASSERT_EQ(tbl.free_head,   (uint16_t)0);
+    ASSERT_EQ(tbl.index_bits,  (uint16_t)8);  /* 128 needs 8 bits */
 
     ne_gmem_table_free(&tbl);
     ASSERT_NULL(tbl.blocks);
@@ -752,6 +753,434 @@ static void test_gmem_free_bad_handle(void)
     TEST_PASS();
 }
 
+static void test_gmem_stale_handle(void)
+{
+    NEGMemTable  tbl;
+    NEGMemHandle h1, h2;
+
+    TEST_BEGIN("gmem handle goes stale once its slot is reused");
+
+    ASSERT_EQ(ne_gmem_table_init(&tbl, 4), NE_MEM_OK);
+    h1 = ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 16u, 0u);
+    ASSERT_EQ((long long)h1, 1LL);              /* slot 0, generation 0 */
+    ASSERT_EQ(ne_gmem_free(&tbl, h1), NE_MEM_OK);
+
+    /* The freed slot is reused with the next generation */
+    h2 = ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 32u, 0u);
+    ASSERT_NE((long long)h2, (long long)NE_GMEM_HANDLE_INVALID);
+    ASSERT_NE((long long)h2, (long long)h1);
+    ASSERT_EQ(h2 & 7u, h1 & 7u);
+
+    ASSERT_NULL(ne_gmem_lock(&tbl, h1));
+    ASSERT_EQ(ne_gmem_unlock(&tbl, h1), NE_MEM_ERR_NOT_FOUND);
+    ASSERT_EQ(ne_gmem_free(&tbl, h1), NE_MEM_ERR_NOT_FOUND);
+    ASSERT_EQ(ne_gmem_size(&tbl, h1), (uint32_t)0);
+    ASSERT_EQ(ne_gmem_size(&tbl, h2), (uint32_t)32);
+    ASSERT_EQ(tbl.count, (uint16_t)1);
+
+    ne_gmem_table_free(&tbl);
+    TEST_PASS();
+}
+
+static void test_gmem_free_list(void)
+{
+    NEGMemTable  tbl;
+    NEGMemHandle h[8];
+    NEGMemHandle again;
+    uint16_t     i;
+
+    TEST_BEGIN("gmem free list refills freed slots until the table is full");
+
+    ASSERT_EQ(ne_gmem_table_init(&tbl, 8), NE_MEM_OK);
+    for (i = 0; i < 8u; i++) {
+        h[i] = ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 8u, (uint16_t)(1u + (i & 1u)));
+        ASSERT_NE((long long)h[i], (long long)NE_GMEM_HANDLE_INVALID);
+    }
+    ASSERT_EQ((long long)ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 8u, 0u),
+              (long long)NE_GMEM_HANDLE_INVALID);
+
+    /* Freeing by owner returns four slots to the list */
+    ASSERT_EQ(ne_gmem_free_by_owner(&tbl, 2u), (uint16_t)4);
+    ASSERT_EQ(ne_gmem_free(&tbl, h[4]), NE_MEM_OK);
+    for (i = 0; i < 5u; i++) {
+        again = ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 8u, 0u);
+        ASSERT_NE((long long)again, (long long)NE_GMEM_HANDLE_INVALID);
+        ASSERT_NOT_NULL(ne_gmem_find_block(&tbl, again));
+    }
+    ASSERT_EQ(tbl.count, (uint16_t)8);
+    ASSERT_EQ((long long)ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 8u, 0u),
+              (long long)NE_GMEM_HANDLE_INVALID);
+
+    /* Survivors are untouched, and old handles of reused slots are stale */
+    ASSERT_EQ(ne_gmem_size(&tbl, h[0]), (uint32_t)8);
+    ASSERT_NULL(ne_gmem_find_block(&tbl, h[1]));
+    ASSERT_NULL(ne_gmem_find_block(&tbl, h[4]));
+
+    ne_gmem_table_free(&tbl);
+    TEST_PASS();
+}
+
+/* =========================================================================
+ * GMEM pool
+ * ===================================================================== */
+
+static void test_gmem_pool_classes(void)
+{
+    NEGMemTable      tbl;
+    NEGMemPoolStats  st;
+    NEGMemHandle     h[40];
+    NEGMemHandle     big;
+    uint8_t         *p;
+    uint8_t         *q;
+    uint16_t         i;
+
+    TEST_BEGIN("gmem pool serves small blocks by class, large pass through");
+
+    ASSERT_EQ(ne_gmem_table_init(&tbl, 64), NE_MEM_OK);
+
+    /* 40 x 100 bytes -> 128-byte class, 31 blocks per 4 KB chunk */
+    for (i = 0; i < 40u; i++) {
+        h[i] = ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 100u, 0u);
+        ASSERT_NE((long long)h[i], (long long)NE_GMEM_HANDLE_INVALID);
+        p = (uint8_t *)ne_gmem_lock(&tbl, h[i]);
+        ASSERT_NOT_NULL(p);
+        memset(p, (int)i, 100u);
+        ne_gmem_unlock(&tbl, h[i]);
+    }
+    big = ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 2000u, 0u);
+    ASSERT_NE((long long)big, (long long)NE_GMEM_HANDLE_INVALID);
+
+    ASSERT_EQ(ne_gmem_pool_stats(&tbl, &st), NE_MEM_OK);
+    ASSERT_EQ(st.classes[3].block_size, (uint16_t)128);
+    ASSERT_EQ(st.classes[3].allocs, (uint32_t)40);
+    ASSERT_EQ(st.classes[3].chunks, (uint32_t)2);
+    ASSERT_EQ(st.classes[3].hits,   (uint32_t)38);
+    ASSERT_EQ(st.classes[3].live,   (uint16_t)40);
+    ASSERT_EQ(st.large.allocs, (uint32_t)1);
+    ASSERT_EQ(st.large.live,   (uint16_t)1);
+
+    /* Blocks do not overlap */
+    for (i = 0; i < 40u; i++) {
+        p = (uint8_t *)ne_gmem_find_block(&tbl, h[i])->data;
+        ASSERT_EQ(p[0], (uint8_t)i);
+        ASSERT_EQ(p[99], (uint8_t)i);
+    }
+
+    /* A freed block is handed out again, zeroed on request */
+    p = ne_gmem_find_block(&tbl, h[7])->data;
+    ASSERT_EQ(ne_gmem_free(&tbl, h[7]), NE_MEM_OK);
+    ASSERT_EQ(ne_gmem_free(&tbl, big), NE_MEM_OK);
+    h[7] = ne_gmem_alloc(&tbl, NE_GMEM_ZEROINIT, 120u, 0u);
+    q = (uint8_t *)ne_gmem_lock(&tbl, h[7]);
+    ASSERT_EQ((long long)q, (long long)p);
+    ASSERT_EQ(q[0], 0);
+    ASSERT_EQ(q[119], 0);
+    ne_gmem_unlock(&tbl, h[7]);
+
+    ASSERT_EQ(ne_gmem_pool_stats(&tbl, &st), NE_MEM_OK);
+    ASSERT_EQ(st.classes[3].chunks, (uint32_t)2);
+    ASSERT_EQ(st.classes[3].live,   (uint16_t)40);
+    ASSERT_EQ(st.classes[3].peak,   (uint16_t)40);
+    ASSERT_EQ(st.large.live, (uint16_t)0);
+    ASSERT_EQ(st.large.peak, (uint16_t)1);
+
+    /* Boundaries: 16 and 512 are pooled, 513 is not */
+    ASSERT_NE((long long)ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 1u, 0u), 0LL);
+    ASSERT_NE((long long)ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 512u, 0u), 0LL);
+    ASSERT_NE((long long)ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 513u, 0u), 0LL);
+    ASSERT_EQ(ne_gmem_pool_stats(&tbl, &st), NE_MEM_OK);
+    ASSERT_EQ(st.classes[0].live, (uint16_t)1);
+    ASSERT_EQ(st.classes[NE_GMEM_POOL_CLASSES - 1u].live, (uint16_t)1);
+    ASSERT_EQ(st.large.live, (uint16_t)1);
+
+    ASSERT_EQ(ne_gmem_pool_stats(NULL, &st), NE_MEM_ERR_NULL);
+    ASSERT_EQ(ne_gmem_pool_stats(&tbl, NULL), NE_MEM_ERR_NULL);
+
+    ne_gmem_table_free(&tbl);
+    TEST_PASS();
+}
+
+static void test_gmem_compact_pack(void)
+{
+    NEGMemTable      tbl;
+    NEGMemPoolStats  st;
+    NEGMemHandle     h[62];
+    NEGMemHandle     pin;
+    NEGMemHandle     big;
+    uint8_t         *p;
+    uint8_t         *pin_data;
+    uint16_t         i;
+
+    TEST_BEGIN("gmem_compact packs moveable pool blocks, frees chunks");
+
+    ASSERT_EQ(ne_gmem_table_init(&tbl, 128), NE_MEM_OK);
+    ASSERT_EQ(ne_gmem_set_limit(&tbl, 64u * 1024u), NE_MEM_OK);
+
+    /* Two chunks of 128-byte blocks, then free every other block */
+    for (i = 0; i < 62u; i++) {
+        h[i] = ne_gmem_alloc(&tbl, NE_GMEM_MOVEABLE, 128u, 0u);
+        ASSERT_NE((long long)h[i], (long long)NE_GMEM_HANDLE_INVALID);
+        p = (uint8_t *)ne_gmem_lock(&tbl, h[i]);
+        memset(p, (int)i, 128u);
+        ne_gmem_unlock(&tbl, h[i]);
+    }
+    pin = ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 60u, 0u);   /* 64-byte class */
+    pin_data = ne_gmem_find_block(&tbl, pin)->data;
+    big = ne_gmem_alloc(&tbl, NE_GMEM_MOVEABLE, 1000u, 0u);
+    for (i = 0; i < 62u; i += 2u)
+        ASSERT_EQ(ne_gmem_free(&tbl, h[i]), NE_MEM_OK);
+
+    ASSERT_EQ(ne_gmem_pool_stats(&tbl, &st), NE_MEM_OK);
+    ASSERT_EQ(st.footprint, 3u * NE_GMEM_POOL_CHUNK + 1000u);
+
+    /* 31 survivors fit one chunk; the fixed block keeps its own */
+    ASSERT_EQ(ne_gmem_compact(&tbl, 0),
+              64u * 1024u - (2u * NE_GMEM_POOL_CHUNK + 1000u));
+    ASSERT_EQ(ne_gmem_pool_stats(&tbl, &st), NE_MEM_OK);
+    ASSERT_EQ(st.released, (uint32_t)1);
+    ASSERT_EQ(st.footprint, 2u * NE_GMEM_POOL_CHUNK + 1000u);
+    ASSERT_EQ(ne_gmem_find_block(&tbl, pin)->data, pin_data);
+
+    for (i = 1; i < 62u; i += 2u) {
+        p = (uint8_t *)ne_gmem_lock(&tbl, h[i]);
+        ASSERT_NOT_NULL(p);
+        ASSERT_EQ(p[0], (uint8_t)i);
+        ASSERT_EQ(p[127], (uint8_t)i);
+        ne_gmem_unlock(&tbl, h[i]);
+    }
+    p = (uint8_t *)ne_gmem_lock(&tbl, big);
+    ASSERT_NOT_NULL(p);
+    ne_gmem_unlock(&tbl, big);
+
+    /* The pool still works after packing */
+    for (i = 0; i < 62u; i += 2u) {
+        h[i] = ne_gmem_alloc(&tbl, NE_GMEM_MOVEABLE, 128u, 0u);
+        ASSERT_NE((long long)h[i], (long long)NE_GMEM_HANDLE_INVALID);
+    }
+    ASSERT_EQ(ne_gmem_pool_stats(&tbl, &st), NE_MEM_OK);
+    ASSERT_EQ(st.classes[3].live, (uint16_t)62);
+
+    ne_gmem_table_free(&tbl);
+    TEST_PASS();
+}
+
+static void test_gmem_compact_discard(void)
+{
+    NEGMemTable      tbl;
+    NEGMemPoolStats  st;
+    NEGMemHandle     locked;
+    NEGMemHandle     cold;
+    NEGMemHandle     small;
+    NEGMemHandle     keep;
+
+    TEST_BEGIN("gmem_compact discards unlocked discardables to reach min");
+
+    ASSERT_EQ(ne_gmem_table_init(&tbl, 16), NE_MEM_OK);
+    ASSERT_EQ(ne_gmem_set_limit(&tbl, 16384u), NE_MEM_OK);
+    locked = ne_gmem_alloc(&tbl, NE_GMEM_MOVEABLE | NE_GMEM_DISCARDABLE,
+                           4000u, 0u);
+    cold   = ne_gmem_alloc(&tbl, NE_GMEM_MOVEABLE | NE_GMEM_DISCARDABLE,
+                           4000u, 0u);
+    small  = ne_gmem_alloc(&tbl, NE_GMEM_MOVEABLE | NE_GMEM_DISCARDABLE,
+                           64u, 0u);
+    keep   = ne_gmem_alloc(&tbl, NE_GMEM_MOVEABLE, 4000u, 0u);
+    ASSERT_NOT_NULL(ne_gmem_lock(&tbl, locked));
+    ASSERT_EQ(ne_gmem_free_space(&tbl), 16384u - 12000u - NE_GMEM_POOL_CHUNK);
+
+    /* Already enough: nothing is discarded */
+    ASSERT_EQ(ne_gmem_compact(&tbl, 100u), 16384u - 12000u - NE_GMEM_POOL_CHUNK);
+    ASSERT_EQ(ne_gmem_size(&tbl, cold), (uint32_t)4000);
+
+    /* Needs the cold block and the pool chunk; the locked one stays */
+    ASSERT_EQ(ne_gmem_compact(&tbl, 10000u), 16384u - 8000u);
+    ASSERT_EQ(ne_gmem_size(&tbl, cold), (uint32_t)0);
+    ASSERT_EQ(ne_gmem_size(&tbl, small), (uint32_t)0);
+    ASSERT_NULL(ne_gmem_lock(&tbl, cold));
+    ASSERT_EQ(ne_gmem_size(&tbl, locked), (uint32_t)4000);
+    ASSERT_EQ(ne_gmem_size(&tbl, keep), (uint32_t)4000);
+    ASSERT_EQ(ne_gmem_pool_stats(&tbl, &st), NE_MEM_OK);
+    ASSERT_EQ(st.discarded, (uint32_t)2);
+
+    /* Cannot be met: everything discardable is gone, the rest stays */
+    ASSERT_EQ(ne_gmem_compact(&tbl, 16384u), 16384u - 8000u);
+
+    /* Explicit discard respects locks; discarded handles can be freed */
+    ASSERT_EQ(ne_gmem_discard(&tbl, locked), NE_MEM_ERR_LOCKED);
+    ASSERT_EQ(ne_gmem_unlock(&tbl, locked), NE_MEM_OK);
+    ASSERT_EQ(ne_gmem_discard(&tbl, locked), NE_MEM_OK);
+    ASSERT_EQ(ne_gmem_discard(&tbl, NE_GMEM_HANDLE_INVALID),
+              NE_MEM_ERR_BAD_HANDLE);
+    ASSERT_EQ(ne_gmem_free(&tbl, cold), NE_MEM_OK);
+    ASSERT_EQ(ne_gmem_free_space(&tbl), 16384u - 4000u);
+    ASSERT_EQ(tbl.count, (uint16_t)3);
+
+    ne_gmem_table_free(&tbl);
+    TEST_PASS();
+}
+
+static void test_gmem_budget_lru(void)
+{
+    NEGMemTable      tbl;
+    NEGMemPoolStats  st;
+    NEGMemHandle     h[4];
+    NEGMemHandle     e, f, g;
+    uint16_t         i;
+    const uint16_t   disc = NE_GMEM_MOVEABLE | NE_GMEM_DISCARDABLE;
+
+    TEST_BEGIN("gmem heap limit discards least recently used blocks");
+
+    ASSERT_EQ(ne_gmem_table_init(&tbl, 16), NE_MEM_OK);
+    ASSERT_EQ(ne_gmem_set_limit(&tbl, 5000u), NE_MEM_OK);
+    for (i = 0; i < 4u; i++) {
+        h[i] = ne_gmem_alloc(&tbl, disc, 1000u, 0u);
+        ASSERT_NE((long long)h[i], (long long)NE_GMEM_HANDLE_INVALID);
+    }
+    ASSERT_EQ(tbl.lru_head, (uint16_t)0);
+
+    /* Using h[0] makes h[1] the coldest */
+    ASSERT_NOT_NULL(ne_gmem_lock(&tbl, h[0]));
+    ASSERT_EQ(ne_gmem_unlock(&tbl, h[0]), NE_MEM_OK);
+
+    e = ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 1000u, 0u);   /* fits exactly */
+    ASSERT_NE((long long)e, (long long)NE_GMEM_HANDLE_INVALID);
+    ASSERT_EQ(ne_gmem_size(&tbl, h[1]), (uint32_t)1000);
+
+    f = ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 1000u, 0u);
+    ASSERT_NE((long long)f, (long long)NE_GMEM_HANDLE_INVALID);
+    ASSERT_EQ(ne_gmem_size(&tbl, h[1]), (uint32_t)0);    /* discarded */
+    ASSERT_NOT_NULL(ne_gmem_find_block(&tbl, h[1]));     /* handle lives */
+    ASSERT_NULL(ne_gmem_lock(&tbl, h[1]));
+    ASSERT_EQ(ne_gmem_size(&tbl, h[0]), (uint32_t)1000);
+
+    /* A locked block is never discarded: h[3] goes instead of h[2] */
+    ASSERT_NOT_NULL(ne_gmem_lock(&tbl, h[2]));
+    g = ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 1000u, 0u);
+    ASSERT_NE((long long)g, (long long)NE_GMEM_HANDLE_INVALID);
+    ASSERT_EQ(ne_gmem_size(&tbl, h[2]), (uint32_t)1000);
+    ASSERT_EQ(ne_gmem_size(&tbl, h[3]), (uint32_t)0);
+
+    /* Nothing left to discard but h[0]: larger requests fail */
+    ASSERT_EQ((long long)ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 3000u, 0u),
+              (long long)NE_GMEM_HANDLE_INVALID);
+    ASSERT_EQ((long long)ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 6000u, 0u),
+              (long long)NE_GMEM_HANDLE_INVALID);
+    ASSERT_EQ(tbl.lru_head, (uint16_t)NE_GMEM_SLOT_NONE);
+    ASSERT_EQ(ne_gmem_free_space(&tbl), (uint32_t)1000);
+
+    /* Unlocked again, h[2] is the only candidate */
+    ASSERT_EQ(ne_gmem_unlock(&tbl, h[2]), NE_MEM_OK);
+    ASSERT_EQ(tbl.lru_head, (uint16_t)2);
+    ASSERT_NE((long long)ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 2000u, 0u),
+              (long long)NE_GMEM_HANDLE_INVALID);
+    ASSERT_EQ(ne_gmem_size(&tbl, h[2]), (uint32_t)0);
+    ASSERT_EQ(ne_gmem_pool_stats(&tbl, &st), NE_MEM_OK);
+    ASSERT_EQ(st.discarded, (uint32_t)4);
+    ASSERT_EQ(st.footprint, (uint32_t)5000);
+
+    ne_gmem_table_free(&tbl);
+    TEST_PASS();
+}
+
+static void test_gmem_budget_pool(void)
+{
+    NEGMemTable      tbl;
+    NEGMemPoolStats  st;
+    NEGMemHandle     small[15];
+    NEGMemHandle     keep;
+    NEGMemHandle     big;
+    uint16_t         i;
+
+    TEST_BEGIN("gmem heap limit reclaims whole chunks of discarded blocks");
+
+    ASSERT_EQ(ne_gmem_table_init(&tbl, 32), NE_MEM_OK);
+    ASSERT_EQ(ne_gmem_set_limit(&tbl, 2u * NE_GMEM_POOL_CHUNK), NE_MEM_OK);
+
+    /* 15 blocks fill one chunk of the 256-byte class */
+    for (i = 0; i < 15u; i++) {
+        small[i] = ne_gmem_alloc(&tbl, NE_GMEM_DISCARDABLE, 200u, 0u);
+        ASSERT_NE((long long)small[i], (long long)NE_GMEM_HANDLE_INVALID);
+    }
+    keep = ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 300u, 0u);
+    ASSERT_NE((long long)keep, (long long)NE_GMEM_HANDLE_INVALID);
+    ASSERT_EQ(ne_gmem_free_space(&tbl), (uint32_t)0);
+
+    /* A 2000-byte block needs the whole 256-byte chunk back */
+    big = ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 2000u, 0u);
+    ASSERT_NE((long long)big, (long long)NE_GMEM_HANDLE_INVALID);
+    for (i = 0; i < 15u; i++)
+        ASSERT_EQ(ne_gmem_size(&tbl, small[i]), (uint32_t)0);
+    ASSERT_EQ(ne_gmem_size(&tbl, keep), (uint32_t)300);
+
+    ASSERT_EQ(ne_gmem_pool_stats(&tbl, &st), NE_MEM_OK);
+    ASSERT_EQ(st.discarded, (uint32_t)15);
+    ASSERT_EQ(st.released, (uint32_t)1);
+    ASSERT_EQ(st.footprint, NE_GMEM_POOL_CHUNK + 2000u);
+
+    /* Discarded handles are freed normally */
+    for (i = 0; i < 15u; i++)
+        ASSERT_EQ(ne_gmem_free(&tbl, small[i]), NE_MEM_OK);
+    ASSERT_EQ(tbl.count, (uint16_t)2);
+
+    ne_gmem_table_free(&tbl);
+    TEST_PASS();
+}
+
+static void test_gmem_handle_lookup(void)
+{
+    NEGMemTable   tbl;
+    NEGMemHandle  h[40];
+    NEGMemHandle  big;
+    uint8_t      *p;
+    uint8_t      *q;
+    uint16_t      i;
+
+    TEST_BEGIN("gmem_handle resolves base and interior pointers");
+
+    ASSERT_EQ(ne_gmem_table_init(&tbl, 64), NE_MEM_OK);
+    for (i = 0; i < 40u; i++) {
+        h[i] = ne_gmem_alloc(&tbl, NE_GMEM_MOVEABLE | NE_GMEM_DISCARDABLE,
+                             (uint32_t)(16u + 8u * i), 0u);
+        ASSERT_NE((long long)h[i], (long long)NE_GMEM_HANDLE_INVALID);
+    }
+    big = ne_gmem_alloc(&tbl, NE_GMEM_FIXED, 3000u, 0u);
+    ASSERT_EQ(tbl.addr_count, (uint16_t)41);
+
+    for (i = 0; i < 40u; i++) {
+        p = ne_gmem_find_block(&tbl, h[i])->data;
+        ASSERT_EQ(ne_gmem_handle(&tbl, p), h[i]);
+        ASSERT_EQ(ne_gmem_handle(&tbl, p + 15u + 8u * i), h[i]);
+    }
+    p = ne_gmem_find_block(&tbl, big)->data;
+    ASSERT_EQ(ne_gmem_handle(&tbl, p + 2999u), big);
+    ASSERT_EQ(ne_gmem_handle(&tbl, p + 3000u), NE_GMEM_HANDLE_INVALID);
+    ASSERT_EQ(ne_gmem_handle(&tbl, NULL), NE_GMEM_HANDLE_INVALID);
+
+    /* Freed and discarded blocks drop out of the index */
+    q = ne_gmem_find_block(&tbl, h[5])->data;
+    ASSERT_EQ(ne_gmem_free(&tbl, h[5]), NE_MEM_OK);
+    ASSERT_EQ(ne_gmem_handle(&tbl, q), NE_GMEM_HANDLE_INVALID);
+    q = ne_gmem_find_block(&tbl, h[6])->data;
+    ASSERT_EQ(ne_gmem_discard(&tbl, h[6]), NE_MEM_OK);
+    ASSERT_EQ(ne_gmem_handle(&tbl, q), NE_GMEM_HANDLE_INVALID);
+    ASSERT_EQ(tbl.addr_count, (uint16_t)39);
+
+    /* After compaction moves blocks, lookups follow the new addresses */
+    for (i = 0; i < 40u; i += 3u) {
+        if (i != 6u)
+            ne_gmem_free(&tbl, h[i]);
+    }
+    ne_gmem_compact(&tbl, 0);
+    for (i = 1; i < 40u; i++) {
+        if (i % 3u == 0 || i == 5u || i == 6u)
+            continue;
+        p = ne_gmem_find_block(&tbl, h[i])->data;
+        ASSERT_EQ(ne_gmem_handle(&tbl, p + 8u), h[i]);
+    }
+
+    ne_gmem_table_free(&tbl);
+    TEST_PASS();
+}
+
 /* =========================================================================
  * GMEM lock / unlock
  * ===================================================================== */
@@ -983,6 +1412,43 @@ static void test_lmem_free_bad_handle(void)
  * LMEM lock / unlock
  * ===================================================================== */
 
+static void test_lmem_handle_lookup(void)
+{
+    NELMemHeap    heap;
+    NELMemHandle  h[8];
+    uint8_t      *p;
+    uint16_t      i;
+
+    TEST_BEGIN("lmem_handle resolves interior pointers across realloc");
+
+    ASSERT_EQ(ne_lmem_heap_init(&heap), NE_MEM_OK);
+    for (i = 0; i < 8u; i++) {
+        h[i] = ne_lmem_alloc(&heap, NE_LMEM_FIXED, (uint16_t)(32u + i));
+        ASSERT_NE((long long)h[i], (long long)NE_LMEM_HANDLE_INVALID);
+    }
+    for (i = 0; i < 8u; i++) {
+        p = (uint8_t *)ne_lmem_lock(&heap, h[i]);
+        ASSERT_EQ(ne_lmem_handle(&heap, p + 31u + i), h[i]);
+        ne_lmem_unlock(&heap, h[i]);
+    }
+
+    ASSERT_EQ(ne_lmem_free(&heap, h[2]), NE_MEM_OK);
+    ASSERT_EQ(ne_lmem_realloc(&heap, h[4], 500u, 0u), h[4]);
+    p = (uint8_t *)ne_lmem_lock(&heap, h[4]);
+    ASSERT_EQ(ne_lmem_handle(&heap, p + 499u), h[4]);
+    ne_lmem_unlock(&heap, h[4]);
+    for (i = 0; i < 8u; i++) {
+        if (i == 2u)
+            continue;
+        p = (uint8_t *)ne_lmem_lock(&heap, h[i]);
+        ASSERT_EQ(ne_lmem_handle(&heap, p), h[i]);
+        ne_lmem_unlock(&heap, h[i]);
+    }
+
+    ne_lmem_heap_free(&heap);
+    TEST_PASS();
+}
+
 static void test_lmem_lock_unlock(void)
 {
     NELMemHeap   heap;
@@ -1069,6 +1535,14 @@ int main(void)
     test_gmem_alloc_null_zero();
     test_gmem_free_basic();
     test_gmem_free_bad_handle();
+    test_gmem_stale_handle();
+    test_gmem_free_list();
+    test_gmem_pool_classes();
+    test_gmem_compact_pack();
+    test_gmem_compact_discard();
+    test_gmem_budget_lru();
+    test_gmem_budget_pool();
+    test_gmem_handle_lookup();
 
     printf("\n--- GMEM lock / unlock ---\n");
     test_gmem_lock_unlock();
@@ -1091,6 +1565,7 @@ int main(void)
 
     printf("\n--- LMEM lock / unlock ---\n");
     test_lmem_lock_unlock();
+    test_lmem_handle_lookup();
     test_mem_strerror();
 
     printf("\n=== Results: %d/%d passed",
@@ -0,0 +1,581 @@
+/*
+ * test_ne_validate.c - Tests for the one-pass NE image integrity check
+ *
+ * Each test builds the two-segment NE image used by test_ne_reloc.c,
+ * optionally corrupts one structure and checks the verdict and report of
+ * ne_validate_image().  The trusted-path tests then parse, load and
+ * relocate an image that passed ne_validate_parsed().
+ *
+ * Build with:
+ *   wcc -ml -za99 -wx -d2 -i=../src ../src/ne_parser.c ../src/ne_loader.c
+ *       ../src/ne_reloc.c ../src/ne_validate.c test_ne_validate.c
+ *   wlink system dos name test_ne_validate.exe file test_ne_validate.obj,ne_parser.obj,ne_loader.obj,ne_reloc.obj,ne_validate.obj
+ */
+
+#include "../src/ne_parser.h"
+#include "../src/ne_loader.h"
+#include "../src/ne_reloc.h"
+#include "../src/ne_validate.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------
+ * Minimal test framework (mirrors test_ne_reloc.c)
+ * ---------------------------------------------------------------------- */
+
+static int g_tests_run    = 0;
+static int g_tests_passed = 0;
+static int g_tests_failed = 0;
+
+#define TEST_BEGIN(name) \
+    do { \
+        g_tests_run++; \
+        printf("  %-60s ", (name)); \
+        fflush(stdout); \
+    } while (0)
+
+#define TEST_PASS() \
+    do { \
+        g_tests_passed++; \
+        printf("PASS\n"); \
+    } while (0)
+
+#define TEST_FAIL(msg) \
+    do { \
+        g_tests_failed++; \
+        printf("FAIL - %s (line %d)\n", (msg), __LINE__); \
+        return; \
+    } while (0)
+
+#define ASSERT_EQ(a, b) \
+    do { \
+        if ((a) != (b)) { \
+            g_tests_failed++; \
+            printf("FAIL - expected %ld got %ld (line %d)\n", \
+                   (long)(b), (long)(a), __LINE__); \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_NE(a, b) \
+    do { \
+        if ((a) == (b)) { \
+            g_tests_failed++; \
+            printf("FAIL - unexpected equal value %ld (line %d)\n", \
+                   (long)(a), __LINE__); \
+            return; \
+        } \
+    } while (0)
+
+#define ASSERT_NOT_NULL(p) \
+    do { \
+        if ((p) == NULL) { \
+            g_tests_failed++; \
+            printf("FAIL - unexpected NULL pointer (line %d)\n", __LINE__); \
+            return; \
+        } \
+    } while (0)
+
+/* -------------------------------------------------------------------------
+ * Binary image builder helpers
+ * ---------------------------------------------------------------------- */
+
+#define MZ_SIZE       64u
+#define NE_HDR_SIZE   64u
+#define SEG_DESC_SIZE  8u
+
+/* Align shift used throughout: 4 → 16-byte logical sectors */
+#define TEST_ALIGN_SHIFT  4u
+#define TEST_SECTOR_SIZE  16u   /* 1 << TEST_ALIGN_SHIFT */
+
+/*
+ * Segment layout (all file-absolute byte offsets):
+ *
+ *   0x000 - 0x03F : MZ header
+ *   0x040 - 0x07F : NE header
+ *   0x080 - 0x087 : Segment descriptor 0 (CODE, with NE_SEG_RELOC)
+ *   0x088 - 0x08F : Segment descriptor 1 (DATA, no reloc)
+ *   0x090         : other-tables placeholder (all tables at same offset)
+ *   ... padding ...
+ *   0x0A0         : CODE segment content (SEG_CONTENT_LEN bytes)
+ *                   sector 10 = 10 * 16 = 0xA0
+ *   0x0B0         : relocation block for CODE segment
+ *                   [0..1] : uint16_t record count
+ *                   [2..2+count*8-1] : raw relocation records
+ *   0x0D0         : DATA segment content (SEG_CONTENT_LEN bytes)
+ *                   sector 13 = 13 * 16 = 0xD0
+ *
+ * Total file size: 0xD0 + SEG_CONTENT_LEN = 0xE0
+ *
+ * With up to 3 relocation records the reloc block is at most
+ *   2 + 3*8 = 26 bytes (0xB0 .. 0xC9), comfortably before DATA at 0xD0.
+ */
+#define SEG_CONTENT_LEN  16u
+#define SEG1_SECTOR      10u   /* CODE segment: byte 0x0A0 */
+#define SEG2_SECTOR      13u   /* DATA segment: byte 0x0D0 */
+#define RELOC_BLOCK_OFF  (SEG1_SECTOR * TEST_SECTOR_SIZE + SEG_CONTENT_LEN)
+                               /* = 0x0B0 */
+#define TOTAL_FILE_SIZE  (SEG2_SECTOR * TEST_SECTOR_SIZE + SEG_CONTENT_LEN)
+                               /* = 0x0E0 = 224 */
+
+static void put_u16(uint8_t *buf, size_t off, uint16_t v)
+{
+    buf[off]     = (uint8_t)(v & 0xFF);
+    buf[off + 1] = (uint8_t)((v >> 8) & 0xFF);
+}
+
+static void put_u32(uint8_t *buf, size_t off, uint32_t v)
+{
+    buf[off]     = (uint8_t)(v & 0xFF);
+    buf[off + 1] = (uint8_t)((v >>  8) & 0xFF);
+    buf[off + 2] = (uint8_t)((v >> 16) & 0xFF);
+    buf[off + 3] = (uint8_t)((v >> 24) & 0xFF);
+}
+
+/*
+ * build_reloc_ne_image
+ *
+ * Build a 224-byte NE image containing:
+ *   - Segment 0 (CODE): SEG_CONTENT_LEN bytes starting at sector SEG1_SECTOR,
+ *     with the NE_SEG_RELOC flag set.  Content is copied from seg1_content[].
+ *   - Segment 1 (DATA): SEG_CONTENT_LEN bytes starting at sector SEG2_SECTOR,
+ *     filled with seg2_fill.  No relocation records.
+ *   - A relocation block for segment 0 at RELOC_BLOCK_OFF, containing
+ *     reloc_count records taken from reloc_recs[].  Each record is 8 bytes;
+ *     the caller supplies raw bytes (address_type, reloc_type, offset16,
+ *     ref1_lo, ref1_hi, ref2_lo, ref2_hi, pad).
+ *
+ * Returns a heap-allocated buffer of TOTAL_FILE_SIZE bytes; caller must free().
+ */
+static uint8_t *build_reloc_ne_image(const uint8_t *seg1_content,
+                                      uint8_t        seg2_fill,
+                                      const uint8_t *reloc_recs,
+                                      uint16_t       reloc_count)
+{
+    uint8_t  *buf;
+    uint8_t  *ne;
+    uint8_t  *sd;
+    uint16_t  seg_tbl_rel;
+    uint16_t  other_rel;
+    uint32_t  seg1_abs;
+    uint32_t  seg2_abs;
+
+    buf = (uint8_t *)calloc(1, TOTAL_FILE_SIZE);
+    if (!buf) return NULL;
+
+    seg_tbl_rel = (uint16_t)NE_HDR_SIZE;                       /* 0x40 */
+    other_rel   = (uint16_t)(NE_HDR_SIZE + 2u * SEG_DESC_SIZE);/* 0x50 */
+    seg1_abs    = (uint32_t)SEG1_SECTOR << TEST_ALIGN_SHIFT;   /* 0xA0 */
+    seg2_abs    = (uint32_t)SEG2_SECTOR << TEST_ALIGN_SHIFT;   /* 0xD0 */
+
+    /* ---- MZ header ---- */
+    put_u16(buf, 0x00, MZ_MAGIC);
+    put_u32(buf, 0x3C, (uint32_t)MZ_SIZE);
+
+    /* ---- NE header ---- */
+    ne = buf + MZ_SIZE;
+    put_u16(ne, 0x00, NE_MAGIC);
+    ne[0x02] = 5;
+    ne[0x03] = 0;
+    put_u16(ne, 0x04, other_rel);     /* entry_table_offset  */
+    put_u16(ne, 0x06, 0);             /* entry_table_length  */
+    ne[0x0C] = NE_PFLAG_MULTIDATA;
+    ne[0x0D] = NE_AFLAG_WINAPI;
+    put_u16(ne, 0x0E, 2);             /* auto_data_seg = 2   */
+    put_u16(ne, 0x10, 0x0200);        /* heap_size           */
+    put_u16(ne, 0x12, 0x0400);        /* stack_size          */
+    put_u16(ne, 0x14, 0x0000);        /* initial_ip = 0      */
+    put_u16(ne, 0x16, 1);             /* initial_cs = seg 1  */
+    put_u16(ne, 0x18, 0x0400);        /* initial_sp          */
+    put_u16(ne, 0x1A, 2);             /* initial_ss = seg 2  */
+    put_u16(ne, 0x1C, 2);             /* segment_count = 2   */
+    put_u16(ne, 0x1E, 0);             /* module_ref_count    */
+    put_u16(ne, 0x20, 0);             /* nonresident_name_size */
+    put_u16(ne, 0x22, seg_tbl_rel);   /* segment_table_offset */
+    put_u16(ne, 0x24, other_rel);
+    put_u16(ne, 0x26, other_rel);
+    put_u16(ne, 0x28, other_rel);
+    put_u16(ne, 0x2A, other_rel);
+    put_u32(ne, 0x2C, 0);
+    put_u16(ne, 0x30, 0);
+    put_u16(ne, 0x32, (uint16_t)TEST_ALIGN_SHIFT);
+    put_u16(ne, 0x34, 0);
+    ne[0x36] = NE_OS_WINDOWS;
+    ne[0x37] = 0;
+    put_u16(ne, 0x38, 0);
+    put_u16(ne, 0x3A, 0);
+    put_u16(ne, 0x3C, 0);
+    ne[0x3E] = 0x0A;
+    ne[0x3F] = 0x03;
+
+    /* ---- Segment descriptor 0: CODE with NE_SEG_RELOC ---- */
+    sd = ne + seg_tbl_rel;
+    put_u16(sd, 0, (uint16_t)SEG1_SECTOR);          /* sector offset       */
+    put_u16(sd, 2, (uint16_t)SEG_CONTENT_LEN);      /* length in file      */
+    put_u16(sd, 4, (uint16_t)NE_SEG_RELOC);         /* flags: CODE + RELOC */
+    put_u16(sd, 6, (uint16_t)SEG_CONTENT_LEN);      /* min_alloc           */
+
+    /* ---- Segment descriptor 1: DATA (no reloc) ---- */
+    sd = ne + seg_tbl_rel + SEG_DESC_SIZE;
+    put_u16(sd, 0, (uint16_t)SEG2_SECTOR);
+    put_u16(sd, 2, (uint16_t)SEG_CONTENT_LEN);
+    put_u16(sd, 4, (uint16_t)NE_SEG_DATA);          /* flags: DATA         */
+    put_u16(sd, 6, (uint16_t)SEG_CONTENT_LEN);
+
+    /* ---- CODE segment content ---- */
+    if (seg1_content)
+        memcpy(buf + seg1_abs, seg1_content, SEG_CONTENT_LEN);
+
+    /* ---- DATA segment content ---- */
+    memset(buf + seg2_abs, seg2_fill, SEG_CONTENT_LEN);
+
+    /* ---- Relocation block for segment 0 ---- */
+    put_u16(buf, RELOC_BLOCK_OFF, reloc_count);
+    if (reloc_recs && reloc_count > 0)
+        memcpy(buf + RELOC_BLOCK_OFF + 2u, reloc_recs,
+               (size_t)reloc_count * 8u);
+
+    return buf;
+}
+
+/*
+ * Convenience: encode one raw relocation record into an 8-byte buffer.
+ */
+static void encode_reloc(uint8_t *dst,
+                          uint8_t  addr_type,
+                          uint8_t  reloc_type,
+                          uint16_t target_off,
+                          uint16_t ref1,
+                          uint16_t ref2)
+{
+    dst[0] = addr_type;
+    dst[1] = reloc_type;
+    dst[2] = (uint8_t)(target_off & 0xFF);
+    dst[3] = (uint8_t)((target_off >> 8) & 0xFF);
+    dst[4] = (uint8_t)(ref1 & 0xFF);
+    dst[5] = (uint8_t)((ref1 >> 8) & 0xFF);
+    dst[6] = (uint8_t)(ref2 & 0xFF);
+    dst[7] = (uint8_t)((ref2 >> 8) & 0xFF);
+}
+
+/* Offset of the NE header field 'f' and of segment descriptor 'i' */
+#define NE_FIELD(f)   (MZ_SIZE + (f))
+#define SEG_DESC(i)   (MZ_SIZE + NE_HDR_SIZE + (i) * SEG_DESC_SIZE)
+
+/* One internal SEG16 record targeting offset 0 of the CODE segment */
+static uint8_t *build_valid_image(void)
+{
+    uint8_t seg1[SEG_CONTENT_LEN];
+    uint8_t recs[8];
+
+    memset(seg1, 0, sizeof(seg1));
+    seg1[0] = 0xFF; seg1[1] = 0xFF;   /* chain terminator */
+    encode_reloc(recs, NE_RELOC_ADDR_SEG16, NE_RELOC_TYPE_INTERNAL,
+                 0x0000, 2, 0);
+    return build_reloc_ne_image(seg1, 0x55, recs, 1);
+}
+
+/* -------------------------------------------------------------------------
+ * Tests
+ * ---------------------------------------------------------------------- */
+
+/* 1 - NULL image is rejected; NULL report is allowed */
+static void test_null_args(void)
+{
+    NEValidateReport rep;
+    uint8_t *buf;
+
+    TEST_BEGIN("NULL image rejected, NULL report accepted");
+    ASSERT_EQ(ne_validate_image(NULL, 0, &rep), NE_VALIDATE_ERR_NULL);
+    ASSERT_EQ(rep.status, NE_VALIDATE_ERR_NULL);
+
+    buf = build_valid_image();
+    ASSERT_NOT_NULL(buf);
+    ASSERT_EQ(ne_validate_image(buf, TOTAL_FILE_SIZE, NULL), NE_VALIDATE_OK);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 2 - A well-formed image passes and the report counts what was checked */
+static void test_valid_image(void)
+{
+    NEValidateReport rep;
+    uint8_t *buf;
+
+    TEST_BEGIN("well-formed image passes with segment / reloc counts");
+    buf = build_valid_image();
+    ASSERT_NOT_NULL(buf);
+
+    ASSERT_EQ(ne_validate_image(buf, TOTAL_FILE_SIZE, &rep), NE_VALIDATE_OK);
+    ASSERT_EQ(rep.status, NE_VALIDATE_OK);
+    ASSERT_EQ(rep.segments, 2);
+    ASSERT_EQ(rep.relocs, 1);
+    ASSERT_EQ(rep.fail_segment, 0xFFFF);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 3 - Bad MZ / NE signatures and an oversized align shift */
+static void test_bad_header(void)
+{
+    uint8_t *buf;
+
+    TEST_BEGIN("bad MZ / NE signature or align shift -> ERR_HEADER");
+    buf = build_valid_image();
+    ASSERT_NOT_NULL(buf);
+
+    ASSERT_EQ(ne_validate_image(buf, 32, NULL), NE_VALIDATE_ERR_HEADER);
+
+    buf[0] = 'X';
+    ASSERT_EQ(ne_validate_image(buf, TOTAL_FILE_SIZE, NULL),
+              NE_VALIDATE_ERR_HEADER);
+    put_u16(buf, 0x00, MZ_MAGIC);
+
+    buf[MZ_SIZE] = 'X';
+    ASSERT_EQ(ne_validate_image(buf, TOTAL_FILE_SIZE, NULL),
+              NE_VALIDATE_ERR_HEADER);
+    put_u16(buf, MZ_SIZE, NE_MAGIC);
+
+    put_u16(buf, NE_FIELD(0x32), 16);
+    ASSERT_EQ(ne_validate_image(buf, TOTAL_FILE_SIZE, NULL),
+              NE_VALIDATE_ERR_HEADER);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 4 - Segment table past the end of the image */
+static void test_table_out_of_bounds(void)
+{
+    NEValidateReport rep;
+    uint8_t *buf;
+
+    TEST_BEGIN("segment table outside the image -> ERR_TABLE");
+    buf = build_valid_image();
+    ASSERT_NOT_NULL(buf);
+
+    put_u16(buf, NE_FIELD(0x22), 0x00F0);
+    ASSERT_EQ(ne_validate_image(buf, TOTAL_FILE_SIZE, &rep),
+              NE_VALIDATE_ERR_TABLE);
+    ASSERT_EQ(rep.fail_offset, MZ_SIZE + 0x00F0u);
+    ASSERT_EQ(rep.fail_segment, 0xFFFF);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 5 - Segment sector range past the end of the image (with align_shift) */
+static void test_segment_out_of_bounds(void)
+{
+    NEValidateReport rep;
+    uint8_t *buf;
+
+    TEST_BEGIN("segment data past end of image -> ERR_SEGMENT");
+    buf = build_valid_image();
+    ASSERT_NOT_NULL(buf);
+
+    /* DATA segment at sector 14 = 0xE0: starts exactly at end of file */
+    put_u16(buf, SEG_DESC(1), 14);
+    ASSERT_EQ(ne_validate_image(buf, TOTAL_FILE_SIZE, &rep),
+              NE_VALIDATE_ERR_SEGMENT);
+    ASSERT_EQ(rep.fail_segment, 1);
+    ASSERT_EQ(rep.fail_offset, 0xE0u);
+    ASSERT_EQ(rep.segments, 2);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 6 - Relocation block or record invalid */
+static void test_bad_relocs(void)
+{
+    NEValidateReport rep;
+    uint8_t *buf;
+
+    TEST_BEGIN("bad reloc count / type / target / segment -> ERR_RELOC");
+    buf = build_valid_image();
+    ASSERT_NOT_NULL(buf);
+
+    /* record count running past the end of the image */
+    put_u16(buf, RELOC_BLOCK_OFF, 40);
+    ASSERT_EQ(ne_validate_image(buf, TOTAL_FILE_SIZE, &rep),
+              NE_VALIDATE_ERR_RELOC);
+    ASSERT_EQ(rep.fail_segment, 0);
+    ASSERT_EQ(rep.fail_offset, RELOC_BLOCK_OFF);
+    put_u16(buf, RELOC_BLOCK_OFF, 1);
+
+    /* unknown address type */
+    buf[RELOC_BLOCK_OFF + 2u] = 0x07;
+    ASSERT_EQ(ne_validate_image(buf, TOTAL_FILE_SIZE, &rep),
+              NE_VALIDATE_ERR_RELOC);
+    ASSERT_EQ(rep.fail_offset, RELOC_BLOCK_OFF + 2u);
+    buf[RELOC_BLOCK_OFF + 2u] = NE_RELOC_ADDR_SEG16;
+
+    /* internal target segment beyond the segment table */
+    put_u16(buf, RELOC_BLOCK_OFF + 6u, 3);
+    ASSERT_EQ(ne_validate_image(buf, TOTAL_FILE_SIZE, NULL),
+              NE_VALIDATE_ERR_RELOC);
+    put_u16(buf, RELOC_BLOCK_OFF + 6u, 2);
+
+    /* first target does not fit the 16-byte segment */
+    put_u16(buf, RELOC_BLOCK_OFF + 4u, SEG_CONTENT_LEN - 1u);
+    ASSERT_EQ(ne_validate_image(buf, TOTAL_FILE_SIZE, NULL),
+              NE_VALIDATE_ERR_RELOC);
+
+    /* imported ordinal with no module-reference table */
+    put_u16(buf, RELOC_BLOCK_OFF + 4u, 0);
+    buf[RELOC_BLOCK_OFF + 3u] = NE_RELOC_TYPE_IMP_ORD;
+    ASSERT_EQ(ne_validate_image(buf, TOTAL_FILE_SIZE, NULL),
+              NE_VALIDATE_ERR_RELOC);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 7 - Validated image: trusted parse / load / apply matches the checked path */
+static void test_trusted_apply(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    NERelocContext  rctx;
+    uint8_t *buf;
+
+    TEST_BEGIN("trusted parse / load / apply patches like checked path");
+    buf = build_valid_image();
+    ASSERT_NOT_NULL(buf);
+
+    ASSERT_EQ(ne_parse_buffer(buf, TOTAL_FILE_SIZE, &parser), NE_OK);
+    ASSERT_EQ(ne_parser_trusted(&parser, buf, TOTAL_FILE_SIZE), 0);
+    ASSERT_EQ(ne_validate_parsed(&parser, buf, TOTAL_FILE_SIZE, NULL),
+              NE_VALIDATE_OK);
+    ASSERT_NE(ne_parser_trusted(&parser, buf, TOTAL_FILE_SIZE), 0);
+    ASSERT_EQ(ne_load_buffer(buf, TOTAL_FILE_SIZE, &parser, &loader),
+              NE_LOAD_OK);
+    ASSERT_EQ(ne_reloc_parse(buf, TOTAL_FILE_SIZE, &parser, &rctx),
+              NE_RELOC_OK);
+    ASSERT_EQ(rctx.count, 1);
+    ASSERT_EQ(ne_reloc_apply(&loader, &rctx, &parser, NULL, NULL),
+              NE_RELOC_OK);
+    ASSERT_EQ(loader.segments[0].data[0], 0x02);
+    ASSERT_EQ(loader.segments[0].data[1], 0x00);
+
+    ne_reloc_free(&rctx);
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 8 - Chain links are still checked on a trusted image */
+static void test_trusted_chain_checked(void)
+{
+    NEParserContext parser;
+    NELoaderContext loader;
+    NERelocContext  rctx;
+    uint8_t *buf;
+
+    TEST_BEGIN("trusted image still bounds-checks chain links");
+    buf = build_valid_image();
+    ASSERT_NOT_NULL(buf);
+    /* first link points past the segment */
+    put_u16(buf, (uint32_t)SEG1_SECTOR << TEST_ALIGN_SHIFT, 0x0100);
+
+    ASSERT_EQ(ne_parse_buffer(buf, TOTAL_FILE_SIZE, &parser), NE_OK);
+    ASSERT_EQ(ne_validate_parsed(&parser, buf, TOTAL_FILE_SIZE, NULL),
+              NE_VALIDATE_OK);
+    ASSERT_EQ(ne_load_buffer(buf, TOTAL_FILE_SIZE, &parser, &loader),
+              NE_LOAD_OK);
+    ASSERT_EQ(ne_reloc_parse(buf, TOTAL_FILE_SIZE, &parser, &rctx),
+              NE_RELOC_OK);
+    ASSERT_EQ(ne_reloc_apply(&loader, &rctx, &parser, NULL, NULL),
+              NE_RELOC_ERR_BAD_SEG);
+
+    ne_reloc_free(&rctx);
+    ne_loader_free(&loader);
+    ne_free(&parser);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 9 - The verdict only covers the bytes that were validated */
+static void test_trust_tied_to_image(void)
+{
+    NEParserContext parser;
+    NEParserContext other;
+    NELoaderContext loader;
+    NERelocContext  rctx;
+    uint8_t *buf;
+    uint8_t *copy;
+
+    TEST_BEGIN("trusted verdict does not carry over to other bytes");
+    buf = build_valid_image();
+    ASSERT_NOT_NULL(buf);
+    copy = (uint8_t *)malloc(TOTAL_FILE_SIZE);
+    ASSERT_NOT_NULL(copy);
+    memcpy(copy, buf, TOTAL_FILE_SIZE);
+
+    ASSERT_EQ(ne_parse_buffer(buf, TOTAL_FILE_SIZE, &parser), NE_OK);
+    ASSERT_EQ(ne_validate_parsed(&parser, buf, TOTAL_FILE_SIZE, NULL),
+              NE_VALIDATE_OK);
+    ASSERT_EQ(ne_parser_trusted(&parser, copy, TOTAL_FILE_SIZE), 0);
+    ASSERT_EQ(ne_parser_trusted(&parser, buf, TOTAL_FILE_SIZE - 1u), 0);
+
+    /* A truncated view of the validated image is checked again */
+    ASSERT_EQ(ne_load_buffer(buf, TOTAL_FILE_SIZE - 1u, &parser, &loader),
+              NE_LOAD_ERR_IO);
+    ASSERT_EQ(ne_reloc_parse(buf, (size_t)RELOC_BLOCK_OFF + 4u,
+                             &parser, &rctx), NE_RELOC_ERR_IO);
+
+    /* The verdict is inherited, and dropped by a failed sweep */
+    ASSERT_EQ(ne_parse_buffer(buf, TOTAL_FILE_SIZE, &other), NE_OK);
+    ne_validate_inherit(&other, &parser);
+    ASSERT_NE(ne_parser_trusted(&other, buf, TOTAL_FILE_SIZE), 0);
+    ASSERT_NE(ne_validate_parsed(&other, buf, 16u, NULL), NE_VALIDATE_OK);
+    ASSERT_EQ(ne_parser_trusted(&other, buf, TOTAL_FILE_SIZE), 0);
+
+    ne_free(&other);
+    ne_free(&parser);
+    free(copy);
+    free(buf);
+    TEST_PASS();
+}
+
+/* 10 - ne_validate_strerror covers all known error codes */
+static void test_strerror(void)
+{
+    TEST_BEGIN("ne_validate_strerror returns non-NULL for all codes");
+    ASSERT_NOT_NULL(ne_validate_strerror(NE_VALIDATE_OK));
+    ASSERT_NOT_NULL(ne_validate_strerror(NE_VALIDATE_ERR_NULL));
+    ASSERT_NOT_NULL(ne_validate_strerror(NE_VALIDATE_ERR_HEADER));
+    ASSERT_NOT_NULL(ne_validate_strerror(NE_VALIDATE_ERR_TABLE));
+    ASSERT_NOT_NULL(ne_validate_strerror(NE_VALIDATE_ERR_SEGMENT));
+    ASSERT_NOT_NULL(ne_validate_strerror(NE_VALIDATE_ERR_RELOC));
+    ASSERT_NOT_NULL(ne_validate_strerror(-99));
+    TEST_PASS();
+}
+
+/* -------------------------------------------------------------------------
+ * Main
+ * ---------------------------------------------------------------------- */
+
+int main(void)
+{
+    printf("=== NE Image Validation Tests ===\n\n");
+
+    test_null_args();
+    test_valid_image();
+    test_bad_header();
+    test_table_out_of_bounds();
+    test_segment_out_of_bounds();
+    test_bad_relocs();
+    test_trusted_apply();
+    test_trusted_chain_checked();
+    test_trust_tied_to_image();
+    test_strerror();
+
+    printf("\n=== Results: %d/%d passed", g_tests_passed, g_tests_run);
+    if (g_tests_failed)
+        printf(", %d FAILED", g_tests_failed);
+    printf(" ===\n");
+
+    return (g_tests_failed == 0) ? 0 : 1;
+}